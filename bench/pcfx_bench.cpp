@@ -0,0 +1,584 @@
+/* Headless benchmark for the PC-FX core: loads a disc image, runs a number of frames through the libretro entry points
+ * with stub callbacks and no frontend, and reports the frame rate, where the time went(see mednafen/pcfx/profile.h), and
+ * how many heap allocations, device event dispatches and KING graphics runs were made while running.  Build with
+ * "make bench".
+ *
+ *  mednafen_pcfx_bench [options] <disc image(.cue, .ccd, .chd, .toc, .m3u)>
+ *
+ *   -n <frames>      Frames to run and time(default 3600).
+ *   -w <frames>      Frames to run before timing starts(default 0).
+ *   -b <dir>         System directory, containing the BIOS(default ".").  Backup RAM is also loaded from and saved
+ *                    to it, which affects emulation, so keep it fixed between runs that are to be compared.
+ *   -o <key>=<value> Set a core option, e.g. -o pcfx_cpu_emulation=accurate; may be repeated.
+ *   -i <file>        Replay the pad input in <file>.
+ *   -s <seed>        Press pseudo-random buttons derived from <seed>(ignored with -i).
+ *   -r <file>        Record the pad input that was used to <file>, in the format -i reads.
+ *   -j <file>        Also write the subsystem times to <file> as JSON(ticks are nanoseconds).
+ *   -k <n>           Tell the core video is disabled(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE) for <n> frames out of
+ *                    every <n> + 1, so that it skips drawing them; the audio hash shouldn't change.
+ *   -m <n>           Load the disc into <n> machines(see PCFX_CreateInstance()) and run them interleaved, one frame of
+ *                    each in turn, all with the same input; each one's hashes should match those of a single machine.
+ *                    Per-frame figures are then per round of all of them.
+ *   -v               Show the core's log messages.
+ *
+ * Input files have one line per frame(warm-up frames included), each with the RETRO_DEVICE_ID_JOYPAD_* button mask
+ * of port 1 and of port 2 in hex; lines starting with '#' are skipped, and all buttons are released after the last
+ * line.  Video and audio hashes are printed too, per machine, so runs with the same disc, options and input can be
+ * checked for determinism.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <libretro.h>
+#include <retro_inline.h>
+
+#include "mednafen/mednafen-types.h"
+#include "mednafen/pcfx/pcfx.h"
+#include "mednafen/pcfx/profile.h"
+
+//
+// Allocation counting.  With glibc, malloc() and friends are interposed so that C allocations are counted too;
+// elsewhere, only C++ operator new is.  Allocations from every thread are counted, the CD read thread's included, so
+// the counters are atomic.
+//
+static std::atomic<uint64> alloc_count, alloc_bytes;
+
+static INLINE void count_alloc(size_t size)
+{
+ alloc_count.fetch_add(1, std::memory_order_relaxed);
+ alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nmemb, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+extern "C" void *malloc(size_t size)
+{
+ count_alloc(size);
+ return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+ count_alloc(nmemb * size);
+ return __libc_calloc(nmemb, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+ count_alloc(size);
+ return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+ __libc_free(ptr);
+}
+#else
+#include <new>
+
+void *operator new(size_t size)
+{
+ void *ret;
+
+ count_alloc(size);
+
+ if(!(ret = malloc(size ? size : 1)))
+  throw std::bad_alloc();
+
+ return ret;
+}
+
+void *operator new[](size_t size)
+{
+ return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+ free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+ free(ptr);
+}
+#endif
+
+// Nanoseconds, from an arbitrary starting point.
+static uint64 get_time_ns(void)
+{
+#ifdef _WIN32
+ LARGE_INTEGER freq, count;
+
+ QueryPerformanceFrequency(&freq);
+ QueryPerformanceCounter(&count);
+
+ return (uint64)((double)count.QuadPart * 1000000000.0 / freq.QuadPart);
+#else
+ struct timespec ts;
+
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+
+ return (uint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static std::string system_dir = ".";
+static std::vector<std::string> options;
+static bool verbose;
+
+struct MachineOutput
+{
+ MachineOutput() : video_hash(14695981039346656037ULL), audio_hash(14695981039346656037ULL), audio_frames(0) { }
+
+ uint64 video_hash, audio_hash;
+ uint64 audio_frames;
+};
+
+static std::vector<MachineOutput> outputs(1);
+static unsigned cur_machine;
+static uint16 pad_state[2];
+static unsigned bytes_per_pixel = 2;
+static unsigned skip_frames, frame_number;
+
+static void hash_bytes(uint64 *hash, const void *data, size_t len)
+{
+ const uint8 *p = (const uint8 *)data;
+
+ while(len--)
+  *hash = (*hash ^ *p++) * 1099511628211ULL;
+}
+
+static void log_printf(enum retro_log_level level, const char *fmt, ...)
+{
+ va_list ap;
+
+ if(!verbose && level < RETRO_LOG_ERROR)
+  return;
+
+ va_start(ap, fmt);
+ vfprintf(stderr, fmt, ap);
+ va_end(ap);
+}
+
+static bool environment(unsigned cmd, void *data)
+{
+ switch(cmd)
+ {
+  case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+	*(const char **)data = system_dir.c_str();
+	return true;
+
+  case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+	((struct retro_log_callback *)data)->log = log_printf;
+	return true;
+
+  case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+	bytes_per_pixel = (*(const enum retro_pixel_format *)data == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+	return true;
+
+  case RETRO_ENVIRONMENT_GET_VARIABLE:
+	{
+	 struct retro_variable *var = (struct retro_variable *)data;
+	 const size_t key_len = strlen(var->key);
+
+	 for(size_t i = 0; i < options.size(); i++)
+	 {
+	  if(!options[i].compare(0, key_len, var->key) && options[i][key_len] == '=')
+	  {
+	   var->value = options[i].c_str() + key_len + 1;
+	   return true;
+	  }
+	 }
+	}
+	return false;
+
+  case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+	*(bool *)data = false;
+	return true;
+
+  case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
+	if(!skip_frames)
+	 return false;
+	*(int *)data = (frame_number % (skip_frames + 1)) ? 0x2 : 0x3;
+	return true;
+
+  case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+	*(bool *)data = true;
+	return true;
+
+  case RETRO_ENVIRONMENT_GET_OVERSCAN:
+	*(bool *)data = false;
+	return true;
+
+  case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+  case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+  case RETRO_ENVIRONMENT_SET_GEOMETRY:
+  case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+  case RETRO_ENVIRONMENT_SET_MESSAGE:
+	return true;
+ }
+
+ return false;
+}
+
+static void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+ if(!data)
+  return;
+
+ const uint32 dims[2] = { width, height };
+
+ MachineOutput *out = &outputs[cur_machine];
+
+ hash_bytes(&out->video_hash, dims, sizeof(dims));
+
+ for(unsigned y = 0; y < height; y++)
+  hash_bytes(&out->video_hash, (const uint8 *)data + y * pitch, width * bytes_per_pixel);
+}
+
+static size_t audio_sample_batch(const int16_t *data, size_t frames)
+{
+ MachineOutput *out = &outputs[cur_machine];
+
+ hash_bytes(&out->audio_hash, data, frames * 2 * sizeof(int16_t));
+ out->audio_frames += frames;
+
+ return frames;
+}
+
+static void audio_sample(int16_t left, int16_t right)
+{
+ const int16_t s[2] = { left, right };
+
+ audio_sample_batch(s, 1);
+}
+
+static void input_poll(void)
+{
+
+}
+
+static int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+ if(port >= 2 || device != RETRO_DEVICE_JOYPAD)
+  return 0;
+
+ if(id == RETRO_DEVICE_ID_JOYPAD_MASK)
+  return pad_state[port];
+
+ return (pad_state[port] >> id) & 1;
+}
+
+//
+// Input sources
+//
+static FILE *replay_fp, *record_fp;
+static uint32 random_seed;
+
+static void next_input(void)
+{
+ if(replay_fp)
+ {
+  char line[256];
+  unsigned p0, p1;
+
+  pad_state[0] = pad_state[1] = 0;
+
+  while(fgets(line, sizeof(line), replay_fp))
+  {
+   if(line[0] == '#')
+    continue;
+
+   if(sscanf(line, "%x %x", &p0, &p1) == 2)
+   {
+    pad_state[0] = p0;
+    pad_state[1] = p1;
+   }
+   break;
+  }
+ }
+ else if(random_seed)
+ {
+  // Hold each random combination of buttons(never Select and Start together) for a few frames.
+  static unsigned hold;
+
+  if(!hold)
+  {
+   for(unsigned port = 0; port < 2; port++)
+   {
+    random_seed ^= random_seed << 13;
+    random_seed ^= random_seed >> 17;
+    random_seed ^= random_seed << 5;
+
+    pad_state[port] = random_seed & 0x0FFF;
+
+    if((pad_state[port] & (1 << RETRO_DEVICE_ID_JOYPAD_SELECT)) && (pad_state[port] & (1 << RETRO_DEVICE_ID_JOYPAD_START)))
+     pad_state[port] &= ~(1 << RETRO_DEVICE_ID_JOYPAD_SELECT);
+   }
+   hold = 4 + (random_seed >> 28);
+  }
+  hold--;
+ }
+
+ if(record_fp)
+  fprintf(record_fp, "%04x %04x\n", pad_state[0], pad_state[1]);
+}
+
+static uint64 prof_clock(void)
+{
+ return get_time_ns();
+}
+
+// Unloads the game from every machine and destroys all but the first, which retro_deinit() takes care of.
+static void unload_machines(const std::vector<PCFX_Instance *> &machines)
+{
+ for(size_t i = machines.size(); i-- > 0; )
+ {
+  PCFX_SelectInstance(machines[i]);
+  retro_unload_game();
+
+  if(i)
+   PCFX_DestroyInstance(machines[i]);
+ }
+
+ if(!machines.empty())
+  PCFX_SelectInstance(machines[0]);
+}
+
+// Runs one frame of each machine, with the same input.
+static void run_frame(const std::vector<PCFX_Instance *> &machines)
+{
+ next_input();
+
+ for(cur_machine = 0; cur_machine < machines.size(); cur_machine++)
+ {
+  PCFX_SelectInstance(machines[cur_machine]);
+  retro_run();
+ }
+
+ frame_number++;
+}
+
+static void usage(const char *argv0)
+{
+ fprintf(stderr, "Usage: %s [-n frames] [-w frames] [-b system_dir] [-o key=value]... [-i replay_file | -s seed] [-r record_file] [-j json_file] [-k n] [-m n] [-v] <disc image>\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+ unsigned frames = 3600, warmup = 0, num_machines = 1;
+ const char *path = NULL, *json_path = NULL;
+
+ for(int i = 1; i < argc; i++)
+ {
+  const char *arg = argv[i];
+
+  if(arg[0] != '-')
+  {
+   path = arg;
+   continue;
+  }
+
+  if(!strcmp(arg, "-v"))
+  {
+   verbose = true;
+   continue;
+  }
+
+  if(i + 1 >= argc || arg[2])
+  {
+   usage(argv[0]);
+   return 1;
+  }
+
+  const char *value = argv[++i];
+
+  switch(arg[1])
+  {
+   case 'n': frames = strtoul(value, NULL, 0); break;
+   case 'w': warmup = strtoul(value, NULL, 0); break;
+   case 'b': system_dir = value; break;
+   case 'o': options.push_back(value); break;
+   case 's': random_seed = strtoul(value, NULL, 0); break;
+   case 'j': json_path = value; break;
+   case 'k': skip_frames = strtoul(value, NULL, 0); break;
+   case 'm': num_machines = std::max<unsigned>(1, strtoul(value, NULL, 0)); break;
+
+   case 'i':
+	if(!(replay_fp = fopen(value, "r")))
+	{
+	 fprintf(stderr, "Error opening input replay file \"%s\".\n", value);
+	 return 1;
+	}
+	break;
+
+   case 'r':
+	if(!(record_fp = fopen(value, "w")))
+	{
+	 fprintf(stderr, "Error creating input record file \"%s\".\n", value);
+	 return 1;
+	}
+	break;
+
+   default:
+	usage(argv[0]);
+	return 1;
+  }
+ }
+
+ if(!path)
+ {
+  usage(argv[0]);
+  return 1;
+ }
+
+ retro_set_environment(environment);
+ retro_set_video_refresh(video_refresh);
+ retro_set_audio_sample(audio_sample);
+ retro_set_audio_sample_batch(audio_sample_batch);
+ retro_set_input_poll(input_poll);
+ retro_set_input_state(input_state);
+ retro_init();
+
+ struct retro_game_info info;
+
+ memset(&info, 0, sizeof(info));
+ info.path = path;
+
+ std::vector<PCFX_Instance *> machines;
+ const uint64 load_start = get_time_ns();
+
+ // The first machine is the one retro_init() created.
+ for(unsigned i = 0; i < num_machines; i++)
+ {
+  PCFX_Instance *inst = i ? PCFX_CreateInstance() : PCFX_GetInstance();
+
+  PCFX_SelectInstance(inst);
+  machines.push_back(inst);
+
+  if(!retro_load_game(&info))
+  {
+   fprintf(stderr, "Error loading \"%s\".\n", path);
+   machines.pop_back();
+
+   if(i)
+    PCFX_DestroyInstance(inst);
+
+   unload_machines(machines);
+   retro_deinit();
+   return 1;
+  }
+ }
+
+ outputs.resize(num_machines);
+
+ const double load_time = (get_time_ns() - load_start) / 1e9;
+
+ for(unsigned i = 0; i < warmup; i++)
+  run_frame(machines);
+
+ const uint64 alloc_count_start = alloc_count, alloc_bytes_start = alloc_bytes;
+ const uint64 run_start = get_time_ns();
+
+ PCFX_Prof_Start(prof_clock);
+
+ for(unsigned i = 0; i < frames; i++)
+  run_frame(machines);
+
+ PCFX_Prof_Stop();
+
+ const uint64 run_time = get_time_ns() - run_start;
+ const uint64 run_alloc_count = alloc_count - alloc_count_start, run_alloc_bytes = alloc_bytes - alloc_bytes_start;
+ uint64 prof_total = 0;
+
+ for(unsigned i = 0; i < PCFX_PROF__COUNT; i++)
+  prof_total += PCFX_Prof.ticks[i];
+
+ printf("Load:        %.3f s\n", load_time);
+ printf("Frames:      %u(+%u warm-up)", frames, warmup);
+ if(num_machines > 1)
+  printf(" on each of %u machines", num_machines);
+ printf("\n");
+ printf("Time:        %.3f s\n", run_time / 1e9);
+ printf("Speed:       %.2f fps(%.1f%% of real time)", frames * 1e9 / run_time, frames * 1e9 / run_time * 100 / 59.94);
+ if(num_machines > 1)
+  printf(", %.2f machine frames per second", (double)frames * num_machines * 1e9 / run_time);
+ printf("\n");
+ printf("Allocations: %llu(%llu bytes), %.2f per frame\n", (unsigned long long)run_alloc_count, (unsigned long long)run_alloc_bytes,
+  frames ? (double)run_alloc_count / frames : 0.0);
+
+ for(unsigned i = 0; i < num_machines; i++)
+ {
+  if(num_machines > 1)
+   printf("Machine %u:\n", i);
+
+  printf("Video hash:  %016llx\n", (unsigned long long)outputs[i].video_hash);
+  printf("Audio hash:  %016llx(%llu frames)\n", (unsigned long long)outputs[i].audio_hash, (unsigned long long)outputs[i].audio_frames);
+ }
+ printf("\nTime in emulation, by subsystem:\n");
+
+ for(unsigned i = 0; i < PCFX_PROF__COUNT; i++)
+ {
+  printf("  %-10s %9.3f s  %5.1f%%  %8.1f us/frame(max %.1f)\n", PCFX_Prof_Name(i), PCFX_Prof.ticks[i] / 1e9, prof_total ? PCFX_Prof.ticks[i] * 100.0 / prof_total : 0.0,
+   frames ? PCFX_Prof.ticks[i] / 1e3 / frames : 0.0, PCFX_Prof.frame_max[i] / 1e3);
+ }
+
+ printf("\nKING BG lines drawn by DrawBG_Fast(), left blank, and why the rest were drawn by DrawBG():\n");
+
+ for(unsigned n = 0; n < 4; n++)
+ {
+  printf("  BG%u  %s %llu", n, PCFX_Prof_BGFallbackName(PCFX_BGFALLBACK_NONE), (unsigned long long)PCFX_Prof.bg_lines[n][PCFX_BGFALLBACK_NONE]);
+
+  for(unsigned i = 1; i < PCFX_BGFALLBACK__COUNT; i++)
+  {
+   if(PCFX_Prof.bg_lines[n][i])
+    printf(", %s %llu", PCFX_Prof_BGFallbackName(i), (unsigned long long)PCFX_Prof.bg_lines[n][i]);
+  }
+  printf("\n");
+ }
+ printf("  Lines reused from the BG line cache: %llu\n", (unsigned long long)PCFX_Prof.bg_cached_lines);
+
+ printf("\nEvent dispatches: %llu, %.1f per frame(%.1f handlers run per frame)\n", (unsigned long long)PCFX_Prof.event_dispatches,
+  frames ? (double)PCFX_Prof.event_dispatches / frames : 0.0, frames ? (double)PCFX_Prof.event_handlers / frames : 0.0);
+ printf("KING graphics runs: %llu, %.1f per frame\n", (unsigned long long)PCFX_Prof.king_gfx_runs,
+  frames ? (double)PCFX_Prof.king_gfx_runs / frames : 0.0);
+
+ if(json_path)
+ {
+  std::string title = path;
+
+  title = title.substr(title.find_last_of("/\\") + 1);
+
+  if(!PCFX_Prof_Dump(json_path, title.c_str()))
+   fprintf(stderr, "Error writing \"%s\".\n", json_path);
+ }
+
+ unload_machines(machines);
+ retro_deinit();
+
+ if(replay_fp)
+  fclose(replay_fp);
+
+ if(record_fp)
+  fclose(record_fp);
+
+ return 0;
+}
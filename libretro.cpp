@@ -3,6 +3,14 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#define MMAP_BIOS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifdef _MSC_VER
 #include <compat/msvc.h>
 #endif
@@ -24,6 +32,7 @@
 #include <rthreads/rthreads.h>
 
 #include "mednafen/pcfx/pcfx.h"
+#include "mednafen/pcfx/membus.h"
 #include "mednafen/pcfx/soundbox.h"
 #include "mednafen/pcfx/input.h"
 #include "mednafen/pcfx/king.h"
@@ -32,6 +41,7 @@
 #include "mednafen/pcfx/rainbow.h"
 #include "mednafen/pcfx/huc6273.h"
 #include "mednafen/pcfx/fxscsi.h"
+#include "mednafen/pcfx/profile.h"
 #include "mednafen/cdrom/scsicd.h"
 #include "mednafen/mempatcher.h"
 #include "mednafen/cdrom/cdromif.h"
@@ -41,8 +51,6 @@
 
 #include "libretro_core_options.h"
 
-static MDFNGI *game;
-
 struct retro_perf_callback perf_cb;
 retro_get_cpu_features_t perf_get_cpu_features_cb = NULL;
 retro_log_printf_t log_cb;
@@ -54,12 +62,10 @@ static retro_input_poll_t input_poll_cb;
 static retro_input_state_t input_state_cb;
 
 static bool overscan;
-static double last_sound_rate;
-static MDFN_PixelFormat last_pixel_format;
-
-static MDFN_Surface *surf;
 
 static bool failed_init;
+static bool can_dupe;
+static unsigned fastforward_frameskip;
 
 
 std::string retro_base_directory;
@@ -86,156 +92,513 @@ std::string retro_save_directory;
   This is a hack to somewhat address the issue, but to really fix it, we need to handle write buffer emulation in the V810 emulation core itself.
 */
 
-static std::vector<CDIF*> *cdifs = NULL;
-static bool CD_TrayOpen;
-static int CD_SelectedDisc;	// -1 for no disc
+#define MAX_PLAYERS 2
+
+// The BIOS ROM is never written, so instances that load the same BIOS file share one image of it, see AcquireBIOS().
+struct BIOSImage
+{
+ std::string path;
+ uint8 *data;		// 1MiB, followed by the V810 fast map trampoline.
+ size_t mapped_size;	// Nonzero if data was mmap()'d.
+ unsigned refs;
+};
+
+// Everything that belongs to one emulated PC-FX.  The device modules keep their own state in contexts that
+// PCFX_SelectInstance() points them at; what's left here is the machine glue and the libretro frontend state.
+struct PCFX_Instance
+{
+ V810 *v810;
+
+ fxtimer_t *timer;
+ pcfxirq_t *irq;
+ fxinput_t *input;
+ huc6273_t *huc6273;
+ rainbow_t *rainbow;
+ SoundBox *sbox;
+ fxking_t *king;
+ scsicd_ctx_t *scsicd;
+ mdfnmp_t *mp;
+ MDFNSS_Context *ss;	// Cached savestate layouts.
+
+ // Parked copies of the emulator-wide globals, only valid while the instance isn't selected.
+ MDFNGI *GameInfo;
+ VDC *vdc_chips[2];
+ uint32 RAM_LPA;
+
+ MDFNGI *game;
+
+ double last_sound_rate;
+ MDFN_PixelFormat last_pixel_format;
+
+ MDFN_Surface *surf;
+ unsigned width, height;
+
+ std::vector<CDIF *> CDInterfaces;	// FIXME: Cleanup on error out.
+ std::vector<CDIF*> *cdifs;
+ bool CD_TrayOpen;
+ int CD_SelectedDisc;	// -1 for no disc
+
+ BIOSImage *BIOS;
+ uint8 *BIOSROM; 	// 1MB
+ uint8 *RAM; 	// 2MB
+ bool RAMExposed;	// The frontend has been handed RAM through retro_get_memory_data(), and may write to it.
+ uint8 *FXSCSIROM;	// 512KiB
+
+ uint16 Last_VDC_AR[2];
+
+ bool WantHuC6273;
+
+ uint16 BackupControl;
+ uint8 SaveRAM[2 * 0x8000]; // BackupRAM + ExBackupRAM
+ uint8* BackupRAM;
+ uint8* ExBackupRAM;
+ uint8 ExBusReset; // I/O Register at 0x0700
+
+ bool BRAMDisabled;	// Cached at game load, don't remove this caching behavior or save game loss may result(if we ever get a GUI).
+
+ struct
+ {
+  v810_timestamp_t event_ts;
+  unsigned int heap_pos;
+ } Events[PCFX_EVENT__COUNT];
+
+ uint8 EventHeap[PCFX_EVENT__COUNT];
+
+ uint32 EmuFlags;
+
+#ifdef NEED_DEINTERLACER
+ bool PrevInterlaced;
+ Deinterlacer deint;
+#endif
+
+ uint32_t input_type[MAX_PLAYERS];
+ uint16_t input_buf[MAX_PLAYERS];
+ int32_t  mousedata[MAX_PLAYERS][3];
+
+ uint64_t video_frames, audio_frames;
+ unsigned frames_skipped;	// In a row, while fast-forwarding.
+
+ size_t serialize_size;
+};
+
+extern MDFNGI EmulatedPCFX;
+
+static PCFX_Instance *pcfx = NULL;
+static PCFX_Instance *default_instance = NULL;
+
+V810 *PCFX_V810 = NULL;
+
+PCFX_ProfState PCFX_Prof = { NULL };
+
+// Each subsystem's per-frame time, reported through the frontend's performance counter interface when the
+// "pcfx_profiling" core option is enabled(a "call" being one frame).
+static struct retro_perf_counter ProfCounters[PCFX_PROF__COUNT];
+static std::string prof_title;	// Content file name without the extension, for the profile dump.
+
+void PCFX_Prof_Start(PCFX_ProfClock clock)
+{
+ memset(&PCFX_Prof, 0, sizeof(PCFX_Prof));
+ PCFX_Prof.current = PCFX_PROF_OTHER;
+ PCFX_Prof.last = clock();
+ PCFX_Prof.clock = clock;
+}
+
+void PCFX_Prof_Stop(void)
+{
+ PCFX_Prof.clock = NULL;
+}
+
+void PCFX_Prof_BeginFrame(void)
+{
+ if(PCFX_Prof.clock)
+ {
+  PCFX_Prof.last = PCFX_Prof.clock();
+  PCFX_Prof.current = PCFX_PROF_OTHER;
+ }
+}
+
+void PCFX_Prof_EndFrame(void)
+{
+ if(!PCFX_Prof.clock)
+  return;
+
+ PCFX_Prof_Leave(PCFX_PROF_OTHER);
+
+ for(unsigned int i = 0; i < PCFX_PROF__COUNT; i++)
+ {
+  const uint64 frame_ticks = PCFX_Prof.ticks[i] - PCFX_Prof.frame_start[i];
+
+  if(frame_ticks > PCFX_Prof.frame_max[i])
+   PCFX_Prof.frame_max[i] = frame_ticks;
+
+  PCFX_Prof.frame_start[i] = PCFX_Prof.ticks[i];
+
+  if(ProfCounters[i].registered)
+  {
+   ProfCounters[i].total += frame_ticks;
+   ProfCounters[i].call_cnt++;
+  }
+ }
+
+ PCFX_Prof.frames++;
+}
+
+const char *PCFX_Prof_Name(unsigned int which)
+{
+ static const char *names[PCFX_PROF__COUNT] = { "other", "v810", "king_gfx", "king_draw", "king_mix", "vdc", "rainbow", "soundbox", "resample", "scsicd", "cd_wait" };
+
+ return((which < PCFX_PROF__COUNT) ? names[which] : NULL);
+}
+
+const char *PCFX_Prof_BGFallbackName(unsigned int which)
+{
+ static const char *names[PCFX_BGFALLBACK__COUNT] = { "fast", "blank", "affine", "mprog_affine", "cg_type", "cg_order" };
 
-V810 PCFX_V810;
+ return((which < PCFX_BGFALLBACK__COUNT) ? names[which] : NULL);
+}
 
-static uint8 *BIOSROM = NULL; 	// 1MB
-static uint8 *RAM = NULL; 	// 2MB
-static uint8 *FXSCSIROM = NULL;	// 512KiB
+bool PCFX_Prof_Dump(const char *path, const char *title)
+{
+ RFILE *fp = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+ uint64 total = 0;
 
-static uint32 RAM_LPA;		// Last page access
+ if(!fp)
+  return(false);
 
-static const int RAM_PageSize = 2048;
-static const int RAM_PageNOTMask = ~(RAM_PageSize - 1);
+ for(unsigned int i = 0; i < PCFX_PROF__COUNT; i++)
+  total += PCFX_Prof.ticks[i];
 
-static uint16 Last_VDC_AR[2];
+ filestream_printf(fp, "{\n  \"title\": \"");
+ for(const char *c = title; *c; c++)
+ {
+  if(*c == '"' || *c == '\\')
+   filestream_printf(fp, "\\%c", *c);
+  else if((unsigned char)*c < 0x20)
+   filestream_printf(fp, "\\u%04x", (unsigned char)*c);
+  else
+   filestream_printf(fp, "%c", *c);
+ }
+ filestream_printf(fp, "\",\n  \"frames\": %llu,\n  \"total_ticks\": %llu,\n  \"subsystems\": [\n", (unsigned long long)PCFX_Prof.frames, (unsigned long long)total);
+
+ for(unsigned int i = 0; i < PCFX_PROF__COUNT; i++)
+ {
+  filestream_printf(fp, "    { \"name\": \"%s\", \"ticks\": %llu, \"ticks_per_frame\": %.1f, \"max_frame_ticks\": %llu, \"share\": %.4f }%s\n",
+	PCFX_Prof_Name(i), (unsigned long long)PCFX_Prof.ticks[i], PCFX_Prof.frames ? (double)PCFX_Prof.ticks[i] / PCFX_Prof.frames : 0.0,
+	(unsigned long long)PCFX_Prof.frame_max[i], total ? (double)PCFX_Prof.ticks[i] / total : 0.0, (i + 1 < PCFX_PROF__COUNT) ? "," : "");
+ }
+
+ filestream_printf(fp, "  ],\n  \"bg_lines\": [\n");
+
+ for(unsigned int n = 0; n < 4; n++)
+ {
+  filestream_printf(fp, "    { \"bg\": %u", n);
+
+  for(unsigned int i = 0; i < PCFX_BGFALLBACK__COUNT; i++)
+   filestream_printf(fp, ", \"%s\": %llu", PCFX_Prof_BGFallbackName(i), (unsigned long long)PCFX_Prof.bg_lines[n][i]);
+
+  filestream_printf(fp, " }%s\n", (n < 3) ? "," : "");
+ }
+
+ filestream_printf(fp, "  ],\n  \"bg_cached_lines\": %llu,\n", (unsigned long long)PCFX_Prof.bg_cached_lines);
+ filestream_printf(fp, "  \"event_dispatches\": %llu,\n  \"event_handlers\": %llu,\n", (unsigned long long)PCFX_Prof.event_dispatches,
+	(unsigned long long)PCFX_Prof.event_handlers);
+ filestream_printf(fp, "  \"king_gfx_runs\": %llu\n}\n", (unsigned long long)PCFX_Prof.king_gfx_runs);
+ filestream_close(fp);
+
+ return(true);
+}
 
-static bool WantHuC6273 = FALSE;
+uint8 *PCFX_MemBus::RAM = NULL;
+uint8 *PCFX_MemBus::BIOSROM = NULL;
+uint32 PCFX_MemBus::RAM_LPA;
 
 //static 
 VDC *fx_vdc_chips[2];
 
-static uint16 BackupControl;
-static uint8 SaveRAM[2 * 0x8000]; // BackupRAM + ExBackupRAM
-static uint8* BackupRAM = (uint8*)(SaveRAM + (0x8000 * 0));
-static uint8* ExBackupRAM = (uint8*)(SaveRAM + (0x8000 * 1));
-static uint8 ExBusReset; // I/O Register at 0x0700
+PCFX_Instance *PCFX_CreateInstance(void)
+{
+ PCFX_Instance *inst = new PCFX_Instance();
+
+ inst->v810 = new V810();
+
+ inst->timer = FXTIMER_NewContext();
+ inst->irq = PCFXIRQ_NewContext();
+ inst->input = FXINPUT_NewContext();
+ inst->huc6273 = HuC6273_NewContext();
+ inst->rainbow = RAINBOW_NewContext();
+ inst->sbox = SoundBox_NewContext();
+ inst->king = KING_NewContext();
+ inst->scsicd = SCSICD_NewContext();
+ inst->mp = MDFNMP_NewContext();
+ inst->ss = MDFNSS_NewContext();
+
+ inst->GameInfo = &EmulatedPCFX;
+
+ inst->BackupRAM = inst->SaveRAM + (0x8000 * 0);
+ inst->ExBackupRAM = inst->SaveRAM + (0x8000 * 1);
+
+ return(inst);
+}
+
+void PCFX_DestroyInstance(PCFX_Instance *inst)
+{
+ if(inst == pcfx)
+  PCFX_SelectInstance(NULL);
+
+ MDFNSS_DeleteContext(inst->ss);
+ MDFNMP_DeleteContext(inst->mp);
+ SCSICD_DeleteContext(inst->scsicd);
+ KING_DeleteContext(inst->king);
+ SoundBox_DeleteContext(inst->sbox);
+ RAINBOW_DeleteContext(inst->rainbow);
+ HuC6273_DeleteContext(inst->huc6273);
+ FXINPUT_DeleteContext(inst->input);
+ PCFXIRQ_DeleteContext(inst->irq);
+ FXTIMER_DeleteContext(inst->timer);
+
+ delete inst->v810;
+ delete inst->surf;
+ delete inst;
+}
+
+// Not reentrant: this repoints the globals every module runs against, see pcfx.h.
+void PCFX_SelectInstance(PCFX_Instance *inst)
+{
+ if(pcfx)
+ {
+  pcfx->GameInfo = MDFNGameInfo;
+  pcfx->vdc_chips[0] = fx_vdc_chips[0];
+  pcfx->vdc_chips[1] = fx_vdc_chips[1];
+  pcfx->RAM_LPA = PCFX_MemBus::RAM_LPA;
+ }
+
+ pcfx = inst;
+
+ PCFX_V810 = inst ? inst->v810 : NULL;
+
+ FXTIMER_SetContext(inst ? inst->timer : NULL);
+ PCFXIRQ_SetContext(inst ? inst->irq : NULL);
+ FXINPUT_SetContext(inst ? inst->input : NULL);
+ HuC6273_SetContext(inst ? inst->huc6273 : NULL);
+ RAINBOW_SetContext(inst ? inst->rainbow : NULL);
+ SoundBox_SetContext(inst ? inst->sbox : NULL);
+ KING_SetContext(inst ? inst->king : NULL);
+ SCSICD_SetContext(inst ? inst->scsicd : NULL);
+ MDFNMP_SetContext(inst ? inst->mp : NULL);
+ MDFNSS_SetContext(inst ? inst->ss : NULL);
+
+ if(inst)
+ {
+  MDFNGameInfo = inst->GameInfo;
+  fx_vdc_chips[0] = inst->vdc_chips[0];
+  fx_vdc_chips[1] = inst->vdc_chips[1];
+  PCFX_MemBus::RAM = inst->RAM;
+  PCFX_MemBus::BIOSROM = inst->BIOSROM;
+  PCFX_MemBus::RAM_LPA = inst->RAM_LPA;
+ }
+}
 
-static bool BRAMDisabled;	// Cached at game load, don't remove this caching behavior or save game loss may result(if we ever get a GUI).
+PCFX_Instance *PCFX_GetInstance(void)
+{
+ return(pcfx);
+}
 
 // Checks to see if this main-RAM-area access
 // is in the same DRAM page as the last access.
-#define RAMLPCHECK	\
-{					\
-  if((A & RAM_PageNOTMask) != RAM_LPA)	\
-  {					\
-   timestamp += 3;			\
-   RAM_LPA = A & RAM_PageNOTMask;	\
-  }					\
+#define RAMLPCHECK PCFX_MemBus::RAMPageCheck(timestamp, A)
+
+// Device event scheduler.  Events[] holds each device's next event timestamp, indexed by PCFX_EVENT_*, and EventHeap[] is a
+// binary min-heap of event types ordered by those timestamps(ties broken by type), so the next event is always EventHeap[0].
+// A device's handler is only called once its timestamp has been reached; to add an event, add it to the PCFX_EVENT_* enum
+// and EventHandlers[].
+typedef v810_timestamp_t (*PCFX_EventHandler)(const v810_timestamp_t timestamp);
+
+static const PCFX_EventHandler EventHandlers[PCFX_EVENT__COUNT] =
+{
+ KING_GfxEvent,
+ KING_SCSIEvent,
+ KING_DMAEvent,
+ FXINPUT_Update,
+ FXTIMER_Update,
+ SoundBox_ADPCMUpdate,
+};
+
+// What each event's handler time is charged to, see profile.h.
+static const uint8 EventProf[PCFX_EVENT__COUNT] =
+{
+ PCFX_PROF_KING_GFX,
+ PCFX_PROF_SCSICD,
+ PCFX_PROF_SCSICD,
+ PCFX_PROF_OTHER,
+ PCFX_PROF_OTHER,
+ PCFX_PROF_SOUNDBOX,
+};
+
+static INLINE bool EventBefore(const unsigned int a, const unsigned int b)
+{
+ if(pcfx->Events[a].event_ts != pcfx->Events[b].event_ts)
+  return(pcfx->Events[a].event_ts < pcfx->Events[b].event_ts);
+
+ return(a < b);
 }
 
-static v810_timestamp_t next_pad_ts, next_timer_ts, next_adpcm_ts, next_king_ts;
+static INLINE void EventHeapSwap(const unsigned int pos_a, const unsigned int pos_b)
+{
+ const uint8 tmp = pcfx->EventHeap[pos_a];
 
-void PCFX_FixNonEvents(void)
+ pcfx->EventHeap[pos_a] = pcfx->EventHeap[pos_b];
+ pcfx->EventHeap[pos_b] = tmp;
+
+ pcfx->Events[pcfx->EventHeap[pos_a]].heap_pos = pos_a;
+ pcfx->Events[pcfx->EventHeap[pos_b]].heap_pos = pos_b;
+}
+
+static void EventHeapSiftDown(unsigned int pos)
 {
- if(next_pad_ts & 0x40000000)
-  next_pad_ts = PCFX_EVENT_NONONO;
+ for(;;)
+ {
+  unsigned int child = pos * 2 + 1;
+
+  if(child >= PCFX_EVENT__COUNT)
+   break;
 
- if(next_timer_ts & 0x40000000)
-  next_timer_ts = PCFX_EVENT_NONONO;
+  if((child + 1) < PCFX_EVENT__COUNT && EventBefore(pcfx->EventHeap[child + 1], pcfx->EventHeap[child]))
+   child++;
 
- if(next_adpcm_ts & 0x40000000)
-  next_adpcm_ts = PCFX_EVENT_NONONO;
+  if(!EventBefore(pcfx->EventHeap[child], pcfx->EventHeap[pos]))
+   break;
 
- if(next_king_ts & 0x40000000)
-  next_king_ts = PCFX_EVENT_NONONO;
+  EventHeapSwap(pos, child);
+  pos = child;
+ }
 }
 
-void PCFX_Event_Reset(void)
+static void EventHeapSiftUp(unsigned int pos)
+{
+ while(pos > 0)
+ {
+  const unsigned int parent = (pos - 1) >> 1;
+
+  if(!EventBefore(pcfx->EventHeap[pos], pcfx->EventHeap[parent]))
+   break;
+
+  EventHeapSwap(pos, parent);
+  pos = parent;
+ }
+}
+
+static void EventHeapRebuild(void)
 {
- next_pad_ts = PCFX_EVENT_NONONO;
- next_timer_ts = PCFX_EVENT_NONONO;
- next_adpcm_ts = PCFX_EVENT_NONONO;
- next_king_ts = PCFX_EVENT_NONONO;
+ for(unsigned int i = 0; i < PCFX_EVENT__COUNT; i++)
+ {
+  pcfx->EventHeap[i] = i;
+  pcfx->Events[i].heap_pos = i;
+ }
+
+ for(unsigned int i = PCFX_EVENT__COUNT / 2; i > 0; i--)
+  EventHeapSiftDown(i - 1);
 }
 
-static INLINE uint32 CalcNextTS(void)
+// Returns a mask of the event types in the subheap at pos whose timestamp has been reached.
+static uint32 EventsDue(const v810_timestamp_t timestamp, const unsigned int pos)
 {
- v810_timestamp_t next_timestamp = next_king_ts;
+ if(pos >= PCFX_EVENT__COUNT || pcfx->Events[pcfx->EventHeap[pos]].event_ts > timestamp)
+  return(0);
 
- if(next_timestamp > next_pad_ts)
-  next_timestamp  = next_pad_ts;
+ return((1U << pcfx->EventHeap[pos]) | EventsDue(timestamp, pos * 2 + 1) | EventsDue(timestamp, pos * 2 + 2));
+}
+
+void PCFX_FixNonEvents(void)
+{
+ for(unsigned int i = 0; i < PCFX_EVENT__COUNT; i++)
+ {
+  if(pcfx->Events[i].event_ts & 0x40000000)
+   pcfx->Events[i].event_ts = PCFX_EVENT_NONONO;
+ }
 
- if(next_timestamp > next_timer_ts)
-  next_timestamp = next_timer_ts;
+ EventHeapRebuild();
+}
 
- if(next_timestamp > next_adpcm_ts)
-  next_timestamp = next_adpcm_ts;
+void PCFX_Event_Reset(void)
+{
+ for(unsigned int i = 0; i < PCFX_EVENT__COUNT; i++)
+  pcfx->Events[i].event_ts = PCFX_EVENT_NONONO;
 
- return(next_timestamp);
+ EventHeapRebuild();
 }
 
-static void RebaseTS(const v810_timestamp_t timestamp, const v810_timestamp_t new_base_timestamp)
+static INLINE uint32 CalcNextTS(void)
 {
- assert(next_pad_ts > timestamp);
- assert(next_timer_ts > timestamp);
- assert(next_adpcm_ts > timestamp);
- assert(next_king_ts > timestamp);
+ return(pcfx->Events[pcfx->EventHeap[0]].event_ts);
+}
 
- next_pad_ts -= (timestamp - new_base_timestamp);
- next_timer_ts -= (timestamp - new_base_timestamp);
- next_adpcm_ts -= (timestamp - new_base_timestamp);
- next_king_ts -= (timestamp - new_base_timestamp);
+static void RebaseTS(const v810_timestamp_t timestamp, const v810_timestamp_t new_base_timestamp)
+{
+ assert(CalcNextTS() > timestamp);
 
- //printf("RTS: %d %d %d %d\n", next_pad_ts, next_timer_ts, next_adpcm_ts, next_king_ts);
+ // Every timestamp moves by the same amount, so the heap order doesn't change.
+ for(unsigned int i = 0; i < PCFX_EVENT__COUNT; i++)
+  pcfx->Events[i].event_ts -= (timestamp - new_base_timestamp);
 }
 
 
+static INLINE void EventReschedule(const unsigned int type, const v810_timestamp_t next_timestamp)
+{
+ pcfx->Events[type].event_ts = next_timestamp;
+ EventHeapSiftUp(pcfx->Events[type].heap_pos);
+ EventHeapSiftDown(pcfx->Events[type].heap_pos);
+}
+
 void PCFX_SetEvent(const int type, const v810_timestamp_t next_timestamp)
 {
- //assert(next_timestamp > PCFX_V810.v810_timestamp);
+ //assert(next_timestamp > PCFX_V810->v810_timestamp);
 
- if(type == PCFX_EVENT_PAD)
-  next_pad_ts = next_timestamp;
- else if(type == PCFX_EVENT_TIMER)
-  next_timer_ts = next_timestamp;
- else if(type == PCFX_EVENT_ADPCM)
-  next_adpcm_ts = next_timestamp;
- else if(type == PCFX_EVENT_KING)
-  next_king_ts = next_timestamp;
+ EventReschedule(type, next_timestamp);
 
- if(next_timestamp < PCFX_V810.GetEventNT())
-  PCFX_V810.SetEventNT(next_timestamp);
+ if(next_timestamp < PCFX_V810->GetEventNT())
+  PCFX_V810->SetEventNT(next_timestamp);
 }
 
 int32 MDFN_FASTCALL pcfx_event_handler(const v810_timestamp_t timestamp)
 {
-     if(timestamp >= next_king_ts)
-      next_king_ts = KING_Update(timestamp);
-
-     if(timestamp >= next_pad_ts)
-      next_pad_ts = FXINPUT_Update(timestamp);
+ // Run everything that's due in PCFX_EVENT_* order, regardless of which came due first; KING and the SoundBox ADPCM
+ // share state, so the order matters.
+ uint32 due = EventsDue(timestamp, 0);
 
-     if(timestamp >= next_timer_ts)
-      next_timer_ts = FXTIMER_Update(timestamp);
+ PCFX_Prof_CountEventDispatch();
 
-     if(timestamp >= next_adpcm_ts)
-      next_adpcm_ts = SoundBox_ADPCMUpdate(timestamp);
+ for(unsigned int i = 0; due; i++, due >>= 1)
+ {
+  if(due & 1)
+  {
+   const unsigned int prof = PCFX_Prof_Enter(EventProf[i]);
+   PCFX_Prof_CountEventHandler();
+   EventReschedule(i, EventHandlers[i](timestamp));
+   PCFX_Prof_Leave(prof);
+  }
+ }
 
 #if 1
-     assert(next_king_ts > timestamp);
-     assert(next_pad_ts > timestamp);
-     assert(next_timer_ts > timestamp);
-     assert(next_adpcm_ts > timestamp);
+ assert(CalcNextTS() > timestamp);
 #endif
-     return(CalcNextTS());
+ return(CalcNextTS());
 }
 
 // Called externally from debug.cpp
 void ForceEventUpdates(const uint32 timestamp)
 {
- next_king_ts = KING_Update(timestamp);
- next_pad_ts = FXINPUT_Update(timestamp);
- next_timer_ts = FXTIMER_Update(timestamp);
- next_adpcm_ts = SoundBox_ADPCMUpdate(timestamp);
+ // Everything has to be caught up to timestamp here(end of frame, reset, state load), not just what's due.
+ for(unsigned int i = 0; i < PCFX_EVENT__COUNT; i++)
+ {
+  const unsigned int prof = PCFX_Prof_Enter(EventProf[i]);
+  pcfx->Events[i].event_ts = EventHandlers[i](timestamp);
+  PCFX_Prof_Leave(prof);
+ }
 
- //printf("Meow: %d\n", CalcNextTS());
- PCFX_V810.SetEventNT(CalcNextTS());
+ EventHeapRebuild();
 
- //printf("FEU: %d %d %d %d\n", next_pad_ts, next_timer_ts, next_adpcm_ts, next_king_ts);
+ //printf("Meow: %d\n", CalcNextTS());
+ PCFX_V810->SetEventNT(CalcNextTS());
 }
 
 #include "mednafen/pcfx/io-handler.inc"
@@ -263,8 +626,6 @@ typedef struct
 #define CDGE_FLAG_ACCURATE_V810         0x01
 #define CDGE_FLAG_FXGA			0x02
 
-static uint32 EmuFlags;
-
 static CDGameEntry GameList[] =
 {
  #include "mednafen/pcfx/gamedb.inc"
@@ -273,7 +634,7 @@ static CDGameEntry GameList[] =
 
 static void Emulate(EmulateSpecStruct *espec)
 {
- //printf("%d\n", PCFX_V810.v810_timestamp);
+ //printf("%d\n", PCFX_V810->v810_timestamp);
 
  FXINPUT_Frame();
 
@@ -289,7 +650,9 @@ static void Emulate(EmulateSpecStruct *espec)
  KING_StartFrame(fx_vdc_chips, espec);	//espec->surface, &espec->DisplayRect, espec->LineWidths, espec->skip);
 
  v810_timestamp_t v810_timestamp;
- v810_timestamp = PCFX_V810.Run(pcfx_event_handler);
+ unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_V810);
+ v810_timestamp = PCFX_V810->Run(pcfx_event_handler);
+ PCFX_Prof_Leave(prof);
 
 
  PCFX_FixNonEvents();
@@ -301,13 +664,17 @@ static void Emulate(EmulateSpecStruct *espec)
  // Call KING_EndFrame() before SoundBox_Flush(), otherwise CD-DA audio distortion will occur due to sound data being updated
  // after it was needed instead of before.
  //
+ prof = PCFX_Prof_Enter(PCFX_PROF_KING_GFX);
  KING_EndFrame(v810_timestamp);
+ PCFX_Prof_Leave(prof);
 
  //
  // new_base_ts is guaranteed to be <= v810_timestamp
  //
  v810_timestamp_t new_base_ts;
+ prof = PCFX_Prof_Enter(PCFX_PROF_SOUNDBOX);
  espec->SoundBufSize = SoundBox_Flush(v810_timestamp, &new_base_ts, espec->SoundBuf, espec->SoundBufMaxSize);
+ PCFX_Prof_Leave(prof);
 
  KING_ResetTS(new_base_ts);
  FXTIMER_ResetTS(new_base_ts);
@@ -319,12 +686,12 @@ static void Emulate(EmulateSpecStruct *espec)
 
  espec->MasterCycles = v810_timestamp - new_base_ts;
 
- PCFX_V810.ResetTS(new_base_ts);
+ PCFX_V810->ResetTS(new_base_ts);
 }
 
 static void PCFX_Reset(void)
 {
- const uint32 timestamp = PCFX_V810.v810_timestamp;
+ const uint32 timestamp = PCFX_V810->v810_timestamp;
 
  //printf("Reset: %d\n", timestamp);
 
@@ -334,15 +701,15 @@ static void PCFX_Reset(void)
 
  PCFX_Event_Reset();
 
- RAM_LPA = 0;
+ PCFX_MemBus::RAM_LPA = 0;
 
- ExBusReset = 0;
- BackupControl = 0;
+ pcfx->ExBusReset = 0;
+ pcfx->BackupControl = 0;
 
- Last_VDC_AR[0] = 0;
- Last_VDC_AR[1] = 0;
+ pcfx->Last_VDC_AR[0] = 0;
+ pcfx->Last_VDC_AR[1] = 0;
 
- memset(RAM, 0x00, 2048 * 1024);
+ memset(pcfx->RAM, 0x00, 2048 * 1024);
 
  for(int i = 0; i < 2; i++)
  {
@@ -355,12 +722,12 @@ static void PCFX_Reset(void)
  SoundBox_Reset(timestamp);
  RAINBOW_Reset();
 
- if(WantHuC6273)
+ if(pcfx->WantHuC6273)
   HuC6273_Reset();
 
  PCFXIRQ_Reset();
  FXTIMER_Reset();
- PCFX_V810.Reset();
+ PCFX_V810->Reset();
 
  // Force device updates so we can get new next event timestamp values.
  ForceEventUpdates(timestamp);
@@ -383,53 +750,175 @@ static void VDCB_IRQHook(bool asserted)
 
 static void SetRegGroups(void);
 
+static std::vector<BIOSImage *> BIOSImages;
+
+#ifdef MMAP_BIOS
+// Maps the file read-only and copy-on-write, with an anonymous page(s) after it for the trampoline; returns false
+// if that isn't possible here, so the caller can fall back to reading the file.
+static bool MapBIOS(BIOSImage *img, bool *bad_size)
+{
+ const size_t page_size = sysconf(_SC_PAGESIZE);
+ const size_t map_size = (0x100000 + V810_FAST_MAP_TRAMPOLINE_SIZE + page_size - 1) & ~(page_size - 1);
+ struct stat st;
+ uint8 *p;
+ int fd;
+
+ if((fd = open(img->path.c_str(), O_RDONLY)) == -1)
+  return(false);
+
+ if(fstat(fd, &st) == -1)
+ {
+  close(fd);
+  return(false);
+ }
+
+ if(st.st_size != 0x100000)
+ {
+  close(fd);
+  *bad_size = true;
+  return(false);
+ }
+
+ if((p = (uint8 *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0)) == (uint8 *)MAP_FAILED)
+ {
+  close(fd);
+  return(false);
+ }
+
+ if(mmap(p, 0x100000, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+ {
+  munmap(p, map_size);
+  close(fd);
+  return(false);
+ }
+ close(fd);
+
+ V810::FillFastMapTrampoline(p, 0x100000);
+ mprotect(p + 0x100000, map_size - 0x100000, PROT_READ);
+
+ img->data = p;
+ img->mapped_size = map_size;
+
+ return(true);
+}
+#endif
+
+static BIOSImage *AcquireBIOS(const std::string &path)
+{
+ BIOSImage *img;
+ bool bad_size = false;
+
+ for(unsigned i = 0; i < BIOSImages.size(); i++)
+ {
+  if(BIOSImages[i]->path == path)
+  {
+   BIOSImages[i]->refs++;
+   return(BIOSImages[i]);
+  }
+ }
+
+ img = new BIOSImage();
+ img->path = path;
+
+#ifdef MMAP_BIOS
+ if(!MapBIOS(img, &bad_size) && !bad_size)
+#endif
+ {
+  MDFNFILE *BIOSFile = file_open(path.c_str());
+
+  if(BIOSFile)
+  {
+   if(BIOSFile->size != 1024 * 1024)
+    bad_size = true;
+   else if((img->data = (uint8 *)malloc(0x100000 + V810_FAST_MAP_TRAMPOLINE_SIZE)))
+   {
+    memcpy(img->data, BIOSFile->data, 0x100000);
+    V810::FillFastMapTrampoline(img->data, 0x100000);
+   }
+
+   file_close(BIOSFile);
+  }
+ }
+
+ if(bad_size)
+  MDFN_PrintError("BIOS ROM file is incorrect size.\n");
+
+ if(!img->data)
+ {
+  delete img;
+  return(NULL);
+ }
+
+ img->refs = 1;
+ BIOSImages.push_back(img);
+
+ return(img);
+}
+
+static void ReleaseBIOS(BIOSImage *img)
+{
+ if(--img->refs)
+  return;
+
+ for(unsigned i = 0; i < BIOSImages.size(); i++)
+ {
+  if(BIOSImages[i] == img)
+  {
+   BIOSImages.erase(BIOSImages.begin() + i);
+   break;
+  }
+ }
+
+#ifdef MMAP_BIOS
+ if(img->mapped_size)
+  munmap(img->data, img->mapped_size);
+ else
+#endif
+  free(img->data);
+
+ delete img;
+}
+
 static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
 {
    V810_Emu_Mode cpu_mode;
    std::string biospath    = MDFN_MakeFName(MDFNMKF_FIRMWARE, 0, MDFN_GetSettingS("pcfx.bios"));
-   MDFNFILE *BIOSFile      = file_open(biospath.c_str());
 
-   if(!BIOSFile)
+   if(!(pcfx->BIOS = AcquireBIOS(biospath)))
       return(0);
 
-   cpu_mode = (V810_Emu_Mode)MDFN_GetSettingI("pcfx.cpu_emulation");
-   if(cpu_mode == _V810_EMU_MODE_COUNT)
+   int64_t cpu_setting = MDFN_GetSettingI("pcfx.cpu_emulation");
+   if(cpu_setting < 0 || cpu_setting >= _V810_EMU_MODE_COUNT)
    {
-      cpu_mode = (EmuFlags & CDGE_FLAG_ACCURATE_V810) ? V810_EMU_MODE_ACCURATE : V810_EMU_MODE_FAST;
+      cpu_mode = (pcfx->EmuFlags & CDGE_FLAG_ACCURATE_V810) ? V810_EMU_MODE_ACCURATE : V810_EMU_MODE_FAST;
    }
+   else
+      cpu_mode = (V810_Emu_Mode)cpu_setting;
 
-   if(EmuFlags & CDGE_FLAG_FXGA)
+   if(pcfx->EmuFlags & CDGE_FLAG_FXGA)
    {
       //WantHuC6273 = TRUE;
    }
 
-   MDFN_printf("V810 Emulation Mode: %s\n", (cpu_mode == V810_EMU_MODE_ACCURATE) ? "Accurate" : "Fast");
-   PCFX_V810.Init(cpu_mode, false);
+   PCFX_Event_Reset();
+
+   PCFX_V810->Init(cpu_mode, false);
+   cpu_mode = PCFX_V810->GetEmuMode();
+   MDFN_printf("V810 Emulation Mode: %s\n", (cpu_mode == V810_EMU_MODE_ACCURATE) ? "Accurate" : ((cpu_mode == V810_EMU_MODE_JIT) ? "Recompiler" : "Fast"));
 
    uint32 RAM_Map_Addresses[1] = { 0x00000000 };
    uint32 BIOSROM_Map_Addresses[1] = { 0xFFF00000 };
 
-   RAM = PCFX_V810.SetFastMap(RAM_Map_Addresses, 0x00200000, 1, "RAM");
+   pcfx->RAM = PCFX_V810->SetFastMap(RAM_Map_Addresses, 0x00200000, 1, "RAM");
 
    // todo: cleanup on error
-   if(!RAM)
+   if(!pcfx->RAM)
       return(0);
 
-   BIOSROM = PCFX_V810.SetFastMap(BIOSROM_Map_Addresses, 0x00100000, 1, "BIOS ROM");
-   if(!BIOSROM)
+   pcfx->BIOSROM = PCFX_V810->SetFastMap(BIOSROM_Map_Addresses, 0x00100000, 1, "BIOS ROM", pcfx->BIOS->data, true);
+   if(!pcfx->BIOSROM)
       return(0);
 
-   if(BIOSFile->size != 1024 * 1024)
-   {
-      MDFN_PrintError("BIOS ROM file is incorrect size.\n");
-      return(0);
-   }
-
-   memcpy(BIOSROM, BIOSFile->data, 1024 * 1024);
-
-   file_close(BIOSFile);
-   BIOSFile = NULL;
-
 #if 0
    const char *fxscsi_path = MDFN_GetSettingS("pcfx.fxscsi");	// For developers only, so don't make it convenient.
    if(fxscsi_path)
@@ -449,12 +938,12 @@ static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
 
       uint32 FXSCSI_Map_Addresses[1] = { 0x80780000 };
 
-      if(!(FXSCSIROM = PCFX_V810.SetFastMap(FXSCSI_Map_Addresses, 0x0080000, 1, "FX-SCSI ROM")))
+      if(!(pcfx->FXSCSIROM = PCFX_V810->SetFastMap(FXSCSI_Map_Addresses, 0x0080000, 1, "FX-SCSI ROM", NULL, true)))
       {
          return(0);
       }
 
-      memcpy(FXSCSIROM, FXSCSIFile->data, 1024 * 512);
+      memcpy(pcfx->FXSCSIROM, FXSCSIFile->data, 1024 * 512);
 
       file_close(FXSCSIFile);
       FXSCSIFile = NULL;
@@ -476,20 +965,21 @@ static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
    FXINPUT_Init();
    FXTIMER_Init();
 
-   if(WantHuC6273)
+   if(pcfx->WantHuC6273)
       HuC6273_Init();
 
    if(!KING_Init())
    {
-      free(BIOSROM);
-      free(RAM);
-      BIOSROM = NULL;
-      RAM = NULL;
+      ReleaseBIOS(pcfx->BIOS);
+      free(pcfx->RAM);
+      pcfx->BIOS = NULL;
+      pcfx->BIOSROM = NULL;
+      pcfx->RAM = NULL;
       return(0);
    }
 
-   CD_TrayOpen = false;
-   CD_SelectedDisc = 0;
+   pcfx->CD_TrayOpen = false;
+   pcfx->CD_SelectedDisc = 0;
 
    SCSICD_SetDisc(true, NULL, true);
    SCSICD_SetDisc(false, (*CDInterfaces)[0], true);
@@ -508,18 +998,18 @@ static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
    MDFNGameInfo->lcm_height = MDFNGameInfo->nominal_height;
 
    MDFNMP_Init(1024 * 1024, ((uint64)1 << 32) / (1024 * 1024));
-   MDFNMP_AddRAM(2048 * 1024, 0x00000000, RAM);
+   MDFNMP_AddRAM(2048 * 1024, 0x00000000, pcfx->RAM);
 
 
-   BRAMDisabled = MDFN_GetSettingB("pcfx.disable_bram");
+   pcfx->BRAMDisabled = MDFN_GetSettingB("pcfx.disable_bram");
 
-   if(BRAMDisabled)
+   if(pcfx->BRAMDisabled)
       MDFN_printf("Warning: BRAM is disabled per pcfx.disable_bram setting.  This is simulating a malfunction.\n");
 
-   if(!BRAMDisabled)
+   if(!pcfx->BRAMDisabled)
    {
       // Initialize Save RAM
-      memset(SaveRAM, 0, sizeof(SaveRAM));
+      memset(pcfx->SaveRAM, 0, sizeof(pcfx->SaveRAM));
 
       static const uint8 BRInit00[] = { 0x24, 0x8A, 0xDF, 0x50, 0x43, 0x46, 0x58, 0x53, 0x72, 0x61, 0x6D, 0x80,
          0x00, 0x01, 0x01, 0x00, 0x01, 0x40, 0x00, 0x00, 0x01, 0xF9, 0x03, 0x00,
@@ -527,8 +1017,8 @@ static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
       };
       static const uint8 BRInit80[] = { 0xF9, 0xFF, 0xFF };
 
-      memcpy(BackupRAM + 0x00, BRInit00, sizeof(BRInit00));
-      memcpy(BackupRAM + 0x80, BRInit80, sizeof(BRInit80));
+      memcpy(pcfx->BackupRAM + 0x00, BRInit00, sizeof(BRInit00));
+      memcpy(pcfx->BackupRAM + 0x80, BRInit80, sizeof(BRInit80));
 
 
       static const uint8 ExBRInit00[] = { 0x24, 0x8A, 0xDF, 0x50, 0x43, 0x46, 0x58, 0x43, 0x61, 0x72, 0x64, 0x80,
@@ -537,47 +1027,58 @@ static bool LoadCommon(std::vector<CDIF *> *CDInterfaces)
       };
       static const uint8 ExBRInit80[] = { 0xF9, 0xFF, 0xFF };
 
-      memcpy(ExBackupRAM + 0x00, ExBRInit00, sizeof(ExBRInit00));
-      memcpy(ExBackupRAM + 0x80, ExBRInit80, sizeof(ExBRInit80));
+      memcpy(pcfx->ExBackupRAM + 0x00, ExBRInit00, sizeof(ExBRInit00));
+      memcpy(pcfx->ExBackupRAM + 0x80, ExBRInit80, sizeof(ExBRInit80));
    }
 
    // Default to 16-bit bus.
    for(int i = 0; i < 256; i++)
    {
-      PCFX_V810.SetMemReadBus32(i, FALSE);
-      PCFX_V810.SetMemWriteBus32(i, FALSE);
+      PCFX_V810->SetMemReadBus32(i, FALSE);
+      PCFX_V810->SetMemWriteBus32(i, FALSE);
    }
 
    // 16MiB RAM area.
-   PCFX_V810.SetMemReadBus32(0, TRUE);
-   PCFX_V810.SetMemWriteBus32(0, TRUE);
+   PCFX_V810->SetMemReadBus32(0, TRUE);
+   PCFX_V810->SetMemWriteBus32(0, TRUE);
 
    // Bitstring read range
    for(int i = 0xA0; i <= 0xAF; i++)
    {
-      PCFX_V810.SetMemReadBus32(i, FALSE);       // Reads to the read range are 16-bit, and
-      PCFX_V810.SetMemWriteBus32(i, TRUE);       // writes are 32-bit.
+      PCFX_V810->SetMemReadBus32(i, FALSE);       // Reads to the read range are 16-bit, and
+      PCFX_V810->SetMemWriteBus32(i, TRUE);       // writes are 32-bit.
    }
 
    // Bitstring write range
    for(int i = 0xB0; i <= 0xBF; i++)
    {
-      PCFX_V810.SetMemReadBus32(i, TRUE);	// Reads to the write range are 32-bit,
-      PCFX_V810.SetMemWriteBus32(i, FALSE);	// but writes are 16-bit!
+      PCFX_V810->SetMemReadBus32(i, TRUE);	// Reads to the write range are 32-bit,
+      PCFX_V810->SetMemWriteBus32(i, FALSE);	// but writes are 16-bit!
    }
 
    // BIOS area
    for(int i = 0xF0; i <= 0xFF; i++)
    {
-      PCFX_V810.SetMemReadBus32(i, FALSE);
-      PCFX_V810.SetMemWriteBus32(i, FALSE);
+      PCFX_V810->SetMemReadBus32(i, FALSE);
+      PCFX_V810->SetMemWriteBus32(i, FALSE);
    }
 
-   PCFX_V810.SetMemReadHandlers(mem_rbyte, mem_rhword, mem_rword);
-   PCFX_V810.SetMemWriteHandlers(mem_wbyte, mem_whword, mem_wword);
+   InitMemRegions();
+
+   PCFX_V810->SetMemReadHandlers(mem_rbyte, mem_rhword, mem_rword);
+   PCFX_V810->SetMemWriteHandlers(mem_wbyte, mem_whword, mem_wword);
+
+   PCFX_MemBus::RAM = pcfx->RAM;
+   PCFX_MemBus::BIOSROM = pcfx->BIOSROM;
+   PCFX_V810->SetMemMap(V810_MEM_MAP_PCFX);
+
+   PCFX_V810->SetIOReadHandlers(port_rbyte, port_rhword, NULL);
+   PCFX_V810->SetIOWriteHandlers(port_wbyte, port_whword, NULL);
 
-   PCFX_V810.SetIOReadHandlers(port_rbyte, port_rhword, NULL);
-   PCFX_V810.SetIOWriteHandlers(port_wbyte, port_whword, NULL);
+   PCFX_V810->ResetIdleLoopStats();
+   PCFX_V810->ResetICacheStats();
+   if(MDFN_GetSettingB("pcfx.idle_loop_skip"))
+      PCFX_V810->SetIdleLoopReadChecks(mem_idle_read_check, port_idle_read_check);
 
 
 
@@ -641,7 +1142,7 @@ FoundIt: ;
 
          if(found_entry)
          {
-            EmuFlags = found_entry->flags;
+            pcfx->EmuFlags = found_entry->flags;
 
             if(found_entry->discs > 1)
             {
@@ -706,9 +1207,9 @@ static bool TestMagicCD(std::vector<CDIF *> *CDInterfaces)
 
 static int LoadCD(std::vector<CDIF *> *CDInterfaces)
 {
- EmuFlags = 0;
+ pcfx->EmuFlags = 0;
 
- cdifs = CDInterfaces;
+ pcfx->cdifs = CDInterfaces;
 
  DoMD5CDVoodoo(CDInterfaces);
 
@@ -726,46 +1227,46 @@ static int LoadCD(std::vector<CDIF *> *CDInterfaces)
 
 static void PCFX_CDInsertEject(void)
 {
- CD_TrayOpen = !CD_TrayOpen;
+ pcfx->CD_TrayOpen = !pcfx->CD_TrayOpen;
 
- for(unsigned disc = 0; disc < cdifs->size(); disc++)
+ for(unsigned disc = 0; disc < pcfx->cdifs->size(); disc++)
  {
 #if 0
-  if(!(*cdifs)[disc]->Eject(CD_TrayOpen))
+  if(!(*pcfx->cdifs)[disc]->Eject(pcfx->CD_TrayOpen))
   {
    MDFN_DispMessage("Eject error.");
-   CD_TrayOpen = !CD_TrayOpen;
+   pcfx->CD_TrayOpen = !pcfx->CD_TrayOpen;
   }
 #endif
  }
 
- if(CD_TrayOpen)
+ if(pcfx->CD_TrayOpen)
   MDFN_DispMessage("Virtual CD Drive Tray Open");
  else
   MDFN_DispMessage("Virtual CD Drive Tray Closed");
 
- SCSICD_SetDisc(CD_TrayOpen, (CD_SelectedDisc >= 0 && !CD_TrayOpen) ? (*cdifs)[CD_SelectedDisc] : NULL);
+ SCSICD_SetDisc(pcfx->CD_TrayOpen, (pcfx->CD_SelectedDisc >= 0 && !pcfx->CD_TrayOpen) ? (*pcfx->cdifs)[pcfx->CD_SelectedDisc] : NULL);
 }
 
 static void PCFX_CDEject(void)
 {
- if(!CD_TrayOpen)
+ if(!pcfx->CD_TrayOpen)
   PCFX_CDInsertEject();
 }
 
 static void PCFX_CDSelect(void)
 {
- if(cdifs && CD_TrayOpen)
+ if(pcfx->cdifs && pcfx->CD_TrayOpen)
  {
-  CD_SelectedDisc = (CD_SelectedDisc + 1) % (cdifs->size() + 1);
+  pcfx->CD_SelectedDisc = (pcfx->CD_SelectedDisc + 1) % (pcfx->cdifs->size() + 1);
 
-  if((unsigned)CD_SelectedDisc == cdifs->size())
-   CD_SelectedDisc = -1;
+  if((unsigned)pcfx->CD_SelectedDisc == pcfx->cdifs->size())
+   pcfx->CD_SelectedDisc = -1;
 
-  if(CD_SelectedDisc == -1)
+  if(pcfx->CD_SelectedDisc == -1)
    MDFN_DispMessage("Disc absence selected.");
   else
-   MDFN_DispMessage("Disc %d of %d selected.", CD_SelectedDisc + 1, (int)cdifs->size());
+   MDFN_DispMessage("Disc %d of %d selected.", pcfx->CD_SelectedDisc + 1, (int)pcfx->cdifs->size());
  }
 }
 
@@ -782,14 +1283,38 @@ static void CloseGame(void)
       }
    }
 
+   if(PCFX_V810->GetEmuMode() == V810_EMU_MODE_FAST)
+   {
+      const V810::IdleLoopStats &idle_stats = PCFX_V810->GetIdleLoopStats();
+
+      MDFN_printf("Idle loops: %llu found, %llu skipped to the next event, %.2f seconds of CPU time skipped\n",
+            (unsigned long long)idle_stats.found, (unsigned long long)idle_stats.skips, idle_stats.skipped_cycles / PCFX_MASTER_CLOCK);
+   }
+   else if(PCFX_V810->GetEmuMode() == V810_EMU_MODE_ACCURATE)
+   {
+      const V810::ICacheStats &icache_stats = PCFX_V810->GetICacheStats();
+      const uint64 fetches = icache_stats.hits + icache_stats.misses;
+
+      MDFN_printf("Instruction cache: %llu hits, %llu misses(%.2f%% hit rate)\n",
+            (unsigned long long)icache_stats.hits, (unsigned long long)icache_stats.misses, fetches ? icache_stats.hits * 100.0 / fetches : 0.0);
+   }
+
    RAINBOW_Close();
    KING_Close();
    SoundBox_Kill();
-   PCFX_V810.Kill();
+   PCFX_V810->Kill();
 
-   // The allocated memory RAM and BIOSROM is free'd in V810_Kill()
-   RAM = NULL;
-   BIOSROM = NULL;
+   // The allocated memory RAM is free'd in V810_Kill()
+   pcfx->RAM = NULL;
+   pcfx->RAMExposed = false;
+   pcfx->BIOSROM = NULL;
+   if(pcfx->BIOS)
+   {
+      ReleaseBIOS(pcfx->BIOS);
+      pcfx->BIOS = NULL;
+   }
+   PCFX_MemBus::RAM = NULL;
+   PCFX_MemBus::BIOSROM = NULL;
 }
 
 static void DoSimpleCommand(int cmd)
@@ -815,19 +1340,19 @@ static void DoSimpleCommand(int cmd)
 
 extern "C" int StateAction(StateMem *sm, int load, int data_only)
 {
-   const v810_timestamp_t timestamp = PCFX_V810.v810_timestamp;
+   const v810_timestamp_t timestamp = PCFX_V810->v810_timestamp;
 
    SFORMAT StateRegs[] =
    {
-      SFARRAY(RAM, 0x200000),
-      SFARRAY16(Last_VDC_AR, 2),
-      SFVAR(BackupControl),
-      SFVAR(ExBusReset),
-      SFARRAY(BackupRAM, BRAMDisabled ? 0 : 0x8000),
-      SFARRAY(ExBackupRAM, BRAMDisabled ? 0 : 0x8000),
+      SFARRAYN(pcfx->RAM, 0x200000, "RAM"),
+      SFARRAY16N(pcfx->Last_VDC_AR, 2, "Last_VDC_AR"),
+      SFVARN(pcfx->BackupControl, "BackupControl"),
+      SFVARN(pcfx->ExBusReset, "ExBusReset"),
+      SFARRAYN(pcfx->BackupRAM, pcfx->BRAMDisabled ? 0 : 0x8000, "BackupRAM"),
+      SFARRAYN(pcfx->ExBackupRAM, pcfx->BRAMDisabled ? 0 : 0x8000, "ExBackupRAM"),
 
-      SFVAR(CD_TrayOpen),
-      SFVAR(CD_SelectedDisc),
+      SFVARN(pcfx->CD_TrayOpen, "CD_TrayOpen"),
+      SFVARN(pcfx->CD_SelectedDisc, "CD_SelectedDisc"),
 
       SFEND
    };
@@ -840,7 +1365,7 @@ extern "C" int StateAction(StateMem *sm, int load, int data_only)
    ret &= FXINPUT_StateAction(sm, load, data_only);
    ret &= PCFXIRQ_StateAction(sm, load, data_only);
    ret &= KING_StateAction(sm, load, data_only);
-   ret &= PCFX_V810.StateAction(sm, load, data_only);
+   ret &= PCFX_V810->StateAction(sm, load, data_only);
    ret &= FXTIMER_StateAction(sm, load, data_only);
    ret &= SoundBox_StateAction(sm, load, data_only);
    ret &= SCSICD_StateAction(sm, load, data_only, "CDRM");
@@ -854,17 +1379,17 @@ extern "C" int StateAction(StateMem *sm, int load, int data_only)
       //
       ForceEventUpdates(timestamp);
 
-      if(cdifs)
+      if(pcfx->cdifs)
       {
          // Sanity check.
-         if(CD_SelectedDisc >= (int)cdifs->size())
-            CD_SelectedDisc = (int)cdifs->size() - 1;
+         if(pcfx->CD_SelectedDisc >= (int)pcfx->cdifs->size())
+            pcfx->CD_SelectedDisc = (int)pcfx->cdifs->size() - 1;
 
-         SCSICD_SetDisc(CD_TrayOpen, (CD_SelectedDisc >= 0 && !CD_TrayOpen) ? (*cdifs)[CD_SelectedDisc] : NULL, true);
+         SCSICD_SetDisc(pcfx->CD_TrayOpen, (pcfx->CD_SelectedDisc >= 0 && !pcfx->CD_TrayOpen) ? (*pcfx->cdifs)[pcfx->CD_SelectedDisc] : NULL, true);
       }
    }
 
-   //printf("0x%08x, %d %d %d %d\n", load, next_pad_ts, next_timer_ts, next_adpcm_ts, next_king_ts);
+   //printf("0x%08x, %d\n", load, CalcNextTS());
 
    return(ret);
 }
@@ -888,18 +1413,13 @@ MDFNGI EmulatedPCFX =
  2,     // Number of output sound channels
 };
 
-#ifdef NEED_DEINTERLACER
-static bool PrevInterlaced;
-static Deinterlacer deint;
-#endif
-
 #define MEDNAFEN_CORE_NAME_MODULE "pcfx"
 #define MEDNAFEN_CORE_NAME "Beetle PC-FX"
 #define MEDNAFEN_CORE_VERSION "v0.9.36.5"
 #define MEDNAFEN_CORE_EXTENSIONS "cue|ccd|toc|chd"
 #define MEDNAFEN_CORE_TIMING_FPS 59.94
-#define MEDNAFEN_CORE_GEOMETRY_BASE_W (game->nominal_width)
-#define MEDNAFEN_CORE_GEOMETRY_BASE_H (game->nominal_height)
+#define MEDNAFEN_CORE_GEOMETRY_BASE_W (pcfx->game->nominal_width)
+#define MEDNAFEN_CORE_GEOMETRY_BASE_H (pcfx->game->nominal_height)
 #define MEDNAFEN_CORE_GEOMETRY_MAX_W 1024
 #define MEDNAFEN_CORE_GEOMETRY_MAX_H 480
 #define MEDNAFEN_CORE_GEOMETRY_ASPECT_RATIO (4.0 / 3.0)
@@ -926,6 +1446,12 @@ void retro_init(void)
 
    CDUtility_Init();
 
+   if (!default_instance)
+   {
+      default_instance = PCFX_CreateInstance();
+      PCFX_SelectInstance(default_instance);
+   }
+
    const char *dir = NULL;
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &dir) && dir)
@@ -937,8 +1463,6 @@ void retro_init(void)
          last++;
 
       retro_base_directory = retro_base_directory.substr(0, last);
-
-      return;
    }
    else
    {
@@ -973,6 +1497,9 @@ void retro_init(void)
       log_cb(RETRO_LOG_INFO, "Frontend supports RGB565 - will use that instead of XRGB1555.\n");
 #endif
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
+
    if (environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
       perf_get_cpu_features_cb = perf_cb.get_cpu_features;
    else
@@ -1010,6 +1537,30 @@ static void check_variables(void)
 {
    struct retro_variable var = {0};
 
+   var.key = "pcfx_cpu_emulation";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "fast") == 0)
+         setting_cpu_emulation = V810_EMU_MODE_FAST;
+      else if (strcmp(var.value, "accurate") == 0)
+         setting_cpu_emulation = V810_EMU_MODE_ACCURATE;
+      else if (strcmp(var.value, "recompiler") == 0)
+         setting_cpu_emulation = V810_EMU_MODE_JIT;
+      else
+         setting_cpu_emulation = -1;
+   }
+
+   var.key = "pcfx_idle_loop_skip";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "disabled") == 0)
+         setting_idle_loop_skip = 0;
+      else if (strcmp(var.value, "enabled") == 0)
+         setting_idle_loop_skip = 1;
+   }
+
    var.key = "pcfx_high_dotclock_width";
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -1085,13 +1636,44 @@ static void check_variables(void)
       mouse_sensitivity = atof(var.value);
    }
 
+   var.key = "pcfx_fastforward_frameskip";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "disabled") == 0)
+         fastforward_frameskip = 0;
+      else
+         fastforward_frameskip = atoi(var.value);
+   }
+
+   var.key = "pcfx_profiling";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0 && !PCFX_Prof.clock)
+      {
+         if (perf_cb.get_perf_counter)
+         {
+            for (unsigned i = 0; i < PCFX_PROF__COUNT; i++)
+            {
+               if (!ProfCounters[i].registered)
+               {
+                  ProfCounters[i].ident = PCFX_Prof_Name(i);
+                  if (perf_cb.perf_register)
+                     perf_cb.perf_register(&ProfCounters[i]);
+               }
+            }
+            PCFX_Prof_Start(perf_cb.get_perf_counter);
+         }
+         else if (log_cb)
+            log_cb(RETRO_LOG_WARN, "Frontend has no performance counter, profiling is unavailable.\n");
+      }
+      else if (strcmp(var.value, "disabled") == 0 && PCFX_Prof.clock)
+         PCFX_Prof_Stop();
+   }
 }
 
-#define MAX_PLAYERS 2
 #define MAX_BUTTONS 15
-static uint32_t input_type[MAX_PLAYERS] = {0};
-static uint16_t input_buf[MAX_PLAYERS] = {0};
-static int32_t  mousedata[MAX_PLAYERS][3] = {{0}, {0}};
 
 static bool ReadM3U(std::vector<std::string> &file_list, std::string path, unsigned depth = 0)
 {
@@ -1148,7 +1730,6 @@ void MDFN_ResetMessages(void)
  MDFND_DispMessage(NULL);
 }
 
- static std::vector<CDIF *> CDInterfaces;	// FIXME: Cleanup on error out.
 // TODO: LoadCommon()
 
 MDFNGI *MDFNI_LoadCD(const char *devicename)
@@ -1166,23 +1747,23 @@ MDFNGI *MDFNI_LoadCD(const char *devicename)
    for(unsigned i = 0; i < file_list.size(); i++)
    {
       CDIF *cdif   = CDIF_Open(file_list[i].c_str(), false /* cdimage_memcache */);
-      CDInterfaces.push_back(cdif);
+      pcfx->CDInterfaces.push_back(cdif);
    }
   }
   else
   {
      CDIF *cdif   = CDIF_Open(devicename, false /* cdimage_memcache */);
-   CDInterfaces.push_back(cdif);
+   pcfx->CDInterfaces.push_back(cdif);
   }
 
  //
  // Print out a track list for all discs.
  //
- for(unsigned i = 0; i < CDInterfaces.size(); i++)
+ for(unsigned i = 0; i < pcfx->CDInterfaces.size(); i++)
  {
   TOC toc;
 
-  CDInterfaces[i]->ReadTOC(&toc);
+  pcfx->CDInterfaces[i]->ReadTOC(&toc);
 
   MDFN_printf("CD %d Layout:\n", i + 1);
 
@@ -1202,11 +1783,11 @@ MDFNGI *MDFNI_LoadCD(const char *devicename)
 
   mednafen_md5_starts(&layout_md5);
 
-  for(unsigned i = 0; i < CDInterfaces.size(); i++)
+  for(unsigned i = 0; i < pcfx->CDInterfaces.size(); i++)
   {
    TOC toc;
 
-   CDInterfaces[i]->ReadTOC(&toc);
+   pcfx->CDInterfaces[i]->ReadTOC(&toc);
 
    mednafen_md5_update_u32_as_lsb(&layout_md5, toc.first_track);
    mednafen_md5_update_u32_as_lsb(&layout_md5, toc.last_track);
@@ -1227,11 +1808,11 @@ MDFNGI *MDFNI_LoadCD(const char *devicename)
  // TODO: include module name in hash
  memcpy(MDFNGameInfo->MD5, LayoutMD5, 16);
 
- if(!(LoadCD(&CDInterfaces)))
+ if(!(LoadCD(&pcfx->CDInterfaces)))
  {
-  for(unsigned i = 0; i < CDInterfaces.size(); i++)
-   delete CDInterfaces[i];
-  CDInterfaces.clear();
+  for(unsigned i = 0; i < pcfx->CDInterfaces.size(); i++)
+   delete pcfx->CDInterfaces[i];
+  pcfx->CDInterfaces.clear();
 
   MDFNGameInfo = NULL;
   return(0);
@@ -1373,24 +1954,32 @@ bool retro_load_game(const struct retro_game_info *info)
 
    check_variables();
 
-   game = MDFNI_LoadGame(info->path);
-   if (!game)
+   pcfx->game = MDFNI_LoadGame(info->path);
+   if (!pcfx->game)
       return false;
 
+   prof_title = info->path;
+   prof_title = prof_title.substr(prof_title.find_last_of("/\\") + 1);
+   prof_title = prof_title.substr(0, prof_title.find_last_of('.'));
+   if (PCFX_Prof.clock)
+      PCFX_Prof_Start(PCFX_Prof.clock);
+
    MDFN_PixelFormat pix_fmt(MDFN_COLORSPACE_RGB, 16, 8, 0, 24);
-   last_pixel_format = MDFN_PixelFormat();
+   pcfx->last_pixel_format = MDFN_PixelFormat();
    
-   surf = new MDFN_Surface(NULL, FB_WIDTH, FB_HEIGHT, FB_WIDTH, pix_fmt);
+   pcfx->surf = new MDFN_Surface(NULL, FB_WIDTH, FB_HEIGHT, FB_WIDTH, pix_fmt);
 
 #ifdef NEED_DEINTERLACER
-	PrevInterlaced = false;
-	deint.ClearState();
+	pcfx->PrevInterlaced = false;
+	pcfx->deint.ClearState();
 #endif
 
    for (unsigned i = 0; i < MAX_PLAYERS; i++)
-      FXINPUT_SetInput(i, "gamepad", &input_buf[i]);
+      FXINPUT_SetInput(i, "gamepad", &pcfx->input_buf[i]);
 
-   return game;
+   pcfx->serialize_size = 0;
+
+   return pcfx->game;
 }
 
 static void MDFNI_CloseGame(void)
@@ -1406,22 +1995,37 @@ static void MDFNI_CloseGame(void)
 
    MDFNGameInfo = NULL;
 
-   for(unsigned i = 0; i < CDInterfaces.size(); i++)
-      delete CDInterfaces[i];
-   CDInterfaces.clear();
+   for(unsigned i = 0; i < pcfx->CDInterfaces.size(); i++)
+      delete pcfx->CDInterfaces[i];
+   pcfx->CDInterfaces.clear();
 }
 
 void retro_unload_game(void)
 {
-   if (!game)
+   if (!pcfx->game)
       return;
 
+   if (PCFX_Prof.clock && PCFX_Prof.frames)
+   {
+#ifdef _WIN32
+      std::string path = retro_save_directory + '\\' + prof_title + ".profile.json";
+#else
+      std::string path = retro_save_directory + '/' + prof_title + ".profile.json";
+#endif
+
+      if (!PCFX_Prof_Dump(path.c_str(), prof_title.c_str()) && log_cb)
+         log_cb(RETRO_LOG_WARN, "Couldn't write profile to \"%s\".\n", path.c_str());
+
+      if (perf_cb.perf_log)
+         perf_cb.perf_log();
+   }
+
    MDFNI_CloseGame();
 }
 
 static void update_input(void)
 {
-   input_buf[0] = input_buf[1] = 0;
+   pcfx->input_buf[0] = pcfx->input_buf[1] = 0;
    static unsigned map[] = {
       RETRO_DEVICE_ID_JOYPAD_A,
       RETRO_DEVICE_ID_JOYPAD_B,
@@ -1442,11 +2046,11 @@ static void update_input(void)
 
    for (unsigned j = 0; j < MAX_PLAYERS; j++)
    {
-      switch (input_type[j])
+      switch (pcfx->input_type[j])
       {
          case RETRO_DEVICE_JOYPAD:
             for (unsigned i = 0; i < MAX_BUTTONS; i++)
-               input_buf[j] |= map[i] != -1u &&
+               pcfx->input_buf[j] |= map[i] != -1u &&
                   input_state_cb(j, RETRO_DEVICE_JOYPAD, 0, map[i]) ? (1 << i) : 0;
 
 #ifdef MSB_FIRST
@@ -1454,30 +2058,28 @@ static void update_input(void)
                uint8_t b[2];
                uint16_t s;
             } u;
-            u.s = input_buf[j];
-            input_buf[j] = u.b[0] | u.b[1] << 8;
+            u.s = pcfx->input_buf[j];
+            pcfx->input_buf[j] = u.b[0] | u.b[1] << 8;
 #endif
             break;
          case RETRO_DEVICE_MOUSE:
-            mousedata[j][2] = 0;
+            pcfx->mousedata[j][2] = 0;
 
             int _x = input_state_cb(j, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_X);
             int _y = input_state_cb(j, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_Y);
 
-            mousedata[j][0] = (int)roundf(_x * mouse_sensitivity);
-            mousedata[j][1] = (int)roundf(_y * mouse_sensitivity);
+            pcfx->mousedata[j][0] = (int)roundf(_x * mouse_sensitivity);
+            pcfx->mousedata[j][1] = (int)roundf(_y * mouse_sensitivity);
 
             if (input_state_cb(j, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_LEFT))
-               mousedata[j][2] |= (1 << 0);
+               pcfx->mousedata[j][2] |= (1 << 0);
             if (input_state_cb(j, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_RIGHT))
-               mousedata[j][2] |= (1 << 1);
+               pcfx->mousedata[j][2] |= (1 << 1);
             break;
       }
    }
 }
 
-static uint64_t video_frames, audio_frames;
-
 void update_geometry(unsigned width, unsigned height)
 {
    struct retro_system_av_info system_av_info;
@@ -1489,22 +2091,47 @@ void update_geometry(unsigned width, unsigned height)
    environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &system_av_info);
 }
 
+// Whether to skip drawing this frame; emulation still runs in full, only the pixels aren't produced.
+static bool SkipThisFrame(void)
+{
+   int av_enable = 0;
+   bool fastforwarding = false;
+
+   // The frontend won't show the frame(e.g. it's one of run-ahead's hidden frames).
+   if (environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable) && !(av_enable & 1))
+      return true;
+
+   // Otherwise a skipped frame must be passed on as a dupe.
+   if (fastforward_frameskip && can_dupe && environ_cb(RETRO_ENVIRONMENT_GET_FASTFORWARDING, &fastforwarding) && fastforwarding)
+   {
+      if (pcfx->frames_skipped < fastforward_frameskip)
+      {
+         pcfx->frames_skipped++;
+         return true;
+      }
+   }
+
+   pcfx->frames_skipped = 0;
+   return false;
+}
+
 void retro_run()
 {
-   MDFNGI *curgame = game;
+   MDFNGI *curgame = pcfx->game;
 
    input_poll_cb();
 
    update_input();
 
+   PCFX_Prof_BeginFrame();
+
    static int16_t sound_buf[0x10000];
    static int32 rects[FB_MAX_HEIGHT];
-   static unsigned width, height;
    bool resolution_changed = false;
    rects[0] = ~0;
 
    EmulateSpecStruct spec = {0};
-   spec.surface = surf;
+   spec.surface = pcfx->surf;
    spec.SoundRate = 44100;
    spec.SoundBuf = sound_buf;
    spec.LineWidths = rects;
@@ -1514,37 +2141,43 @@ void retro_run()
    spec.SoundBufSize = 0;
    spec.VideoFormatChanged = false;
    spec.SoundFormatChanged = false;
+   spec.skip = SkipThisFrame();
 
-   if (memcmp(&last_pixel_format, &spec.surface->format, sizeof(MDFN_PixelFormat)))
+   if (memcmp(&pcfx->last_pixel_format, &spec.surface->format, sizeof(MDFN_PixelFormat)))
    {
       spec.VideoFormatChanged = TRUE;
 
-      last_pixel_format = spec.surface->format;
+      pcfx->last_pixel_format = spec.surface->format;
    }
 
-   if (spec.SoundRate != last_sound_rate)
+   if (spec.SoundRate != pcfx->last_sound_rate)
    {
       spec.SoundFormatChanged = true;
-      last_sound_rate = spec.SoundRate;
+      pcfx->last_sound_rate = spec.SoundRate;
    }
 
+   // The frontend can write RAM behind the CPU's back(cheats, debuggers), which would leave stale recompiled or
+   // pre-decoded code around.
+   if (pcfx->RAMExposed)
+      PCFX_V810->RevalidateCode();
+
    Emulate(&spec);
 
 #ifdef NEED_DEINTERLACER
    if (spec.InterlaceOn)
    {
-      if (!PrevInterlaced)
-         deint.ClearState();
+      if (!pcfx->PrevInterlaced)
+         pcfx->deint.ClearState();
 
-      deint.Process(spec.surface, spec.DisplayRect, spec.LineWidths, spec.InterlaceField);
+      pcfx->deint.Process(spec.surface, spec.DisplayRect, spec.LineWidths, spec.InterlaceField);
 
-      PrevInterlaced = true;
+      pcfx->PrevInterlaced = true;
 
       spec.InterlaceOn = false;
       spec.InterlaceField = 0;
    }
    else
-      PrevInterlaced = false;
+      pcfx->PrevInterlaced = false;
 #endif
 
    int16 *const SoundBuf = spec.SoundBuf + spec.SoundBufSizeALMS * curgame->soundchan;
@@ -1553,32 +2186,44 @@ void retro_run()
 
    spec.SoundBufSize = spec.SoundBufSizeALMS + SoundBufSize;
 
-   if (width  != spec.DisplayRect.w || height != spec.DisplayRect.h)
-      resolution_changed = true;
+   // A skipped frame's DisplayRect isn't filled in(and KING clears spec.skip if it drew the frame anyway).
+   if (!spec.skip)
+   {
+      if (pcfx->width  != spec.DisplayRect.w || pcfx->height != spec.DisplayRect.h)
+         resolution_changed = true;
+
+      pcfx->width  = spec.DisplayRect.w;
+      pcfx->height = spec.DisplayRect.h;
+   }
 
-   width  = spec.DisplayRect.w;
-   height = spec.DisplayRect.h;
+   PCFX_Prof_EndFrame();
 
 #if defined(WANT_32BPP)
-   const uint32_t *pix = surf->pixels;
-   video_cb(pix + surf->pitchinpix * spec.DisplayRect.y, width, height, FB_WIDTH << 2);
+   const uint32_t *pix = pcfx->surf->pixels;
+   if (spec.skip && can_dupe)
+      video_cb(NULL, pcfx->width, pcfx->height, FB_WIDTH << 2);
+   else
+      video_cb(pix + pcfx->surf->pitchinpix * spec.DisplayRect.y, pcfx->width, pcfx->height, FB_WIDTH << 2);
 #elif defined(WANT_16BPP)
-   const uint16_t *pix = surf->pixels16;
-   video_cb(pix, width, height, FB_WIDTH << 1);
+   const uint16_t *pix = pcfx->surf->pixels16;
+   if (spec.skip && can_dupe)
+      video_cb(NULL, pcfx->width, pcfx->height, FB_WIDTH << 1);
+   else
+      video_cb(pix, pcfx->width, pcfx->height, FB_WIDTH << 1);
 #endif
 
    bool updated = false;
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
    {
       check_variables();
-      update_geometry(width, height);
+      update_geometry(pcfx->width, pcfx->height);
    }
 
    if (resolution_changed)
-	update_geometry(width, height);
+	update_geometry(pcfx->width, pcfx->height);
 
-   video_frames++;
-   audio_frames += spec.SoundBufSize;
+   pcfx->video_frames++;
+   pcfx->audio_frames += spec.SoundBufSize;
 
    audio_batch_cb(spec.SoundBuf, spec.SoundBufSize);
 
@@ -1611,15 +2256,18 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 
 void retro_deinit()
 {
-   delete surf;
-   surf = NULL;
-
-   if (log_cb)
+   if (log_cb && pcfx)
    {
       log_cb(RETRO_LOG_INFO, "[%s]: Samples / Frame: %.5f\n",
-            mednafen_core_str, (double)audio_frames / video_frames);
+            mednafen_core_str, (double)pcfx->audio_frames / pcfx->video_frames);
       log_cb(RETRO_LOG_INFO, "[%s]: Estimated FPS: %.5f\n",
-            mednafen_core_str, (double)video_frames * 44100 / audio_frames);
+            mednafen_core_str, (double)pcfx->video_frames * 44100 / pcfx->audio_frames);
+   }
+
+   if (default_instance)
+   {
+      PCFX_DestroyInstance(default_instance);
+      default_instance = NULL;
    }
 }
 
@@ -1640,13 +2288,13 @@ void retro_set_controller_port_device(unsigned in_port, unsigned device)
       switch(device)
       {
          case RETRO_DEVICE_JOYPAD:
-            input_type[in_port] = RETRO_DEVICE_JOYPAD;
-            FXINPUT_SetInput(in_port, "gamepad", &input_buf[in_port]);
+            pcfx->input_type[in_port] = RETRO_DEVICE_JOYPAD;
+            FXINPUT_SetInput(in_port, "gamepad", &pcfx->input_buf[in_port]);
             log_cb(RETRO_LOG_INFO," Port %d: gamepad\n", in_port +1);
             break;
          case RETRO_DEVICE_MOUSE:
-            input_type[in_port] = RETRO_DEVICE_MOUSE;
-            FXINPUT_SetInput(in_port, "mouse", &mousedata[in_port]);
+            pcfx->input_type[in_port] = RETRO_DEVICE_MOUSE;
+            FXINPUT_SetInput(in_port, "mouse", &pcfx->mousedata[in_port]);
             log_cb(RETRO_LOG_INFO," Port %d: mouse\n", in_port +1);
             break;
       }
@@ -1703,12 +2351,15 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
    video_cb = cb;
 }
 
-static size_t serialize_size;
-
+// The state's size doesn't change while a game is loaded, so it's only measured once; that also records the
+// layout MDFNSS_SaveSMFast() needs.
 size_t retro_serialize_size(void)
 {
    StateMem st;
 
+   if (pcfx->serialize_size)
+      return pcfx->serialize_size;
+
    st.data           = NULL;
    st.loc            = 0;
    st.len            = 0;
@@ -1719,27 +2370,38 @@ size_t retro_serialize_size(void)
       return 0;
 
    free(st.data);
-   return serialize_size = st.len;
+   return pcfx->serialize_size = st.len;
 }
 
 bool retro_serialize(void *data, size_t size)
 {
    StateMem st;
    bool ret          = false;
-   uint8_t *_dat     = (uint8_t*)malloc(size);
-
-   if (!_dat)
-      return false;
 
-   st.data           = _dat;
+   st.data           = (uint8_t*)data;
    st.loc            = 0;
    st.len            = 0;
    st.malloced       = size;
    st.initial_malloc = 0;
 
-   ret = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   if (MDFNSS_SaveSMFast(&st))
+      return true;
+
+   // No layout yet, or it changed; build the state the slow way, which records a new one.
+   st.data           = NULL;
+   st.loc            = 0;
+   st.len            = 0;
+   st.malloced       = 0;
+   st.initial_malloc = size;
+
+   ret = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL) && st.len <= size;
+
+   if (ret)
+   {
+      memcpy(data, st.data, st.len);
+      pcfx->serialize_size = st.len;
+   }
 
-   memcpy(data,st.data,size);
    free(st.data);
    return ret;
 }
@@ -1762,9 +2424,11 @@ void *retro_get_memory_data(unsigned type)
    switch (type)
    {
       case RETRO_MEMORY_SAVE_RAM:
-         return (uint8_t*)SaveRAM;
+         return (uint8_t*)pcfx->SaveRAM;
       case RETRO_MEMORY_SYSTEM_RAM:
-         return RAM;
+         if (pcfx->RAM)
+            pcfx->RAMExposed = true;
+         return pcfx->RAM;
       default:
          break;
    }
@@ -1777,7 +2441,7 @@ size_t retro_get_memory_size(unsigned type)
    switch (type)
    {
       case RETRO_MEMORY_SAVE_RAM:
-         return sizeof(SaveRAM);
+         return sizeof(pcfx->SaveRAM);
       case RETRO_MEMORY_SYSTEM_RAM:
          return (2048 * 1024);
       default:
@@ -29,6 +29,30 @@ extern "C" {
 #define MAX_CORE_OPTIONS 32
 
 struct retro_core_option_definition option_defs_us[] = {
+   {
+      "pcfx_cpu_emulation",
+      "CPU Emulation (Restart)",
+      "V810 emulation mode. 'auto' uses the accurate interpreter for the few games that need it and the fast one otherwise. 'recompiler' translates V810 code to native x86-64 code and falls back to the fast interpreter on other hosts.",
+      {
+         { "auto",       NULL },
+         { "fast",       NULL },
+         { "accurate",   NULL },
+         { "recompiler", NULL },
+         { NULL, NULL},
+      },
+      "auto",
+   },
+   {
+      "pcfx_idle_loop_skip",
+      "Idle Loop Skipping (Restart)",
+      "Lets the fast interpreter skip ahead to the next event when a game sits in a loop polling hardware status, as it already does for HALT. Saves host CPU time, but it's a speed hack that can change timing; leave it disabled unless a game is known to work with it.",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL},
+      },
+      "disabled",
+   },
    {
       "pcfx_high_dotclock_width",
       "High Dotclock Width (Restart)",
@@ -217,6 +241,32 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "1.25",
    },
+   {
+      "pcfx_fastforward_frameskip",
+      "Frameskip when Fast-Forwarding",
+      "Skip drawing this many frames for every one shown while the frontend is fast-forwarding. Emulation is unaffected, only less video is produced. Frames the frontend won't show, such as run-ahead's, are always skipped.",
+      {
+         { "disabled", NULL },
+         { "1",        NULL },
+         { "2",        NULL },
+         { "3",        NULL },
+         { "4",        NULL },
+         { "5",        NULL },
+         { NULL, NULL},
+      },
+      "disabled",
+   },
+   {
+      "pcfx_profiling",
+      "Profiling",
+      "Measures the host time each part of the emulator takes per frame, through the frontend's performance counters, and writes a summary to '<content name>.profile.json' in the save directory when the content is closed. Slows emulation slightly.",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL},
+      },
+      "disabled",
+   },
    { NULL, NULL, NULL, { NULL, NULL }, NULL },
 };
 
@@ -21,6 +21,7 @@
 #include "cdromif.h"
 #include "CDAccess.h"
 #include "../general.h"
+#include "../pcfx/profile.h"
 
 #include <algorithm>
 
@@ -420,6 +421,8 @@ bool CDIF_MT::ReadRawSector(uint8_t *buf, int32_t lba)
 
    ReadThreadQueue.Write(CDIF_Message(CDIF_MSG_READ_SECTOR, lba));
 
+   const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_CD_WAIT);
+
    slock_lock(SBMutex);
 
    do
@@ -440,6 +443,8 @@ bool CDIF_MT::ReadRawSector(uint8_t *buf, int32_t lba)
 
    slock_unlock(SBMutex);
 
+   PCFX_Prof_Leave(prof);
+
    return(!error_condition);
 }
 
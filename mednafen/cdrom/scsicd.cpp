@@ -30,32 +30,14 @@
 #include "../mednafen-endian.h"
 #include "../state_helpers.h"
 
-static uint32_t CD_DATA_TRANSFER_RATE;
-static uint32_t System_Clock;
-static void (*CDIRQCallback)(int);
-static void (*CDStuffSubchannels)(uint8_t, int);
-static int32_t* HRBufs[2];
-static int WhichSystem;
-
-static CDIF *Cur_CDIF;
-static bool TrayOpen;
-
 // Internal operation to the SCSI CD unit.  Only pass 1 or 0 to these macros!
-#define SetIOP(mask, set)	{ cd_bus.signals &= ~mask; if(set) cd_bus.signals |= mask; }
+#define SetIOP(mask, set)	{ cd_bus->signals &= ~mask; if(set) cd_bus->signals |= mask; }
 
 #define SetBSY(set)		SetIOP(SCSICD_BSY_mask, set)
 #define SetIO(set)              SetIOP(SCSICD_IO_mask, set)
 #define SetCD(set)              SetIOP(SCSICD_CD_mask, set)
 #define SetMSG(set)             SetIOP(SCSICD_MSG_mask, set)
 
-static INLINE void SetREQ(bool set)
-{
- if(set && !REQ_signal)
-  CDIRQCallback(SCSICD_IRQ_MAGICAL_REQ);
-
- SetIOP(SCSICD_REQ_mask, set);
-}
-
 #define SetkingACK(set)		SetIOP(SCSICD_kingACK_mask, set)
 #define SetkingRST(set)         SetIOP(SCSICD_kingRST_mask, set)
 #define SetkingSEL(set)         SetIOP(SCSICD_kingSEL_mask, set)
@@ -163,26 +145,58 @@ void MakeSense(uint8_t * target, uint8_t key, uint8_t asc, uint8_t ascq, uint8_t
 static void (*SCSILog)(const char *, const char *format, ...);
 static void InitModePages(void);
 
-static scsicd_timestamp_t lastts;
-static int64_t monotonic_timestamp;
-static int64_t pce_lastsapsp_timestamp;
+static const int NumModePages = 5;	// See ModePages[] below
 
-scsicd_t cd;
-scsicd_bus_t cd_bus;
-static cdda_t cdda;
+//
+// Everything that belongs to one emulated drive, see SCSICD_SetContext().
+//
+struct scsicd_ctx_t
+{
+ uint32_t CD_DATA_TRANSFER_RATE;
+ uint32_t System_Clock;
+ void (*CDIRQCallback)(int);
+ void (*CDStuffSubchannels)(uint8_t, int);
+ int32_t* HRBufs[2];
+ int WhichSystem;
 
-static SimpleFIFO<uint8_t> *din = NULL;
+ CDIF *Cur_CDIF;
+ bool TrayOpen;
 
-static TOC toc;
+ scsicd_timestamp_t lastts;
+ int64_t monotonic_timestamp;
+ int64_t pce_lastsapsp_timestamp;
 
-static uint32_t read_sec_start;
-static uint32_t read_sec;
-static uint32_t read_sec_end;
+ scsicd_t cd;
+ scsicd_bus_t cd_bus;
+ cdda_t cdda;
 
-static int32_t CDReadTimer;
-static uint32_t SectorAddr;
-static uint32_t SectorCount;
+ SimpleFIFO<uint8_t> *din;
+
+ TOC toc;
+
+ uint32_t read_sec_start;
+ uint32_t read_sec;
+ uint32_t read_sec_end;
+
+ int32_t CDReadTimer;
+ uint32_t SectorAddr;
+ uint32_t SectorCount;
+
+ unsigned int CurrentPhase;
+
+ uint8_t ModePageValues[NumModePages][64];	// current_value of each of ModePages[]
+};
+
+static scsicd_ctx_t *scsicd = NULL;
+scsicd_bus_t *cd_bus = NULL;
+
+static INLINE void SetREQ(bool set)
+{
+ if(set && !REQ_signal)
+  scsicd->CDIRQCallback(SCSICD_IRQ_MAGICAL_REQ);
 
+ SetIOP(SCSICD_REQ_mask, set);
+}
 
 enum
 {
@@ -194,7 +208,7 @@ enum
  PHASE_MESSAGE_IN,
  PHASE_MESSAGE_OUT
 };
-static unsigned int CurrentPhase;
+static void ChangePhase(const unsigned int new_phase);
 static void ChangePhase(const unsigned int new_phase);
 
 
@@ -202,20 +216,20 @@ static void FixOPV(void)
 {
  for(int port = 0; port < 2; port++)
  {
-  int32_t tmpvol = cdda.CDDAVolume[port] * 100 / (2 * cdda.CDDADivAccVolFudge);
+  int32_t tmpvol = scsicd->cdda.CDDAVolume[port] * 100 / (2 * scsicd->cdda.CDDADivAccVolFudge);
 
   //printf("TV: %d\n", tmpvol);
 
-  cdda.OutPortVolumeCache[port] = tmpvol;
+  scsicd->cdda.OutPortVolumeCache[port] = tmpvol;
 
-  if(cdda.OutPortChSelect[port] & 0x01)
-   cdda.OutPortChSelectCache[port] = 0;
-  else if(cdda.OutPortChSelect[port] & 0x02)
-   cdda.OutPortChSelectCache[port] = 1;
+  if(scsicd->cdda.OutPortChSelect[port] & 0x01)
+   scsicd->cdda.OutPortChSelectCache[port] = 0;
+  else if(scsicd->cdda.OutPortChSelect[port] & 0x02)
+   scsicd->cdda.OutPortChSelectCache[port] = 1;
   else
   {
-   cdda.OutPortChSelectCache[port] = 0;
-   cdda.OutPortVolumeCache[port] = 0;
+   scsicd->cdda.OutPortChSelectCache[port] = 0;
+   scsicd->cdda.OutPortVolumeCache[port] = 0;
   }
  }
 }
@@ -224,32 +238,32 @@ static void VirtualReset(void)
 {
  InitModePages();
 
- din->Flush();
+ scsicd->din->Flush();
 
- CDReadTimer = 0;
+ scsicd->CDReadTimer = 0;
 
- pce_lastsapsp_timestamp = monotonic_timestamp;
+ scsicd->pce_lastsapsp_timestamp = scsicd->monotonic_timestamp;
 
- SectorAddr = SectorCount = 0;
- read_sec_start = read_sec = 0;
- read_sec_end = ~0;
+ scsicd->SectorAddr = scsicd->SectorCount = 0;
+ scsicd->read_sec_start = scsicd->read_sec = 0;
+ scsicd->read_sec_end = ~0;
 
- cdda.PlayMode = PLAYMODE_SILENT;
- cdda.CDDAReadPos = 0;
- cdda.CDDAStatus = CDDASTATUS_STOPPED;
- cdda.CDDADiv = 0;
+ scsicd->cdda.PlayMode = PLAYMODE_SILENT;
+ scsicd->cdda.CDDAReadPos = 0;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
+ scsicd->cdda.CDDADiv = 0;
 
- cdda.ScanMode = 0;
- cdda.scan_sec_end = 0;
+ scsicd->cdda.ScanMode = 0;
+ scsicd->cdda.scan_sec_end = 0;
 
- cdda.OversamplePos = 0;
- memset(cdda.sr, 0, sizeof(cdda.sr));
- memset(cdda.OversampleBuffer, 0, sizeof(cdda.OversampleBuffer));
- memset(cdda.DeemphState, 0, sizeof(cdda.DeemphState));
+ scsicd->cdda.OversamplePos = 0;
+ memset(scsicd->cdda.sr, 0, sizeof(scsicd->cdda.sr));
+ memset(scsicd->cdda.OversampleBuffer, 0, sizeof(scsicd->cdda.OversampleBuffer));
+ memset(scsicd->cdda.DeemphState, 0, sizeof(scsicd->cdda.DeemphState));
 
- memset(cd.data_out, 0, sizeof(cd.data_out));
- cd.data_out_pos = 0;
- cd.data_out_want = 0;
+ memset(scsicd->cd.data_out, 0, sizeof(scsicd->cd.data_out));
+ scsicd->cd.data_out_pos = 0;
+ scsicd->cd.data_out_want = 0;
 
 
  FixOPV();
@@ -259,17 +273,17 @@ static void VirtualReset(void)
 
 void SCSICD_Power(scsicd_timestamp_t system_timestamp)
 {
- memset(&cd, 0, sizeof(scsicd_t));
- memset(&cd_bus, 0, sizeof(scsicd_bus_t));
+ memset(&scsicd->cd, 0, sizeof(scsicd_t));
+ memset(cd_bus, 0, sizeof(scsicd_bus_t));
 
- monotonic_timestamp = system_timestamp;
+ scsicd->monotonic_timestamp = system_timestamp;
 
- cd.DiscChanged = false;
+ scsicd->cd.DiscChanged = false;
 
- if(Cur_CDIF && !TrayOpen)
-  Cur_CDIF->ReadTOC(&toc);
+ if(scsicd->Cur_CDIF && !scsicd->TrayOpen)
+  scsicd->Cur_CDIF->ReadTOC(&scsicd->toc);
 
- CurrentPhase = PHASE_BUS_FREE;
+ scsicd->CurrentPhase = PHASE_BUS_FREE;
 
  VirtualReset();
 }
@@ -277,7 +291,7 @@ void SCSICD_Power(scsicd_timestamp_t system_timestamp)
 
 void SCSICD_SetDB(uint8_t data)
 {
- cd_bus.DB = data;
+ cd_bus->DB = data;
  //printf("Set DB: %02x\n", data);
 }
 
@@ -312,7 +326,7 @@ static void GenSubQFromSubPW(void)
  memset(SubQBuf, 0, 0xC);
 
  for(int i = 0; i < 96; i++)
-  SubQBuf[i >> 3] |= ((cd.SubPWBuf[i] & 0x40) >> 6) << (7 - (i & 7));
+  SubQBuf[i >> 3] |= ((scsicd->cd.SubPWBuf[i] & 0x40) >> 6) << (7 - (i & 7));
 
  //printf("Real %d/ SubQ %d - ", read_sec, BCD_to_U8(SubQBuf[7]) * 75 * 60 + BCD_to_U8(SubQBuf[8]) * 75 + BCD_to_U8(SubQBuf[9]) - 150);
  // Debug code, remove me.
@@ -326,12 +340,12 @@ static void GenSubQFromSubPW(void)
  }
  else
  {
-  memcpy(cd.SubQBuf_Last, SubQBuf, 0xC);
+  memcpy(scsicd->cd.SubQBuf_Last, SubQBuf, 0xC);
 
   uint8_t adr = SubQBuf[0] & 0xF;
 
   if(adr <= 0x3)
-   memcpy(cd.SubQBuf[adr], SubQBuf, 0xC);
+   memcpy(scsicd->cd.SubQBuf[adr], SubQBuf, 0xC);
 
   //if(adr == 0x02)
   //for(int i = 0; i < 12; i++)
@@ -392,7 +406,7 @@ static void ChangePhase(const unsigned int new_phase)
 		SetIO(false);
 		SetREQ(false);
 
-	        CDIRQCallback(0x8000 | SCSICD_IRQ_DATA_TRANSFER_DONE);
+	        scsicd->CDIRQCallback(0x8000 | SCSICD_IRQ_DATA_TRANSFER_DONE);
 		break;
 
   case PHASE_DATA_IN:		// Us to them
@@ -445,69 +459,69 @@ static void ChangePhase(const unsigned int new_phase)
 		SetREQ(true);
 		break;
  }
- CurrentPhase = new_phase;
+ scsicd->CurrentPhase = new_phase;
 }
 
 static void SendStatusAndMessage(uint8_t status, uint8_t message)
 {
  // This should never ever happen, but that doesn't mean it won't. ;)
- if(din->in_count)
+ if(scsicd->din->in_count)
  {
   //printf("[SCSICD] BUG: %d bytes still in SCSI CD FIFO\n", din->in_count);
-  din->Flush();
+  scsicd->din->Flush();
  }
 
- cd.message_pending = message;
+ scsicd->cd.message_pending = message;
 
- cd.status_sent = FALSE;
- cd.message_sent = FALSE;
+ scsicd->cd.status_sent = FALSE;
+ scsicd->cd.message_sent = FALSE;
 
- if(WhichSystem == SCSICD_PCE)
+ if(scsicd->WhichSystem == SCSICD_PCE)
  {
   if(status == STATUS_GOOD || status == STATUS_CONDITION_MET)
-   cd_bus.DB = 0x00;
+   cd_bus->DB = 0x00;
   else
-   cd_bus.DB = 0x01;
+   cd_bus->DB = 0x01;
  }
  else
-  cd_bus.DB = status << 1;
+  cd_bus->DB = status << 1;
 
  ChangePhase(PHASE_STATUS);
 }
 
 static void DoSimpleDataIn(const uint8_t *data_in, uint32_t len)
 {
- din->Write(data_in, len);
+ scsicd->din->Write(data_in, len);
 
- cd.data_transfer_done = true;
+ scsicd->cd.data_transfer_done = true;
 
  ChangePhase(PHASE_DATA_IN);
 }
 
 void SCSICD_SetDisc(bool new_tray_open, CDIF *cdif, bool no_emu_side_effects)
 {
- Cur_CDIF = cdif;
+ scsicd->Cur_CDIF = cdif;
 
  // Closing the tray.
- if(TrayOpen && !new_tray_open)
+ if(scsicd->TrayOpen && !new_tray_open)
  {
-  TrayOpen = false;
+  scsicd->TrayOpen = false;
 
   if(cdif)
   {
-   cdif->ReadTOC(&toc);
+   cdif->ReadTOC(&scsicd->toc);
 
    if(!no_emu_side_effects)
    {
-    memset(cd.SubQBuf, 0, sizeof(cd.SubQBuf));
-    memset(cd.SubQBuf_Last, 0, sizeof(cd.SubQBuf_Last));
-    cd.DiscChanged = true;
+    memset(scsicd->cd.SubQBuf, 0, sizeof(scsicd->cd.SubQBuf));
+    memset(scsicd->cd.SubQBuf_Last, 0, sizeof(scsicd->cd.SubQBuf_Last));
+    scsicd->cd.DiscChanged = true;
    }
   }
  }
- else if(!TrayOpen && new_tray_open)	// Opening the tray
+ else if(!scsicd->TrayOpen && new_tray_open)	// Opening the tray
  {
-  TrayOpen = true;
+  scsicd->TrayOpen = true;
  }
 }
 
@@ -515,20 +529,20 @@ static void CommandCCError(int key, int asc = 0, int ascq = 0)
 {
  //printf("[SCSICD] CC Error: %02x %02x %02x\n", key, asc, ascq);
 
- cd.key_pending = key;
- cd.asc_pending = asc;
- cd.ascq_pending = ascq;
- cd.fru_pending = 0x00;
+ scsicd->cd.key_pending = key;
+ scsicd->cd.asc_pending = asc;
+ scsicd->cd.ascq_pending = ascq;
+ scsicd->cd.fru_pending = 0x00;
 
  SendStatusAndMessage(STATUS_CHECK_CONDITION, 0x00);
 }
 
 static bool ValidateRawDataSector(uint8_t *data, const uint32_t lba)
 {
-   if(!Cur_CDIF->ValidateRawSector(data))
+   if(!scsicd->Cur_CDIF->ValidateRawSector(data))
    {
-      din->Flush();
-      cd.data_transfer_done = false;
+      scsicd->din->Flush();
+      scsicd->cd.data_transfer_done = false;
 
       CommandCCError(SENSEKEY_MEDIUM_ERROR, AP_LEC_UNCORRECTABLE_ERROR);
       return(false);
@@ -541,8 +555,8 @@ static void DoMODESELECT6(const uint8_t *cdb)
 {
    if(cdb[4])
    {
-      cd.data_out_pos = 0;
-      cd.data_out_want = cdb[4];
+      scsicd->cd.data_out_pos = 0;
+      scsicd->cd.data_out_want = cdb[4];
       //printf("Switch to DATA OUT phase, len: %d\n", cd.data_out_want);
 
       ChangePhase(PHASE_DATA_OUT);
@@ -616,7 +630,6 @@ struct ModePage
  const uint8_t code;
  const uint8_t param_length;
  const ModePageParam params[64];	// 64 should be more than enough
- uint8_t current_value[64];
 };
 
 /*
@@ -630,8 +643,7 @@ struct ModePage
 	0x3F(Yes, not really a mode page but a fetch method)
 */
 // Remember to update the code in StateAction() if we change the number or layout of modepages here.
-static const int NumModePages = 5;
-static ModePage ModePages[NumModePages] =
+static const ModePage ModePages[NumModePages] =
 {
  // Unknown
  { 0x28,
@@ -693,16 +705,21 @@ static ModePage ModePages[NumModePages] =
  },
 };
 
+static INLINE uint8_t *MPCurrentValue(const ModePage *mp)
+{
+ return scsicd->ModePageValues[mp - ModePages];
+}
+
 static void UpdateMPCacheP(const ModePage* mp)
 {
   switch(mp->code)
   {
    case 0x0E:
 	     {
-              const uint8_t *pd = &mp->current_value[0];
+              const uint8_t *pd = MPCurrentValue(mp);
 
               for(int i = 0; i < 2; i++)
-               cdda.OutPortChSelect[i] = pd[6 + i * 2];
+               scsicd->cdda.OutPortChSelect[i] = pd[6 + i * 2];
               FixOPV();
 	     }
 	     break;
@@ -737,12 +754,12 @@ static void UpdateMPCacheP(const ModePage* mp)
 	     // But, until there's a killer PC-FX homebrew game that necessitates more computationally-expensive CD-DA handling,
 	     // I don't see a good reason to change how CD-DA resampling is currently implemented.
 	     // 
-	     speed = std::max<int>(-32, std::min<int>(32, (int8_t)mp->current_value[0]));
+	     speed = std::max<int>(-32, std::min<int>(32, (int8_t)MPCurrentValue(mp)[0]));
 	     rate = 44100 + 441 * speed;
 
-             //printf("[SCSICD] Speed: %d(pre-clamped=%d) %d\n", speed, (int8_t)mp->current_value[0], rate);
-             cdda.CDDADivAcc = ((int64_t)System_Clock * (1024 * 1024) / (2 * rate));
-	     cdda.CDDADivAccVolFudge = 100 + speed;
+             //printf("[SCSICD] Speed: %d(pre-clamped=%d) %d\n", speed, (int8_t)MPCurrentValue(mp)[0], rate);
+             scsicd->cdda.CDDADivAcc = ((int64_t)scsicd->System_Clock * (1024 * 1024) / (2 * rate));
+	     scsicd->cdda.CDDADivAccVolFudge = 100 + speed;
 	     FixOPV();	// Resampler impulse amplitude volume adjustment(call after setting cdda.CDDADivAccVolFudge)
 	    }
 	    break;
@@ -767,11 +784,11 @@ static void InitModePages(void)
 {
  for(int pi = 0; pi < NumModePages; pi++)
  {
-  ModePage *mp = &ModePages[pi];
+  const ModePage *mp = &ModePages[pi];
   const ModePageParam *params = &ModePages[pi].params[0];
 
   for(int parami = 0; parami < mp->param_length; parami++)
-   mp->current_value[parami] = params[parami].default_value;
+   MPCurrentValue(mp)[parami] = params[parami].default_value;
 
   UpdateMPCacheP(mp);
  }
@@ -849,7 +866,7 @@ static void FinishMODESELECT6(const uint8_t *data, const uint8_t data_len)
 
 	 for(int pi = 0; pi < NumModePages; pi++)
 	 {
-	  ModePage *mp = &ModePages[pi];
+	  const ModePage *mp = &ModePages[pi];
 
 	  if(code == mp->code)
 	  {
@@ -869,8 +886,8 @@ static void FinishMODESELECT6(const uint8_t *data, const uint8_t data_len)
 
 	   for(int parami = 0; parami < mp->param_length; parami++)
 	   {
-	    mp->current_value[parami] &= ~mp->params[parami].real_mask;
-	    mp->current_value[parami] |= (data[offset++]) & mp->params[parami].real_mask;
+	    MPCurrentValue(mp)[parami] &= ~mp->params[parami].real_mask;
+	    MPCurrentValue(mp)[parami] |= (data[offset++]) & mp->params[parami].real_mask;
 	   }
 
 	   UpdateMPCacheP(mp);
@@ -976,7 +993,7 @@ static void DoMODESENSE6(const uint8_t *cdb)
    else if(PC == 0x01)
     data = params[parami].alterable_mask;
    else
-    data = mp->current_value[parami];
+    data = MPCurrentValue(mp)[parami];
 
    data_in[index++] = data;
   }
@@ -1108,14 +1125,14 @@ static void DoREQUESTSENSE(const uint8_t *cdb)
 {
  uint8_t data_in[8192];
 
- MakeSense(data_in, cd.key_pending, cd.asc_pending, cd.ascq_pending, cd.fru_pending);
+ MakeSense(data_in, scsicd->cd.key_pending, scsicd->cd.asc_pending, scsicd->cd.ascq_pending, scsicd->cd.fru_pending);
 
  DoSimpleDataIn(data_in, 18);
 
- cd.key_pending = 0;
- cd.asc_pending = 0;
- cd.ascq_pending = 0;
- cd.fru_pending = 0;
+ scsicd->cd.key_pending = 0;
+ scsicd->cd.asc_pending = 0;
+ scsicd->cd.ascq_pending = 0;
+ scsicd->cd.fru_pending = 0;
 }
 
 static void EncodeM3TOC(uint8_t *buf, uint8_t POINTER_RAW, int32_t LBA, uint32_t PLBA, uint8_t control)
@@ -1179,29 +1196,29 @@ static void DoNEC_GETDIRINFO(const uint8_t *cdb)
 
     if(!match || match == 0xA0)
     {
-     EncodeM3TOC(&data_in[offset], 0xA0, lilba, toc.first_track * 75 * 60 - 150, toc.tracks[toc.first_track].control);
+     EncodeM3TOC(&data_in[offset], 0xA0, lilba, scsicd->toc.first_track * 75 * 60 - 150, scsicd->toc.tracks[scsicd->toc.first_track].control);
      lilba++;
      offset += 0xA;
     }
 
     if(!match || match == 0xA1)
     {
-     EncodeM3TOC(&data_in[offset], 0xA1, lilba, toc.last_track * 75 * 60 - 150, toc.tracks[toc.last_track].control);
+     EncodeM3TOC(&data_in[offset], 0xA1, lilba, scsicd->toc.last_track * 75 * 60 - 150, scsicd->toc.tracks[scsicd->toc.last_track].control);
      lilba++;
      offset += 0xA;
     }
   
     if(!match || match == 0xA2)
     {
-     EncodeM3TOC(&data_in[offset], 0xA2, lilba, toc.tracks[100].lba, toc.tracks[100].control);
+     EncodeM3TOC(&data_in[offset], 0xA2, lilba, scsicd->toc.tracks[100].lba, scsicd->toc.tracks[100].control);
      lilba++;
      offset += 0xA;
     }
 
     if(!match)
-     for(int track = toc.first_track; track <= toc.last_track; track++)
+     for(int track = scsicd->toc.first_track; track <= scsicd->toc.last_track; track++)
      {
-      EncodeM3TOC(&data_in[offset], U8_to_BCD(track), lilba, toc.tracks[track].lba, toc.tracks[track].control);
+      EncodeM3TOC(&data_in[offset], U8_to_BCD(track), lilba, scsicd->toc.tracks[track].lba, scsicd->toc.tracks[track].control);
       lilba++;
       offset += 0xA;
      }
@@ -1219,8 +1236,8 @@ static void DoNEC_GETDIRINFO(const uint8_t *cdb)
    break;
 
   case 0x0:
-   data_in[0] = U8_to_BCD(toc.first_track);
-   data_in[1] = U8_to_BCD(toc.last_track);
+   data_in[0] = U8_to_BCD(scsicd->toc.first_track);
+   data_in[1] = U8_to_BCD(scsicd->toc.last_track);
 
    data_in_size = 4;
    break;
@@ -1229,7 +1246,7 @@ static void DoNEC_GETDIRINFO(const uint8_t *cdb)
    {
     uint8_t m, s, f;
 
-    LBA_to_AMSF(toc.tracks[100].lba, &m, &s, &f);
+    LBA_to_AMSF(scsicd->toc.tracks[100].lba, &m, &s, &f);
 
     data_in[0] = U8_to_BCD(m);
     data_in[1] = U8_to_BCD(s);
@@ -1244,18 +1261,18 @@ static void DoNEC_GETDIRINFO(const uint8_t *cdb)
     uint8_t m, s, f;
     int track = BCD_to_U8(cdb[2]);
 
-    if(track < toc.first_track || track > toc.last_track)
+    if(track < scsicd->toc.first_track || track > scsicd->toc.last_track)
     {
      CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_ADDRESS);
      return;
     }
 
-    LBA_to_AMSF(toc.tracks[track].lba, &m, &s, &f);
+    LBA_to_AMSF(scsicd->toc.tracks[track].lba, &m, &s, &f);
 
     data_in[0] = U8_to_BCD(m);
     data_in[1] = U8_to_BCD(s);
     data_in[2] = U8_to_BCD(f);
-    data_in[3] = toc.tracks[track].control;
+    data_in[3] = scsicd->toc.tracks[track].control;
     data_in_size = 4;
    }
    break;
@@ -1267,8 +1284,8 @@ static void DoNEC_GETDIRINFO(const uint8_t *cdb)
 static void DoREADTOC(const uint8_t *cdb)
 {
  uint8_t data_in[8192];
- int FirstTrack = toc.first_track;
- int LastTrack = toc.last_track;
+ int FirstTrack = scsicd->toc.first_track;
+ int LastTrack = scsicd->toc.last_track;
  int StartingTrack = cdb[6];
  unsigned int AllocSize = (cdb[7] << 8) | cdb[8];
  unsigned int RealSize = 0;
@@ -1292,7 +1309,7 @@ static void DoREADTOC(const uint8_t *cdb)
  {
   StartingTrack = LastTrack + 1;
  }
- else if(StartingTrack > toc.last_track)
+ else if(StartingTrack > scsicd->toc.last_track)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
@@ -1316,11 +1333,11 @@ static void DoREADTOC(const uint8_t *cdb)
   else
    eff_track = track;
 
-  lba = toc.tracks[eff_track].lba;
+  lba = scsicd->toc.tracks[eff_track].lba;
   LBA_to_AMSF(lba, &m, &s, &f);
 
   subptr[0] = 0;
-  subptr[1] = toc.tracks[eff_track].control | (toc.tracks[eff_track].adr << 4);
+  subptr[1] = scsicd->toc.tracks[eff_track].control | (scsicd->toc.tracks[eff_track].adr << 4);
 
   if(eff_track == 100)
    subptr[2] = 0xAA;
@@ -1376,7 +1393,7 @@ static void DoREADCDCAP10(const uint8_t *cdb)
   return;
  }
 
- ret_lba = toc.tracks[100].lba - 1;
+ ret_lba = scsicd->toc.tracks[100].lba - 1;
 
  if(pmi)
  {
@@ -1386,19 +1403,19 @@ static void DoREADCDCAP10(const uint8_t *cdb)
   // If the specified LBA is >= leadout track, return the LBA of the sector immediately before the leadout track.
   //
   // If the specified LBA is < than the LBA of the first track, then return the LBA of sector preceding the first track.  (I don't know if PC-FX can even handle discs like this, though)
-  if(lba >= toc.tracks[100].lba)
-   ret_lba = toc.tracks[100].lba - 1;
-  else if(lba < toc.tracks[toc.first_track].lba)
-   ret_lba = toc.tracks[toc.first_track].lba - 1;
+  if(lba >= scsicd->toc.tracks[100].lba)
+   ret_lba = scsicd->toc.tracks[100].lba - 1;
+  else if(lba < scsicd->toc.tracks[scsicd->toc.first_track].lba)
+   ret_lba = scsicd->toc.tracks[scsicd->toc.first_track].lba - 1;
   else
   {
-   const int track = toc.FindTrackByLBA(lba);
+   const int track = scsicd->toc.FindTrackByLBA(lba);
 
-   for(int st = track + 1; st <= toc.last_track; st++)
+   for(int st = track + 1; st <= scsicd->toc.last_track; st++)
    {
-    if((toc.tracks[st].control ^ toc.tracks[track].control) & 0x4)
+    if((scsicd->toc.tracks[st].control ^ scsicd->toc.tracks[track].control) & 0x4)
     {
-     ret_lba = toc.tracks[st].lba - 1;
+     ret_lba = scsicd->toc.tracks[st].lba - 1;
      break;
     }
    }
@@ -1410,7 +1427,7 @@ static void DoREADCDCAP10(const uint8_t *cdb)
  MDFN_en32msb(&data_in[0], ret_lba);
  MDFN_en32msb(&data_in[4], ret_bl);
 
- cdda.CDDAStatus = CDDASTATUS_STOPPED;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
 
  DoSimpleDataIn(data_in, 8);
 }
@@ -1434,19 +1451,19 @@ static void DoREADHEADER10(const uint8_t *cdb)
   return;
  }
 
- if(HeaderLBA >= toc.tracks[100].lba)
+ if(HeaderLBA >= scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
 
- if(HeaderLBA < toc.tracks[toc.first_track].lba)
+ if(HeaderLBA < scsicd->toc.tracks[scsicd->toc.first_track].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
 
- Cur_CDIF->ReadRawSector(raw_buf, HeaderLBA);	//, HeaderLBA + 1);
+ scsicd->Cur_CDIF->ReadRawSector(raw_buf, HeaderLBA);	//, HeaderLBA + 1);
  if(!ValidateRawDataSector(raw_buf, HeaderLBA))
   return;
 
@@ -1478,7 +1495,7 @@ static void DoREADHEADER10(const uint8_t *cdb)
   data_in[7] = lba >> 0;
  }
 
- cdda.CDDAStatus = CDDASTATUS_STOPPED;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
 
  DoSimpleDataIn(data_in, 8);
 }
@@ -1490,13 +1507,13 @@ static void DoNEC_SST(const uint8_t *cdb)		// Command 0xDB, Set Stop Time
 
 static void DoPABase(const uint32_t lba, const uint32_t length, unsigned int status = CDDASTATUS_PLAYING, unsigned int mode = PLAYMODE_NORMAL)
 {
- if(lba > toc.tracks[100].lba) // > is not a typo, it's a PC-FX bug apparently.
+ if(lba > scsicd->toc.tracks[100].lba) // > is not a typo, it's a PC-FX bug apparently.
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
   
- if(lba < toc.tracks[toc.first_track].lba)
+ if(lba < scsicd->toc.tracks[scsicd->toc.first_track].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
@@ -1509,22 +1526,22 @@ static void DoPABase(const uint32_t lba, const uint32_t length, unsigned int sta
  }
  else
  {
-  if(toc.tracks[toc.FindTrackByLBA(lba)].control & 0x04)
+  if(scsicd->toc.tracks[scsicd->toc.FindTrackByLBA(lba)].control & 0x04)
   {
    CommandCCError(SENSEKEY_MEDIUM_ERROR, NSE_NOT_AUDIO_TRACK);
    return;
   }
 
-  cdda.CDDAReadPos = 588;
-  read_sec = read_sec_start = lba;
-  read_sec_end = read_sec_start + length;
+  scsicd->cdda.CDDAReadPos = 588;
+  scsicd->read_sec = scsicd->read_sec_start = lba;
+  scsicd->read_sec_end = scsicd->read_sec_start + length;
 
-  cdda.CDDAStatus = status;
-  cdda.PlayMode = mode;
+  scsicd->cdda.CDDAStatus = status;
+  scsicd->cdda.PlayMode = mode;
 
-  if(read_sec < toc.tracks[100].lba)
+  if(scsicd->read_sec < scsicd->toc.tracks[100].lba)
   {
-   Cur_CDIF->HintReadSector(read_sec);	//, read_sec_end, read_sec_start);
+   scsicd->Cur_CDIF->HintReadSector(scsicd->read_sec);	//, read_sec_end, read_sec_start);
   }
  }
 
@@ -1577,22 +1594,22 @@ static void DoNEC_SAPSP(const uint8_t *cdb)
 	  return;
 	 }
 
-	 if(track == toc.last_track + 1)
+	 if(track == scsicd->toc.last_track + 1)
 	  track = 100;
-	 else if(track > toc.last_track)
+	 else if(track > scsicd->toc.last_track)
 	 {
 	  CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
 	  return;
 	 }
-	 lba = toc.tracks[track].lba;
+	 lba = scsicd->toc.tracks[track].lba;
 	}
 	break;
  }
 
  if(cdb[1] & 0x01)
-  DoPABase(lba, toc.tracks[100].lba - lba, CDDASTATUS_PLAYING, PLAYMODE_NORMAL);
+  DoPABase(lba, scsicd->toc.tracks[100].lba - lba, CDDASTATUS_PLAYING, PLAYMODE_NORMAL);
  else
-  DoPABase(lba, toc.tracks[100].lba - lba, CDDASTATUS_PAUSED, PLAYMODE_SILENT);
+  DoPABase(lba, scsicd->toc.tracks[100].lba - lba, CDDASTATUS_PAUSED, PLAYMODE_SILENT);
 }
 
 
@@ -1606,7 +1623,7 @@ static void DoNEC_SAPEP(const uint8_t *cdb)
 {
  uint32_t lba;
 
- if(cdda.CDDAStatus == CDDASTATUS_STOPPED)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_STOPPED)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_AUDIO_NOT_PLAYING);
   return;
@@ -1647,32 +1664,32 @@ static void DoNEC_SAPEP(const uint8_t *cdb)
 	  return;
 	 }
 
-	 if(track == toc.last_track + 1)
+	 if(track == scsicd->toc.last_track + 1)
 	  track = 100;
-	 else if(track > toc.last_track)
+	 else if(track > scsicd->toc.last_track)
 	 {
 	  CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
 	  return;
 	 }
-	 lba = toc.tracks[track].lba;
+	 lba = scsicd->toc.tracks[track].lba;
 	}
 	break;
  }
 
  switch(cdb[1] & 0x7)
  {
-   case 0x00: cdda.PlayMode = PLAYMODE_SILENT;
+   case 0x00: scsicd->cdda.PlayMode = PLAYMODE_SILENT;
 	      break;
 
-   case 0x04: cdda.PlayMode = PLAYMODE_LOOP;
+   case 0x04: scsicd->cdda.PlayMode = PLAYMODE_LOOP;
 	      break;
 
-   default:   cdda.PlayMode = PLAYMODE_NORMAL;
+   default:   scsicd->cdda.PlayMode = PLAYMODE_NORMAL;
 	      break;
  }
- cdda.CDDAStatus = CDDASTATUS_PLAYING;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_PLAYING;
 
- read_sec_end = lba;
+ scsicd->read_sec_end = lba;
 
  SendStatusAndMessage(STATUS_GOOD, 0x00);
 }
@@ -1723,7 +1740,7 @@ static void DoPAMSF(const uint8_t *cdb)
  lba_start = AMSF_to_LBA(cdb[3], cdb[4], cdb[5]);
  lba_end = AMSF_to_LBA(cdb[6], cdb[7], cdb[8]);
 
- if(lba_start < 0 || lba_end < 0 || lba_start >= (int32_t)toc.tracks[100].lba)
+ if(lba_start < 0 || lba_end < 0 || lba_start >= (int32_t)scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
   return;
@@ -1740,12 +1757,12 @@ static void DoPAMSF(const uint8_t *cdb)
   return;
  }
 
- cdda.CDDAReadPos = 588;
- read_sec = read_sec_start = lba_start;
- read_sec_end = lba_end;
+ scsicd->cdda.CDDAReadPos = 588;
+ scsicd->read_sec = scsicd->read_sec_start = lba_start;
+ scsicd->read_sec_end = lba_end;
 
- cdda.CDDAStatus = CDDASTATUS_PLAYING;
- cdda.PlayMode = PLAYMODE_NORMAL;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_PLAYING;
+ scsicd->cdda.PlayMode = PLAYMODE_NORMAL;
 
  SendStatusAndMessage(STATUS_GOOD, 0x00);
 }
@@ -1763,7 +1780,7 @@ static void DoPATI(const uint8_t *cdb)
  //int StartIndex = cdb[5];
  //int EndIndex = cdb[8];
 
- if(!StartTrack || StartTrack < toc.first_track || StartTrack > toc.last_track)
+ if(!StartTrack || StartTrack < scsicd->toc.first_track || StartTrack > scsicd->toc.last_track)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
@@ -1771,19 +1788,19 @@ static void DoPATI(const uint8_t *cdb)
 
  //printf("PATI: %d %d %d  SI: %d, EI: %d\n", StartTrack, EndTrack, Cur_CDIF->GetTrackStartPositionLBA(StartTrack), StartIndex, EndIndex);
 
- DoPABase(toc.tracks[StartTrack].lba, toc.tracks[EndTrack].lba - toc.tracks[StartTrack].lba);
+ DoPABase(scsicd->toc.tracks[StartTrack].lba, scsicd->toc.tracks[EndTrack].lba - scsicd->toc.tracks[StartTrack].lba);
 }
 
 
 static void DoPATRBase(const uint32_t lba, const uint32_t length)
 {
- if(lba >= toc.tracks[100].lba)
+ if(lba >= scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
 
- if(lba < toc.tracks[toc.first_track].lba)
+ if(lba < scsicd->toc.tracks[scsicd->toc.first_track].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
@@ -1796,18 +1813,18 @@ static void DoPATRBase(const uint32_t lba, const uint32_t length)
  }
  else
  {  
-  if(toc.tracks[toc.FindTrackByLBA(lba)].control & 0x04)
+  if(scsicd->toc.tracks[scsicd->toc.FindTrackByLBA(lba)].control & 0x04)
   {
    CommandCCError(SENSEKEY_MEDIUM_ERROR, NSE_NOT_AUDIO_TRACK);
    return;
   }
 
-  cdda.CDDAReadPos = 588;
-  read_sec = read_sec_start = lba;
-  read_sec_end = read_sec_start + length;
+  scsicd->cdda.CDDAReadPos = 588;
+  scsicd->read_sec = scsicd->read_sec_start = lba;
+  scsicd->read_sec_end = scsicd->read_sec_start + length;
 
-  cdda.CDDAStatus = CDDASTATUS_PLAYING;
-  cdda.PlayMode = PLAYMODE_NORMAL;
+  scsicd->cdda.CDDAStatus = CDDASTATUS_PLAYING;
+  scsicd->cdda.PlayMode = PLAYMODE_NORMAL;
  }
 
  SendStatusAndMessage(STATUS_GOOD, 0x00);
@@ -1825,13 +1842,13 @@ static void DoPATR10(const uint8_t *cdb)
  const int StartTrack  = cdb[6];
  const uint16_t length = MDFN_de16msb(cdb + 0x7);
 
- if(!StartTrack || StartTrack < toc.first_track || StartTrack > toc.last_track)
+ if(!StartTrack || StartTrack < scsicd->toc.first_track || StartTrack > scsicd->toc.last_track)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
 
- DoPATRBase(toc.tracks[StartTrack].lba + rel_lba, length);
+ DoPATRBase(scsicd->toc.tracks[StartTrack].lba + rel_lba, length);
 }
 
 
@@ -1847,13 +1864,13 @@ static void DoPATR12(const uint8_t *cdb)
  const int StartTrack = cdb[10];
  const uint32_t length = MDFN_de32msb(cdb + 0x6);
 
- if(!StartTrack || StartTrack < toc.first_track || StartTrack > toc.last_track)
+ if(!StartTrack || StartTrack < scsicd->toc.first_track || StartTrack > scsicd->toc.last_track)
  { 
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
  }
 
- DoPATRBase(toc.tracks[StartTrack].lba + rel_lba, length);
+ DoPATRBase(scsicd->toc.tracks[StartTrack].lba + rel_lba, length);
 }
 
 static void DoPAUSERESUME(const uint8_t *cdb)
@@ -1862,16 +1879,16 @@ static void DoPAUSERESUME(const uint8_t *cdb)
  // "It shall not be considered an error to request a pause when a pause is already in effect, 
  // or to request a resume when a play operation is in progress."
 
- if(cdda.CDDAStatus == CDDASTATUS_STOPPED)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_STOPPED)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_AUDIO_NOT_PLAYING);
   return;
  }
 
  if(cdb[8] & 1)	// Resume
-  cdda.CDDAStatus = CDDASTATUS_PLAYING;
+  scsicd->cdda.CDDAStatus = CDDASTATUS_PLAYING;
  else
-  cdda.CDDAStatus = CDDASTATUS_PAUSED;
+  scsicd->cdda.CDDAStatus = CDDASTATUS_PAUSED;
 
  SendStatusAndMessage(STATUS_GOOD, 0x00);
 }
@@ -1884,26 +1901,26 @@ static void DoREADBase(uint32_t sa, uint32_t sc)
 {
  int track;
 
- if(sa > toc.tracks[100].lba) // Another one of those off-by-one PC-FX CD bugs.
+ if(sa > scsicd->toc.tracks[100].lba) // Another one of those off-by-one PC-FX CD bugs.
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
   return;
  }
 
- if((track = toc.FindTrackByLBA(sa)) == 0)
+ if((track = scsicd->toc.FindTrackByLBA(sa)) == 0)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
   return;
  }
 
- if(!(toc.tracks[track].control) & 0x4)
+ if(!(scsicd->toc.tracks[track].control) & 0x4)
  {
   CommandCCError(SENSEKEY_MEDIUM_ERROR, NSE_NOT_DATA_TRACK);
   return;
  }
 
  // Case for READ(10) and READ(12) where sc == 0, and sa == toc.tracks[100].lba
- if(!sc && sa == toc.tracks[100].lba)
+ if(!sc && sa == scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_MEDIUM_ERROR, NSE_HEADER_READ_ERROR);
   return;
@@ -1911,25 +1928,25 @@ static void DoREADBase(uint32_t sa, uint32_t sc)
 
  if(SCSILog)
  {
-  int Track = toc.FindTrackByLBA(sa);
-  uint32_t Offset = sa - toc.tracks[Track].lba; //Cur_CDIF->GetTrackStartPositionLBA(Track);
+  int Track = scsicd->toc.FindTrackByLBA(sa);
+  uint32_t Offset = sa - scsicd->toc.tracks[Track].lba; //Cur_CDIF->GetTrackStartPositionLBA(Track);
   SCSILog("SCSI", "Read: start=0x%08x(track=%d, offs=0x%08x), cnt=0x%08x", sa, Track, Offset, sc);
  }
 
- SectorAddr = sa;
- SectorCount = sc;
- if(SectorCount)
+ scsicd->SectorAddr = sa;
+ scsicd->SectorCount = sc;
+ if(scsicd->SectorCount)
  {
-  Cur_CDIF->HintReadSector(sa);	//, sa + sc);
+  scsicd->Cur_CDIF->HintReadSector(sa);	//, sa + sc);
 
-  CDReadTimer = (uint64_t)((WhichSystem == SCSICD_PCE) ? 3 : 1) * 2048 * System_Clock / CD_DATA_TRANSFER_RATE;
+  scsicd->CDReadTimer = (uint64_t)((scsicd->WhichSystem == SCSICD_PCE) ? 3 : 1) * 2048 * scsicd->System_Clock / scsicd->CD_DATA_TRANSFER_RATE;
  }
  else
  {
-  CDReadTimer = 0;
+  scsicd->CDReadTimer = 0;
   SendStatusAndMessage(STATUS_GOOD, 0x00);
  }
- cdda.CDDAStatus = CDDASTATUS_STOPPED;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
 }
 
 
@@ -2000,7 +2017,7 @@ static void DoPREFETCH(const uint8_t *cdb)
 
  // Note: This command appears to lock up the CD unit to some degree on a real PC-FX if the (lba + len) >= leadout_track_lba,
  // more testing is needed if we ever try to fully emulate this command.
- if(lba >= toc.tracks[100].lba)
+ if(lba >= scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
   return;
@@ -2017,13 +2034,13 @@ static void DoPREFETCH(const uint8_t *cdb)
 // SEEK functions are mostly just stubs for now, until(if) we emulate seek delays.
 static void DoSEEKBase(uint32_t lba)
 {
- if(lba >= toc.tracks[100].lba)
+ if(lba >= scsicd->toc.tracks[100].lba)
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
   return;
  } 
 
- cdda.CDDAStatus = CDDASTATUS_STOPPED;
+ scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
  SendStatusAndMessage(STATUS_GOOD, 0x00);
 }
 
@@ -2083,7 +2100,7 @@ static void DoREADSUBCHANNEL(const uint8_t *cdb)
   return;
  }
 
- if(DataFormat == 0x3 && (TrackNum < toc.first_track || TrackNum > toc.last_track))
+ if(DataFormat == 0x3 && (TrackNum < scsicd->toc.first_track || TrackNum > scsicd->toc.last_track))
  {
   CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_INVALID_PARAMETER);
   return;
@@ -2092,9 +2109,9 @@ static void DoREADSUBCHANNEL(const uint8_t *cdb)
  data_in[offset++] = 0;
 
  // FIXME:  Is this audio status code correct for scanning playback??
- if(cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING)
   data_in[offset++] = 0x11;	// Audio play operation in progress
- else if(cdda.CDDAStatus == CDDASTATUS_PAUSED)
+ else if(scsicd->cdda.CDDAStatus == CDDASTATUS_PAUSED)
   data_in[offset++] = 0x12;	// Audio play operation paused
  else
   data_in[offset++] = 0x13;	// 0x13(audio play operation completed successfully) or 0x15(no current audio status to return)? :(
@@ -2111,7 +2128,7 @@ static void DoREADSUBCHANNEL(const uint8_t *cdb)
   data_in[offset++] = DataFormat;
   if(!DataFormat || DataFormat == 0x01)
   {
-   uint8_t *SubQBuf = cd.SubQBuf[QMode_Time];
+   uint8_t *SubQBuf = scsicd->cd.SubQBuf[QMode_Time];
 
    data_in[offset++] = ((SubQBuf[0] & 0x0F) << 4) | ((SubQBuf[0] & 0xF0) >> 4); // Control/adr
    data_in[offset++] = SubQBuf[1]; // Track
@@ -2172,7 +2189,7 @@ static void DoREADSUBCHANNEL(const uint8_t *cdb)
   {
    if(DataFormat == 0x03)
    {
-    uint8_t *SubQBuf = cd.SubQBuf[QMode_Time];	// FIXME
+    uint8_t *SubQBuf = scsicd->cd.SubQBuf[QMode_Time];	// FIXME
     data_in[offset++] = ((SubQBuf[0] & 0x0F) << 4) | ((SubQBuf[0] & 0xF0) >> 4); // Control/adr
     data_in[offset++] = TrackNum;	// From sub Q or from parameter?
     data_in[offset++] = 0x00;		// Reserved.
@@ -2197,15 +2214,15 @@ static void DoREADSUBCHANNEL(const uint8_t *cdb)
 ********************************************************/
 static void DoNEC_READSUBQ(const uint8_t *cdb)
 {
- uint8_t *SubQBuf = cd.SubQBuf[QMode_Time];
+ uint8_t *SubQBuf = scsicd->cd.SubQBuf[QMode_Time];
  uint8_t data_in[10];
  const uint8_t alloc_size = (cdb[1] < 10) ? cdb[1] : 10;
 
  memset(data_in, 0x00, 10);
 
- if(cdda.CDDAStatus == CDDASTATUS_PAUSED)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_PAUSED)
   data_in[0] = 2;		// Pause
- else if(cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING) // FIXME:  Is this the correct status code for scanning playback?
+ else if(scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING) // FIXME:  Is this the correct status code for scanning playback?
   data_in[0] = 0;		// Playing
  else
   data_in[0] = 3;		// Stopped
@@ -2230,9 +2247,9 @@ static void DoTESTUNITREADY(const uint8_t *cdb)
 
 static void DoNEC_PAUSE(const uint8_t *cdb)
 {
- if(cdda.CDDAStatus != CDDASTATUS_STOPPED) // Hmm, should we give an error if it tries to pause and it's already paused?
+ if(scsicd->cdda.CDDAStatus != CDDASTATUS_STOPPED) // Hmm, should we give an error if it tries to pause and it's already paused?
  {
-  cdda.CDDAStatus = CDDASTATUS_PAUSED;
+  scsicd->cdda.CDDAStatus = CDDASTATUS_PAUSED;
   SendStatusAndMessage(STATUS_GOOD, 0x00);
  }
  else // Definitely give an error if it tries to pause when no track is playing!
@@ -2266,18 +2283,18 @@ static void DoNEC_SCAN(const uint8_t *cdb)
    break;
 
   case 0x80:	// FIXME: error on invalid track number???
-   sector_tmp = toc.tracks[BCD_to_U8(cdb[2])].lba;
+   sector_tmp = scsicd->toc.tracks[BCD_to_U8(cdb[2])].lba;
    break;
  }
 
- cdda.ScanMode = cdb[1] & 0x3;
- cdda.scan_sec_end = sector_tmp;
+ scsicd->cdda.ScanMode = cdb[1] & 0x3;
+ scsicd->cdda.scan_sec_end = sector_tmp;
 
- if(cdda.CDDAStatus != CDDASTATUS_STOPPED)
+ if(scsicd->cdda.CDDAStatus != CDDASTATUS_STOPPED)
  {
-  if(cdda.ScanMode)
+  if(scsicd->cdda.ScanMode)
   {
-   cdda.CDDAStatus = CDDASTATUS_SCANNING;
+   scsicd->cdda.CDDAStatus = CDDASTATUS_SCANNING;
   }
  }
  SendStatusAndMessage(STATUS_GOOD, 0x00);
@@ -2411,15 +2428,15 @@ static SCSICH PCECommandDefs[] =
 
 void SCSICD_ResetTS(uint32_t ts_base)
 {
- lastts = ts_base;
+ scsicd->lastts = ts_base;
 }
 
 void SCSICD_GetCDDAValues(int16_t &left, int16_t &right)
 {
- if(cdda.CDDAStatus)
+ if(scsicd->cdda.CDDAStatus)
  {
-  left = cdda.sr[0];
-  right = cdda.sr[1];
+  left = scsicd->cdda.sr[0];
+  right = scsicd->cdda.sr[1];
  }
  else
   left = right = 0;
@@ -2444,66 +2461,66 @@ static const int16_t OversampleFilter[2][0x10] =
 
 static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
 {
- if(cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING)
  {
-  cdda.CDDADiv -= (int64_t)run_time << 20;
+  scsicd->cdda.CDDADiv -= (int64_t)run_time << 20;
 
-  while(cdda.CDDADiv <= 0)
+  while(scsicd->cdda.CDDADiv <= 0)
   {
-   const uint32_t synthtime_ex = (((uint64_t)system_timestamp << 20) + (int64_t)cdda.CDDADiv) / cdda.CDDATimeDiv;
+   const uint32_t synthtime_ex = (((uint64_t)system_timestamp << 20) + (int64_t)scsicd->cdda.CDDADiv) / scsicd->cdda.CDDATimeDiv;
    const int synthtime = (synthtime_ex >> 16) & 0xFFFF;	// & 0xFFFF(or equivalent) to prevent overflowing HRBufs[]
    const int synthtime_phase = (int)(synthtime_ex & 0xFFFF) - 0x80;
    const int synthtime_phase_int = synthtime_phase >> (16 - CDDA_FILTER_NUMPHASES_SHIFT);
    const int synthtime_phase_fract = synthtime_phase & ((1 << (16 - CDDA_FILTER_NUMPHASES_SHIFT)) - 1);
    int32_t sample_va[2];
 
-   cdda.CDDADiv += cdda.CDDADivAcc;
+   scsicd->cdda.CDDADiv += scsicd->cdda.CDDADivAcc;
 
-   if(!(cdda.OversamplePos & 1))
+   if(!(scsicd->cdda.OversamplePos & 1))
    {
-    if(cdda.CDDAReadPos == 588)
+    if(scsicd->cdda.CDDAReadPos == 588)
     {
-     if(read_sec >= read_sec_end || (cdda.CDDAStatus == CDDASTATUS_SCANNING && read_sec == cdda.scan_sec_end))
+     if(scsicd->read_sec >= scsicd->read_sec_end || (scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING && scsicd->read_sec == scsicd->cdda.scan_sec_end))
      {
-      switch(cdda.PlayMode)
+      switch(scsicd->cdda.PlayMode)
       {
        case PLAYMODE_SILENT:
        case PLAYMODE_NORMAL:
-        cdda.CDDAStatus = CDDASTATUS_STOPPED;
+        scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
         break;
 
        case PLAYMODE_INTERRUPT:
-        cdda.CDDAStatus = CDDASTATUS_STOPPED;
-        CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_DONE);
+        scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
+        scsicd->CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_DONE);
         break;
 
        case PLAYMODE_LOOP:
-        read_sec = read_sec_start;
+        scsicd->read_sec = scsicd->read_sec_start;
         break;
       }
 
       // If CDDA playback is stopped, break out of our while(CDDADiv ...) loop and don't play any more sound!
-      if(cdda.CDDAStatus == CDDASTATUS_STOPPED)
+      if(scsicd->cdda.CDDAStatus == CDDASTATUS_STOPPED)
        break;
      }
 
      // Don't play past the user area of the disc.
-     if(read_sec >= toc.tracks[100].lba)
+     if(scsicd->read_sec >= scsicd->toc.tracks[100].lba)
      {
-      cdda.CDDAStatus = CDDASTATUS_STOPPED;
+      scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
       break;
      }
 
-     if(TrayOpen || !Cur_CDIF)
+     if(scsicd->TrayOpen || !scsicd->Cur_CDIF)
      {
-      cdda.CDDAStatus = CDDASTATUS_STOPPED;
+      scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
 
       #if 0
-      cd.data_transfer_done = FALSE;
-      cd.key_pending = SENSEKEY_NOT_READY;
-      cd.asc_pending = ASC_MEDIUM_NOT_PRESENT;
-      cd.ascq_pending = 0x00;
-      cd.fru_pending = 0x00;
+      scsicd->cd.data_transfer_done = FALSE;
+      scsicd->cd.key_pending = SENSEKEY_NOT_READY;
+      scsicd->cd.asc_pending = ASC_MEDIUM_NOT_PRESENT;
+      scsicd->cd.ascq_pending = 0x00;
+      scsicd->cd.fru_pending = 0x00;
       SendStatusAndMessage(STATUS_CHECK_CONDITION, 0x00);
       #endif
 
@@ -2511,64 +2528,64 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
      }
 
 
-     cdda.CDDAReadPos = 0;
+     scsicd->cdda.CDDAReadPos = 0;
 
      {
       uint8_t tmpbuf[2352 + 96];
 
-      Cur_CDIF->ReadRawSector(tmpbuf, read_sec);	//, read_sec_end, read_sec_start);
+      scsicd->Cur_CDIF->ReadRawSector(tmpbuf, scsicd->read_sec);	//, read_sec_end, read_sec_start);
 
       for(int i = 0; i < 588 * 2; i++)
-       cdda.CDDASectorBuffer[i] = MDFN_de16lsb(&tmpbuf[i * 2]);
+       scsicd->cdda.CDDASectorBuffer[i] = MDFN_de16lsb(&tmpbuf[i * 2]);
 
-      memcpy(cd.SubPWBuf, tmpbuf + 2352, 96);
+      memcpy(scsicd->cd.SubPWBuf, tmpbuf + 2352, 96);
      }
      GenSubQFromSubPW();
 
-     if(!(cd.SubQBuf_Last[0] & 0x10))
+     if(!(scsicd->cd.SubQBuf_Last[0] & 0x10))
      {
       // Not using de-emphasis, so clear the de-emphasis filter state.
-      memset(cdda.DeemphState, 0, sizeof(cdda.DeemphState));
+      memset(scsicd->cdda.DeemphState, 0, sizeof(scsicd->cdda.DeemphState));
      }
 
-     if(cdda.CDDAStatus == CDDASTATUS_SCANNING)
+     if(scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING)
      {
-      int64_t tmp_read_sec = read_sec;
+      int64_t tmp_read_sec = scsicd->read_sec;
 
-      if(cdda.ScanMode & 1)
+      if(scsicd->cdda.ScanMode & 1)
       {
        tmp_read_sec -= 24;
-       if(tmp_read_sec < cdda.scan_sec_end)
-        tmp_read_sec = cdda.scan_sec_end;
+       if(tmp_read_sec < scsicd->cdda.scan_sec_end)
+        tmp_read_sec = scsicd->cdda.scan_sec_end;
       }
       else
       {
        tmp_read_sec += 24;
-       if(tmp_read_sec > cdda.scan_sec_end)
-        tmp_read_sec = cdda.scan_sec_end;
+       if(tmp_read_sec > scsicd->cdda.scan_sec_end)
+        tmp_read_sec = scsicd->cdda.scan_sec_end;
       }
-      read_sec = tmp_read_sec;
+      scsicd->read_sec = tmp_read_sec;
      }
      else
-      read_sec++;
+      scsicd->read_sec++;
     } // End    if(CDDAReadPos == 588)
 
-    if(!(cdda.CDDAReadPos % 6))
+    if(!(scsicd->cdda.CDDAReadPos % 6))
     {
-     int subindex = cdda.CDDAReadPos / 6 - 2;
+     int subindex = scsicd->cdda.CDDAReadPos / 6 - 2;
 
      if(subindex >= 0)
-      CDStuffSubchannels(cd.SubPWBuf[subindex], subindex);
+      scsicd->CDStuffSubchannels(scsicd->cd.SubPWBuf[subindex], subindex);
      else // The system-specific emulation code should handle what value the sync bytes are.
-      CDStuffSubchannels(0x00, subindex);
+      scsicd->CDStuffSubchannels(0x00, subindex);
     }
 
     // If the last valid sub-Q data decoded indicate that the corresponding sector is a data sector, don't output the
     // current sector as audio.
-    if(!(cd.SubQBuf_Last[0] & 0x40) && cdda.PlayMode != PLAYMODE_SILENT)
+    if(!(scsicd->cd.SubQBuf_Last[0] & 0x40) && scsicd->cdda.PlayMode != PLAYMODE_SILENT)
     {
-     cdda.sr[0] = cdda.CDDASectorBuffer[cdda.CDDAReadPos * 2 + cdda.OutPortChSelectCache[0]];
-     cdda.sr[1] = cdda.CDDASectorBuffer[cdda.CDDAReadPos * 2 + cdda.OutPortChSelectCache[1]];
+     scsicd->cdda.sr[0] = scsicd->cdda.CDDASectorBuffer[scsicd->cdda.CDDAReadPos * 2 + scsicd->cdda.OutPortChSelectCache[0]];
+     scsicd->cdda.sr[1] = scsicd->cdda.CDDASectorBuffer[scsicd->cdda.CDDAReadPos * 2 + scsicd->cdda.OutPortChSelectCache[1]];
     }
 
 #if 0
@@ -2579,8 +2596,8 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
      static double phase_inc = 0;
      static const double phase_inc_inc = 0.000003 / 2;
 
-     cdda.sr[0] = 32767 * sin(phase);
-     cdda.sr[1] = 32767 * sin(phase);
+     scsicd->cdda.sr[0] = 32767 * sin(phase);
+     scsicd->cdda.sr[1] = 32767 * sin(phase);
 
      //cdda.sr[0] = wv;
      //cdda.sr[1] = wv;
@@ -2594,16 +2611,16 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
 #endif
 
     {
-     const unsigned obwp = cdda.OversamplePos >> 1;
-     cdda.OversampleBuffer[0][obwp] = cdda.OversampleBuffer[0][0x10 + obwp] = cdda.sr[0];
-     cdda.OversampleBuffer[1][obwp] = cdda.OversampleBuffer[1][0x10 + obwp] = cdda.sr[1];
+     const unsigned obwp = scsicd->cdda.OversamplePos >> 1;
+     scsicd->cdda.OversampleBuffer[0][obwp] = scsicd->cdda.OversampleBuffer[0][0x10 + obwp] = scsicd->cdda.sr[0];
+     scsicd->cdda.OversampleBuffer[1][obwp] = scsicd->cdda.OversampleBuffer[1][0x10 + obwp] = scsicd->cdda.sr[1];
     }
 
-    cdda.CDDAReadPos++;
+    scsicd->cdda.CDDAReadPos++;
    } // End if(!(cdda.OversamplePos & 1))
 
    {
-    const int16_t* f = OversampleFilter[cdda.OversamplePos & 1];
+    const int16_t* f = OversampleFilter[scsicd->cdda.OversamplePos & 1];
 #if defined(__SSE2__)
     __m128i f0 = _mm_load_si128((__m128i *)&f[0]);
     __m128i f1 = _mm_load_si128((__m128i *)&f[8]);
@@ -2611,7 +2628,7 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
       
     for(unsigned lr = 0; lr < 2; lr++)
     {
-     const int16_t* b = &cdda.OversampleBuffer[lr][((cdda.OversamplePos >> 1) + 1) & 0xF];
+     const int16_t* b = &scsicd->cdda.OversampleBuffer[lr][((scsicd->cdda.OversamplePos >> 1) + 1) & 0xF];
 #if defined(__SSE2__)
      union
      {
@@ -2646,7 +2663,7 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
      // -1935802368 * 65536 = -126864743989248
      //
      // -126864743989248 / 65536 = -1935802368
-     sample_va[lr] = ((int64_t)accum * cdda.OutPortVolumeCache[lr]) >> 16;
+     sample_va[lr] = ((int64_t)accum * scsicd->cdda.OutPortVolumeCache[lr]) >> 16;
      // Output of this stage will be (approximate max ranges) -2147450880 through 2147385345.
     }
    }
@@ -2655,23 +2672,23 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
    // This de-emphasis filter's frequency response isn't totally correct, but it's much better than nothing(and it's not like any known PCE CD/TG16 CD/PC-FX games
    // utilize pre-emphasis anyway).
    //
-   if(MDFN_UNLIKELY(cd.SubQBuf_Last[0] & 0x10))
+   if(MDFN_UNLIKELY(scsicd->cd.SubQBuf_Last[0] & 0x10))
    {
     //puts("Deemph");
     for(unsigned lr = 0; lr < 2; lr++)
     {
      float inv = sample_va[lr] * 0.35971507338824012f;
 
-     cdda.DeemphState[lr][1] = (cdda.DeemphState[lr][0] - 0.4316395666f * inv) + (0.7955522347f * cdda.DeemphState[lr][1]);
-     cdda.DeemphState[lr][0] = inv;
+     scsicd->cdda.DeemphState[lr][1] = (scsicd->cdda.DeemphState[lr][0] - 0.4316395666f * inv) + (0.7955522347f * scsicd->cdda.DeemphState[lr][1]);
+     scsicd->cdda.DeemphState[lr][0] = inv;
 
-     sample_va[lr] = std::max<float>(-2147483648.0, std::min<float>(2147483647.0, cdda.DeemphState[lr][1]));
+     sample_va[lr] = std::max<float>(-2147483648.0, std::min<float>(2147483647.0, scsicd->cdda.DeemphState[lr][1]));
      //printf("%u: %f, %d\n", lr, cdda.DeemphState[lr][1], sample_va[lr]);
     }
    }
 
 
-   if(HRBufs[0] && HRBufs[1])
+   if(scsicd->HRBufs[0] && scsicd->HRBufs[1])
    {
     //
     // FINAL_OUT_SHIFT should be 32 so we can take advantage of 32x32->64 multipliers on 32-bit CPUs.
@@ -2696,8 +2713,8 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
 		 CDDA_Filter[1 + synthtime_phase_int + 1][c] * mult_b);
     }
 
-    int32_t* tb0 = &HRBufs[0][synthtime];
-    int32_t* tb1 = &HRBufs[1][synthtime];
+    int32_t* tb0 = &scsicd->HRBufs[0][synthtime];
+    int32_t* tb1 = &scsicd->HRBufs[1][synthtime];
 
     for(unsigned c = 0; c < CDDA_FILTER_NUMCONVOLUTIONS; c++)
     {
@@ -2708,25 +2725,25 @@ static INLINE void RunCDDA(uint32_t system_timestamp, int32_t run_time)
     #undef MULT_SHIFT_ADJ
    }
 
-   cdda.OversamplePos = (cdda.OversamplePos + 1) & 0x1F;
+   scsicd->cdda.OversamplePos = (scsicd->cdda.OversamplePos + 1) & 0x1F;
   } // end while(cdda.CDDADiv <= 0)
  }
 }
 
 static INLINE void RunCDRead(uint32_t system_timestamp, int32_t run_time)
 {
- if(CDReadTimer > 0)
+ if(scsicd->CDReadTimer > 0)
  {
-  CDReadTimer -= run_time;
+  scsicd->CDReadTimer -= run_time;
 
-  if(CDReadTimer <= 0)
+  if(scsicd->CDReadTimer <= 0)
   {
-   if(din->CanWrite() < ((WhichSystem == SCSICD_PCFX) ? 2352 : 2048))	// +96 if we find out the PC-FX can read subchannel data along with raw data too. ;)
+   if(scsicd->din->CanWrite() < ((scsicd->WhichSystem == SCSICD_PCFX) ? 2352 : 2048))	// +96 if we find out the PC-FX can read subchannel data along with raw data too. ;)
    {
     //printf("Carp: %d %d %d\n", din->CanWrite(), SectorCount, CDReadTimer);
     //CDReadTimer = (cd.data_in_size - cd.data_in_pos) * 10;
     
-    CDReadTimer += (uint64_t) 1 * 2048 * System_Clock / CD_DATA_TRANSFER_RATE;
+    scsicd->CDReadTimer += (uint64_t) 1 * 2048 * scsicd->System_Clock / scsicd->CD_DATA_TRANSFER_RATE;
 
     //CDReadTimer += (uint64_t) 1 * 128 * System_Clock / CD_DATA_TRANSFER_RATE;
    }
@@ -2734,54 +2751,54 @@ static INLINE void RunCDRead(uint32_t system_timestamp, int32_t run_time)
    {
     uint8_t tmp_read_buf[2352 + 96];
 
-    if(TrayOpen)
+    if(scsicd->TrayOpen)
     {
-     din->Flush();
-     cd.data_transfer_done = FALSE;
+     scsicd->din->Flush();
+     scsicd->cd.data_transfer_done = FALSE;
 
      CommandCCError(SENSEKEY_NOT_READY, NSE_TRAY_OPEN);
     }
-    else if(!Cur_CDIF)
+    else if(!scsicd->Cur_CDIF)
     {
      CommandCCError(SENSEKEY_NOT_READY, NSE_NO_DISC);
     }
-    else if(SectorAddr >= toc.tracks[100].lba)
+    else if(scsicd->SectorAddr >= scsicd->toc.tracks[100].lba)
     {
      CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
     }
-    else if(!Cur_CDIF->ReadRawSector(tmp_read_buf, SectorAddr))	//, SectorAddr + SectorCount))
+    else if(!scsicd->Cur_CDIF->ReadRawSector(tmp_read_buf, scsicd->SectorAddr))	//, SectorAddr + SectorCount))
     {
-     cd.data_transfer_done = FALSE;
+     scsicd->cd.data_transfer_done = FALSE;
 
      CommandCCError(SENSEKEY_ILLEGAL_REQUEST);
     }
-    else if(ValidateRawDataSector(tmp_read_buf, SectorAddr))
+    else if(ValidateRawDataSector(tmp_read_buf, scsicd->SectorAddr))
     {
-     memcpy(cd.SubPWBuf, tmp_read_buf + 2352, 96);
+     memcpy(scsicd->cd.SubPWBuf, tmp_read_buf + 2352, 96);
 
      if(tmp_read_buf[12 + 3] == 0x2)
-      din->Write(tmp_read_buf + 24, 2048);
+      scsicd->din->Write(tmp_read_buf + 24, 2048);
      else
-      din->Write(tmp_read_buf + 16, 2048);
+      scsicd->din->Write(tmp_read_buf + 16, 2048);
 
      GenSubQFromSubPW();
 
-     CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_READY);
+     scsicd->CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_READY);
 
-     SectorAddr++;
-     SectorCount--;
+     scsicd->SectorAddr++;
+     scsicd->SectorCount--;
 
-     if(CurrentPhase != PHASE_DATA_IN)
+     if(scsicd->CurrentPhase != PHASE_DATA_IN)
       ChangePhase(PHASE_DATA_IN);
 
-     if(SectorCount)
+     if(scsicd->SectorCount)
      {
-      cd.data_transfer_done = FALSE;
-      CDReadTimer += (uint64_t) 1 * 2048 * System_Clock / CD_DATA_TRANSFER_RATE;
+      scsicd->cd.data_transfer_done = FALSE;
+      scsicd->CDReadTimer += (uint64_t) 1 * 2048 * scsicd->System_Clock / scsicd->CD_DATA_TRANSFER_RATE;
      }
      else
      {
-      cd.data_transfer_done = TRUE;
+      scsicd->cd.data_transfer_done = TRUE;
      }
     }
    }				// end else to if(!Cur_CDIF->ReadSector
@@ -2791,39 +2808,54 @@ static INLINE void RunCDRead(uint32_t system_timestamp, int32_t run_time)
 }
 
 
+uint32_t SCSICD_DataInBurstAvail(void)
+{
+ if(scsicd->CurrentPhase != PHASE_DATA_IN || !REQ_signal || ACK_signal || ATN_signal || (RST_signal && !scsicd->cd.last_RST_signal))
+  return(0);
+
+ return(scsicd->din->in_count);
+}
+
+void SCSICD_DataInBurstNext(void)
+{
+ cd_bus->DB = scsicd->din->ReadByte();
+ SetREQ(FALSE);
+ SetREQ(TRUE);
+}
+
 uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
 {
- int32_t run_time = system_timestamp - lastts;
+ int32_t run_time = system_timestamp - scsicd->lastts;
 
- if(system_timestamp < lastts)
-  assert(system_timestamp >= lastts);
+ if(system_timestamp < scsicd->lastts)
+  assert(system_timestamp >= scsicd->lastts);
 
- monotonic_timestamp += run_time;
+ scsicd->monotonic_timestamp += run_time;
 
- lastts = system_timestamp;
+ scsicd->lastts = system_timestamp;
 
  RunCDRead(system_timestamp, run_time);
  RunCDDA(system_timestamp, run_time);
 
  bool ResetNeeded = false;
 
- if(RST_signal && !cd.last_RST_signal)
+ if(RST_signal && !scsicd->cd.last_RST_signal)
   ResetNeeded = true;
 
- cd.last_RST_signal = RST_signal;
+ scsicd->cd.last_RST_signal = RST_signal;
 
  if(ResetNeeded)
  {
   //puts("RST");
   VirtualReset();
  }
- else if(CurrentPhase == PHASE_BUS_FREE)
+ else if(scsicd->CurrentPhase == PHASE_BUS_FREE)
  {
   if(SEL_signal)
   {
-   if(WhichSystem == SCSICD_PCFX)
+   if(scsicd->WhichSystem == SCSICD_PCFX)
    {
-    //if(cd_bus.DB == 0x84)
+    //if(cd_bus->DB == 0x84)
     {
      ChangePhase(PHASE_COMMAND);
     }
@@ -2839,28 +2871,28 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
   //printf("Yay: %d %d\n", REQ_signal, ACK_signal);
   ChangePhase(PHASE_MESSAGE_OUT);
  }
- else switch(CurrentPhase)
+ else switch(scsicd->CurrentPhase)
  {
   case PHASE_COMMAND:
     if(REQ_signal && ACK_signal)	// Data bus is valid nowww
     {
-     //printf("Command Phase Byte I->T: %02x, %d\n", cd_bus.DB, cd.command_buffer_pos);
-     cd.command_buffer[cd.command_buffer_pos++] = cd_bus.DB;
+     //printf("Command Phase Byte I->T: %02x, %d\n", cd_bus->DB, cd.command_buffer_pos);
+     scsicd->cd.command_buffer[scsicd->cd.command_buffer_pos++] = cd_bus->DB;
      SetREQ(FALSE);
     }
 
-    if(!REQ_signal && !ACK_signal && cd.command_buffer_pos)	// Received at least one byte, what should we do?
+    if(!REQ_signal && !ACK_signal && scsicd->cd.command_buffer_pos)	// Received at least one byte, what should we do?
     {
-     if(cd.command_buffer_pos == RequiredCDBLen[cd.command_buffer[0] >> 4])
+     if(scsicd->cd.command_buffer_pos == RequiredCDBLen[scsicd->cd.command_buffer[0] >> 4])
      {
       const SCSICH *cmd_info_ptr;
 
-      if(WhichSystem == SCSICD_PCFX)
+      if(scsicd->WhichSystem == SCSICD_PCFX)
        cmd_info_ptr = PCFXCommandDefs;
       else
        cmd_info_ptr = PCECommandDefs;
 
-      while(cmd_info_ptr->pretty_name && cmd_info_ptr->cmd != cd.command_buffer[0])
+      while(cmd_info_ptr->pretty_name && cmd_info_ptr->cmd != scsicd->cd.command_buffer[0])
        cmd_info_ptr++;
   
       if(SCSILog)
@@ -2870,11 +2902,11 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
 
        log_buffer[0] = 0;
        
-       lb_pos = snprintf(log_buffer, 1024, "Command: %02x, %s%s  ", cd.command_buffer[0], cmd_info_ptr->pretty_name ? cmd_info_ptr->pretty_name : "!!BAD COMMAND!!",
+       lb_pos = snprintf(log_buffer, 1024, "Command: %02x, %s%s  ", scsicd->cd.command_buffer[0], cmd_info_ptr->pretty_name ? cmd_info_ptr->pretty_name : "!!BAD COMMAND!!",
 			(cmd_info_ptr->flags & SCF_UNTESTED) ? "(UNTESTED)" : "");
 
-       for(int i = 0; i < RequiredCDBLen[cd.command_buffer[0] >> 4]; i++)
-        lb_pos += snprintf(log_buffer + lb_pos, 1024 - lb_pos, "%02x ", cd.command_buffer[i]);
+       for(int i = 0; i < RequiredCDBLen[scsicd->cd.command_buffer[0] >> 4]; i++)
+        lb_pos += snprintf(log_buffer + lb_pos, 1024 - lb_pos, "%02x ", scsicd->cd.command_buffer[i]);
 
        SCSILog("SCSI", "%s", log_buffer);
        //puts(log_buffer);
@@ -2888,9 +2920,9 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
        //SCSIDBG("Bad Command: %02x\n", cd.command_buffer[0]);
 
        if(SCSILog)
-        SCSILog("SCSI", "Bad Command: %02x", cd.command_buffer[0]);
+        SCSILog("SCSI", "Bad Command: %02x", scsicd->cd.command_buffer[0]);
 
-       cd.command_buffer_pos = 0;
+       scsicd->cd.command_buffer_pos = 0;
       }
       else
       {
@@ -2899,38 +2931,38 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
         //SCSIDBG("Untested SCSI command: %02x, %s", cd.command_buffer[0], cmd_info_ptr->pretty_name);
        }
 
-       if(TrayOpen && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
+       if(scsicd->TrayOpen && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
        {
 	CommandCCError(SENSEKEY_NOT_READY, NSE_TRAY_OPEN);
        }
-       else if(!Cur_CDIF && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
+       else if(!scsicd->Cur_CDIF && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
        {
 	CommandCCError(SENSEKEY_NOT_READY, NSE_NO_DISC);
        }
-       else if(cd.DiscChanged && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
+       else if(scsicd->cd.DiscChanged && (cmd_info_ptr->flags & SCF_REQUIRES_MEDIUM))
        {
 	CommandCCError(SENSEKEY_UNIT_ATTENTION, NSE_DISC_CHANGED);
-	cd.DiscChanged = false;
+	scsicd->cd.DiscChanged = false;
        }
        else
        {
-	bool prev_ps = (cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING);
+	bool prev_ps = (scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING);
 
-        cmd_info_ptr->func(cd.command_buffer);
+        cmd_info_ptr->func(scsicd->cd.command_buffer);
 
-	bool new_ps = (cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING);
+	bool new_ps = (scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING);
 
 	// A bit kludgey, but ehhhh.
 	if(!prev_ps && new_ps)
 	{
-	 memset(cdda.sr, 0, sizeof(cdda.sr));
-	 memset(cdda.OversampleBuffer, 0, sizeof(cdda.OversampleBuffer));
-	 memset(cdda.DeemphState, 0, sizeof(cdda.DeemphState));
+	 memset(scsicd->cdda.sr, 0, sizeof(scsicd->cdda.sr));
+	 memset(scsicd->cdda.OversampleBuffer, 0, sizeof(scsicd->cdda.OversampleBuffer));
+	 memset(scsicd->cdda.DeemphState, 0, sizeof(scsicd->cdda.DeemphState));
 	 //printf("CLEAR BUFFERS LALALA\n");
 	}
        }
 
-       cd.command_buffer_pos = 0;
+       scsicd->cd.command_buffer_pos = 0;
       }
      } // end if(cd.command_buffer_pos == RequiredCDBLen[cd.command_buffer[0] >> 4])
      else			// Otherwise, get more data for the command!
@@ -2941,18 +2973,18 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
   case PHASE_DATA_OUT:
     if(REQ_signal && ACK_signal)	// Data bus is valid nowww
     {
-     //printf("DATAOUT-SCSIIN: %d %02x\n", cd.data_out_pos, cd_bus.DB);
-     cd.data_out[cd.data_out_pos++] = cd_bus.DB;
+     //printf("DATAOUT-SCSIIN: %d %02x\n", cd.data_out_pos, cd_bus->DB);
+     scsicd->cd.data_out[scsicd->cd.data_out_pos++] = cd_bus->DB;
      SetREQ(FALSE);
     }
-    else if(!REQ_signal && !ACK_signal && cd.data_out_pos)
+    else if(!REQ_signal && !ACK_signal && scsicd->cd.data_out_pos)
     {
-     if(cd.data_out_pos == cd.data_out_want)
+     if(scsicd->cd.data_out_pos == scsicd->cd.data_out_want)
      {
-      cd.data_out_pos = 0;
+      scsicd->cd.data_out_pos = 0;
 
-      if(cd.command_buffer[0] == 0x15)
-	FinishMODESELECT6(cd.data_out, cd.data_out_want);
+      if(scsicd->cd.command_buffer[0] == 0x15)
+	FinishMODESELECT6(scsicd->cd.data_out, scsicd->cd.data_out_want);
       else	// Error out here?  It shouldn't be reached:
        SendStatusAndMessage(STATUS_GOOD, 0x00);
      }
@@ -2963,7 +2995,7 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
 
   
   case PHASE_MESSAGE_OUT:
-   //printf("%d %d, %02x\n", REQ_signal, ACK_signal, cd_bus.DB);
+   //printf("%d %d, %02x\n", REQ_signal, ACK_signal, cd_bus->DB);
    if(REQ_signal && ACK_signal)
    {
     SetREQ(FALSE);
@@ -2971,19 +3003,19 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
     // ABORT message is 0x06, but the code isn't set up to be able to recover from a MESSAGE OUT phase back to the previous phase, so we treat any message as an ABORT.
     // Real tests are needed on the PC-FX to determine its behavior.
     //  (Previously, ATN emulation was a bit broken, which resulted in the wrong data on the data bus in this code path in at least "Battle Heat", but it's fixed now and 0x06 is on the data bus).
-    //if(cd_bus.DB == 0x6)		// ABORT message!
+    //if(cd_bus->DB == 0x6)		// ABORT message!
     if(1)
     {
-     //printf("[SCSICD] Abort Received(DB=0x%02x)\n", cd_bus.DB);
-     din->Flush();
-     cd.data_out_pos = cd.data_out_want = 0;
+     //printf("[SCSICD] Abort Received(DB=0x%02x)\n", cd_bus->DB);
+     scsicd->din->Flush();
+     scsicd->cd.data_out_pos = scsicd->cd.data_out_want = 0;
 
-     CDReadTimer = 0;
-     cdda.CDDAStatus = CDDASTATUS_STOPPED;
+     scsicd->CDReadTimer = 0;
+     scsicd->cdda.CDDAStatus = CDDASTATUS_STOPPED;
      ChangePhase(PHASE_BUS_FREE);
     }
     //else
-    // printf("[SCSICD] Message to target: 0x%02x\n", cd_bus.DB);
+    // printf("[SCSICD] Message to target: 0x%02x\n", cd_bus->DB);
    }
    break;
 
@@ -2992,14 +3024,14 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
     if(REQ_signal && ACK_signal)
     {
      SetREQ(FALSE);
-     cd.status_sent = TRUE;
+     scsicd->cd.status_sent = TRUE;
     }
 
-    if(!REQ_signal && !ACK_signal && cd.status_sent)
+    if(!REQ_signal && !ACK_signal && scsicd->cd.status_sent)
     {
      // Status sent, so get ready to send the message!
-     cd.status_sent = FALSE;
-     cd_bus.DB = cd.message_pending;
+     scsicd->cd.status_sent = FALSE;
+     cd_bus->DB = scsicd->cd.message_pending;
 
      ChangePhase(PHASE_MESSAGE_IN);
     }
@@ -3009,20 +3041,20 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
     if(!REQ_signal && !ACK_signal)
     {
      //puts("REQ and ACK false");
-     if(din->in_count == 0)	// aaand we're done!
+     if(scsicd->din->in_count == 0)	// aaand we're done!
      {
-      CDIRQCallback(0x8000 | SCSICD_IRQ_DATA_TRANSFER_READY);
+      scsicd->CDIRQCallback(0x8000 | SCSICD_IRQ_DATA_TRANSFER_READY);
 
-      if(cd.data_transfer_done)
+      if(scsicd->cd.data_transfer_done)
       {
        SendStatusAndMessage(STATUS_GOOD, 0x00);
-       cd.data_transfer_done = FALSE;
-       CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_DONE);
+       scsicd->cd.data_transfer_done = FALSE;
+       scsicd->CDIRQCallback(SCSICD_IRQ_DATA_TRANSFER_DONE);
       }
      }
      else
      {
-      cd_bus.DB = din->ReadByte();
+      cd_bus->DB = scsicd->din->ReadByte();
       SetREQ(TRUE);
      }
     }
@@ -3037,12 +3069,12 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
    if(REQ_signal && ACK_signal)
    {
     SetREQ(FALSE);
-    cd.message_sent = TRUE;
+    scsicd->cd.message_sent = TRUE;
    }
 
-   if(!REQ_signal && !ACK_signal && cd.message_sent)
+   if(!REQ_signal && !ACK_signal && scsicd->cd.message_sent)
    {
-    cd.message_sent = FALSE;
+    scsicd->cd.message_sent = FALSE;
     ChangePhase(PHASE_BUS_FREE);
    }
    break;
@@ -3050,12 +3082,12 @@ uint32_t SCSICD_Run(scsicd_timestamp_t system_timestamp)
 
  int32_t next_time = 0x7fffffff;
 
- if(CDReadTimer > 0 && CDReadTimer < next_time)
-  next_time = CDReadTimer;
+ if(scsicd->CDReadTimer > 0 && scsicd->CDReadTimer < next_time)
+  next_time = scsicd->CDReadTimer;
 
- if(cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING)
+ if(scsicd->cdda.CDDAStatus == CDDASTATUS_PLAYING || scsicd->cdda.CDDAStatus == CDDASTATUS_SCANNING)
  {
-  int32_t cdda_div_sexytime = (cdda.CDDADiv + (cdda.CDDADivAcc * (cdda.OversamplePos & 1)) + ((1 << 20) - 1)) >> 20;
+  int32_t cdda_div_sexytime = (scsicd->cdda.CDDADiv + (scsicd->cdda.CDDADivAcc * (scsicd->cdda.OversamplePos & 1)) + ((1 << 20) - 1)) >> 20;
   if(cdda_div_sexytime > 0 && cdda_div_sexytime < next_time)
    next_time = cdda_div_sexytime;
  }
@@ -3072,66 +3104,82 @@ void SCSICD_SetLog(void (*logfunc)(const char *, const char *, ...))
 
 void SCSICD_SetTransferRate(uint32_t TransferRate)
 {
- CD_DATA_TRANSFER_RATE = TransferRate;
+ scsicd->CD_DATA_TRANSFER_RATE = TransferRate;
+}
+
+scsicd_ctx_t *SCSICD_NewContext(void)
+{
+ return new scsicd_ctx_t();
+}
+
+void SCSICD_DeleteContext(scsicd_ctx_t *ctx)
+{
+ delete ctx;
+}
+
+void SCSICD_SetContext(scsicd_ctx_t *ctx)
+{
+ scsicd = ctx;
+ cd_bus = ctx ? &ctx->cd_bus : NULL;
 }
 
 void SCSICD_Close(void)
 {
- if(din)
+ if(scsicd->din)
  {
-  delete din;
-  din = NULL;
+  delete scsicd->din;
+  scsicd->din = NULL;
  }
 }
 
 void SCSICD_Init(int type, int cdda_time_div, int32_t* left_hrbuf, int32_t* right_hrbuf, uint32_t TransferRate, uint32_t SystemClock, void (*IRQFunc)(int), void (*SSCFunc)(uint8_t, int))
 {
- Cur_CDIF = NULL;
- TrayOpen = true;
+ scsicd->Cur_CDIF = NULL;
+ scsicd->TrayOpen = true;
 
  assert(SystemClock < 30000000);	// 30 million, sanity check.
 
- monotonic_timestamp = 0;
- lastts = 0;
+ scsicd->monotonic_timestamp = 0;
+ scsicd->lastts = 0;
 
  SCSILog = NULL;
 
  if(type == SCSICD_PCFX)
-  din = new SimpleFIFO<uint8_t>(65536);	//4096);
+  scsicd->din = new SimpleFIFO<uint8_t>(65536);	//4096);
  else
-  din = new SimpleFIFO<uint8_t>(2048); //8192); //1024); /2048);
+  scsicd->din = new SimpleFIFO<uint8_t>(2048); //8192); //1024); /2048);
 
- WhichSystem = type;
+ scsicd->WhichSystem = type;
 
- cdda.CDDADivAcc = (int64_t)System_Clock * (1024 * 1024) / 88200;
- cdda.CDDADivAccVolFudge = 100;
- cdda.CDDATimeDiv = cdda_time_div * (1 << (4 + 2));
+ scsicd->cdda.CDDADivAcc = (int64_t)scsicd->System_Clock * (1024 * 1024) / 88200;
+ scsicd->cdda.CDDADivAccVolFudge = 100;
+ scsicd->cdda.CDDATimeDiv = cdda_time_div * (1 << (4 + 2));
 
- cdda.CDDAVolume[0] = 65536;
- cdda.CDDAVolume[1] = 65536;
+ scsicd->cdda.CDDAVolume[0] = 65536;
+ scsicd->cdda.CDDAVolume[1] = 65536;
 
  FixOPV();
 
- HRBufs[0] = left_hrbuf;
- HRBufs[1] = right_hrbuf;
+ scsicd->HRBufs[0] = left_hrbuf;
+ scsicd->HRBufs[1] = right_hrbuf;
 
- CD_DATA_TRANSFER_RATE = TransferRate;
- System_Clock = SystemClock;
- CDIRQCallback = IRQFunc;
- CDStuffSubchannels = SSCFunc;
+ scsicd->CD_DATA_TRANSFER_RATE = TransferRate;
+ scsicd->System_Clock = SystemClock;
+ scsicd->CDIRQCallback = IRQFunc;
+ scsicd->CDStuffSubchannels = SSCFunc;
 }
 
 void SCSICD_SetCDDAVolume(double left, double right)
 {
- cdda.CDDAVolume[0] = 65536 * left;
- cdda.CDDAVolume[1] = 65536 * right;
+ scsicd->cdda.CDDAVolume[0] = 65536 * left;
+ scsicd->cdda.CDDAVolume[1] = 65536 * right;
 
  for(int i = 0; i < 2; i++)
  {
-  if(cdda.CDDAVolume[i] > 65536)
+  if(scsicd->cdda.CDDAVolume[i] > 65536)
   {
-   printf("[SCSICD] Debug Warning: CD-DA volume %d too large: %d\n", i, cdda.CDDAVolume[i]);
-   cdda.CDDAVolume[i] = 65536;
+   printf("[SCSICD] Debug Warning: CD-DA volume %d too large: %d\n", i, scsicd->cdda.CDDAVolume[i]);
+   scsicd->cdda.CDDAVolume[i] = 65536;
   }
  }
 
@@ -3142,75 +3190,75 @@ int SCSICD_StateAction(StateMem* sm, const unsigned load, const bool data_only,
 {
  SFORMAT StateRegs[] = 
  {
-  SFVARN(cd_bus.DB, "DB"),
-  SFVARN(cd_bus.signals, "Signals"),
-  SFVAR(CurrentPhase),
+  SFVARN(cd_bus->DB, "DB"),
+  SFVARN(cd_bus->signals, "Signals"),
+  SFVARN(scsicd->CurrentPhase, "CurrentPhase"),
 
-  SFVARN(cd.last_RST_signal, "last_RST"),
-  SFVARN(cd.message_pending, "message_pending"),
-  SFVARN(cd.status_sent, "status_sent"),
-  SFVARN(cd.message_sent, "message_sent"),
-  SFVARN(cd.key_pending, "key_pending"),
-  SFVARN(cd.asc_pending, "asc_pending"),
-  SFVARN(cd.ascq_pending, "ascq_pending"),
-  SFVARN(cd.fru_pending, "fru_pending"),
+  SFVARN(scsicd->cd.last_RST_signal, "last_RST"),
+  SFVARN(scsicd->cd.message_pending, "message_pending"),
+  SFVARN(scsicd->cd.status_sent, "status_sent"),
+  SFVARN(scsicd->cd.message_sent, "message_sent"),
+  SFVARN(scsicd->cd.key_pending, "key_pending"),
+  SFVARN(scsicd->cd.asc_pending, "asc_pending"),
+  SFVARN(scsicd->cd.ascq_pending, "ascq_pending"),
+  SFVARN(scsicd->cd.fru_pending, "fru_pending"),
 
-  SFARRAYN(cd.command_buffer, 256, "command_buffer"),
-  SFVARN(cd.command_buffer_pos, "command_buffer_pos"),
-  SFVARN(cd.command_size_left, "command_size_left"),
+  SFARRAYN(scsicd->cd.command_buffer, 256, "command_buffer"),
+  SFVARN(scsicd->cd.command_buffer_pos, "command_buffer_pos"),
+  SFVARN(scsicd->cd.command_size_left, "command_size_left"),
 
   // Don't save the FIFO's write position, it will be reconstructed from read_pos and in_count
-  SFARRAYN(&din->data[0], din->data.size(), "din_fifo"),
-  SFVARN(din->read_pos, "din_read_pos"),
-  SFVARN(din->in_count, "din_in_count"),
-  SFVARN(cd.data_transfer_done, "data_transfer_done"),
+  SFARRAYN(&scsicd->din->data[0], scsicd->din->data.size(), "din_fifo"),
+  SFVARN(scsicd->din->read_pos, "din_read_pos"),
+  SFVARN(scsicd->din->in_count, "din_in_count"),
+  SFVARN(scsicd->cd.data_transfer_done, "data_transfer_done"),
 
-  SFARRAYN(cd.data_out, sizeof(cd.data_out), "data_out"),
-  SFVARN(cd.data_out_pos, "data_out_pos"),
-  SFVARN(cd.data_out_want, "data_out_want"),
+  SFARRAYN(scsicd->cd.data_out, sizeof(scsicd->cd.data_out), "data_out"),
+  SFVARN(scsicd->cd.data_out_pos, "data_out_pos"),
+  SFVARN(scsicd->cd.data_out_want, "data_out_want"),
 
-  SFVARN(cd.DiscChanged, "DiscChanged"),
+  SFVARN(scsicd->cd.DiscChanged, "DiscChanged"),
 
-  SFVAR(cdda.PlayMode),
-  SFARRAY16(cdda.CDDASectorBuffer, 1176),
-  SFVAR(cdda.CDDAReadPos),
-  SFVAR(cdda.CDDAStatus),
-  SFVAR(cdda.CDDADiv),
-  SFVAR(read_sec_start),
-  SFVAR(read_sec),
-  SFVAR(read_sec_end),
+  SFVARN(scsicd->cdda.PlayMode, "cdda.PlayMode"),
+  SFARRAY16N(scsicd->cdda.CDDASectorBuffer, 1176, "cdda.CDDASectorBuffer"),
+  SFVARN(scsicd->cdda.CDDAReadPos, "cdda.CDDAReadPos"),
+  SFVARN(scsicd->cdda.CDDAStatus, "cdda.CDDAStatus"),
+  SFVARN(scsicd->cdda.CDDADiv, "cdda.CDDADiv"),
+  SFVARN(scsicd->read_sec_start, "read_sec_start"),
+  SFVARN(scsicd->read_sec, "read_sec"),
+  SFVARN(scsicd->read_sec_end, "read_sec_end"),
 
-  SFVAR(CDReadTimer),
-  SFVAR(SectorAddr),
-  SFVAR(SectorCount),
+  SFVARN(scsicd->CDReadTimer, "CDReadTimer"),
+  SFVARN(scsicd->SectorAddr, "SectorAddr"),
+  SFVARN(scsicd->SectorCount, "SectorCount"),
 
-  SFVAR(cdda.ScanMode),
-  SFVAR(cdda.scan_sec_end),
+  SFVARN(scsicd->cdda.ScanMode, "cdda.ScanMode"),
+  SFVARN(scsicd->cdda.scan_sec_end, "cdda.scan_sec_end"),
 
-  SFVAR(cdda.OversamplePos),
-  SFARRAY16(&cdda.sr[0], sizeof(cdda.sr) / sizeof(cdda.sr[0])),
-  SFARRAY16(&cdda.OversampleBuffer[0][0], sizeof(cdda.OversampleBuffer) / sizeof(cdda.OversampleBuffer[0][0])),
+  SFVARN(scsicd->cdda.OversamplePos, "cdda.OversamplePos"),
+  SFARRAY16N(&scsicd->cdda.sr[0], sizeof(scsicd->cdda.sr) / sizeof(scsicd->cdda.sr[0]), "&cdda.sr[0]"),
+  SFARRAY16N(&scsicd->cdda.OversampleBuffer[0][0], sizeof(scsicd->cdda.OversampleBuffer) / sizeof(scsicd->cdda.OversampleBuffer[0][0]), "&cdda.OversampleBuffer[0][0]"),
 
-  SFVAR(cdda.DeemphState[0][0]),
-  SFVAR(cdda.DeemphState[0][1]),
-  SFVAR(cdda.DeemphState[1][0]),
-  SFVAR(cdda.DeemphState[1][1]),
+  SFVARN(scsicd->cdda.DeemphState[0][0], "cdda.DeemphState[0][0]"),
+  SFVARN(scsicd->cdda.DeemphState[0][1], "cdda.DeemphState[0][1]"),
+  SFVARN(scsicd->cdda.DeemphState[1][0], "cdda.DeemphState[1][0]"),
+  SFVARN(scsicd->cdda.DeemphState[1][1], "cdda.DeemphState[1][1]"),
 
-  SFARRAYN(&cd.SubQBuf[0][0], sizeof(cd.SubQBuf), "SubQBufs"),
-  SFARRAYN(cd.SubQBuf_Last, sizeof(cd.SubQBuf_Last), "SubQBufLast"),
-  SFARRAYN(cd.SubPWBuf, sizeof(cd.SubPWBuf), "SubPWBuf"),
+  SFARRAYN(&scsicd->cd.SubQBuf[0][0], sizeof(scsicd->cd.SubQBuf), "SubQBufs"),
+  SFARRAYN(scsicd->cd.SubQBuf_Last, sizeof(scsicd->cd.SubQBuf_Last), "SubQBufLast"),
+  SFARRAYN(scsicd->cd.SubPWBuf, sizeof(scsicd->cd.SubPWBuf), "SubPWBuf"),
 
-  SFVAR(monotonic_timestamp),
-  SFVAR(pce_lastsapsp_timestamp),
+  SFVARN(scsicd->monotonic_timestamp, "monotonic_timestamp"),
+  SFVARN(scsicd->pce_lastsapsp_timestamp, "pce_lastsapsp_timestamp"),
 
   //
   //
   //
-  SFARRAY(ModePages[0].current_value, ModePages[0].param_length),
-  SFARRAY(ModePages[1].current_value, ModePages[1].param_length),
-  SFARRAY(ModePages[2].current_value, ModePages[2].param_length),
-  SFARRAY(ModePages[3].current_value, ModePages[3].param_length),
-  SFARRAY(ModePages[4].current_value, ModePages[4].param_length),
+  SFARRAYN(scsicd->ModePageValues[0], ModePages[0].param_length, "ModePages[0].current_value"),
+  SFARRAYN(scsicd->ModePageValues[1], ModePages[1].param_length, "ModePages[1].current_value"),
+  SFARRAYN(scsicd->ModePageValues[2], ModePages[2].param_length, "ModePages[2].current_value"),
+  SFARRAYN(scsicd->ModePageValues[3], ModePages[3].param_length, "ModePages[3].current_value"),
+  SFARRAYN(scsicd->ModePageValues[4], ModePages[4].param_length, "ModePages[4].current_value"),
   SFEND
  };
 
@@ -3218,18 +3266,18 @@ int SCSICD_StateAction(StateMem* sm, const unsigned load, const bool data_only,
 
  if(load)
  {
-  din->in_count &= din->size - 1;
-  din->read_pos &= din->size - 1;
-  din->write_pos = (din->read_pos + din->in_count) & (din->size - 1);
+  scsicd->din->in_count &= scsicd->din->size - 1;
+  scsicd->din->read_pos &= scsicd->din->size - 1;
+  scsicd->din->write_pos = (scsicd->din->read_pos + scsicd->din->in_count) & (scsicd->din->size - 1);
   //printf("%d %d %d\n", din->in_count, din->read_pos, din->write_pos);
 
   if(load < 0x0935)
-   cdda.CDDADiv /= 2;
+   scsicd->cdda.CDDADiv /= 2;
 
-  if(cdda.CDDADiv <= 0)
-   cdda.CDDADiv = 1;
+  if(scsicd->cdda.CDDADiv <= 0)
+   scsicd->cdda.CDDADiv = 1;
 
-  cdda.OversamplePos &= 0x1F;
+  scsicd->cdda.OversamplePos &= 0x1F;
 
   for(int i = 0; i < NumModePages; i++)
    UpdateMPCacheP(&ModePages[i]);
@@ -23,7 +23,7 @@ typedef struct
  //bool kingACK, kingRST, kingSEL, kingATN;
 } scsicd_bus_t;
 
-extern scsicd_bus_t cd_bus; // Don't access this structure directly by name outside of scsicd.c, but use the macros below.
+extern scsicd_bus_t *cd_bus; // Don't access this structure directly by name outside of scsicd.c, but use the macros below.
 
 // Signals under our(the "target") control.
 #define SCSICD_IO_mask	0x001
@@ -38,17 +38,17 @@ extern scsicd_bus_t cd_bus; // Don't access this structure directly by name outs
 #define SCSICD_kingATN_mask	0x080
 #define SCSICD_kingSEL_mask	0x100
 
-#define BSY_signal ((const bool)(cd_bus.signals & SCSICD_BSY_mask))
-#define ACK_signal ((const bool)(cd_bus.signals & SCSICD_kingACK_mask))
-#define RST_signal ((const bool)(cd_bus.signals & SCSICD_kingRST_mask))
-#define MSG_signal ((const bool)(cd_bus.signals & SCSICD_MSG_mask))
-#define SEL_signal ((const bool)(cd_bus.signals & SCSICD_kingSEL_mask))
-#define REQ_signal ((const bool)(cd_bus.signals & SCSICD_REQ_mask))
-#define IO_signal ((const bool)(cd_bus.signals & SCSICD_IO_mask))
-#define CD_signal ((const bool)(cd_bus.signals & SCSICD_CD_mask))
-#define ATN_signal ((const bool)(cd_bus.signals & SCSICD_kingATN_mask))
+#define BSY_signal ((const bool)(cd_bus->signals & SCSICD_BSY_mask))
+#define ACK_signal ((const bool)(cd_bus->signals & SCSICD_kingACK_mask))
+#define RST_signal ((const bool)(cd_bus->signals & SCSICD_kingRST_mask))
+#define MSG_signal ((const bool)(cd_bus->signals & SCSICD_MSG_mask))
+#define SEL_signal ((const bool)(cd_bus->signals & SCSICD_kingSEL_mask))
+#define REQ_signal ((const bool)(cd_bus->signals & SCSICD_REQ_mask))
+#define IO_signal ((const bool)(cd_bus->signals & SCSICD_IO_mask))
+#define CD_signal ((const bool)(cd_bus->signals & SCSICD_CD_mask))
+#define ATN_signal ((const bool)(cd_bus->signals & SCSICD_kingATN_mask))
 
-#define DB_signal ((const uint8_t)cd_bus.DB)
+#define DB_signal ((const uint8_t)cd_bus->DB)
 
 #define SCSICD_GetDB() DB_signal
 #define SCSICD_GetBSY() BSY_signal
@@ -74,6 +74,15 @@ void SCSICD_SetRST(bool set);
 void SCSICD_SetATN(bool set);
 
 uint32_t SCSICD_Run(scsicd_timestamp_t);
+
+// For the initiator's DMA: while in the data-in phase with REQ asserted and ACK not, returns how many more bytes
+// SCSICD_DataInBurstNext() can put on the bus after the current one(0 if none, or if the bus isn't in that state).
+uint32_t SCSICD_DataInBurstAvail(void);
+
+// Same as a full REQ/ACK handshake on the byte on the bus(assert ACK, run, release ACK, run), as long as the drive has no
+// event of its own in between; puts up the next data-in byte with REQ asserted.  Only call when SCSICD_DataInBurstAvail() != 0.
+void SCSICD_DataInBurstNext(void);
+
 void SCSICD_ResetTS(uint32_t ts_base);
 
 enum
@@ -102,4 +111,10 @@ int SCSICD_StateAction(StateMem *sm, const unsigned load, const bool data_only,
 
 void SCSICD_SetDisc(bool tray_open, CDIF *cdif, bool no_emu_side_effects = false);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct scsicd_ctx_t;
+scsicd_ctx_t *SCSICD_NewContext(void);
+void SCSICD_DeleteContext(scsicd_ctx_t *ctx);
+void SCSICD_SetContext(scsicd_ctx_t *ctx);
+
 #endif
@@ -54,6 +54,11 @@ found freely through public domain sources.
 #include "v810_opt.h"
 #include "v810_cpu.h"
 #include "v810_cpuD.h"
+#include "v810_jit.h"
+
+#ifdef WANT_PCFX_EMU
+#include "../../pcfx/membus.h"
+#endif
 
 #include "../../state_helpers.h"
 
@@ -80,7 +85,28 @@ V810::V810()
  IOWrite16 = NULL;
  IOWrite32 = NULL;
 
- memset(FastMap, 0, sizeof(FastMap));
+ memset(&FastMapDummy, 0, sizeof(FastMapDummy));
+ for(unsigned int i = 0; i < sizeof(FastMap) / sizeof(FastMap[0]); i++)
+  FastMap[i] = &FastMapDummy;
+ DummyRegion = NULL;
+ DummyPD = NULL;
+ PD_delta = 0;
+ PD_BlockGen = 1;
+
+ IdleMemReadCheck = NULL;
+ IdleIOReadCheck = NULL;
+ IdleArmed = false;
+ IdleLoopFlush();
+ ResetIdleLoopStats();
+
+ memset(Cache, 0, sizeof(Cache));
+ CacheSyncFastAll();
+ ResetICacheStats();
+
+ LazyFlags = LAZY_FLAGS_NONE;
+
+ JIT = NULL;
+ MemMap = V810_MEM_MAP_GENERIC;
 
  memset(MemReadBus32, 0, sizeof(MemReadBus32));
  memset(MemWriteBus32, 0, sizeof(MemWriteBus32));
@@ -129,11 +155,53 @@ INLINE void V810::RecalcIPendingCache(void)
 // and try to restore cache from an interrupt acknowledge register or dump it to a register
 // controlling interrupt masks...  I wanna be sadistic~
 
+void V810::CacheSyncFast(uint32 CI)
+{
+ for(unsigned SBI = 0; SBI < 2; SBI++)
+ {
+  V810_CacheFastEntry_t *fe = &CacheFast[(CI << 1) | SBI];
+
+  fe->key = Cache[CI].data_valid[SBI] ? ((Cache[CI].tag << 8) | (CI << 1) | SBI) : ~0U;
+  fe->data = Cache[CI].data[SBI];
+ }
+}
+
+void V810::CacheSyncFastAll(void)
+{
+ for(uint32 CI = 0; CI < 128; CI++)
+  CacheSyncFast(CI);
+}
+
+void V810::ResetICacheStats(void)
+{
+ memset(&CacheStats, 0, sizeof(CacheStats));
+}
+
 void V810::CacheClear(v810_timestamp_t &timestamp, uint32 start, uint32 count)
 {
  //printf("Cache clear: %08x %08x\n", start, count);
  for(uint32 i = 0; i < count && (i + start) < 128; i++)
+ {
   memset(&Cache[i + start], 0, sizeof(V810_CacheEntry_t));
+  CacheSyncFast(i + start);
+ }
+}
+
+// For stores of up to 4 bytes; the halfword before A is included, since it may be the start of a 32-bit instruction.
+// Tables have a spare entry before the start of the region for that, and the trampoline after the end.
+INLINE void V810::PD_InvalidateStore(uint32 A)
+{
+ PDOp *pd = (PDOp *)((uintptr_t)FastMapPtr(A & ~1) * (sizeof(PDOp) / 2) + FastMapPD(A));
+
+ if(pd[-1].block | pd[0].block | pd[1].block)
+ {
+  pd[-1].block = 0;
+  pd[0].block = 0;
+  pd[1].block = 0;
+
+  if(MDFN_UNLIKELY(++PD_BlockGen == PD_BLOCK_GEN_MAX))
+   PD_Flush();
+ }
 }
 
 INLINE void V810::CacheOpMemStore(v810_timestamp_t &timestamp, uint32 A, uint32 V)
@@ -151,6 +219,14 @@ INLINE void V810::CacheOpMemStore(v810_timestamp_t &timestamp, uint32 A, uint32
   timestamp += 2;
   MemWrite16(timestamp, A | 2, V >> 16);
  }
+
+ #ifdef V810_HAVE_JIT
+ if(JIT)
+  JIT->CheckWrite(A, 4);
+ #endif
+
+ if(EmuMode == V810_EMU_MODE_FAST)
+  PD_InvalidateStore(A);
 }
 
 INLINE uint32 V810::CacheOpMemLoad(v810_timestamp_t &timestamp, uint32 A)
@@ -212,11 +288,23 @@ void V810::CacheRestore(v810_timestamp_t &timestamp, const uint32 SA)
   Cache[i].data_valid[0] = (icht >> 22) & 1;
   Cache[i].data_valid[1] = (icht >> 23) & 1;
  }
+
+ CacheSyncFastAll();
 }
 
 
 INLINE uint32 V810::RDCACHE(v810_timestamp_t &timestamp, uint32 addr)
 {
+ const V810_CacheFastEntry_t *fe = &CacheFast[(addr >> 2) & 0xFF];
+
+ if(MDFN_LIKELY(fe->key == (addr >> 2)))
+ {
+  CacheStats.hits++;
+  return(fe->data);
+ }
+
+ CacheStats.misses++;
+
  const int CI = (addr >> 3) & 0x7F;
  const int SBI = (addr & 4) >> 2;
 
@@ -273,6 +361,8 @@ INLINE uint32 V810::RDCACHE(v810_timestamp_t &timestamp, uint32 addr)
  // }
  //}
 
+ CacheSyncFast(CI);
+
  return(Cache[CI].data[SBI]);
 }
 
@@ -307,12 +397,14 @@ void V810::Reset()
  memset(P_REG, 0, sizeof(P_REG));
  memset(S_REG, 0, sizeof(S_REG));
  memset(Cache, 0, sizeof(Cache));
+ CacheSyncFastAll();
 
  P_REG[0]      =  0x00000000;
  SetPC(0xFFFFFFF0);
 
  S_REG[ECR]    =  0x0000FFF0;
  S_REG[PSW]    =  0x00008000;
+ LazyFlags = LAZY_FLAGS_NONE;
 
  if(VBMode)
   S_REG[PIR]	= 0x00005346;
@@ -327,20 +419,46 @@ void V810::Reset()
 
  in_bstr = FALSE;
 
+ // Memory may have been cleared or reloaded since the last run.
+ RevalidateCode();
+ IdleLoopFlush();
+
  RecalcIPendingCache();
 }
 
 bool V810::Init(V810_Emu_Mode mode, bool vb_mode)
 {
+ #ifndef V810_HAVE_JIT
+ if(mode == V810_EMU_MODE_JIT)
+  mode = V810_EMU_MODE_FAST;
+ #endif
+
  EmuMode = mode;
  VBMode = vb_mode;
 
  in_bstr = FALSE;
  in_bstr_to = 0;
 
- if(mode == V810_EMU_MODE_FAST)
+ #ifdef V810_HAVE_JIT
+ if(mode == V810_EMU_MODE_JIT)
  {
-  memset(DummyRegion, 0, V810_FAST_MAP_PSIZE);
+  JIT = new V810_JIT(this);
+
+  if(!JIT->Init())
+  {
+   MDFN_PrintError("V810 recompiler initialization failed, falling back to the fast interpreter.");
+   delete JIT;
+   JIT = NULL;
+   EmuMode = mode = V810_EMU_MODE_FAST;
+  }
+ }
+ #endif
+
+ // The recompiler keeps the PC in the same form as the fast interpreter, which it falls back to for anything it doesn't translate.
+ if(mode != V810_EMU_MODE_ACCURATE)
+ {
+  if(!(DummyRegion = (uint8 *)calloc(1, V810_FAST_MAP_PSIZE + V810_FAST_MAP_TRAMPOLINE_SIZE)))
+   return(FALSE);
 
   for(unsigned int i = V810_FAST_MAP_PSIZE; i < V810_FAST_MAP_PSIZE + V810_FAST_MAP_TRAMPOLINE_SIZE; i += 2)
   {
@@ -348,8 +466,17 @@ bool V810::Init(V810_Emu_Mode mode, bool vb_mode)
    DummyRegion[i + 1] = 0x36 << 2;
   }
 
-  for(uint64 A = 0; A < (1ULL << 32); A += V810_FAST_MAP_PSIZE)
-   FastMap[A / V810_FAST_MAP_PSIZE] = DummyRegion - A;
+  for(unsigned int i = 0; i < V810_FAST_MAP_L2_SIZE; i++)
+   FastMapDummy.Page[i] = DummyRegion;
+ }
+
+ if(mode == V810_EMU_MODE_FAST)
+ {
+  if(!(DummyPD = (PDOp *)calloc(DUMMY_PD_COUNT, sizeof(PDOp))))
+   return(FALSE);
+
+  for(unsigned int i = 0; i < V810_FAST_MAP_L2_SIZE; i++)
+   FastMapDummy.PD[i] = (uintptr_t)&DummyPD[1] - (uintptr_t)DummyRegion * (sizeof(PDOp) / 2);
  }
 
  return(TRUE);
@@ -357,10 +484,43 @@ bool V810::Init(V810_Emu_Mode mode, bool vb_mode)
 
 void V810::Kill(void)
 {
+ #ifdef V810_HAVE_JIT
+ if(JIT)
+ {
+  delete JIT;
+  JIT = NULL;
+ }
+ #endif
+
  for(unsigned int i = 0; i < FastMapAllocList.size(); i++)
   free(FastMapAllocList[i]);
 
  FastMapAllocList.clear();
+
+ for(unsigned int i = 0; i < sizeof(FastMap) / sizeof(FastMap[0]); i++)
+  FastMap[i] = &FastMapDummy;
+
+ memset(&FastMapDummy, 0, sizeof(FastMapDummy));
+
+ if(DummyRegion)
+ {
+  free(DummyRegion);
+  DummyRegion = NULL;
+ }
+
+ if(DummyPD)
+ {
+  free(DummyPD);
+  DummyPD = NULL;
+ }
+
+ for(unsigned int i = 0; i < FastMapRegions.size(); i++)
+ {
+  free(FastMapRegions[i].pd);
+  free(FastMapRegions[i].pd_lines);
+ }
+
+ FastMapRegions.clear();
 }
 
 void V810::SetInt(int level)
@@ -371,9 +531,38 @@ void V810::SetInt(int level)
  RecalcIPendingCache();
 }
 
-uint8 *V810::SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addresses, const char *name)
+// Returns the second-level table for address A, giving the area its own copy of FastMapDummy if it's still sharing it.
+V810::FastMapL2 *V810::GetFastMapL2(uint32 A)
+{
+ FastMapL2 *L2 = FastMap[A >> V810_FAST_MAP_L1_SHIFT];
+
+ if(L2 == &FastMapDummy)
+ {
+  if(!(L2 = (FastMapL2 *)malloc(sizeof(FastMapL2))))
+   return(NULL);
+
+  memcpy(L2, &FastMapDummy, sizeof(FastMapL2));
+  FastMapAllocList.push_back(L2);
+  FastMap[A >> V810_FAST_MAP_L1_SHIFT] = L2;
+ }
+
+ return(L2);
+}
+
+void V810::FillFastMapTrampoline(uint8 *mem, uint32 length)
+{
+ for(unsigned int i = length; i < length + V810_FAST_MAP_TRAMPOLINE_SIZE; i += 2)
+ {
+  mem[i + 0] = 0;
+  mem[i + 1] = 0x36 << 2;
+ }
+}
+
+uint8 *V810::SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addresses, const char *name, uint8 *mem, bool read_only)
 {
  uint8 *ret = NULL;
+ FastMapL2 *L2;
+ FastMapRegion region;
 
  for(unsigned int i = 0; i < num_addresses; i++)
  {
@@ -381,16 +570,50 @@ uint8 *V810::SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addr
  }
  assert((length & (V810_FAST_MAP_PSIZE - 1)) == 0);
 
- if(!(ret = (uint8 *)malloc(length + V810_FAST_MAP_TRAMPOLINE_SIZE)))
+ if(mem)
+  ret = mem;
+ else
  {
-  return(NULL);
+  if(!(ret = (uint8 *)malloc(length + V810_FAST_MAP_TRAMPOLINE_SIZE)))
+  {
+   return(NULL);
+  }
+
+  FillFastMapTrampoline(ret, length);
  }
 
- for(unsigned int i = length; i < length + V810_FAST_MAP_TRAMPOLINE_SIZE; i += 2)
+ region.mem = ret;
+ region.length = length;
+ region.read_only = read_only;
+ region.pd = NULL;
+ region.pd_count = 0;
+ region.pd_lines = NULL;
+
+ if(EmuMode == V810_EMU_MODE_FAST)
  {
-  ret[i + 0] = 0;
-  ret[i + 1] = 0x36 << 2;
+  region.pd_count = 1 + (length + V810_FAST_MAP_TRAMPOLINE_SIZE) / 2;
+
+  if(!(region.pd = (PDOp *)calloc(region.pd_count, sizeof(PDOp))) ||
+	(!read_only && !(region.pd_lines = (uint32 *)calloc((region.pd_count + 1023) / 1024, sizeof(uint32)))))
+  {
+   free(region.pd);
+   if(!mem)
+    free(ret);
+   return(NULL);
+  }
+
+  for(unsigned int i = 0; i < num_addresses; i++)
+  {
+   for(uint64 addr = addresses[i]; addr != (uint64)addresses[i] + length; addr += V810_FAST_MAP_PSIZE)
+   {
+    if(!(L2 = GetFastMapL2(addr)))
+     return(NULL);
+
+    L2->PD[(addr >> V810_FAST_MAP_SHIFT) & (V810_FAST_MAP_L2_SIZE - 1)] = (uintptr_t)&region.pd[1] - (uintptr_t)ret * (sizeof(PDOp) / 2);
+   }
+  }
  }
+ FastMapRegions.push_back(region);
 
  for(unsigned int i = 0; i < num_addresses; i++)
  {  
@@ -398,15 +621,286 @@ uint8 *V810::SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addr
   {
    //printf("%08x, %d, %s\n", addr, length, name);
 
-   FastMap[addr / V810_FAST_MAP_PSIZE] = ret - addresses[i];
+   if(!(L2 = GetFastMapL2(addr)))
+    return(NULL);
+
+   L2->Page[(addr >> V810_FAST_MAP_SHIFT) & (V810_FAST_MAP_L2_SIZE - 1)] = ret + (addr - addresses[i]);
   }
  }
 
- FastMapAllocList.push_back(ret);
+ if(!mem)
+  FastMapAllocList.push_back(ret);
 
  return(ret);
 }
 
+const V810::FastMapRegion *V810::FindFastMapRegion(const uint8 *p)
+{
+ for(unsigned int i = 0; i < FastMapRegions.size(); i++)
+ {
+  if(p >= FastMapRegions[i].mem && p < FastMapRegions[i].mem + FastMapRegions[i].length)
+   return(&FastMapRegions[i]);
+ }
+
+ return(NULL);
+}
+
+void V810::PD_Decode(PDOp *pd, const uint8 *p)
+{
+ const uint16 op = LoadU16_LE((uint16 *)p);
+ const unsigned int opcode = op >> 10;
+
+ pd->op = op;
+
+ // 0x32 and 0x36 are invalid, and the trampoline is made of 0x36; don't read past the end of the region for them.
+ if(opcode >= 0x28 && opcode != 0x32 && opcode != 0x36)
+  pd->op2 = LoadU16_LE((uint16 *)(p + 2));
+ else
+  pd->op2 = 0;
+
+ pd->block = PDOP_DECODED;
+
+ // Note where there's decoded code, for PD_Revalidate().
+ for(unsigned int i = 0; i < FastMapRegions.size(); i++)
+ {
+  FastMapRegion *r = &FastMapRegions[i];
+
+  if(pd >= r->pd && pd < r->pd + r->pd_count)
+  {
+   if(r->pd_lines)
+    r->pd_lines[(pd - r->pd) >> 10] |= 1U << (((pd - r->pd) >> 5) & 0x1F);
+   break;
+  }
+ }
+}
+
+// Cycles taken by instructions that can be in the middle of a block, indexed by op >> 9; 0 for the rest.
+static const uint8 PD_BlockCycles[128] =
+{
+ 1, 1, 1, 1, 1, 1, 1, 1,	// MOV, ADD, SUB, CMP
+ 1, 1, 1, 1, 0, 0, 1, 1,	// SHL, SHR, JMP, SAR
+ 0, 0, 0, 0, 0, 0, 0, 0,	// MUL, DIV, MULU, DIVU
+ 1, 1, 1, 1, 1, 1, 1, 1,	// OR, AND, XOR, NOT
+ 1, 1, 1, 1, 1, 1, 1, 1,	// MOV_I, ADD_I, SETF, CMP_I
+ 1, 1, 1, 1, 0, 0, 1, 1,	// SHL_I, SHR_I, EI, SAR_I
+ 0, 0, 0, 0, 0, 0, 0, 0,	// TRAP, RETI, HALT, invalid
+ 0, 0, 1, 1, 0, 0, 0, 0,	// LDSR, STSR, DI, BSTR
+ 0, 0, 0, 0, 0, 0, 0, 0,	// BV, BL, BE, BNH, BN, BR, BLT, BLE
+ 0, 0, 0, 0, 0, 1, 0, 0,	// BNV, BNL, BNE, BH, BP, NOP, BGE, BGT
+ 1, 1, 1, 1, 0, 0, 0, 0,	// MOVEA, ADDI, JR, JAL
+ 1, 1, 1, 1, 1, 1, 1, 1,	// ORI, ANDI, XORI, MOVHI
+ 0, 0, 0, 0, 0, 0, 0, 0,	// LD.B, LD.H, invalid, LD.W
+ 0, 0, 0, 0, 0, 0, 0, 0,	// ST.B, ST.H, invalid, ST.W
+ 0, 0, 0, 0, 0, 0, 0, 0,	// IN.B, IN.H, CAXI, IN.W
+ 0, 0, 0, 0, 0, 0, 0, 0,	// OUT.B, OUT.H, FPP, OUT.W
+};
+
+// Decodes the instruction at p if needed, and works out the block starting there.
+void V810::PD_ScanBlock(PDOp *pd, const uint8 *p)
+{
+ PDOp *cur = pd;
+ unsigned int length = 0;
+ unsigned int cycles = 0;
+
+ for(;;)
+ {
+  if(!cur->block)
+   PD_Decode(cur, p);
+
+  length++;
+
+  const unsigned int c = PD_BlockCycles[cur->op >> 9];
+
+  if(!c || length == PD_MAX_BLOCK_LENGTH)
+   break;
+
+  cycles += c;
+
+  // The trampoline(all invalid instructions) ends the block before it can run past the end of the region.
+  const unsigned int halfwords = ((cur->op >> 10) >= 0x28) ? 2 : 1;
+
+  cur += halfwords;
+  p += halfwords * 2;
+ }
+
+ pd->block = PDOP_DECODED | length | (cycles << 6) | (PD_BlockGen << 12);
+}
+
+// Compares the decoded instructions of the writable regions against memory.
+void V810::PD_Revalidate(void)
+{
+ bool changed = false;
+
+ for(unsigned int ri = 0; ri < FastMapRegions.size(); ri++)
+ {
+  FastMapRegion *r = &FastMapRegions[ri];
+
+  if(!r->pd_lines)
+   continue;
+
+  for(uint32 line = 0; line < (r->pd_count + 31) / 32; line++)
+  {
+   uint32 *lw = &r->pd_lines[line >> 5];
+
+   if(!*lw)
+   {
+    line |= 0x1F;
+    continue;
+   }
+
+   if(!((*lw >> (line & 0x1F)) & 1))
+    continue;
+
+   bool any_decoded = false;
+
+   for(uint32 i = std::max<uint32>(line * 32, 1); i < std::min<uint32>(line * 32 + 32, r->pd_count); i++)
+   {
+    PDOp *pd = &r->pd[i];
+    const uint8 *p = r->mem + (i - 1) * 2;
+
+    if(!pd->block)
+     continue;
+
+    const uint16 op = LoadU16_LE((uint16 *)p);
+    const unsigned int opcode = op >> 10;
+
+    if(op != pd->op || (opcode >= 0x28 && opcode != 0x32 && opcode != 0x36 && LoadU16_LE((uint16 *)(p + 2)) != pd->op2))
+    {
+     pd->block = 0;
+     changed = true;
+    }
+    else
+     any_decoded = true;
+   }
+
+   if(!any_decoded)
+    *lw &= ~(1U << (line & 0x1F));
+  }
+ }
+
+ // Blocks and idle loops that took in any of them have to be worked out again.
+ if(changed && MDFN_UNLIKELY(++PD_BlockGen == PD_BLOCK_GEN_MAX))
+  PD_Flush();
+}
+
+// Only for when PD_BlockGen runs out.  The read-only regions and DummyPD are left alone: nothing in them can change, so
+// their blocks are still right even if their generation happens to match again.
+void V810::PD_Flush(void)
+{
+ for(unsigned int i = 0; i < FastMapRegions.size(); i++)
+ {
+  FastMapRegion *r = &FastMapRegions[i];
+
+  if(r->pd_lines)
+  {
+   memset(r->pd, 0, r->pd_count * sizeof(PDOp));
+   memset(r->pd_lines, 0, (r->pd_count + 1023) / 1024 * sizeof(uint32));
+  }
+ }
+
+ PD_BlockGen = 1;
+ IdleLoopFlush();
+}
+
+void V810::IdleLoopFlush(void)
+{
+ for(unsigned int i = 0; i < IDLE_LOOP_CACHE_SIZE; i++)
+ {
+  IdleLoops[i].branch_pc = 1;
+  IdleLoops[i].gen = 0;
+  IdleLoops[i].idle = false;
+ }
+
+ IdleArmed = false;
+}
+
+// The loop body has to be straight-line code in the same fast map page as the branch, so that every iteration runs all of
+// it, and mustn't do anything but change registers and flags or load.
+bool V810::IdleLoopAnalyze(uint32 target_pc, uint32 branch_pc)
+{
+ if((target_pc ^ branch_pc) >> V810_FAST_MAP_SHIFT)
+  return(false);
+
+ const uint8 *p = FastMapPtr(target_pc);
+ PDOp *pd = (PDOp *)((uintptr_t)p * (sizeof(PDOp) / 2) + FastMapPD(target_pc));
+ uint32 pc = target_pc;
+
+ while(pc < branch_pc)
+ {
+  if(!pd->block)
+   PD_Decode(pd, p);
+
+  const unsigned int opcode = pd->op >> 10;
+
+  if(!PD_BlockCycles[pd->op >> 9] && opcode != LD_B && opcode != LD_H && opcode != LD_W && opcode != IN_B && opcode != IN_H && opcode != IN_W)
+   return(false);
+
+  const unsigned int halfwords = (opcode >= 0x28) ? 2 : 1;
+
+  pd += halfwords;
+  p += halfwords * 2;
+  pc += halfwords * 2;
+ }
+
+ // A 32-bit instruction straddling the branch.
+ return(pc == branch_pc);
+}
+
+void V810::IdleLoopCheck(v810_timestamp_t &timestamp, IdleLoop *il, uint32 branch_pc, uint32 target_pc)
+{
+ if(il->branch_pc != branch_pc || il->gen != PD_BlockGen)
+ {
+  il->branch_pc = branch_pc;
+  il->gen = PD_BlockGen;
+  il->idle = IdleIOReadCheck && IdleLoopAnalyze(target_pc, branch_pc);
+
+  if(il->idle)
+   IdleStats.found++;
+
+  IdleArmed = false;
+
+  if(!il->idle)
+   return;
+ }
+
+ FlushLazyFlags();
+
+ if(IdleArmed && IdleArmedPC == branch_pc && !IPendingCache && !memcmp(IdleSnap, &P_REG[1], 31 * sizeof(uint32)) && IdleSnap[31] == S_REG[PSW])
+ {
+  if(timestamp < next_event_ts)
+  {
+   IdleStats.skips++;
+   IdleStats.skipped_cycles += next_event_ts - timestamp;
+   timestamp = next_event_ts;
+  }
+  return;
+ }
+
+ memcpy(IdleSnap, &P_REG[1], 31 * sizeof(uint32));
+ IdleSnap[31] = S_REG[PSW];
+ IdleArmedPC = branch_pc;
+ IdleArmed = true;
+}
+
+void V810::SetIdleLoopReadChecks(bool MDFN_FASTCALL (*mem_check)(uint32 A), bool MDFN_FASTCALL (*io_check)(uint32 A))
+{
+ IdleMemReadCheck = mem_check;
+ IdleIOReadCheck = io_check;
+ IdleLoopFlush();
+}
+
+void V810::ResetIdleLoopStats(void)
+{
+ memset(&IdleStats, 0, sizeof(IdleStats));
+}
+
+
+void V810::SetMemMap(V810_Mem_Map map)
+{
+ #ifdef WANT_PCFX_EMU
+ MemMap = map;
+ #endif
+}
 
 void V810::SetMemReadBus32(uint8 A, bool value)
 {
@@ -447,8 +941,110 @@ void V810::SetIOWriteHandlers(void MDFN_FASTCALL (*write8)(v810_timestamp_t &, u
 }
 
 
+void V810::FlushLazyFlags_Slow(void)
+{
+ const uint32 a = LazyOp1;
+ const uint32 r = LazyResult;
+ uint32 flags = 0;
+
+ switch(LazyFlags)
+ {
+  case LAZY_FLAGS_ADD:
+	{
+	 const uint32 b = r - a;
+
+	 if(((a ^ ~b) & (a ^ r)) & 0x80000000)
+	  flags |= PSW_OV;
+
+	 if(r < a)
+	  flags |= PSW_CY;
+	}
+	break;
+
+  case LAZY_FLAGS_SUB:
+	{
+	 const uint32 b = a - r;
+
+	 if(((a ^ b) & (a ^ r)) & 0x80000000)
+	  flags |= PSW_OV;
+
+	 if(r > a)
+	  flags |= PSW_CY;
+	}
+	break;
+
+  case LAZY_FLAGS_LOGIC:
+	if(LazyCY)
+	 flags |= PSW_CY;
+	break;
+ }
+
+ if(!r)
+  flags |= PSW_Z;
+
+ if(r & 0x80000000)
+  flags |= PSW_S;
+
+ S_REG[PSW] = (S_REG[PSW] & ~(PSW_Z | PSW_S | PSW_OV | PSW_CY)) | flags;
+ LazyFlags = LAZY_FLAGS_NONE;
+}
+
+INLINE void V810::FlushLazyFlags(void)
+{
+ if(LazyFlags != LAZY_FLAGS_NONE)
+  FlushLazyFlags_Slow();
+}
+
+INLINE bool V810::GetLazyCY(void)
+{
+ switch(LazyFlags)
+ {
+  default:
+  case LAZY_FLAGS_NONE: return((bool)(S_REG[PSW] & PSW_CY));
+  case LAZY_FLAGS_ADD: return(LazyResult < LazyOp1);
+  case LAZY_FLAGS_SUB: return(LazyResult > LazyOp1);
+  case LAZY_FLAGS_LOGIC: return(LazyCY);
+ }
+}
+
+// For op1 + op2 = result; op2 is implied.
+INLINE void V810::SetFlagsAdd(uint32 op1, uint32 result)
+{
+ LazyFlags = LAZY_FLAGS_ADD;
+ LazyOp1 = op1;
+ LazyResult = result;
+}
+
+// For op1 - op2 = result; op2 is implied.
+INLINE void V810::SetFlagsSub(uint32 op1, uint32 result)
+{
+ LazyFlags = LAZY_FLAGS_SUB;
+ LazyOp1 = op1;
+ LazyResult = result;
+}
+
+// Z and S from the result, OV cleared, CY unchanged.
+INLINE void V810::SetFlagsLogic(uint32 result)
+{
+ if(LazyFlags != LAZY_FLAGS_LOGIC)
+ {
+  LazyCY = GetLazyCY();
+  LazyFlags = LAZY_FLAGS_LOGIC;
+ }
+ LazyResult = result;
+}
+
+INLINE void V810::SetFlagsShift(uint32 result, bool cy)
+{
+ LazyFlags = LAZY_FLAGS_LOGIC;
+ LazyCY = cy;
+ LazyResult = result;
+}
+
 INLINE void V810::SetFlag(uint32 n, bool condition)
 {
+ FlushLazyFlags();
+
  S_REG[PSW] &= ~n;
 
  if(condition)
@@ -531,6 +1127,7 @@ INLINE void V810::SetSREG(v810_timestamp_t &timestamp, unsigned int which, uint3
 
 	 case PSW:
               	S_REG[which] = value & 0xFF3FF;
+		LazyFlags = LAZY_FLAGS_NONE;
 		RecalcIPendingCache();
 		break;
 
@@ -576,6 +1173,9 @@ INLINE uint32 V810::GetSREG(unsigned int which)
 	 printf("STSR from reserved system register: 0x%02x", which);
         }
 
+	if(which == PSW)
+	 FlushLazyFlags();
+
 	ret = S_REG[which];
 
 	return(ret);
@@ -588,8 +1188,9 @@ INLINE uint32 V810::GetSREG(unsigned int which)
 			    PC = new_pc;								\
 			   else										\
 			   {										\
-			    PC_ptr = &FastMap[(new_pc) >> V810_FAST_MAP_SHIFT][(new_pc)];		\
+			    PC_ptr = FastMapPtr(new_pc);						\
 			    PC_base = PC_ptr - (new_pc);						\
+			    PD_delta = FastMapPD(new_pc);						\
 			   }										\
 			  }
 
@@ -619,6 +1220,7 @@ INLINE uint32 V810::GetSREG(unsigned int which)
 #define RB_RDOP(PC_offset, ...) RDOP(timestamp, PC + PC_offset, ## __VA_ARGS__)
 #endif
 
+template<typename RB_Bus>
 void V810::Run_Accurate(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
 {
  const bool RB_AccurateMode = true;
@@ -642,6 +1244,7 @@ void V810::Run_Accurate(int32 MDFN_FASTCALL (*event_handler)(const v810_timestam
 void V810::Run_Accurate_Debug(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
 {
  const bool RB_AccurateMode = true;
+ typedef V810_GenericBus RB_Bus;
 
  #define RB_ADDBT(n,o,p) { if(ADDBT) ADDBT(n,o,p); }
  /* Make sure class member variable v810_timestamp is synchronized to our local copy, since we'll read it externally if a system
@@ -677,15 +1280,34 @@ void V810::Run_Accurate_Debug(int32 MDFN_FASTCALL (*event_handler)(const v810_ti
 #define RB_RDOP(PC_offset, ...) LoadU16_LE((uint16 *)&PC_ptr[PC_offset])
 #endif
 
+#define RB_PDOP()		((PDOp *)((uintptr_t)PC_ptr * (sizeof(PDOp) / 2) + PD_delta))
+
+// For taken branches in Run_Fast(); disp is the branch displacement.
+INLINE void V810::IdleLoopBranch(v810_timestamp_t &timestamp, uint32 branch_pc, uint32 disp)
+{
+ if(MDFN_LIKELY((uint32)-(int32)disp > IDLE_LOOP_MAX_BYTES))
+  return;
+
+ IdleLoop *il = &IdleLoops[(branch_pc >> 1) & (IDLE_LOOP_CACHE_SIZE - 1)];
+
+ if(MDFN_LIKELY(il->branch_pc == branch_pc && il->gen == PD_BlockGen && !il->idle))
+  return;
+
+ IdleLoopCheck(timestamp, il, branch_pc, branch_pc + disp);
+}
+
+template<typename RB_Bus>
 void V810::Run_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
 {
  const bool RB_AccurateMode = false;
 
  #define RB_ADDBT(n,o,p)
  #define RB_CPUHOOK(n)
+ #define RB_PREDECODE
 
  #include "v810_oploop.inc"
 
+ #undef RB_PREDECODE
  #undef RB_CPUHOOK
  #undef RB_ADDBT
 }
@@ -694,6 +1316,7 @@ void V810::Run_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t
 void V810::Run_Fast_Debug(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
 {
  const bool RB_AccurateMode = false;
+ typedef V810_GenericBus RB_Bus;
 
  #define RB_ADDBT(n,o,p) { if(ADDBT) ADDBT(n,o,p); }
  #define RB_CPUHOOK(n) RB_CPUHOOK_DBG(n)
@@ -707,11 +1330,31 @@ void V810::Run_Fast_Debug(int32 MDFN_FASTCALL (*event_handler)(const v810_timest
 }
 #endif
 
+#ifdef V810_HAVE_JIT
+// Runs a single instruction(or takes a pending interrupt), for V810_EMU_MODE_JIT.
+void V810::Step_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
+{
+ const bool RB_AccurateMode = false;
+ typedef V810_GenericBus RB_Bus;
+
+ #define RB_ADDBT(n,o,p)
+ #define RB_CPUHOOK(n)
+ #define RB_JITSTEP
+
+ #include "v810_oploop.inc"
+
+ #undef RB_JITSTEP
+ #undef RB_CPUHOOK
+ #undef RB_ADDBT
+}
+#endif
+
 //
 // Undefine fast mode defines
 //
 #undef RB_GETPC
 #undef RB_RDOP
+#undef RB_PDOP
 
 v810_timestamp_t V810::Run(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
 {
@@ -720,7 +1363,7 @@ v810_timestamp_t V810::Run(int32 MDFN_FASTCALL (*event_handler)(const v810_times
  #ifdef WANT_DEBUGGER
  if(CPUHook || ADDBT)
  {
-  if(EmuMode == V810_EMU_MODE_FAST)
+  if(EmuMode != V810_EMU_MODE_ACCURATE)
    Run_Fast_Debug(event_handler);
   else
    Run_Accurate_Debug(event_handler);
@@ -729,9 +1372,27 @@ v810_timestamp_t V810::Run(int32 MDFN_FASTCALL (*event_handler)(const v810_times
  #endif
  {
   if(EmuMode == V810_EMU_MODE_FAST)
-   Run_Fast(event_handler);
+  {
+   #ifdef WANT_PCFX_EMU
+   if(MemMap == V810_MEM_MAP_PCFX)
+    Run_Fast<PCFX_MemBus>(event_handler);
+   else
+   #endif
+    Run_Fast<V810_GenericBus>(event_handler);
+  }
+  #ifdef V810_HAVE_JIT
+  else if(EmuMode == V810_EMU_MODE_JIT)
+   Run_JIT(event_handler);
+  #endif
   else
-   Run_Accurate(event_handler);
+  {
+   #ifdef WANT_PCFX_EMU
+   if(MemMap == V810_MEM_MAP_PCFX)
+    Run_Accurate<PCFX_MemBus>(event_handler);
+   else
+   #endif
+    Run_Accurate<V810_GenericBus>(event_handler);
+  }
  }
  return(v810_timestamp);
 }
@@ -741,6 +1402,31 @@ void V810::Exit(void)
  Running = false;
 }
 
+void V810::RevalidateCode(void)
+{
+ #ifdef V810_HAVE_JIT
+ if(JIT)
+  JIT->Revalidate();
+ #endif
+
+ if(EmuMode == V810_EMU_MODE_FAST)
+  PD_Revalidate();
+}
+
+void V810::InvalidateCode(uint32 A, uint32 length)
+{
+ #ifdef V810_HAVE_JIT
+ if(JIT)
+  JIT->Invalidate(A, length);
+ #endif
+
+ if(EmuMode == V810_EMU_MODE_FAST && length)
+ {
+  for(uint32 a = A & ~1; a - (A & ~1) < length + (A & 1); a += 2)
+   PD_InvalidateStore(a);
+ }
+}
+
 #ifdef WANT_DEBUGGER
 void V810::SetCPUHook(void (*newhook)(const v810_timestamp_t timestamp, uint32 PC), void (*new_ADDBT)(uint32 old_PC, uint32 new_PC, uint32))
 {
@@ -765,8 +1451,9 @@ void V810::SetPC(uint32 new_pc)
   PC = new_pc;
  else
  {
-  PC_ptr = &FastMap[new_pc >> V810_FAST_MAP_SHIFT][new_pc];
+  PC_ptr = FastMapPtr(new_pc);
   PC_base = PC_ptr - new_pc;
+  PD_delta = FastMapPD(new_pc);
  }
 }
 
@@ -801,16 +1488,18 @@ void V810::SetSR(const unsigned int which, uint32 value)
 }
 
 
-#define BSTR_OP_MOV dst_cache &= ~(1 << dstoff); dst_cache |= ((src_cache >> srcoff) & 1) << dstoff;
-#define BSTR_OP_NOT dst_cache &= ~(1 << dstoff); dst_cache |= (((src_cache >> srcoff) & 1) ^ 1) << dstoff;
+// Bitstring operations are done on up to a word's worth of bits at a time: "mask" selects the bits of dst_cache being
+// operated on, and "sbits" holds the corresponding source bits, shifted into place.
+#define BSTR_OP_MOV dst_cache = (dst_cache & ~mask) | (sbits & mask);
+#define BSTR_OP_NOT dst_cache = (dst_cache & ~mask) | (~sbits & mask);
 
-#define BSTR_OP_XOR dst_cache ^= ((src_cache >> srcoff) & 1) << dstoff;
-#define BSTR_OP_OR dst_cache |= ((src_cache >> srcoff) & 1) << dstoff;
-#define BSTR_OP_AND dst_cache &= ~((((src_cache >> srcoff) & 1) ^ 1) << dstoff);
+#define BSTR_OP_XOR dst_cache ^= sbits & mask;
+#define BSTR_OP_OR dst_cache |= sbits & mask;
+#define BSTR_OP_AND dst_cache &= ~(~sbits & mask);
 
-#define BSTR_OP_XORN dst_cache ^= (((src_cache >> srcoff) & 1) ^ 1) << dstoff;
-#define BSTR_OP_ORN dst_cache |= (((src_cache >> srcoff) & 1) ^ 1) << dstoff;
-#define BSTR_OP_ANDN dst_cache &= ~(((src_cache >> srcoff) & 1) << dstoff);
+#define BSTR_OP_XORN dst_cache ^= ~sbits & mask;
+#define BSTR_OP_ORN dst_cache |= ~sbits & mask;
+#define BSTR_OP_ANDN dst_cache &= ~(sbits & mask);
 
 INLINE uint32 V810::BSTR_RWORD(v810_timestamp_t &timestamp, uint32 A)
 {
@@ -847,8 +1536,19 @@ INLINE void V810::BSTR_WWORD(v810_timestamp_t &timestamp, uint32 A, uint32 V)
   timestamp += 2;
   MemWrite16(timestamp, A | 2, V >> 16);
  }
+
+ #ifdef V810_HAVE_JIT
+ if(JIT)
+  JIT->CheckWrite(A, 4);
+ #endif
+
+ if(EmuMode == V810_EMU_MODE_FAST)
+  PD_InvalidateStore(A);
 }
 
+// Each pass handles the bits up to the end of the current source word or destination word, whichever comes first(so
+// a whole word per pass when the two are aligned), which keeps the memory accesses and their timing, and where the
+// instruction can be interrupted, the same as when stepping a bit at a time.
 #define DO_BSTR(op) { 						\
                 while(len)					\
                 {						\
@@ -864,10 +1564,14 @@ INLINE void V810::BSTR_WWORD(v810_timestamp_t &timestamp, uint32 A, uint32 V)
                   dst_cache = BSTR_RWORD(timestamp, dst);       \
                  }                                              \
 								\
+		 const uint32 count = std::min<uint32>(len, 0x20 - std::max<uint32>(srcoff, dstoff));	\
+		 const uint32 mask = (0xFFFFFFFFU >> (0x20 - count)) << dstoff;				\
+		 const uint32 sbits = (src_cache >> srcoff) << dstoff;					\
+								\
 		 op;						\
-                 srcoff = (srcoff + 1) & 0x1F;			\
-                 dstoff = (dstoff + 1) & 0x1F;			\
-		 len--;						\
+                 srcoff = (srcoff + count) & 0x1F;		\
+                 dstoff = (dstoff + count) & 0x1F;		\
+		 len -= count;					\
 								\
 		 if(!srcoff)					\
 		 {                                              \
@@ -1400,6 +2104,8 @@ void V810::Exception(uint32 handler, uint16 eCode)
     have_src_cache = FALSE;
     have_dst_cache = FALSE;
 
+    FlushLazyFlags();
+
     if(S_REG[PSW] & PSW_NP) // Fatal exception
     {
      printf("Fatal exception; Code: %08x, ECR: %08x, PSW: %08x, PC: %08x\n", eCode, S_REG[ECR], S_REG[PSW], PC);
@@ -1526,6 +2232,10 @@ int V810::StateAction(StateMem *sm, int load, int data_only)
 
   RecalcIPendingCache();
 
+  // RAM was loaded in place; only code in what changed is thrown away.
+  RevalidateCode();
+  IdleLoopFlush();
+
   SetPC(PC_tmp);
   if(EmuMode == V810_EMU_MODE_ACCURATE)
   {
@@ -1541,6 +2251,7 @@ int V810::StateAction(StateMem *sm, int load, int data_only)
 
     //printf("%d %08x %08x %08x %d %d\n", i, Cache[i].tag << 10, Cache[i].data[0], Cache[i].data[1], Cache[i].data_valid[0], Cache[i].data_valid[1]);
    }
+   CacheSyncFastAll();
   }
  }
 
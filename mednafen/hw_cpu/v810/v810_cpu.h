@@ -10,10 +10,19 @@
 
 typedef int32 v810_timestamp_t;
 
+// The recompiler only emits x86-64 code; elsewhere V810_EMU_MODE_JIT falls back to the fast interpreter.
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(NO_V810_JIT)
+#define V810_HAVE_JIT 1
+#endif
+
 #define V810_FAST_MAP_SHIFT	16
 #define V810_FAST_MAP_PSIZE     (1 << V810_FAST_MAP_SHIFT)
 #define V810_FAST_MAP_TRAMPOLINE_SIZE	1024
 
+// The fast map is a two-level table; each second-level table covers (1 << V810_FAST_MAP_L1_SHIFT) bytes.
+#define V810_FAST_MAP_L1_SHIFT	24
+#define V810_FAST_MAP_L2_SIZE	(1 << (V810_FAST_MAP_L1_SHIFT - V810_FAST_MAP_SHIFT))
+
 // Exception codes
 enum
 {
@@ -134,11 +143,39 @@ typedef enum
 {
  V810_EMU_MODE_FAST = 0,
  V810_EMU_MODE_ACCURATE = 1,
+ V810_EMU_MODE_JIT = 2,
  _V810_EMU_MODE_COUNT
 } V810_Emu_Mode;
 
+// Memory maps the run loops can be specialized for; see SetMemMap().
+typedef enum
+{
+ V810_MEM_MAP_GENERIC = 0,
+ V810_MEM_MAP_PCFX = 1	// mednafen/pcfx/membus.h
+} V810_Mem_Map;
+
+// The run loops are templated on a memory bus, which does loads and stores given the handler to fall back on, and tells
+// whether an address is on the 32-bit bus given MemReadBus32[]/MemWriteBus32[].  This one always uses the handlers.
+struct V810_GenericBus
+{
+ static INLINE bool ReadBus32(const bool *table, uint32 A) { return(table[A >> 24]); }
+ static INLINE bool WriteBus32(const bool *table, uint32 A) { return(table[A >> 24]); }
+
+ static INLINE uint8 Read8(v810_timestamp_t &timestamp, uint32 A, uint8 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32)) { return(handler(timestamp, A)); }
+ static INLINE uint16 Read16(v810_timestamp_t &timestamp, uint32 A, uint16 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32)) { return(handler(timestamp, A)); }
+ static INLINE uint32 Read32(v810_timestamp_t &timestamp, uint32 A, uint32 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32)) { return(handler(timestamp, A)); }
+
+ static INLINE void Write8(v810_timestamp_t &timestamp, uint32 A, uint8 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint8)) { handler(timestamp, A, V); }
+ static INLINE void Write16(v810_timestamp_t &timestamp, uint32 A, uint16 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint16)) { handler(timestamp, A, V); }
+ static INLINE void Write32(v810_timestamp_t &timestamp, uint32 A, uint32 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint32)) { handler(timestamp, A, V); }
+};
+
+class V810_JIT;
+
 class V810
 {
+ friend class V810_JIT;
+
  public:
 
  V810();
@@ -148,6 +185,12 @@ class V810
  bool Init(V810_Emu_Mode mode, bool vb_mode);
  void Kill(void);
 
+ // May differ from the mode passed to Init() if the recompiler isn't available.
+ INLINE V810_Emu_Mode GetEmuMode(void) const
+ {
+  return(EmuMode);
+ }
+
  void SetInt(int level);
 
  void SetMemWriteBus32(uint8 A, bool value);
@@ -159,8 +202,50 @@ class V810
  void SetIOReadHandlers(uint8 MDFN_FASTCALL (*read8)(v810_timestamp_t &, uint32), uint16 MDFN_FASTCALL (*read16)(v810_timestamp_t &, uint32), uint32 MDFN_FASTCALL (*read32)(v810_timestamp_t &, uint32));
  void SetIOWriteHandlers(void MDFN_FASTCALL (*write8)(v810_timestamp_t &, uint32, uint8), void MDFN_FASTCALL (*write16)(v810_timestamp_t &, uint32, uint16), void MDFN_FASTCALL (*write32)(v810_timestamp_t &, uint32, uint32));
 
+ // Idle loop detection, V810_EMU_MODE_FAST only.  A short backward loop that does nothing but compute and load is
+ // fast-forwarded to the next event(like HALT) once one of its iterations is seen to leave the CPU state unchanged.
+ // The checks decide which loads may be part of such a loop: they must return true only for addresses whose value,
+ // and the side effects of reading it, can't change until an event is processed.  Detection is off while they're NULL.
+ void SetIdleLoopReadChecks(bool MDFN_FASTCALL (*mem_check)(uint32 A), bool MDFN_FASTCALL (*io_check)(uint32 A));
+
+ struct IdleLoopStats
+ {
+  uint64 found;		// Loops that passed the static checks(counted again after being evicted or invalidated).
+  uint64 skips;		// Fast-forwards to the next event.
+  uint64 skipped_cycles;	// CPU cycles not emulated because of them.
+ };
+
+ INLINE const IdleLoopStats &GetIdleLoopStats(void) const
+ {
+  return(IdleStats);
+ }
+
+ void ResetIdleLoopStats(void);
+
+ // Instruction cache statistics, V810_EMU_MODE_ACCURATE only(opcode fetches while the cache is enabled).
+ struct ICacheStats
+ {
+  uint64 hits;
+  uint64 misses;
+ };
+
+ INLINE const ICacheStats &GetICacheStats(void) const
+ {
+  return(CacheStats);
+ }
+
+ void ResetICacheStats(void);
+
+ // Lets Run() use run loops that handle the common regions of a known memory map inline, instead of through the
+ // memory handlers(which must still be set, for everything else).  Ignored if support for the map wasn't compiled in.
+ void SetMemMap(V810_Mem_Map map);
+
  // Length specifies the number of bytes to map in, at each location specified by addresses[] (for mirroring)
- uint8 *SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addresses, const char *name);
+ // If mem is non-NULL, it's mapped in instead of newly-allocated memory, and stays owned by the caller; it must be
+ // length + V810_FAST_MAP_TRAMPOLINE_SIZE bytes, with the tail filled in by FillFastMapTrampoline().
+ // read_only promises that the contents won't change once the CPU has started running, so RevalidateCode() skips it.
+ uint8 *SetFastMap(uint32 addresses[], uint32 length, unsigned int num_addresses, const char *name, uint8 *mem = NULL, bool read_only = false);
+ static void FillFastMapTrampoline(uint8 *mem, uint32 length);
 
  INLINE void ResetTS(v810_timestamp_t new_base_timestamp)
  {
@@ -185,6 +270,16 @@ class V810
 
  void Reset(void);
 
+ // Must be called by anything other than the CPU itself that modifies fast-mapped memory(DMA, cheats...), so that
+ // recompiled or pre-decoded code covering it is thrown away.  No-op in V810_EMU_MODE_ACCURATE.
+ void InvalidateCode(uint32 A, uint32 length);
+
+ // For when fast-mapped memory may have been changed wholesale without InvalidateCode()(a state load, or a frontend
+ // writing through a pointer it was handed): compares the recompiled or pre-decoded code of the writable regions
+ // against memory, and throws away what no longer matches.  Takes time proportional to the amount of that code, not to
+ // the size of memory.  Also done by Reset() and by StateAction() when loading.
+ void RevalidateCode(void);
+
  int StateAction(StateMem *sm, int load, int data_only);
 
  #ifdef WANT_DEBUGGER
@@ -213,6 +308,20 @@ class V810
  uint32 IPendingCache;
  void RecalcIPendingCache(void);
 
+ // Condition flags(Z, S, OV, CY) of the last ALU operation, not yet stored in S_REG[PSW].  The run loops leave them
+ // pending until something reads PSW, and always flush them on the way out; see FlushLazyFlags().
+ enum
+ {
+  LAZY_FLAGS_NONE = 0,	// S_REG[PSW] is up to date.
+  LAZY_FLAGS_ADD,	// LazyResult = LazyOp1 + (something)
+  LAZY_FLAGS_SUB,	// LazyResult = LazyOp1 - (something)
+  LAZY_FLAGS_LOGIC	// OV clear, CY = LazyCY
+ };
+ uint32 LazyFlags;
+ uint32 LazyOp1;
+ uint32 LazyResult;
+ bool LazyCY;
+
  public:
  v810_timestamp_t v810_timestamp;	// Will never be less than 0.
 
@@ -231,9 +340,15 @@ class V810
 
  V810_Emu_Mode EmuMode;
  bool VBMode;
+ V810_Mem_Map MemMap;
+
+ template<typename RB_Bus> void Run_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
+ template<typename RB_Bus> void Run_Accurate(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
 
- void Run_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
- void Run_Accurate(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
+ #ifdef V810_HAVE_JIT
+ void Run_JIT(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
+ void Step_Fast(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
+ #endif
 
  #ifdef WANT_DEBUGGER
  void Run_Fast_Debug(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp)) NO_INLINE;
@@ -297,14 +412,135 @@ class V810
 
  V810_CacheEntry_t Cache[128];
 
+ // Direct-mapped mirror of Cache[] with one entry per 4-byte subblock, indexed by bits 2-9 of the address, so that
+ // a hit is a single compare.  key is the address >> 2 for a valid subblock, and ~0 otherwise.  Must be kept in sync
+ // with Cache[] through CacheSyncFast().
+ struct V810_CacheFastEntry_t
+ {
+  uint32 key;
+  uint32 data;
+ };
+
+ V810_CacheFastEntry_t CacheFast[256];
+ ICacheStats CacheStats;
+
+ void CacheSyncFast(uint32 CI);
+ void CacheSyncFastAll(void);
+
  // Bitstring variables.
  uint32 src_cache;
  uint32 dst_cache;
  bool have_src_cache, have_dst_cache;
 
- uint8 *FastMap[(1ULL << 32) / V810_FAST_MAP_PSIZE];
+ struct FastMapL2
+ {
+  uint8 *Page[V810_FAST_MAP_L2_SIZE];	// Host address of the start of each page.
+  uintptr_t PD[V810_FAST_MAP_L2_SIZE];	// See PDOp below.
+ };
+
+ // Every area with nothing fast-mapped in it shares FastMapDummy, whose pages are all DummyRegion.
+ FastMapL2 *FastMap[(1ULL << 32) >> V810_FAST_MAP_L1_SHIFT];
+ FastMapL2 FastMapDummy;
  std::vector<void *> FastMapAllocList;
 
+ INLINE uint8 *FastMapPtr(uint32 A)
+ {
+  return(FastMap[A >> V810_FAST_MAP_L1_SHIFT]->Page[(A >> V810_FAST_MAP_SHIFT) & (V810_FAST_MAP_L2_SIZE - 1)] + (A & (V810_FAST_MAP_PSIZE - 1)));
+ }
+
+ INLINE uintptr_t FastMapPD(uint32 A)
+ {
+  return(FastMap[A >> V810_FAST_MAP_L1_SHIFT]->PD[(A >> V810_FAST_MAP_SHIFT) & (V810_FAST_MAP_L2_SIZE - 1)]);
+ }
+
+ FastMapL2 *GetFastMapL2(uint32 A);
+
+ // Pre-decoded instructions for V810_EMU_MODE_FAST, one per halfword of each fast-mapped region(trampoline included).
+ // An entry is decoded the first time its halfword is executed, and marked undecoded again when it's written to.
+ // The tables are zero-filled by calloc(), so the pages of them covering code that never runs are never touched.
+ //
+ // A block is a run of instructions with fixed timing and no side effects beyond registers and flags, plus the
+ // instruction that ends it.  Run_Fast() skips the event and interrupt checks inside a block when the whole of it fits
+ // before the next event.
+ struct PDOp
+ {
+  uint16 op;	// First halfword.
+  uint16 op2;	// Second halfword of the 32-bit formats, 0 for the rest.
+  uint32 block;	// 0 if undecoded, else PDOP_DECODED | block_length | (block_cycles << 6) | (PD_BlockGen << 12), with
+		// PD_BlockGen as of when the block starting here was last worked out.
+ };
+
+ enum
+ {
+  PDOP_DECODED = 1 << 11,
+  PD_MAX_BLOCK_LENGTH = 32,	// Fits in the low 6 bits of PDOp::block, and the cycles of all but the last one in the next 5.
+  PD_BLOCK_GEN_MAX = 0xFFFFF
+ };
+
+ // The PDOp for fast-mapped address A is at FastMapPD(A) + (uintptr_t)FastMapPtr(A) * (sizeof(PDOp) / 2),
+ // so that it can be found from PC_ptr without going through PC_base.
+ uintptr_t PD_delta;	// FastMapPD() for the region PC_ptr is in.
+
+ // Bumped whenever a decoded instruction is written to, which makes every block be worked out again(a block doesn't know
+ // which of its instructions were written to).  Starts at 1, so that no block is current in a zero-filled entry.
+ uint32 PD_BlockGen;
+
+ // Every region mapped in by SetFastMap().
+ struct FastMapRegion
+ {
+  uint8 *mem;
+  uint32 length;
+  bool read_only;
+
+  PDOp *pd;		// pd[0] is the spare entry before the start of the region.  V810_EMU_MODE_FAST only.
+  uint32 pd_count;
+  uint32 *pd_lines;	// One bit per 32 entries with at least one of them decoded; NULL for read-only regions.
+ };
+ std::vector<FastMapRegion> FastMapRegions;
+
+ const FastMapRegion *FindFastMapRegion(const uint8 *p);
+
+ void PD_Decode(PDOp *pd, const uint8 *p);
+ void PD_ScanBlock(PDOp *pd, const uint8 *p);
+ void PD_InvalidateStore(uint32 A);
+ void PD_Revalidate(void);
+ void PD_Flush(void);
+
+ // Idle loop detection.  Backward branches of up to IDLE_LOOP_MAX_BYTES are looked up in IdleLoops[], which caches
+ // whether the loop they close is straight-line code made only of fixed-timing instructions and loads.  For such a
+ // loop, the registers are saved at the branch(IdleArmed); if they're the same the next time around, and every load
+ // in between passed the read checks, the loop will keep doing the same thing until an event or interrupt.
+ // Anything that leaves the loop disarms it.
+ enum
+ {
+  IDLE_LOOP_MAX_BYTES = 64,
+  IDLE_LOOP_CACHE_SIZE = 64
+ };
+
+ struct IdleLoop
+ {
+  uint32 branch_pc;	// Odd when the entry is unused.
+  uint32 gen;		// PD_BlockGen when the loop was checked.
+  bool idle;
+ };
+ IdleLoop IdleLoops[IDLE_LOOP_CACHE_SIZE];
+
+ bool MDFN_FASTCALL (*IdleMemReadCheck)(uint32 A);
+ bool MDFN_FASTCALL (*IdleIOReadCheck)(uint32 A);
+
+ bool IdleArmed;
+ uint32 IdleArmedPC;
+ uint32 IdleSnap[32];	// P_REG[1] through P_REG[31], then S_REG[PSW].
+
+ IdleLoopStats IdleStats;
+
+ void IdleLoopBranch(v810_timestamp_t &timestamp, uint32 branch_pc, uint32 disp);
+ void IdleLoopCheck(v810_timestamp_t &timestamp, IdleLoop *il, uint32 branch_pc, uint32 target_pc);
+ bool IdleLoopAnalyze(uint32 target_pc, uint32 branch_pc);
+ void IdleLoopFlush(void);
+
+ V810_JIT *JIT;	// Only non-NULL in V810_EMU_MODE_JIT.
+
 
  #ifdef WANT_DEBUGGER
  void (*CPUHook)(const v810_timestamp_t timestamp, uint32 PC);
@@ -329,6 +565,14 @@ class V810
  void SetFlag(uint32 n, bool condition);
  void SetSZ(uint32 value);
 
+ void FlushLazyFlags(void);
+ void FlushLazyFlags_Slow(void);
+ bool GetLazyCY(void);
+ void SetFlagsAdd(uint32 op1, uint32 result);
+ void SetFlagsSub(uint32 op1, uint32 result);
+ void SetFlagsLogic(uint32 result);
+ void SetFlagsShift(uint32 result, bool cy);
+
  void SetSREG(v810_timestamp_t &timestamp, unsigned int which, uint32 value);
  uint32 GetSREG(unsigned int which);
 
@@ -347,7 +591,10 @@ class V810
 
  V810_FP_Ops fpo;
 
- uint8 DummyRegion[V810_FAST_MAP_PSIZE + V810_FAST_MAP_TRAMPOLINE_SIZE];
+ // What unmapped pages map to, outside of V810_EMU_MODE_ACCURATE; allocated by Init().
+ uint8 *DummyRegion;
+ PDOp *DummyPD;	// V810_EMU_MODE_FAST only.
+ enum { DUMMY_PD_COUNT = 1 + (V810_FAST_MAP_PSIZE + V810_FAST_MAP_TRAMPOLINE_SIZE) / 2 };
 };
 
 #endif
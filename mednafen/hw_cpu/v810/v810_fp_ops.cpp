@@ -49,6 +49,143 @@ bool V810_FP_Ops::fp_is_inf_nan_sub(uint32 v)
  return(false);
 }
 
+#ifdef V810_FP_HOST
+//
+// Host FPU paths.  Each returns false, leaving the operation to the software model, for anything but zero or normal
+// inputs giving a normal(or exactly zero) result, which is where the two are known to agree: the software model
+// rounds to nearest-even like the host, but flushes tiny results to zero and wraps the exponent on overflow.
+// Within that range the only flag that can be raised is inexact, which is found by checking the result against
+// an exact computation in double precision.  Rounding an exact double to float, or the double result of
+// an add or divide of two floats, gives the correctly rounded float.
+//
+static INLINE float host_u2f(uint32 v)
+{
+ float ret;
+
+ memcpy(&ret, &v, sizeof(ret));
+
+ return(ret);
+}
+
+static INLINE uint32 host_f2u(float v)
+{
+ uint32 ret;
+
+ memcpy(&ret, &v, sizeof(ret));
+
+ return(ret);
+}
+
+INLINE bool V810_FP_Ops::host_inputs_ok(uint32 a, uint32 b)
+{
+ return(!fp_is_inf_nan_sub(a) && !fp_is_inf_nan_sub(b));
+}
+
+// Exponent of 0x01 is excluded too, since rounding near the bottom of the normal range may differ.
+INLINE bool V810_FP_Ops::host_result(float r, uint32* ret)
+{
+ const uint32 ri = host_f2u(r);
+ const uint32 exp = (ri >> 23) & 0xFF;
+
+ if(exp <= 0x01 || exp == 0xFF)
+  return(false);
+
+ *ret = ri;
+ return(true);
+}
+
+bool V810_FP_Ops::host_mul(uint32 a, uint32 b, uint32* ret)
+{
+ if(!host_inputs_ok(a, b))
+  return(false);
+
+ if(fp_is_zero(a) || fp_is_zero(b))
+ {
+  *ret = (a ^ b) & 0x80000000;
+  return(true);
+ }
+
+ // 24 x 24 bit significands, so this is exact.
+ const double p = (double)host_u2f(a) * host_u2f(b);
+ const float r = p;
+
+ if(!host_result(r, ret))
+  return(false);
+
+ if((double)r != p)
+  exception_flags |= flag_inexact;
+
+ return(true);
+}
+
+bool V810_FP_Ops::host_div(uint32 a, uint32 b, uint32* ret)
+{
+ if(!host_inputs_ok(a, b) || fp_is_zero(b))
+  return(false);
+
+ if(fp_is_zero(a))
+ {
+  *ret = (a ^ b) & 0x80000000;
+  return(true);
+ }
+
+ const double da = host_u2f(a);
+ const double db = host_u2f(b);
+ const float r = da / db;
+
+ if(!host_result(r, ret))
+  return(false);
+
+ // r * b is exact in double, so this is only equal when the quotient was.
+ if((double)r * db != da)
+  exception_flags |= flag_inexact;
+
+ return(true);
+}
+
+bool V810_FP_Ops::host_add(uint32 a, uint32 b, uint32* ret)
+{
+ if(!host_inputs_ok(a, b))
+  return(false);
+
+ const double da = host_u2f(a);
+ const double db = host_u2f(b);
+ const double s = da + db;
+ const float r = s;
+
+ // Exact cancellation(including zero plus zero) gives a zero with the same sign as the software model's.
+ if(r == 0)
+ {
+  *ret = host_f2u(r);
+  return(true);
+ }
+
+ if(!host_result(r, ret))
+  return(false);
+
+ // Error of the double addition(2Sum).
+ const double sb = s - da;
+ const double err = (da - (s - sb)) + (db - sb);
+
+ if(err != 0 || (double)r != s)
+  exception_flags |= flag_inexact;
+
+ return(true);
+}
+
+bool V810_FP_Ops::host_itof(uint32 v, uint32* ret)
+{
+ const float r = (float)(int32)v;
+
+ *ret = host_f2u(r);
+
+ if((double)r != (double)(int32)v)
+  exception_flags |= flag_inexact;
+
+ return(true);
+}
+#endif
+
 uint8 V810_FP_Ops::clz64(uint64 v)
 {
  uint8 ret = 0;
@@ -181,6 +318,15 @@ uint32 V810_FP_Ops::fpim_encode(fpim* df)
 
 uint32 V810_FP_Ops::mul(uint32 a, uint32 b)
 {
+ #ifdef V810_FP_HOST
+ {
+  uint32 ret;
+
+  if(host_mul(a, b, &ret))
+   return(ret);
+ }
+ #endif
+
  fpim ins[2];
  fpim res;
 
@@ -206,6 +352,15 @@ uint32 V810_FP_Ops::mul(uint32 a, uint32 b)
 
 uint32 V810_FP_Ops::add(uint32 a, uint32 b)
 {
+ #ifdef V810_FP_HOST
+ {
+  uint32 ret;
+
+  if(host_add(a, b, &ret))
+   return(ret);
+ }
+ #endif
+
  fpim ins[2];
  fpim res;
  int64 ft[2];
@@ -286,6 +441,15 @@ uint32 V810_FP_Ops::sub(uint32 a, uint32 b)
 
 uint32 V810_FP_Ops::div(uint32 a, uint32 b)
 {
+ #ifdef V810_FP_HOST
+ {
+  uint32 ret;
+
+  if(host_div(a, b, &ret))
+   return(ret);
+ }
+ #endif
+
  fpim ins[2];
  fpim res;
  uint64 mtmp;
@@ -367,6 +531,15 @@ int V810_FP_Ops::cmp(uint32 a, uint32 b)
 
 uint32 V810_FP_Ops::itof(uint32 v)
 {
+ #ifdef V810_FP_HOST
+ {
+  uint32 ret;
+
+  if(host_itof(v, &ret))
+   return(ret);
+ }
+ #endif
+
  fpim res;
 
  res.sign = (bool)(v & 0x80000000);
@@ -16,6 +16,13 @@
  */
 
 #include "mednafen/mednafen.h"
+#include <float.h>
+
+// The host FPU is used for the common cases of add, sub, mul, div and itof when it evaluates float and double
+// expressions at their own precision(so not on x87).  The results and flags are the same as the software model's.
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0 && !defined(V810_FP_SOFT_ONLY)
+ #define V810_FP_HOST 1
+#endif
 
 class V810_FP_Ops
 {
@@ -64,6 +71,16 @@ class V810_FP_Ops
  bool fp_is_zero(uint32 v);
  bool fp_is_inf_nan_sub(uint32 v);
 
+ #ifdef V810_FP_HOST
+ bool host_inputs_ok(uint32 a, uint32 b);
+ bool host_result(float r, uint32* ret);
+
+ bool host_mul(uint32 a, uint32 b, uint32* ret);
+ bool host_div(uint32 a, uint32 b, uint32* ret);
+ bool host_add(uint32 a, uint32 b, uint32* ret);
+ bool host_itof(uint32 v, uint32* ret);
+ #endif
+
  uint8 clz64(uint64 v);
  void fpim_decode(fpim* df, uint32 v);
  void fpim_round(fpim* df);
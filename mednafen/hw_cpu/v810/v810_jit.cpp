@@ -0,0 +1,1405 @@
+/* V810 Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+//////////////////////////////////////////////////////////
+// x86-64 dynamic recompiler
+//
+// Blocks are translated from fast-mapped memory only, and end at the first branch, at the first instruction that isn't
+// handled(that one is then run by the interpreter), or at a fast map page boundary.  Simple ALU instructions and branches are
+// emitted inline; loads, stores, port I/O and multiplies call helpers that mirror v810_oploop.inc, so the timing(including
+// the lastop-dependent load/store penalties) is identical to V810_EMU_MODE_FAST.
+//
+// Events: at the start of each block, and after each helper call, the code checks that every remaining inline instruction up
+// to the next helper call or branch would start before next_event_ts.  If not, the block is left and the interpreter runs up to
+// the event, so events fire at exactly the same timestamps as with the interpreter.
+//
+// Register usage inside of translated code:
+//  rbx = V810 *, r12d = v810_timestamp, r13 = CondTable; eax, ecx, edx, r8 and r9 are scratch.
+
+#include "mednafen/mednafen.h"
+#include <mednafen/masmem.h>
+
+#include "v810_opt.h"
+#include "v810_cpu.h"
+#include "v810_jit.h"
+
+#ifdef V810_HAVE_JIT
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+ REG_EAX = 0,
+ REG_ECX = 1,
+ REG_EDX = 2,
+ REG_EBX = 3,
+ REG_R12 = 12,
+ REG_R13 = 13
+};
+
+// x86 condition codes used with EmitJccShort()
+enum
+{
+ CC_Z = 0x4,
+ CC_NZ = 0x5,
+ CC_L = 0xC
+};
+
+V810_JIT::V810_JIT(V810 *c)
+{
+ cpu = c;
+
+ CodeBuffer = NULL;
+ CodePtr = NULL;
+ CodeBlocksStart = NULL;
+ EnterThunk = NULL;
+ ExitThunk = NULL;
+ UnresolvedStub = NULL;
+
+ Slots = NULL;
+ SlotCount = 0;
+ SlotHash = NULL;
+
+ memset(LineMap, 0, sizeof(LineMap));
+
+ off_PREG = (int32)((uint8 *)&c->P_REG[0] - (uint8 *)c);
+ off_PSW = (int32)((uint8 *)&c->S_REG[PSW] - (uint8 *)c);
+ off_timestamp = (int32)((uint8 *)&c->v810_timestamp - (uint8 *)c);
+ off_next_event_ts = (int32)((uint8 *)&c->next_event_ts - (uint8 *)c);
+ off_lastop = (int32)((uint8 *)&c->lastop - (uint8 *)c);
+
+ for(unsigned cond = 0; cond < 16; cond++)
+ {
+  for(unsigned flags = 0; flags < 16; flags++)
+  {
+   uint32 S_REG[32];
+   bool taken = false;
+
+   S_REG[PSW] = flags;
+
+   switch(cond)
+   {
+    case COND_V: taken = TESTCOND_V; break;
+    case COND_C: taken = TESTCOND_C; break;
+    case COND_Z: taken = TESTCOND_Z; break;
+    case COND_NH: taken = TESTCOND_NH; break;
+    case COND_S: taken = TESTCOND_S; break;
+    case COND_T: taken = true; break;
+    case COND_LT: taken = TESTCOND_LT; break;
+    case COND_LE: taken = TESTCOND_LE; break;
+    case COND_NV: taken = TESTCOND_NV; break;
+    case COND_NC: taken = TESTCOND_NC; break;
+    case COND_NZ: taken = TESTCOND_NZ; break;
+    case COND_H: taken = TESTCOND_H; break;
+    case COND_NS: taken = TESTCOND_NS; break;
+    case COND_F: taken = false; break;
+    case COND_GE: taken = TESTCOND_GE; break;
+    case COND_GT: taken = TESTCOND_GT; break;
+   }
+   CondTable[cond * 16 + flags] = taken;
+  }
+ }
+}
+
+V810_JIT::~V810_JIT()
+{
+ if(CodeBuffer)
+ {
+  #ifdef _WIN32
+  VirtualFree(CodeBuffer, 0, MEM_RELEASE);
+  #else
+  munmap(CodeBuffer, CODE_BUFFER_SIZE);
+  #endif
+  CodeBuffer = NULL;
+ }
+
+ if(Slots)
+ {
+  free(Slots);
+  Slots = NULL;
+ }
+
+ if(SlotHash)
+ {
+  free(SlotHash);
+  SlotHash = NULL;
+ }
+
+ for(unsigned i = 0; i < 4096; i++)
+ {
+  if(LineMap[i])
+  {
+   free(LineMap[i]);
+   LineMap[i] = NULL;
+  }
+ }
+}
+
+bool V810_JIT::Init(void)
+{
+ #ifdef _WIN32
+ CodeBuffer = (uint8 *)VirtualAlloc(NULL, CODE_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+ #else
+ int map_flags = MAP_PRIVATE | MAP_ANON;
+
+ #ifdef MAP_JIT
+ map_flags |= MAP_JIT;
+ #endif
+
+ CodeBuffer = (uint8 *)mmap(NULL, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+ if(CodeBuffer == (uint8 *)MAP_FAILED)
+  CodeBuffer = NULL;
+ #endif
+
+ if(!CodeBuffer)
+  return(false);
+
+ if(!(Slots = (Slot *)malloc(sizeof(Slot) * MAX_SLOTS)))
+  return(false);
+
+ if(!(SlotHash = (uint32 *)calloc(SLOT_HASH_SIZE, sizeof(uint32))))
+  return(false);
+
+ CodePtr = CodeBuffer;
+
+ //
+ // uint32 EnterThunk(V810 *c, void *code)
+ //
+ EnterThunk = (uint32 (*)(V810 *, void *))CodePtr;
+ Emit8(0x53);					// push rbx
+ Emit8(0x41); Emit8(0x54);			// push r12
+ Emit8(0x41); Emit8(0x55);			// push r13
+ #ifdef _WIN32
+ Emit8(0x48); Emit8(0x83); Emit8(0xEC); Emit8(0x20);	// sub rsp, 32
+ Emit8(0x48); Emit8(0x89); Emit8(0xCB);		// mov rbx, rcx
+ #else
+ Emit8(0x48); Emit8(0x89); Emit8(0xFB);		// mov rbx, rdi
+ #endif
+ Emit8(0x49); Emit8(0xBD); Emit64((uintptr_t)CondTable);	// mov r13, CondTable
+ EmitLoad(REG_R12, off_timestamp);		// mov r12d, [rbx + v810_timestamp]
+ #ifdef _WIN32
+ Emit8(0xFF); Emit8(0xE2);			// jmp rdx
+ #else
+ Emit8(0xFF); Emit8(0xE6);			// jmp rsi
+ #endif
+
+ //
+ // Exit, next PC in eax
+ //
+ ExitThunk = CodePtr;
+ EmitStore(off_timestamp, REG_R12);		// mov [rbx + v810_timestamp], r12d
+ #ifdef _WIN32
+ Emit8(0x48); Emit8(0x83); Emit8(0xC4); Emit8(0x20);	// add rsp, 32
+ #endif
+ Emit8(0x41); Emit8(0x5D);			// pop r13
+ Emit8(0x41); Emit8(0x5C);			// pop r12
+ Emit8(0x5B);					// pop rbx
+ Emit8(0xC3);					// ret
+
+ //
+ // Target of chained jumps to slots without code, slot pointer in rax
+ //
+ UnresolvedStub = CodePtr;
+ Emit8(0x8B); Emit8(0x40); Emit8(0x08);		// mov eax, [rax + 8]
+ EmitJmp(ExitThunk);
+
+ CodeBlocksStart = CodePtr;
+
+ Flush();
+
+ return(ProtectCode(CodeBuffer, CODE_BUFFER_SIZE, false));
+}
+
+bool V810_JIT::ProtectCode(uint8 *start, size_t length, bool writable)
+{
+ #ifdef _WIN32
+ DWORD old_protect;
+
+ return(VirtualProtect(start, length, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old_protect) != 0);
+ #else
+ static const uintptr_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+ const uintptr_t first = (uintptr_t)start & ~page_mask;
+ const uintptr_t end = ((uintptr_t)start + length + page_mask) & ~page_mask;
+
+ return(mprotect((void *)first, end - first, writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC)) == 0);
+ #endif
+}
+
+void V810_JIT::Flush(void)
+{
+ CodePtr = CodeBlocksStart;
+
+ SlotCount = 0;
+ memset(SlotHash, 0, sizeof(uint32) * SLOT_HASH_SIZE);
+
+ Blocks.clear();
+ RegionBlocks.clear();
+
+ for(unsigned i = 0; i < 4096; i++)
+ {
+  if(LineMap[i])
+   memset(LineMap[i], 0, 2048);
+ }
+}
+
+void V810_JIT::MarkCode(uint32 start, uint32 last)
+{
+ for(uint32 line = start >> 6; line <= (last >> 6); line++)
+ {
+  uint8 **lm = &LineMap[line >> 14];
+
+  if(!*lm)
+  {
+   if(!(*lm = (uint8 *)calloc(2048, 1)))
+    abort();
+  }
+
+  (*lm)[(line >> 3) & 0x7FF] |= 1 << (line & 0x7);
+ }
+}
+
+void V810_JIT::Invalidate(uint32 A, uint32 length)
+{
+ const uint32 last = A + length - 1;
+
+ if(!length)
+  return;
+
+ if(last < A)	// Wrapped around.
+ {
+  Invalidate(A, 0 - A);
+  Invalidate(0, last + 1);
+  return;
+ }
+
+ for(uint32 region = A >> 20; region <= (last >> 20); region++)
+ {
+  std::map<uint32, std::vector<uint32> >::iterator it = RegionBlocks.find(region);
+
+  if(it == RegionBlocks.end())
+   continue;
+
+  std::vector<uint32> &bl = it->second;
+  uint32 kill_first = ~0U;
+  uint32 kill_last = 0;
+
+  for(size_t i = 0; i < bl.size(); )
+  {
+   Block *b = &Blocks[bl[i]];
+
+   if(b->start <= last && A <= b->last)
+   {
+    Slots[b->slot].code = UnresolvedStub;
+    b->valid = false;
+
+    kill_first = std::min<uint32>(kill_first, b->start >> 6);
+    kill_last = std::max<uint32>(kill_last, b->last >> 6);
+
+    bl[i] = bl.back();
+    bl.pop_back();
+   }
+   else
+    i++;
+  }
+
+  if(kill_first <= kill_last)
+  {
+   for(uint32 line = kill_first; line <= kill_last; line++)
+    LineMap[line >> 14][(line >> 3) & 0x7FF] &= ~(1 << (line & 0x7));
+
+   // Lines can be shared with blocks that are still valid.
+   for(size_t i = 0; i < bl.size(); i++)
+   {
+    const Block *b = &Blocks[bl[i]];
+
+    if((b->start >> 6) <= kill_last && kill_first <= (b->last >> 6))
+     MarkCode(b->start, b->last);
+   }
+  }
+ }
+}
+
+// FNV-1a over halfwords; blocks never cross a fast map page, so their code is contiguous.
+uint64 V810_JIT::HashCode(const uint8 *p, uint32 length)
+{
+ uint64 h = 0xCBF29CE484222325ULL;
+
+ for(uint32 i = 0; i < length; i += 2)
+  h = (h ^ LoadU16_LE((uint16 *)(p + i))) * 0x100000001B3ULL;
+
+ return(h);
+}
+
+void V810_JIT::Revalidate(void)
+{
+ for(size_t i = 0; i < Blocks.size(); i++)
+ {
+  const Block *b = &Blocks[i];
+
+  if(!b->valid)
+   continue;
+
+  const uint8 *p = cpu->FastMapPtr(b->start);
+  const V810::FastMapRegion *r = cpu->FindFastMapRegion(p);
+
+  if(!r || r->read_only)
+   continue;
+
+  if(HashCode(p, b->last - b->start + 1) != b->hash)
+   Invalidate(b->start, b->last - b->start + 1);
+ }
+}
+
+V810_JIT::Slot *V810_JIT::GetSlot(uint32 PC, bool create)
+{
+ uint32 h = ((PC >> 1) * 2654435761U) >> (32 - 17);
+
+ for(;;)
+ {
+  const uint32 e = SlotHash[h];
+
+  if(!e)
+   break;
+
+  if(Slots[e - 1].pc == PC)
+   return(&Slots[e - 1]);
+
+  h = (h + 1) & (SLOT_HASH_SIZE - 1);
+ }
+
+ if(!create || SlotCount >= MAX_SLOTS)
+  return(NULL);
+
+ Slot *s = &Slots[SlotCount];
+
+ s->code = UnresolvedStub;
+ s->pc = PC;
+ s->interp = false;
+
+ SlotHash[h] = ++SlotCount;
+
+ return(s);
+}
+
+void *V810_JIT::GetBlock(uint32 PC)
+{
+ const Slot *s = GetSlot(PC, false);
+
+ if(s)
+ {
+  if(s->code != UnresolvedStub)
+   return(s->code);
+
+  if(s->interp)
+   return(NULL);
+ }
+
+ return(Compile(PC));
+}
+
+//
+// Emitter
+//
+void V810_JIT::EmitMem(unsigned reg, int32 disp)
+{
+ if(disp >= -128 && disp <= 127)
+ {
+  Emit8(0x40 | ((reg & 0x7) << 3) | REG_EBX);
+  Emit8(disp);
+ }
+ else
+ {
+  Emit8(0x80 | ((reg & 0x7) << 3) | REG_EBX);
+  Emit32(disp);
+ }
+}
+
+void V810_JIT::EmitLoad(unsigned reg, int32 disp)
+{
+ if(reg & 0x8)
+  Emit8(0x44);
+ Emit8(0x8B);
+ EmitMem(reg, disp);
+}
+
+void V810_JIT::EmitStore(int32 disp, unsigned reg)
+{
+ if(reg & 0x8)
+  Emit8(0x44);
+ Emit8(0x89);
+ EmitMem(reg, disp);
+}
+
+void V810_JIT::EmitStoreImm(int32 disp, uint32 imm)
+{
+ Emit8(0xC7);
+ EmitMem(0, disp);
+ Emit32(imm);
+}
+
+// opc is the "reg, r/m" form: 0x03 add, 0x0B or, 0x23 and, 0x2B sub, 0x33 xor, 0x3B cmp
+void V810_JIT::EmitALUMem(uint8 opc, unsigned reg, int32 disp)
+{
+ if(reg & 0x8)
+  Emit8(0x44);
+ Emit8(opc);
+ EmitMem(reg, disp);
+}
+
+// digit: 0 add, 1 or, 4 and, 5 sub, 6 xor, 7 cmp
+void V810_JIT::EmitALUImm(unsigned digit, unsigned reg, uint32 imm)
+{
+ if(reg & 0x8)
+  Emit8(0x41);
+
+ if((int32)imm >= -128 && (int32)imm <= 127)
+ {
+  Emit8(0x83);
+  Emit8(0xC0 | (digit << 3) | (reg & 0x7));
+  Emit8(imm);
+ }
+ else
+ {
+  Emit8(0x81);
+  Emit8(0xC0 | (digit << 3) | (reg & 0x7));
+  Emit32(imm);
+ }
+}
+
+void V810_JIT::EmitLoadPREG(unsigned reg, unsigned which)
+{
+ if(!which)
+ {
+  // xor reg, reg
+  Emit8(0x31);
+  Emit8(0xC0 | (reg << 3) | reg);
+ }
+ else
+  EmitLoad(reg, off_PREG + which * 4);
+}
+
+void V810_JIT::EmitStorePREG(unsigned which, unsigned reg)
+{
+ if(which)
+  EmitStore(off_PREG + which * 4, reg);
+}
+
+void V810_JIT::EmitAddTS(uint32 cycles)
+{
+ if(cycles)
+  EmitALUImm(0, REG_R12, cycles);
+}
+
+// Z, S, OV and CY from the host flags.
+void V810_JIT::EmitFlagsFull(void)
+{
+ static const uint8 seq[] =
+ {
+  0x0F, 0x94, 0xC0,		// setz al
+  0x0F, 0x98, 0xC1,		// sets cl
+  0x41, 0x0F, 0x90, 0xC0,	// seto r8b
+  0x41, 0x0F, 0x92, 0xC1,	// setc r9b
+  0x0F, 0xB6, 0xC0,		// movzx eax, al
+  0x0F, 0xB6, 0xC9,		// movzx ecx, cl
+  0x45, 0x0F, 0xB6, 0xC0,	// movzx r8d, r8b
+  0x45, 0x0F, 0xB6, 0xC9,	// movzx r9d, r9b
+  0x8D, 0x04, 0x48,		// lea eax, [rax + rcx * 2]
+  0x42, 0x8D, 0x04, 0x80,	// lea eax, [rax + r8 * 4]
+  0x42, 0x8D, 0x04, 0xC8,	// lea eax, [rax + r9 * 8]
+ };
+
+ memcpy(CodePtr, seq, sizeof(seq));
+ CodePtr += sizeof(seq);
+
+ EmitLoad(REG_ECX, off_PSW);
+ Emit8(0x83); Emit8(0xE1); Emit8(0xF0);	// and ecx, ~0xF
+ Emit8(0x09); Emit8(0xC1);			// or ecx, eax
+ EmitStore(off_PSW, REG_ECX);
+}
+
+// Z, S and CY from the host flags, OV cleared.
+void V810_JIT::EmitFlagsSZCY(void)
+{
+ static const uint8 seq[] =
+ {
+  0x0F, 0x94, 0xC0,		// setz al
+  0x0F, 0x98, 0xC1,		// sets cl
+  0x41, 0x0F, 0x92, 0xC1,	// setc r9b
+  0x0F, 0xB6, 0xC0,		// movzx eax, al
+  0x0F, 0xB6, 0xC9,		// movzx ecx, cl
+  0x45, 0x0F, 0xB6, 0xC9,	// movzx r9d, r9b
+  0x8D, 0x04, 0x48,		// lea eax, [rax + rcx * 2]
+  0x42, 0x8D, 0x04, 0xC8,	// lea eax, [rax + r9 * 8]
+ };
+
+ memcpy(CodePtr, seq, sizeof(seq));
+ CodePtr += sizeof(seq);
+
+ EmitLoad(REG_ECX, off_PSW);
+ Emit8(0x83); Emit8(0xE1); Emit8(0xF0);	// and ecx, ~0xF
+ Emit8(0x09); Emit8(0xC1);			// or ecx, eax
+ EmitStore(off_PSW, REG_ECX);
+}
+
+// Z and S from the host flags, OV cleared, CY untouched.
+void V810_JIT::EmitFlagsSZ(void)
+{
+ static const uint8 seq[] =
+ {
+  0x0F, 0x94, 0xC0,		// setz al
+  0x0F, 0x98, 0xC1,		// sets cl
+  0x0F, 0xB6, 0xC0,		// movzx eax, al
+  0x0F, 0xB6, 0xC9,		// movzx ecx, cl
+  0x8D, 0x04, 0x48,		// lea eax, [rax + rcx * 2]
+ };
+
+ memcpy(CodePtr, seq, sizeof(seq));
+ CodePtr += sizeof(seq);
+
+ EmitLoad(REG_ECX, off_PSW);
+ Emit8(0x83); Emit8(0xE1); Emit8(0xF8);	// and ecx, ~0x7
+ Emit8(0x09); Emit8(0xC1);			// or ecx, eax
+ EmitStore(off_PSW, REG_ECX);
+}
+
+void V810_JIT::EmitJmp(const uint8 *target)
+{
+ Emit8(0xE9);
+ Emit32((uint32)(target - (CodePtr + 4)));
+}
+
+void V810_JIT::EmitExit(uint32 next_pc)
+{
+ Emit8(0xB8);		// mov eax, next_pc
+ Emit32(next_pc);
+ EmitJmp(ExitThunk);
+}
+
+void V810_JIT::EmitChain(uint32 next_pc)
+{
+ const Slot *s = GetSlot(next_pc, true);
+
+ if(!s)
+ {
+  EmitExit(next_pc);
+  return;
+ }
+
+ Emit8(0x48); Emit8(0xB8); Emit64((uintptr_t)s);	// mov rax, slot
+ Emit8(0xFF); Emit8(0x20);				// jmp [rax]
+}
+
+void V810_JIT::EmitCall(const void *func, uint32 a, uint32 b, uint32 c)
+{
+ #ifdef _WIN32
+ Emit8(0x48); Emit8(0x89); Emit8(0xD9);		// mov rcx, rbx
+ Emit8(0xBA); Emit32(a);			// mov edx, a
+ Emit8(0x41); Emit8(0xB8); Emit32(b);		// mov r8d, b
+ Emit8(0x41); Emit8(0xB9); Emit32(c);		// mov r9d, c
+ #else
+ Emit8(0x48); Emit8(0x89); Emit8(0xDF);		// mov rdi, rbx
+ Emit8(0xBE); Emit32(a);			// mov esi, a
+ Emit8(0xBA); Emit32(b);			// mov edx, b
+ Emit8(0xB9); Emit32(c);			// mov ecx, c
+ #endif
+ Emit8(0x48); Emit8(0xB8); Emit64((uintptr_t)func);	// mov rax, func
+ Emit8(0xFF); Emit8(0xD0);				// call rax
+}
+
+uint8 *V810_JIT::EmitJccShort(uint8 cc)
+{
+ Emit8(0x70 | cc);
+ Emit8(0x00);
+
+ return(CodePtr - 1);
+}
+
+void V810_JIT::PatchShort(uint8 *at)
+{
+ const ptrdiff_t rel = CodePtr - (at + 1);
+
+ assert(rel >= 0 && rel <= 127);
+ *at = rel;
+}
+
+//
+// Helpers; these must stay in sync with the corresponding ops in v810_oploop.inc
+//
+#define LOAD_DELAY(n) { if(c->lastop >= 0) { timestamp += (c->lastop == LASTOP_LD) ? (n) : ((n) + 1); } c->lastop = LASTOP_LD; }
+
+uint32 V810_JIT::H_LD_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ c->P_REG[arg3] = sign_8(c->MemRead8(timestamp, sign_16(arg1) + c->P_REG[arg2]));
+ LOAD_DELAY(1);
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_LD_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ c->P_REG[arg3] = sign_16(c->MemRead16(timestamp, (sign_16(arg1) + c->P_REG[arg2]) & 0xFFFFFFFE));
+ LOAD_DELAY(1);
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_LD_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ A = (sign_16(arg1) + c->P_REG[arg2]) & 0xFFFFFFFC;
+
+ if(c->MemReadBus32[A >> 24])
+ {
+  c->P_REG[arg3] = c->MemRead32(timestamp, A);
+  LOAD_DELAY(1);
+ }
+ else
+ {
+  uint32 rv;
+
+  rv = c->MemRead16(timestamp, A);
+  rv |= c->MemRead16(timestamp, A | 2) << 16;
+  c->P_REG[arg3] = rv;
+  LOAD_DELAY(3);
+ }
+
+ return(c->IPendingCache);
+}
+
+#undef LOAD_DELAY
+
+uint32 V810_JIT::H_ST_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ A = sign_16(arg2) + c->P_REG[arg3];
+ c->MemWrite8(timestamp, A, c->P_REG[arg1] & 0xFF);
+
+ if(c->lastop == LASTOP_ST)
+  timestamp += 1;
+ c->lastop = LASTOP_ST;
+
+ return(c->IPendingCache | c->JIT->CheckWrite(A, 1));
+}
+
+uint32 V810_JIT::H_ST_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ A = (sign_16(arg2) + c->P_REG[arg3]) & 0xFFFFFFFE;
+ c->MemWrite16(timestamp, A, c->P_REG[arg1] & 0xFFFF);
+
+ if(c->lastop == LASTOP_ST)
+  timestamp += 1;
+ c->lastop = LASTOP_ST;
+
+ return(c->IPendingCache | c->JIT->CheckWrite(A, 2));
+}
+
+uint32 V810_JIT::H_ST_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ A = (sign_16(arg2) + c->P_REG[arg3]) & 0xFFFFFFFC;
+
+ if(c->MemWriteBus32[A >> 24])
+ {
+  c->MemWrite32(timestamp, A, c->P_REG[arg1]);
+
+  if(c->lastop == LASTOP_ST)
+   timestamp += 1;
+ }
+ else
+ {
+  c->MemWrite16(timestamp, A, c->P_REG[arg1] & 0xFFFF);
+  c->MemWrite16(timestamp, A | 2, c->P_REG[arg1] >> 16);
+
+  if(c->lastop == LASTOP_ST)
+   timestamp += 3;
+ }
+ c->lastop = LASTOP_ST;
+
+ return(c->IPendingCache | c->JIT->CheckWrite(A, 4));
+}
+
+uint32 V810_JIT::H_IN_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 3;
+ c->P_REG[arg3] = c->IORead8(timestamp, sign_16(arg1) + c->P_REG[arg2]);
+ c->lastop = LASTOP_IN;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_IN_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 3;
+ c->P_REG[arg3] = c->IORead16(timestamp, (sign_16(arg1) + c->P_REG[arg2]) & 0xFFFFFFFE);
+ c->lastop = LASTOP_IN;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_IN_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ A = (sign_16(arg1) + c->P_REG[arg2]) & 0xFFFFFFFC;
+
+ if(c->IORead32)
+ {
+  timestamp += 3;
+  c->P_REG[arg3] = c->IORead32(timestamp, A);
+ }
+ else
+ {
+  uint32 rv;
+
+  timestamp += 5;
+  rv = c->IORead16(timestamp, A);
+  rv |= c->IORead16(timestamp, A | 2) << 16;
+  c->P_REG[arg3] = rv;
+ }
+ c->lastop = LASTOP_IN;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_OUT_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ c->IOWrite8(timestamp, sign_16(arg2) + c->P_REG[arg3], c->P_REG[arg1] & 0xFF);
+
+ if(c->lastop == LASTOP_OUT)
+  timestamp += 1;
+ c->lastop = LASTOP_OUT;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_OUT_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ c->IOWrite16(timestamp, (sign_16(arg2) + c->P_REG[arg3]) & 0xFFFFFFFE, c->P_REG[arg1] & 0xFFFF);
+
+ if(c->lastop == LASTOP_OUT)
+  timestamp += 1;
+ c->lastop = LASTOP_OUT;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_OUT_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ v810_timestamp_t &timestamp = c->v810_timestamp;
+ uint32 A;
+
+ c->P_REG[0] = 0;
+ timestamp += 1;
+ A = (sign_16(arg2) + c->P_REG[arg3]) & 0xFFFFFFFC;
+
+ if(c->IOWrite32)
+  c->IOWrite32(timestamp, A, c->P_REG[arg1]);
+ else
+ {
+  c->IOWrite16(timestamp, A, c->P_REG[arg1] & 0xFFFF);
+  c->IOWrite16(timestamp, A | 2, c->P_REG[arg1] >> 16);
+ }
+
+ if(c->lastop == LASTOP_OUT)
+  timestamp += c->IOWrite32 ? 1 : 3;
+ c->lastop = LASTOP_OUT;
+
+ return(c->IPendingCache);
+}
+
+uint32 V810_JIT::H_MUL(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ uint64 temp;
+
+ c->P_REG[0] = 0;
+ c->v810_timestamp += 13;
+
+ temp = (int64)(int32)c->P_REG[arg1] * (int32)c->P_REG[arg2];
+
+ c->P_REG[30] = (uint32)(temp >> 32);
+ c->P_REG[arg2] = temp;
+
+ c->S_REG[PSW] &= ~(PSW_Z | PSW_S | PSW_OV);
+ c->S_REG[PSW] |= (c->P_REG[arg2] ? 0 : PSW_Z) | ((c->P_REG[arg2] & 0x80000000) ? PSW_S : 0);
+ c->S_REG[PSW] |= (temp != (uint64)(int64)(int32)(uint32)temp) ? PSW_OV : 0;
+ c->lastop = -1;
+
+ return(0);
+}
+
+uint32 V810_JIT::H_MULU(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3)
+{
+ uint64 temp;
+
+ c->P_REG[0] = 0;
+ c->v810_timestamp += 13;
+
+ temp = (uint64)c->P_REG[arg1] * (uint64)c->P_REG[arg2];
+
+ c->P_REG[30] = (uint32)(temp >> 32);
+ c->P_REG[arg2] = (uint32)temp;
+
+ c->S_REG[PSW] &= ~(PSW_Z | PSW_S | PSW_OV);
+ c->S_REG[PSW] |= (c->P_REG[arg2] ? 0 : PSW_Z) | ((c->P_REG[arg2] & 0x80000000) ? PSW_S : 0);
+ c->S_REG[PSW] |= (temp != (uint32)temp) ? PSW_OV : 0;
+ c->lastop = -1;
+
+ return(0);
+}
+
+//
+// Translation
+//
+enum
+{
+ KIND_NONE = 0,
+ KIND_INLINE,	// Fixed 1 cycle, can't leave the block.
+ KIND_HELPER,	// Variable timing, ends a segment.
+ KIND_BRANCH	// Ends the block.
+};
+
+static unsigned ClassifyOp(const uint16 tmpop)
+{
+ if((tmpop >> 13) == 0x4)
+  return((((tmpop >> 9) & 0xF) == COND_F) ? KIND_INLINE : KIND_BRANCH);
+
+ switch(tmpop >> 10)
+ {
+  case MOV: case ADD: case SUB: case CMP: case SHL: case SHR: case SAR:
+  case OR: case AND: case XOR: case NOT:
+  case MOV_I: case ADD_I: case SETF: case CMP_I: case SHL_I: case SHR_I: case SAR_I:
+  case MOVEA: case ADDI: case ORI: case ANDI: case XORI: case MOVHI:
+	return(KIND_INLINE);
+
+  case MUL: case MULU:
+  case LD_B: case LD_H: case LD_W: case ST_B: case ST_H: case ST_W:
+  case IN_B: case IN_H: case IN_W: case OUT_B: case OUT_H: case OUT_W:
+	return(KIND_HELPER);
+
+  case JMP: case JR: case JAL:
+	return(KIND_BRANCH);
+ }
+
+ return(KIND_NONE);
+}
+
+void *V810_JIT::Compile(uint32 PC)
+{
+ struct
+ {
+  uint32 pc;
+  uint16 tmpop;
+  uint16 tmpop_high;
+  unsigned kind;
+ } insns[MAX_BLOCK_INSNS];
+ unsigned count = 0;
+ uint32 end_pc = PC;
+ Slot *slot;
+
+ if((size_t)(CodeBuffer + CODE_BUFFER_SIZE - CodePtr) < MAX_BLOCK_CODE || (SlotCount + MAX_BLOCK_INSNS + 2) > MAX_SLOTS)
+  Flush();
+
+ if(!(slot = GetSlot(PC, true)))
+  return(NULL);
+
+ uint8 *page = cpu->FastMapPtr(PC) - PC;
+
+ if(cpu->FastMapPtr(PC & ~(V810_FAST_MAP_PSIZE - 1)) == cpu->DummyRegion)
+ {
+  slot->interp = true;
+  return(NULL);
+ }
+
+ //
+ // Decode
+ //
+ while(count < MAX_BLOCK_INSNS)
+ {
+  const uint16 tmpop = LoadU16_LE((uint16 *)&page[end_pc]);
+  const unsigned len = ((tmpop >> 10) >= MOVEA) ? 4 : 2;
+  const unsigned kind = ClassifyOp(tmpop);
+
+  if(((end_pc & (V810_FAST_MAP_PSIZE - 1)) + len) > V810_FAST_MAP_PSIZE)
+   break;
+
+  if(kind == KIND_NONE)
+   break;
+
+  insns[count].pc = end_pc;
+  insns[count].tmpop = tmpop;
+  insns[count].tmpop_high = (len == 4) ? LoadU16_LE((uint16 *)&page[end_pc + 2]) : 0;
+  insns[count].kind = kind;
+  count++;
+
+  end_pc += len;
+
+  if(kind == KIND_BRANCH || (end_pc & (V810_FAST_MAP_PSIZE - 1)) == 0)
+   break;
+ }
+
+ if(!count)
+ {
+  slot->interp = true;
+  return(NULL);
+ }
+
+ //
+ // Emit
+ //
+ if(!ProtectCode(CodePtr, MAX_BLOCK_CODE, true))
+  return(NULL);
+
+ uint8 *const entry = CodePtr;
+ uint32 pending_cycles = 0;
+ int32 lastop_val = 0;
+ bool lastop_stale = false;
+ bool segment_start = true;
+ bool ended = false;
+
+ for(unsigned i = 0; i < count; i++)
+ {
+  const uint32 pc = insns[i].pc;
+  const uint16 tmpop = insns[i].tmpop;
+  const uint16 tmpop_high = insns[i].tmpop_high;
+  const unsigned op = tmpop >> 10;
+
+  if(segment_start)
+  {
+   // Every instruction of the segment must start before next_event_ts; the inline ones all take 1 cycle.
+   unsigned last = i;
+   uint8 *skip;
+
+   while(last < (count - 1) && insns[last].kind == KIND_INLINE)
+    last++;
+
+   if(last != i)
+   {
+    Emit8(0x41); Emit8(0x8D); Emit8(0x84); Emit8(0x24); Emit32(last - i);	// lea eax, [r12 + (last - i)]
+    EmitALUMem(0x3B, REG_EAX, off_next_event_ts);
+   }
+   else
+    EmitALUMem(0x3B, REG_R12, off_next_event_ts);
+
+   skip = EmitJccShort(CC_L);
+   EmitExit(pc | 1);
+   PatchShort(skip);
+
+   segment_start = false;
+  }
+
+  if(insns[i].kind == KIND_HELPER)
+  {
+   const void *func = NULL;
+   uint32 a, b, c;
+   uint8 *skip;
+
+   EmitAddTS(pending_cycles);
+   pending_cycles = 0;
+
+   if(lastop_stale)
+   {
+    EmitStoreImm(off_lastop, lastop_val);
+    lastop_stale = false;
+   }
+
+   if(op == MUL || op == MULU)
+   {
+    a = tmpop & 0x1F;
+    b = (tmpop >> 5) & 0x1F;
+    c = 0;
+   }
+   else if(op == ST_B || op == ST_H || op == ST_W || op == OUT_B || op == OUT_H || op == OUT_W)
+   {
+    a = (tmpop >> 5) & 0x1F;
+    b = tmpop_high;
+    c = tmpop & 0x1F;
+   }
+   else
+   {
+    a = tmpop_high;
+    b = tmpop & 0x1F;
+    c = (tmpop >> 5) & 0x1F;
+   }
+
+   switch(op)
+   {
+    case MUL: func = (const void *)H_MUL; break;
+    case MULU: func = (const void *)H_MULU; break;
+    case LD_B: func = (const void *)H_LD_B; break;
+    case LD_H: func = (const void *)H_LD_H; break;
+    case LD_W: func = (const void *)H_LD_W; break;
+    case ST_B: func = (const void *)H_ST_B; break;
+    case ST_H: func = (const void *)H_ST_H; break;
+    case ST_W: func = (const void *)H_ST_W; break;
+    case IN_B: func = (const void *)H_IN_B; break;
+    case IN_H: func = (const void *)H_IN_H; break;
+    case IN_W: func = (const void *)H_IN_W; break;
+    case OUT_B: func = (const void *)H_OUT_B; break;
+    case OUT_H: func = (const void *)H_OUT_H; break;
+    case OUT_W: func = (const void *)H_OUT_W; break;
+   }
+
+   EmitStore(off_timestamp, REG_R12);
+   EmitCall(func, a, b, c);
+   EmitLoad(REG_R12, off_timestamp);
+
+   // Interrupt now pending, or code invalidated?
+   Emit8(0x85); Emit8(0xC0);		// test eax, eax
+   skip = EmitJccShort(CC_Z);
+   EmitExit(pc + ((op >= MOVEA) ? 4 : 2));
+   PatchShort(skip);
+
+   segment_start = true;
+   continue;
+  }
+
+  if(insns[i].kind == KIND_BRANCH)
+  {
+   lastop_val = tmpop >> 9;
+   lastop_stale = true;
+
+   if(op == JMP)
+   {
+    EmitAddTS(pending_cycles + 3);
+    EmitStoreImm(off_lastop, lastop_val);
+    EmitLoadPREG(REG_EAX, tmpop & 0x1F);
+    Emit8(0x83); Emit8(0xE0); Emit8(0xFE);	// and eax, ~1
+    EmitJmp(ExitThunk);
+   }
+   else if(op == JR || op == JAL)
+   {
+    const uint32 target = pc + (sign_26(((tmpop & 0x3FF) << 16) | tmpop_high) & 0xFFFFFFFE);
+
+    if(op == JAL)
+     EmitStoreImm(off_PREG + 31 * 4, pc + 4);
+
+    EmitAddTS(pending_cycles + 3);
+    EmitStoreImm(off_lastop, lastop_val);
+    EmitChain(target);
+   }
+   else
+   {
+    const unsigned cond = (tmpop >> 9) & 0xF;
+    const uint32 target = pc + (sign_9(tmpop & 0x1FE) & 0xFFFFFFFE);
+
+    EmitStoreImm(off_lastop, lastop_val);
+
+    if(cond == COND_T)
+    {
+     EmitAddTS(pending_cycles + 3);
+     EmitChain(target);
+    }
+    else
+    {
+     uint8 *taken;
+
+     EmitAddTS(pending_cycles);
+     EmitLoad(REG_EAX, off_PSW);
+     Emit8(0x83); Emit8(0xE0); Emit8(0x0F);	// and eax, 0xF
+     Emit8(0x41); Emit8(0x0F); Emit8(0xB6); Emit8(0x84); Emit8(0x05); Emit32(cond * 16);	// movzx eax, byte [r13 + rax + cond * 16]
+     Emit8(0x85); Emit8(0xC0);		// test eax, eax
+     taken = EmitJccShort(CC_NZ);
+     EmitAddTS(1);
+     EmitChain(pc + 2);
+     PatchShort(taken);
+     EmitAddTS(3);
+     EmitChain(target);
+    }
+   }
+   ended = true;
+   break;
+  }
+
+  //
+  // Inline
+  //
+  const unsigned arg1 = tmpop & 0x1F;
+  const unsigned arg2 = (tmpop >> 5) & 0x1F;
+
+  pending_cycles++;
+  lastop_val = tmpop >> 9;
+  lastop_stale = true;
+
+  if((tmpop >> 13) == 0x4)	// NOP
+   continue;
+
+  switch(op)
+  {
+   case MOV:
+	EmitLoadPREG(REG_EDX, arg1);
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case ADD:
+   case SUB:
+   case CMP:
+	EmitLoadPREG(REG_EDX, arg2);
+	if(arg1)
+	 EmitALUMem((op == ADD) ? 0x03 : ((op == SUB) ? 0x2B : 0x3B), REG_EDX, off_PREG + arg1 * 4);
+	else
+	 EmitALUImm((op == ADD) ? 0 : ((op == SUB) ? 5 : 7), REG_EDX, 0);
+	EmitFlagsFull();
+	if(op != CMP)
+	 EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case SHL:
+   case SHR:
+   case SAR:
+	EmitLoadPREG(REG_EDX, arg2);
+	if(arg1)
+	{
+	 uint8 *zero, *done;
+
+	 EmitLoad(REG_ECX, off_PREG + arg1 * 4);
+	 Emit8(0x83); Emit8(0xE1); Emit8(0x1F);	// and ecx, 0x1F
+	 zero = EmitJccShort(CC_Z);
+	 Emit8(0xD3); Emit8((op == SHL) ? 0xE2 : ((op == SHR) ? 0xEA : 0xFA));	// shl/shr/sar edx, cl
+	 Emit8(0xEB); Emit8(0x00);			// jmp done
+	 done = CodePtr - 1;
+	 PatchShort(zero);
+	 Emit8(0x85); Emit8(0xD2);			// test edx, edx
+	 PatchShort(done);
+	}
+	else
+	{
+	 Emit8(0x85); Emit8(0xD2);			// test edx, edx
+	}
+	EmitFlagsSZCY();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case OR:
+   case AND:
+   case XOR:
+	EmitLoadPREG(REG_EDX, arg2);
+	if(arg1)
+	 EmitALUMem((op == OR) ? 0x0B : ((op == AND) ? 0x23 : 0x33), REG_EDX, off_PREG + arg1 * 4);
+	else
+	 EmitALUImm((op == OR) ? 1 : ((op == AND) ? 4 : 6), REG_EDX, 0);
+	EmitFlagsSZ();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case NOT:
+	EmitLoadPREG(REG_EDX, arg1);
+	Emit8(0xF7); Emit8(0xD2);			// not edx
+	Emit8(0x85); Emit8(0xD2);			// test edx, edx
+	EmitFlagsSZ();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case MOV_I:
+	if(arg2)
+	 EmitStoreImm(off_PREG + arg2 * 4, sign_5(arg1));
+	break;
+
+   case ADD_I:
+   case CMP_I:
+	EmitLoadPREG(REG_EDX, arg2);
+	EmitALUImm((op == ADD_I) ? 0 : 7, REG_EDX, sign_5(arg1));
+	EmitFlagsFull();
+	if(op == ADD_I)
+	 EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case SETF:
+	if(arg2)
+	{
+	 EmitLoad(REG_EAX, off_PSW);
+	 Emit8(0x83); Emit8(0xE0); Emit8(0x0F);	// and eax, 0xF
+	 Emit8(0x41); Emit8(0x0F); Emit8(0xB6); Emit8(0x84); Emit8(0x05); Emit32((arg1 & 0xF) * 16);	// movzx eax, byte [r13 + rax + cond * 16]
+	 EmitStorePREG(arg2, REG_EAX);
+	}
+	break;
+
+   case SHL_I:
+   case SHR_I:
+   case SAR_I:
+	EmitLoadPREG(REG_EDX, arg2);
+	if(arg1)
+	{
+	 Emit8(0xC1); Emit8((op == SHL_I) ? 0xE2 : ((op == SHR_I) ? 0xEA : 0xFA)); Emit8(arg1);	// shl/shr/sar edx, arg1
+	}
+	else
+	{
+	 Emit8(0x85); Emit8(0xD2);			// test edx, edx
+	}
+	EmitFlagsSZCY();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   //
+   // Format V: arg1 = imm16, reg2 = tmpop & 0x1F(source), reg3 = (tmpop >> 5) & 0x1F(destination)
+   //
+   case MOVEA:
+	if(arg2)
+	{
+	 EmitLoadPREG(REG_EDX, arg1);
+	 EmitALUImm(0, REG_EDX, sign_16(tmpop_high));
+	 EmitStorePREG(arg2, REG_EDX);
+	}
+	break;
+
+   case ADDI:
+	EmitLoadPREG(REG_EDX, arg1);
+	EmitALUImm(0, REG_EDX, sign_16(tmpop_high));
+	EmitFlagsFull();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case ORI:
+   case ANDI:
+   case XORI:
+	EmitLoadPREG(REG_EDX, arg1);
+	EmitALUImm((op == ORI) ? 1 : ((op == ANDI) ? 4 : 6), REG_EDX, tmpop_high);
+	EmitFlagsSZ();
+	EmitStorePREG(arg2, REG_EDX);
+	break;
+
+   case MOVHI:
+	if(arg2)
+	{
+	 EmitLoadPREG(REG_EDX, arg1);
+	 EmitALUImm(0, REG_EDX, (uint32)tmpop_high << 16);
+	 EmitStorePREG(arg2, REG_EDX);
+	}
+	break;
+  }
+ }
+
+ if(!ended)
+ {
+  EmitAddTS(pending_cycles);
+
+  if(lastop_stale)
+   EmitStoreImm(off_lastop, lastop_val);
+
+  EmitChain(end_pc);
+ }
+
+ assert((size_t)(CodePtr - entry) <= MAX_BLOCK_CODE);
+
+ if(!ProtectCode(entry, MAX_BLOCK_CODE, false))
+  abort();
+
+ //
+ // Register
+ //
+ Block b;
+
+ b.start = PC;
+ b.last = end_pc - 1;
+ b.slot = slot - Slots;
+ b.valid = true;
+ b.hash = HashCode(page + PC, end_pc - PC);
+
+ Blocks.push_back(b);
+ RegionBlocks[PC >> 20].push_back(Blocks.size() - 1);
+ MarkCode(PC, end_pc - 1);
+
+ slot->code = entry;
+
+ return(entry);
+}
+
+//
+// Run loop; the interpreter handles interrupts, the bitstring instructions and everything else that isn't translated.
+//
+void V810::Run_JIT(int32 MDFN_FASTCALL (*event_handler)(const v810_timestamp_t timestamp))
+{
+ while(Running)
+ {
+  assert(v810_timestamp <= next_event_ts);
+
+  if(!IPendingCache && Halted)
+   v810_timestamp = next_event_ts;
+
+  while(v810_timestamp < next_event_ts)
+  {
+   void *code;
+
+   if(IPendingCache || in_bstr || !(code = JIT->GetBlock(GetPC())))
+   {
+    Step_Fast(event_handler);
+    continue;
+   }
+
+   const uint32 next_pc = JIT->Execute(code);
+
+   SetPC(next_pc &~ 1);
+
+   // An event falls inside of the block; let the interpreter walk up to it.
+   if(next_pc & 1)
+   {
+    while(v810_timestamp < next_event_ts)
+     Step_Fast(event_handler);
+   }
+  }
+  next_event_ts = event_handler(v810_timestamp);
+ }
+}
+
+#endif
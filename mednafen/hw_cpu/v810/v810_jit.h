@@ -0,0 +1,185 @@
+/* V810 Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+////////////////////////////////////////////////////////////////
+// x86-64 dynamic recompiler for the V810 fast mode
+
+#ifndef V810_JIT_H_
+#define V810_JIT_H_
+
+#include "v810_cpu.h"
+
+#ifdef V810_HAVE_JIT
+
+#include "../../mednafen-endian.h"
+
+#include <map>
+#include <vector>
+
+class V810_JIT
+{
+ public:
+
+ V810_JIT(V810 *c);
+ ~V810_JIT();
+
+ // Returns false if executable memory couldn't be allocated.
+ bool Init(void);
+
+ // Throws away all translated code.  Must not be called while a translated block is executing.
+ void Flush(void);
+
+ // Unlinks every block overlapping [A, A + length).  Safe to call from inside a translated block(the host code
+ // stays allocated until the next Flush()).
+ void Invalidate(uint32 A, uint32 length);
+
+ // Unlinks every block whose V810 code in a writable region no longer matches what it was translated from.
+ void Revalidate(void);
+
+ // Returns true if the 64-byte line containing A has translated code in it.
+ INLINE bool IsCode(uint32 A) const
+ {
+  const uint8 *lm = LineMap[A >> 20];
+
+  return(lm && ((lm[(A >> 9) & 0x7FF] >> ((A >> 6) & 0x7)) & 1));
+ }
+
+ // Invalidates if needed, returns true if something was invalidated.
+ INLINE bool CheckWrite(uint32 A, uint32 length)
+ {
+  if(MDFN_LIKELY(!IsCode(A) && !IsCode(A + length - 1)))
+   return(false);
+
+  Invalidate(A, length);
+  return(true);
+ }
+
+ // Returns NULL if the instruction at PC has to be run by the interpreter.
+ void *GetBlock(uint32 PC);
+
+ // Runs translated code until a block exits; returns the PC to continue at, with bit 0 set if the interpreter
+ // has to take over until next_event_ts because an event falls inside the block.
+ INLINE uint32 Execute(void *code)
+ {
+  return(EnterThunk(cpu, code));
+ }
+
+ private:
+
+ struct Slot
+ {
+  void *code;	// Always executable: either a block or UnresolvedStub.  Must stay at offset 0.
+  uint32 pc;	// Must stay at offset 8.
+  bool interp;	// First instruction isn't translatable.
+ };
+
+ struct Block
+ {
+  uint32 start;
+  uint32 last;	// Inclusive, a block can end at 0xFFFFFFFF.
+  uint32 slot;
+  bool valid;
+  uint64 hash;	// Of the V810 code, see HashCode().
+ };
+
+ enum
+ {
+  CODE_BUFFER_SIZE = 8 * 1024 * 1024,
+  MAX_BLOCK_INSNS = 64,
+  MAX_BLOCK_CODE = MAX_BLOCK_INSNS * 160 + 256,
+  MAX_SLOTS = 65536,
+  SLOT_HASH_SIZE = 131072
+ };
+
+ // The code buffer is never writable and executable at the same time; this flips the pages of [start, start + length)
+ // between read/write and read/execute.
+ bool ProtectCode(uint8 *start, size_t length, bool writable);
+
+ Slot *GetSlot(uint32 PC, bool create);
+ void *Compile(uint32 PC);
+ void MarkCode(uint32 start, uint32 last);
+ static uint64 HashCode(const uint8 *p, uint32 length);
+
+ // Emitter
+ void Emit8(uint8 v) { *CodePtr++ = v; }
+ void Emit32(uint32 v) { MDFN_en32lsb(CodePtr, v); CodePtr += 4; }
+ void Emit64(uint64 v) { Emit32(v); Emit32(v >> 32); }
+ void EmitMem(unsigned reg, int32 disp);
+ void EmitLoad(unsigned reg, int32 disp);
+ void EmitStore(int32 disp, unsigned reg);
+ void EmitStoreImm(int32 disp, uint32 imm);
+ void EmitALUMem(uint8 opc, unsigned reg, int32 disp);
+ void EmitALUImm(unsigned digit, unsigned reg, uint32 imm);
+ void EmitLoadPREG(unsigned reg, unsigned which);
+ void EmitStorePREG(unsigned which, unsigned reg);
+ void EmitAddTS(uint32 cycles);
+ void EmitFlagsFull(void);
+ void EmitFlagsSZCY(void);
+ void EmitFlagsSZ(void);
+ void EmitJmp(const uint8 *target);
+ void EmitExit(uint32 next_pc);
+ void EmitChain(uint32 next_pc);
+ void EmitCall(const void *func, uint32 a, uint32 b, uint32 c);
+ uint8 *EmitJccShort(uint8 cc);
+ void PatchShort(uint8 *at);
+
+ V810 *cpu;
+
+ uint8 *CodeBuffer;
+ uint8 *CodePtr;
+ uint8 *CodeBlocksStart;
+
+ uint32 (*EnterThunk)(V810 *c, void *code);
+ uint8 *ExitThunk;
+ uint8 *UnresolvedStub;
+
+ Slot *Slots;
+ uint32 SlotCount;
+ uint32 *SlotHash;
+
+ std::vector<Block> Blocks;
+ std::map<uint32, std::vector<uint32> > RegionBlocks;	// Keyed by A >> 20
+ uint8 *LineMap[4096];
+
+ int32 off_PREG;
+ int32 off_PSW;
+ int32 off_timestamp;
+ int32 off_next_event_ts;
+ int32 off_lastop;
+
+ uint8 CondTable[16 * 16];	// [cond][PSW & 0xF]
+
+ // Helpers called from translated code; they return non-zero if the block has to be exited afterwards.
+ static uint32 H_LD_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_LD_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_LD_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_ST_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_ST_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_ST_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_IN_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_IN_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_IN_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_OUT_B(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_OUT_H(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_OUT_W(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_MUL(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+ static uint32 H_MULU(V810 *c, uint32 arg1, uint32 arg2, uint32 arg3);
+};
+
+#endif
+
+#endif
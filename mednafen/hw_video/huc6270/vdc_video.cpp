@@ -53,23 +53,35 @@ static const unsigned int bat_width_tab[4] = { 32, 64, 128, 128 };
 static const unsigned int bat_width_shift_tab[4] = { 5, 6, 7, 7 };
 static const unsigned int bat_height_tab[2] = { 32, 64 };
 
+// Multiplying a byte by 0x8040201008040201 puts its bit 7 - i at the top of byte i of the product, without carries; the
+// bytes are ordered as in memory on little-endian hosts.
+static INLINE uint64 SpreadTileBits(uint32 b)
+{
+ uint64 ret = (((uint64)b * 0x8040201008040201ULL) >> 7) & 0x0101010101010101ULL;
+
+#ifdef MSB_FIRST
+ ret = ((ret & 0x00FF00FF00FF00FFULL) << 8) | ((ret >> 8) & 0x00FF00FF00FF00FFULL);
+ ret = ((ret & 0x0000FFFF0000FFFFULL) << 16) | ((ret >> 16) & 0x0000FFFF0000FFFFULL);
+ ret = (ret << 32) | (ret >> 32);
+#endif
+
+ return(ret);
+}
+
+// One row of bg_tile_cache, its eight 4-bit pixels left to right, from the row's two bitplane words.  Different words
+// always give a different row, so the cache doubles as the record of what VRAM it was built from; see StateAction().
+static INLINE uint64 TileRowPixels(uint32 bitplane01, uint32 bitplane23)
+{
+ return(SpreadTileBits(bitplane01 & 0xFF) | (SpreadTileBits(bitplane01 >> 8) << 1) |
+	(SpreadTileBits(bitplane23 & 0xFF) << 2) | (SpreadTileBits(bitplane23 >> 8) << 3));
+}
+
 void VDC::FixTileCache(uint16 A)
 {
  uint32 charname = (A >> 4);
  uint32 y = (A & 0x7);
- uint8 *tc = bg_tile_cache[charname][y];
-
- uint32 bitplane01 = VRAM[y + charname * 16];
- uint32 bitplane23 = VRAM[y+ 8 + charname * 16];
 
- for(int x = 0; x < 8; x++)
- {
-  uint32 raw_pixel = ((bitplane01 >> x) & 1);
-  raw_pixel |= ((bitplane01 >> (x + 8)) & 1) << 1;
-  raw_pixel |= ((bitplane23 >> x) & 1) << 2;
-  raw_pixel |= ((bitplane23 >> (x + 8)) & 1) << 3;
-  tc[7 - x] = raw_pixel;
- }
+ bg_tile_cache64[charname][y] = TileRowPixels(VRAM[y + charname * 16], VRAM[y + 8 + charname * 16]);
 }
 
 // Some virtual vdc macros to make code simpler to read
@@ -1635,8 +1647,8 @@ int32 VDC::Reset(void)
  memset(SAT, 0, sizeof(SAT));
  memset(SpriteList, 0, sizeof(SpriteList));
 
- for(uint32 A = 0; A < 65536; A += 16)
-  FixTileCache(A);
+ // All-zero VRAM decodes to all-zero tiles.
+ memset(bg_tile_cache64, 0, sizeof(bg_tile_cache64));
 
  pending_read = false;
  pending_read_addr = 0xFFFF;
@@ -1875,8 +1887,18 @@ int VDC::StateAction(StateMem *sm, int load, int data_only, const char *sname)
   {
    StateExtra(sl_packer, true);
 
-   for(int x = 0; x < VRAM_Size; x++)
-    FixTileCache(x);
+   // The tile cache is kept up to date as VRAM is written, so after a load only the rows that changed need storing;
+   // run-ahead loads a state every frame, and it's usually only a frame old.
+   for(uint32 charname = 0; charname < VRAM_Size / 16; charname++)
+   {
+    for(uint32 y = 0; y < 8; y++)
+    {
+     const uint64 row = TileRowPixels(VRAM[y + charname * 16], VRAM[y + 8 + charname * 16]);
+
+     if(bg_tile_cache64[charname][y] != row)
+      bg_tile_cache64[charname][y] = row;
+    }
+   }
   }
 
  return(ret);
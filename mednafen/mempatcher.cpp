@@ -30,10 +30,6 @@
 #include "msvc_compat.h"
 #endif
 
-static uint8 **RAMPtrs = NULL;
-static uint32 PageSize;
-static uint32 NumPages;
-
 typedef struct __CHEATF
 {
    char *name;
@@ -50,26 +46,55 @@ typedef struct __CHEATF
    int status;
 } CHEATF;
 
-static std::vector<CHEATF> cheats;
-static int savecheats;
-static uint32 resultsbytelen = 1;
-static bool resultsbigendian = 0;
-static bool CheatsActive = TRUE;
+struct mdfnmp_t
+{
+   uint8 **RAMPtrs;
+   uint32 PageSize;
+   uint32 NumPages;
+
+   std::vector<CHEATF> cheats;
+   int savecheats;
+   uint32 resultsbytelen;
+   bool resultsbigendian;
+   bool CheatsActive;
+
+   bool SubCheatsOn;
+   std::vector<SUBCHEAT> SubCheats[8];
+};
+
+static mdfnmp_t *mdfnmp = NULL;
+
+mdfnmp_t *MDFNMP_NewContext(void)
+{
+   mdfnmp_t *ctx = new mdfnmp_t();
+
+   ctx->resultsbytelen = 1;
+   ctx->CheatsActive = TRUE;
 
-bool SubCheatsOn = 0;
-std::vector<SUBCHEAT> SubCheats[8];
+   return ctx;
+}
+
+void MDFNMP_DeleteContext(mdfnmp_t *ctx)
+{
+   delete ctx;
+}
+
+void MDFNMP_SetContext(mdfnmp_t *ctx)
+{
+   mdfnmp = ctx;
+}
 
 static void RebuildSubCheats(void)
 {
  std::vector<CHEATF>::iterator chit;
 
- SubCheatsOn = 0;
+ mdfnmp->SubCheatsOn = 0;
  for(int x = 0; x < 8; x++)
-  SubCheats[x].clear();
+  mdfnmp->SubCheats[x].clear();
 
- if(!CheatsActive) return;
+ if(!mdfnmp->CheatsActive) return;
 
- for(chit = cheats.begin(); chit != cheats.end(); chit++)
+ for(chit = mdfnmp->cheats.begin(); chit != mdfnmp->cheats.end(); chit++)
  {
   if(chit->status && chit->type != 'R')
   {
@@ -89,8 +114,8 @@ static void RebuildSubCheats(void)
      tmpsub.compare = (chit->compare >> shiftie) & 0xFF;
     else
      tmpsub.compare = -1;
-    SubCheats[(chit->addr + x) & 0x7].push_back(tmpsub);
-    SubCheatsOn = 1;
+    mdfnmp->SubCheats[(chit->addr + x) & 0x7].push_back(tmpsub);
+    mdfnmp->SubCheatsOn = 1;
    }
   }
  }
@@ -98,48 +123,48 @@ static void RebuildSubCheats(void)
 
 bool MDFNMP_Init(uint32 ps, uint32 numpages)
 {
-   PageSize = ps;
-   NumPages = numpages;
+   mdfnmp->PageSize = ps;
+   mdfnmp->NumPages = numpages;
 
-   RAMPtrs = (uint8 **)calloc(numpages, sizeof(uint8 *));
+   mdfnmp->RAMPtrs = (uint8 **)calloc(numpages, sizeof(uint8 *));
 
-   CheatsActive = MDFN_GetSettingB("cheats");
+   mdfnmp->CheatsActive = MDFN_GetSettingB("cheats");
    return(1);
 }
 
 void MDFNMP_Kill(void)
 {
-   if(RAMPtrs)
+   if(mdfnmp->RAMPtrs)
    {
-      free(RAMPtrs);
-      RAMPtrs = NULL;
+      free(mdfnmp->RAMPtrs);
+      mdfnmp->RAMPtrs = NULL;
    }
 }
 
 
 void MDFNMP_AddRAM(uint32 size, uint32 A, uint8 *RAM)
 {
- uint32 AB = A / PageSize;
+ uint32 AB = A / mdfnmp->PageSize;
  
- size /= PageSize;
+ size /= mdfnmp->PageSize;
 
  for(unsigned int x = 0; x < size; x++)
  {
-  RAMPtrs[AB + x] = RAM;
+  mdfnmp->RAMPtrs[AB + x] = RAM;
   if(RAM) // Don't increment the RAM pointer if we're passed a NULL pointer
-   RAM += PageSize;
+   RAM += mdfnmp->PageSize;
  }
 }
 
 void MDFNMP_InstallReadPatches(void)
 {
- if(!CheatsActive) return;
+ if(!mdfnmp->CheatsActive) return;
 
  std::vector<SUBCHEAT>::iterator chit;
 
 #if 0
  for(unsigned int x = 0; x < 8; x++)
-  for(chit = SubCheats[x].begin(); chit != SubCheats[x].end(); chit++)
+  for(chit = mdfnmp->SubCheats[x].begin(); chit != mdfnmp->SubCheats[x].end(); chit++)
   {
    if(MDFNGameInfo->InstallReadPatch)
     MDFNGameInfo->InstallReadPatch(chit->addr);
@@ -177,7 +202,7 @@ static int AddCheatEntry(char *name, char *conditions, uint32 addr, uint64 val,
  temp.bigendian = bigendian;
  temp.type=type;
 
- cheats.push_back(temp);
+ mdfnmp->cheats.push_back(temp);
  return(1);
 }
 
@@ -190,13 +215,13 @@ void MDFN_FlushGameCheats(int nosave)
 {
    std::vector<CHEATF>::iterator chit;
 
-   for(chit = cheats.begin(); chit != cheats.end(); chit++)
+   for(chit = mdfnmp->cheats.begin(); chit != mdfnmp->cheats.end(); chit++)
    {
       free(chit->name);
       if(chit->conditions)
          free(chit->conditions);
    }
-   cheats.clear();
+   mdfnmp->cheats.clear();
    RebuildSubCheats();
 }
 
@@ -216,7 +241,7 @@ int MDFNI_AddCheat(const char *name, uint32 addr, uint64 val, uint64 compare, ch
   return(0);
  }
 
- savecheats = 1;
+ mdfnmp->savecheats = 1;
 
  MDFNMP_RemoveReadPatches();
  RebuildSubCheats();
@@ -227,10 +252,10 @@ int MDFNI_AddCheat(const char *name, uint32 addr, uint64 val, uint64 compare, ch
 
 int MDFNI_DelCheat(uint32 which)
 {
- free(cheats[which].name);
- cheats.erase(cheats.begin() + which);
+ free(mdfnmp->cheats[which].name);
+ mdfnmp->cheats.erase(mdfnmp->cheats.begin() + which);
 
- savecheats=1;
+ mdfnmp->savecheats=1;
 
  MDFNMP_RemoveReadPatches();
  RebuildSubCheats();
@@ -390,20 +415,20 @@ void MDFNMP_ApplyPeriodicCheats(void)
  std::vector<CHEATF>::iterator chit;
 
 
- if(!CheatsActive)
+ if(!mdfnmp->CheatsActive)
   return;
 
  //TestConditions("2 L 0x1F00F5 == 0xDEAD");
  //if(TestConditions("1 L 0x1F0058 > 0")) //, 1 L 0xC000 == 0x01"));
- for(chit = cheats.begin(); chit != cheats.end(); chit++)
+ for(chit = mdfnmp->cheats.begin(); chit != mdfnmp->cheats.end(); chit++)
  {
   if(chit->status && chit->type == 'R')
   {
    if(!chit->conditions || TestConditions(chit->conditions))
     for(unsigned int x = 0; x < chit->length; x++)
     {
-     uint32 page = ((chit->addr + x) / PageSize) % NumPages;
-     if(RAMPtrs[page])
+     uint32 page = ((chit->addr + x) / mdfnmp->PageSize) % mdfnmp->NumPages;
+     if(mdfnmp->RAMPtrs[page])
      {
       uint64 tmpval = chit->val;
 
@@ -412,7 +437,7 @@ void MDFNMP_ApplyPeriodicCheats(void)
       else
        tmpval >>= x * 8;
 
-      RAMPtrs[page][(chit->addr + x) % PageSize] = tmpval;
+      mdfnmp->RAMPtrs[page][(chit->addr + x) % mdfnmp->PageSize] = tmpval;
      }
    }
   }
@@ -424,7 +449,7 @@ void MDFNI_ListCheats(int (*callb)(char *name, uint32 a, uint64 v, uint64 compar
 {
  std::vector<CHEATF>::iterator chit;
 
- for(chit = cheats.begin(); chit != cheats.end(); chit++)
+ for(chit = mdfnmp->cheats.begin(); chit != mdfnmp->cheats.end(); chit++)
  {
   if(!callb(chit->name, chit->addr, chit->val, chit->compare, chit->status, chit->type, chit->length, chit->bigendian, data)) break;
  }
@@ -432,7 +457,7 @@ void MDFNI_ListCheats(int (*callb)(char *name, uint32 a, uint64 v, uint64 compar
 
 int MDFNI_GetCheat(uint32 which, char **name, uint32 *a, uint64 *v, uint64 *compare, int *s, char *type, unsigned int *length, bool *bigendian)
 {
- CHEATF *next = &cheats[which];
+ CHEATF *next = &mdfnmp->cheats[which];
 
  if(name)
   *name=next->name;
@@ -622,7 +647,7 @@ int MDFNI_DecodePAR(const char *str, uint32 *a, uint8 *v, uint8 *c, char *type)
 /* name can be NULL if the name isn't going to be changed. */
 int MDFNI_SetCheat(uint32 which, const char *name, uint32 a, uint64 v, uint64 compare, int s, char type, unsigned int length, bool bigendian)
 {
- CHEATF *next = &cheats[which];
+ CHEATF *next = &mdfnmp->cheats[which];
 
  if(name)
  {
@@ -645,7 +670,7 @@ int MDFNI_SetCheat(uint32 which, const char *name, uint32 a, uint64 v, uint64 co
  next->bigendian = bigendian;
 
  RebuildSubCheats();
- savecheats=1;
+ mdfnmp->savecheats=1;
 
  return(1);
 }
@@ -653,9 +678,9 @@ int MDFNI_SetCheat(uint32 which, const char *name, uint32 a, uint64 v, uint64 co
 /* Convenience function. */
 int MDFNI_ToggleCheat(uint32 which)
 {
- cheats[which].status = !cheats[which].status;
- savecheats = 1;
+ mdfnmp->cheats[which].status = !mdfnmp->cheats[which].status;
+ mdfnmp->savecheats = 1;
  RebuildSubCheats();
 
- return(cheats[which].status);
+ return(mdfnmp->cheats[which].status);
 }
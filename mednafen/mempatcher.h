@@ -10,8 +10,6 @@ typedef struct __SUBCHEAT
 	int compare; // < 0 on no compare
 } SUBCHEAT;
 
-extern bool SubCheatsOn;
-
 bool MDFNMP_Init(uint32 ps, uint32 numpages);
 void MDFNMP_AddRAM(uint32 size, uint32 address, uint8 *RAM);
 void MDFNMP_Kill(void);
@@ -22,4 +20,10 @@ void MDFNMP_RemoveReadPatches(void);
 
 void MDFNMP_ApplyPeriodicCheats(void);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct mdfnmp_t;
+mdfnmp_t *MDFNMP_NewContext(void);
+void MDFNMP_DeleteContext(mdfnmp_t *ctx);
+void MDFNMP_SetContext(mdfnmp_t *ctx);
+
 #endif
@@ -62,40 +62,46 @@ enum
    INT_FSY = 1, // Frame sync
 };
 
-static uint16 FIFO[0x20];
-static uint8 InFIFO;
-#define AFW (0x20 - InFIFO)
+struct huc6273_t
+{
+   uint16 FIFO[0x20];
+   uint8 InFIFO;
+
+   uint16 FIFOControl; // 0x00004
 
-#define AEMPWD ((FIFOControl >> 4) & 0xFF)
-#define AFLWD (FIFOControl & 0xF)
-static uint16 FIFOControl; // 0x00004
+   uint8 CMTBankSelect;
+   uint16 CMTStartAddress;
+   uint16 CMTByteCount;
 
-static uint8 CMTBankSelect;
-static uint16 CMTStartAddress;
-static uint16 CMTByteCount;
+   uint16 InterruptMask;
+   uint16 InterruptStatus;
 
-static uint16 InterruptMask;
-static uint16 InterruptStatus;
+   uint16 ReadBack;
 
-static uint16 ReadBack;
+   uint16 HorizontalTiming, VerticalTiming;
 
-static uint16 HorizontalTiming, VerticalTiming;
+   uint16 SCTAddressHi;
+   uint16 SpriteControl;
+   uint16 CDResult[2];
+   uint16 SPWindowX[2]; // left and right
+   uint16 SPWindowY[2]; // top and bottom
+   uint16 MiscStatus;
+   uint16 ErrorStatus; // Read only!
+   uint16 DisplayControl;
+   uint16 StatusControl;
+   uint16 Config;
 
-static uint16 SCTAddressHi;
-static uint16 SpriteControl;
-static uint16 CDResult[2];
-static uint16 SPWindowX[2]; // left and right
-static uint16 SPWindowY[2]; // top and bottom
-static uint16 MiscStatus;
-static uint16 ErrorStatus; // Read only!
-static uint16 DisplayControl;
-static uint16 StatusControl;
-static uint16 Config;
+   uint16 RasterHit;
+
+   uint16 Results[0x10];
+};
 
-static uint16 RasterHit;
+static huc6273_t *huc6273 = NULL;
 
+#define AFW (0x20 - huc6273->InFIFO)
 
-static uint16 Results[0x10];
+#define AEMPWD ((huc6273->FIFOControl >> 4) & 0xFF)
+#define AFLWD (huc6273->FIFOControl & 0xF)
 
 static void CheckIRQ(void)
 {
@@ -104,7 +110,7 @@ static void CheckIRQ(void)
 
 static void ProcessFIFO(void)
 {
-   uint8 length = FIFO[0] & 0xFF;
+   uint8 length = huc6273->FIFO[0] & 0xFF;
 
    if(length > 0x20) 
    {
@@ -112,16 +118,16 @@ static void ProcessFIFO(void)
       puts("Length too long");
    }
 
-   if(InFIFO >= length)
+   if(huc6273->InFIFO >= length)
    {
-      int opcode = FIFO[0] >> 12;
-      int option = (FIFO[0] >> 8) & 0x0F;
+      int opcode = huc6273->FIFO[0] >> 12;
+      int option = (huc6273->FIFO[0] >> 8) & 0x0F;
 
       printf("Op: %02x, option: %02x\n", opcode, option);
 
-      InFIFO -= length;
-      for(int i = 0; i < InFIFO; i++)
-         FIFO[i] = FIFO[length + i];
+      huc6273->InFIFO -= length;
+      for(int i = 0; i < huc6273->InFIFO; i++)
+         huc6273->FIFO[i] = huc6273->FIFO[length + i];
    }
 }
 
@@ -130,8 +136,8 @@ static void StoreInFIFO(uint16 V)
 {
    if(AFW > 0)
    {
-      FIFO[InFIFO] = V;
-      InFIFO++;
+      huc6273->FIFO[huc6273->InFIFO] = V;
+      huc6273->InFIFO++;
 
       ProcessFIFO();
    }
@@ -155,52 +161,52 @@ uint16 HuC6273_Read16(uint32 A)
       case 0x00002:
          return(AFW); // Command FIFO status
       case 0x00004:
-         return(FIFOControl);
+         return(huc6273->FIFOControl);
       case 0x00006:
-         return(CMTBankSelect);
+         return(huc6273->CMTBankSelect);
       case 0x00008:
-         return(CMTStartAddress);
+         return(huc6273->CMTStartAddress);
       case 0x0000A:
-         return(CMTByteCount);
+         return(huc6273->CMTByteCount);
       case 0x0000C:
-         return(InterruptMask);
+         return(huc6273->InterruptMask);
       case 0x0000E:
          return(0);
       case 0x00010:
-         return(InterruptStatus);
+         return(huc6273->InterruptStatus);
       case 0x00012:
-         return(ReadBack);
+         return(huc6273->ReadBack);
       case 0x00014:
-         return(HorizontalTiming);
+         return(huc6273->HorizontalTiming);
       case 0x00016:
-         return(VerticalTiming);
+         return(huc6273->VerticalTiming);
       case 0x00018:
-         return(SCTAddressHi);
+         return(huc6273->SCTAddressHi);
       case 0x0001A:
-         return(SpriteControl);
+         return(huc6273->SpriteControl);
       case 0x0001C:
-         return(CDResult[0]);
+         return(huc6273->CDResult[0]);
       case 0x0001E:
-         return(CDResult[1]);
+         return(huc6273->CDResult[1]);
       case 0x00020:
-         return(SPWindowX[0]);
+         return(huc6273->SPWindowX[0]);
       case 0x00022:
-         return(SPWindowY[0]);
+         return(huc6273->SPWindowY[0]);
       case 0x00024:
-         return(SPWindowX[1]);
+         return(huc6273->SPWindowX[1]);
       case 0x00026:
-         return(SPWindowY[1]);
+         return(huc6273->SPWindowY[1]);
       case 0x00028:
-         return(MiscStatus);
+         return(huc6273->MiscStatus);
       case 0x0002A:
-         return(ErrorStatus);
+         return(huc6273->ErrorStatus);
       case 0x0002C:
-         return(DisplayControl);
+         return(huc6273->DisplayControl);
       case 0x0002E:
-         return(Config);
+         return(huc6273->Config);
    }
    if(A >= 0x00060 && A <= 0x0007E)
-      return(Results[(A >> 1) & 0xF]);
+      return(huc6273->Results[(A >> 1) & 0xF]);
    return 0;
 }
 
@@ -218,19 +224,19 @@ void HuC6273_Write16(uint32 A, uint16 V)
          StoreInFIFO(V);
          break;
       case 0x00004:
-         FIFOControl = V;
+         huc6273->FIFOControl = V;
          break;
       case 0x00006:
-         CMTBankSelect = V & 0x1F;
+         huc6273->CMTBankSelect = V & 0x1F;
          break;
       case 0x00008:
-         CMTStartAddress = V & 0xFFFE;
+         huc6273->CMTStartAddress = V & 0xFFFE;
          break;
       case 0x0000A:
-         CMTByteCount = V & 0xFFFE;
+         huc6273->CMTByteCount = V & 0xFFFE;
          break;
       case 0x0000C:
-         InterruptMask = V;
+         huc6273->InterruptMask = V;
          CheckIRQ();
          break;
       case 0x0000E:
@@ -238,53 +244,53 @@ void HuC6273_Write16(uint32 A, uint16 V)
          CheckIRQ();
          break;
       case 0x00010:
-         InterruptStatus = V; 
+         huc6273->InterruptStatus = V; 
          CheckIRQ();
          break;
       case 0x00012:
-         ReadBack = V;
+         huc6273->ReadBack = V;
          break;
       case 0x00014:
-         HorizontalTiming = V;
+         huc6273->HorizontalTiming = V;
          break;
       case 0x00016:
-         VerticalTiming = V;
+         huc6273->VerticalTiming = V;
          break;
       case 0x00018:
-         SCTAddressHi = V;
+         huc6273->SCTAddressHi = V;
          break;
       case 0x0001A:
-         SpriteControl = V;
+         huc6273->SpriteControl = V;
          break;
       case 0x0001C:
-         CDResult[0] = V;
+         huc6273->CDResult[0] = V;
          break;
       case 0x0001E:
-         CDResult[1] = V;
+         huc6273->CDResult[1] = V;
          break;
       case 0x00020: /* X Left */
-         SPWindowX[0] = V;
+         huc6273->SPWindowX[0] = V;
          break;
       case 0x00022: /* Y Top */
-         SPWindowY[0] = V;
+         huc6273->SPWindowY[0] = V;
          break;
       case 0x00024: /* X Right */
-         SPWindowX[1] = V;
+         huc6273->SPWindowX[1] = V;
          break;
       case 0x00026: /* Y Bottom */
-         SPWindowY[1] = V;
+         huc6273->SPWindowY[1] = V;
          break;
       case 0x00028:
-         MiscStatus = V;
+         huc6273->MiscStatus = V;
          break;
       case 0x0002C:
-         DisplayControl = V;
+         huc6273->DisplayControl = V;
          break;
       case 0x0002E:
-         StatusControl = V;
+         huc6273->StatusControl = V;
          break;
       case 0x0003C:
-         RasterHit = V;
+         huc6273->RasterHit = V;
          break;
    }
 }
@@ -296,11 +302,26 @@ void HuC6273_Write8(uint32 A, uint8 V)
 
 void HuC6273_Reset(void)
 {
-   InFIFO = 0;
-   FIFOControl = 0x5 | (0x20 << 4);
+   huc6273->InFIFO = 0;
+   huc6273->FIFOControl = 0x5 | (0x20 << 4);
 }
 
 bool HuC6273_Init(void)
 {
    return(TRUE);
 }
+
+huc6273_t *HuC6273_NewContext(void)
+{
+   return(new huc6273_t());
+}
+
+void HuC6273_DeleteContext(huc6273_t *ctx)
+{
+   delete ctx;
+}
+
+void HuC6273_SetContext(huc6273_t *ctx)
+{
+   huc6273 = ctx;
+}
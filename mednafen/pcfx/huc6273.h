@@ -9,5 +9,11 @@ void HuC6273_Write16(uint32 A, uint16 V);
 void HuC6273_Write8(uint32 A, uint8 V);
 void HuC6273_Reset(void);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct huc6273_t;
+huc6273_t *HuC6273_NewContext(void);
+void HuC6273_DeleteContext(huc6273_t *ctx);
+void HuC6273_SetContext(huc6273_t *ctx);
+
 
 #endif
@@ -36,8 +36,31 @@ static const int TapMap[2][TAP_PORTS] =
 };
 
 
+struct fxinput_t
+{
+ uint8 MultiTapEnabled;
+
+ PCFX_Input_Device *devices[TOTAL_PORTS];
+
+ // D0 = TRG, trigger bit
+ // D1 = MOD, multi-tap clear mode?
+ // D2 = IOS, data direction.  0 = output, 1 = input
+
+ uint8 TapCounter[PCFX_PORTS];
+ uint8 control[PCFX_PORTS];
+ bool latched[PCFX_PORTS];
+ int32 LatchPending[PCFX_PORTS];
+
+ int InputTypes[TOTAL_PORTS];
+ void *data_ptr[TOTAL_PORTS];
+ uint32 data_latch[TOTAL_PORTS];
+
+ v810_timestamp_t lastts;
+};
+
+static fxinput_t *fxinput = NULL;
+
 static void RemakeDevices(int which = -1);
-static uint8 MultiTapEnabled;
 
 // Mednafen-specific input type numerics
 enum
@@ -88,22 +111,6 @@ int PCFX_Input_Device::StateAction(StateMem *sm, int load, int data_only, const
  return(1);
 }
 
-static PCFX_Input_Device *devices[TOTAL_PORTS] = { NULL };
-
-
-// D0 = TRG, trigger bit
-// D1 = MOD, multi-tap clear mode?
-// D2 = IOS, data direction.  0 = output, 1 = input
-
-static uint8 TapCounter[PCFX_PORTS];
-static uint8 control[PCFX_PORTS];
-static bool latched[PCFX_PORTS];
-static int32 LatchPending[PCFX_PORTS];
-
-static int InputTypes[TOTAL_PORTS];
-static void *data_ptr[TOTAL_PORTS];
-static uint32 data_latch[TOTAL_PORTS];
-
 static void SyncSettings(void);
 
 void FXINPUT_Init(void)
@@ -132,7 +139,7 @@ static INLINE int32 min(int32 a, int32 b, int32 c)
 
 static INLINE int32 CalcNextEventTS(const v810_timestamp_t timestamp)
 {
- return(min(LatchPending[0] > 0 ? (timestamp + LatchPending[0]) : PCFX_EVENT_NONONO, LatchPending[1] > 0 ? (timestamp + LatchPending[1]) : PCFX_EVENT_NONONO, PCFX_EVENT_NONONO));
+ return(min(fxinput->LatchPending[0] > 0 ? (timestamp + fxinput->LatchPending[0]) : PCFX_EVENT_NONONO, fxinput->LatchPending[1] > 0 ? (timestamp + fxinput->LatchPending[1]) : PCFX_EVENT_NONONO, PCFX_EVENT_NONONO));
 }
 
 static void RemakeDevices(int which)
@@ -148,32 +155,32 @@ static void RemakeDevices(int which)
 
  for(int i = s; i < e; i++)
  {
-  if(devices[i])
-   delete devices[i];
-  devices[i] = NULL;
+  if(fxinput->devices[i])
+   delete fxinput->devices[i];
+  fxinput->devices[i] = NULL;
 
-  switch(InputTypes[i])
+  switch(fxinput->InputTypes[i])
   {
    default:
-   case FXIT_NONE: devices[i] = new PCFX_Input_Device(); break;
-   case FXIT_GAMEPAD: devices[i] = PCFXINPUT_MakeGamepad(i); break;
-   case FXIT_MOUSE: devices[i] = PCFXINPUT_MakeMouse(i); break;
+   case FXIT_NONE: fxinput->devices[i] = new PCFX_Input_Device(); break;
+   case FXIT_GAMEPAD: fxinput->devices[i] = PCFXINPUT_MakeGamepad(i); break;
+   case FXIT_MOUSE: fxinput->devices[i] = PCFXINPUT_MakeMouse(i); break;
   }
  }
 }
 
 void FXINPUT_SetInput(int port, const char *type, void *ptr)
 {
- data_ptr[port] = ptr;
+ fxinput->data_ptr[port] = ptr;
 
  if(!strcasecmp(type, "mouse"))
  {
-  InputTypes[port] = FXIT_MOUSE;
+  fxinput->InputTypes[port] = FXIT_MOUSE;
  }
  else if(!strcasecmp(type, "gamepad"))
-  InputTypes[port] = FXIT_GAMEPAD;
+  fxinput->InputTypes[port] = FXIT_GAMEPAD;
  else
-  InputTypes[port] = FXIT_NONE;
+  fxinput->InputTypes[port] = FXIT_NONE;
  RemakeDevices(port);
 }
 
@@ -198,7 +205,7 @@ uint16 FXINPUT_Read16(uint32 A, const v810_timestamp_t timestamp)
  {
   int w = (A & 0x80) >> 7;
 
-  if(latched[w])
+  if(fxinput->latched[w])
    ret = 0x8;
   else
    ret = 0x0;
@@ -207,14 +214,14 @@ uint16 FXINPUT_Read16(uint32 A, const v810_timestamp_t timestamp)
  {
   int which = (A >> 7) & 1;
 
-  ret = data_latch[which] >> ((A & 2) ? 16 : 0);
+  ret = fxinput->data_latch[which] >> ((A & 2) ? 16 : 0);
 
   // Which way is correct?  Clear on low reads, or both?  Official docs only say low...
   if(!(A & 0x2))
-   latched[which] = FALSE;
+   fxinput->latched[which] = FALSE;
  }
 
- if(!latched[0] && !latched[1])
+ if(!fxinput->latched[0] && !fxinput->latched[1])
    PCFXIRQ_Assert(PCFXIRQ_SOURCE_INPUT, FALSE);
 
  return(ret);
@@ -237,18 +244,18 @@ void FXINPUT_Write16(uint32 A, uint16 V, const v810_timestamp_t timestamp)
 	    {
 	     int w = (A & 0x80) >> 7;
 
-	     if((V & 0x1) && !(control[w] & 0x1))
+	     if((V & 0x1) && !(fxinput->control[w] & 0x1))
 	     {
 	      //printf("Start: %d\n", w);
-	      if(MultiTapEnabled & (1 << w))
+	      if(fxinput->MultiTapEnabled & (1 << w))
 	      {
 	       if(V & 0x2)
-	        TapCounter[w] = 0;
+	        fxinput->TapCounter[w] = 0;
 	      }
-	      LatchPending[w] = 1536;
+	      fxinput->LatchPending[w] = 1536;
 	      PCFX_SetEvent(PCFX_EVENT_PAD, CalcNextEventTS(timestamp));
 	     }
-	     control[w] = V & 0x7;
+	     fxinput->control[w] = V & 0x7;
 	    }
 	    break;
  }
@@ -263,48 +270,46 @@ void FXINPUT_Frame(void)
 {
  for(int i = 0; i < TOTAL_PORTS; i++)
  {
-  devices[i]->Frame(data_ptr[i]);
+  fxinput->devices[i]->Frame(fxinput->data_ptr[i]);
  }
 }
 
-static v810_timestamp_t lastts;
-
 v810_timestamp_t FXINPUT_Update(const v810_timestamp_t timestamp)
 {
- int32 run_time = timestamp - lastts;
+ int32 run_time = timestamp - fxinput->lastts;
 
  for(int i = 0; i < 2; i++)
  {
-  if(LatchPending[i] > 0)
+  if(fxinput->LatchPending[i] > 0)
   {
-   LatchPending[i] -= run_time;
-   if(LatchPending[i] <= 0)
+   fxinput->LatchPending[i] -= run_time;
+   if(fxinput->LatchPending[i] <= 0)
    {
     //printf("Update: %d, %d\n", i, timestamp / 1365);
 
-    if(MultiTapEnabled & (1 << i))
+    if(fxinput->MultiTapEnabled & (1 << i))
     {
-     if(TapCounter[i] >= TAP_PORTS)
-      data_latch[i] = FX_SIG_TAP << 28;
+     if(fxinput->TapCounter[i] >= TAP_PORTS)
+      fxinput->data_latch[i] = FX_SIG_TAP << 28;
      else
      {
-      data_latch[i] = devices[TapMap[i][TapCounter[i]]]->Read();
+      fxinput->data_latch[i] = fxinput->devices[TapMap[i][fxinput->TapCounter[i]]]->Read();
      }
     }
     else
     {
-     data_latch[i] = devices[i]->Read();
+     fxinput->data_latch[i] = fxinput->devices[i]->Read();
     }
     // printf("Moo: %d, %d, %08x\n", i, TapCounter[i], data_latch[i]);
-    latched[i] = TRUE;
-    control[i] &= ~1;
+    fxinput->latched[i] = TRUE;
+    fxinput->control[i] &= ~1;
     PCFXIRQ_Assert(PCFXIRQ_SOURCE_INPUT, TRUE);
 
-    if(MultiTapEnabled & (1 << i))
+    if(fxinput->MultiTapEnabled & (1 << i))
     {
-     if(TapCounter[i] < TAP_PORTS)
+     if(fxinput->TapCounter[i] < TAP_PORTS)
      {
-      TapCounter[i]++;
+      fxinput->TapCounter[i]++;
      }
     }
 
@@ -312,14 +317,14 @@ v810_timestamp_t FXINPUT_Update(const v810_timestamp_t timestamp)
   }
  }
 
- lastts = timestamp;
+ fxinput->lastts = timestamp;
 
  return(CalcNextEventTS(timestamp));
 }
 
 void FXINPUT_ResetTS(int32 ts_base)
 {
- lastts = ts_base;
+ fxinput->lastts = ts_base;
 }
 
 
@@ -327,11 +332,11 @@ int FXINPUT_StateAction(StateMem *sm, int load, int data_only)
 {
  SFORMAT StateRegs[] =
  {
-  SFARRAY(TapCounter, 2),
-  SFARRAY32(LatchPending, 2),
-  SFARRAY(control, 2),
-  SFARRAYB(latched, 2),
-  SFARRAY32(data_latch, 2),
+  SFARRAYN(fxinput->TapCounter, 2, "TapCounter"),
+  SFARRAY32N(fxinput->LatchPending, 2, "LatchPending"),
+  SFARRAYN(fxinput->control, 2, "control"),
+  SFARRAYBN(fxinput->latched, 2, "latched"),
+  SFARRAY32N(fxinput->data_latch, 2, "data_latch"),
   SFEND
  };
 
@@ -340,8 +345,8 @@ int FXINPUT_StateAction(StateMem *sm, int load, int data_only)
  for(int i = 0; i < TOTAL_PORTS; i++)
  {
   char sname[256];
-  snprintf(sname, 256, "INPUT%d:%d", i, InputTypes[i]);
-  ret &= devices[i]->StateAction(sm, load, data_only, sname);
+  snprintf(sname, 256, "INPUT%d:%d", i, fxinput->InputTypes[i]);
+  ret &= fxinput->devices[i]->StateAction(sm, load, data_only, sname);
  }
 
  if(load)
@@ -411,7 +416,24 @@ static void SyncSettings(void)
  MDFNGameInfo->mouse_sensitivity = MDFN_GetSettingF("pcfx.mouse_sensitivity");
  InputDeviceInfo[1].IDII = MDFN_GetSettingB("pcfx.disable_softreset") ? PCFX_GamepadIDII_DSR : PCFX_GamepadIDII;
 
- MultiTapEnabled = MDFN_GetSettingB("pcfx.input.port1.multitap");
- MultiTapEnabled |= MDFN_GetSettingB("pcfx.input.port2.multitap") << 1;
+ fxinput->MultiTapEnabled = MDFN_GetSettingB("pcfx.input.port1.multitap");
+ fxinput->MultiTapEnabled |= MDFN_GetSettingB("pcfx.input.port2.multitap") << 1;
+}
+
+fxinput_t *FXINPUT_NewContext(void)
+{
+ return(new fxinput_t());
+}
+
+void FXINPUT_DeleteContext(fxinput_t *ctx)
+{
+ for(int i = 0; i < TOTAL_PORTS; i++)
+  delete ctx->devices[i];
+
+ delete ctx;
 }
 
+void FXINPUT_SetContext(fxinput_t *ctx)
+{
+ fxinput = ctx;
+}
@@ -47,6 +47,12 @@ int FXINPUT_StateAction(StateMem *sm, int load, int data_only);
 v810_timestamp_t FXINPUT_Update(const v810_timestamp_t timestamp);
 void FXINPUT_ResetTS(int32 ts_base);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct fxinput_t;
+fxinput_t *FXINPUT_NewContext(void);
+void FXINPUT_DeleteContext(fxinput_t *ctx);
+void FXINPUT_SetContext(fxinput_t *ctx);
+
 extern InputInfoStruct PCFXInputInfo;
 
 
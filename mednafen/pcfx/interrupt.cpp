@@ -19,13 +19,18 @@
 #include "interrupt.h"
 #include "../state_helpers.h"
 
-static uint16 InterruptAsserted;
-static uint16 InterruptMask;
-static uint16 InterruptPriority[2];
+struct pcfxirq_t
+{
+   uint16 InterruptAsserted;
+   uint16 InterruptMask;
+   uint16 InterruptPriority[2];
+};
+
+static pcfxirq_t *pcfxirq = NULL;
 
 static void BuildInterruptCache(void)
 {
-   uint32 iwithmask = InterruptAsserted &~ InterruptMask;
+   uint32 iwithmask = pcfxirq->InterruptAsserted &~ pcfxirq->InterruptMask;
    int InterruptCache = -1;
    int last_prio = -1;
 
@@ -35,9 +40,9 @@ static void BuildInterruptCache(void)
          int tmp_prio;
 
          if(level >= 12)
-            tmp_prio = (InterruptPriority[0] >> ((15 - level) * 3)) & 0x7;
+            tmp_prio = (pcfxirq->InterruptPriority[0] >> ((15 - level) * 3)) & 0x7;
          else
-            tmp_prio = (InterruptPriority[1] >> ((11 - level) * 3)) & 0x7;
+            tmp_prio = (pcfxirq->InterruptPriority[1] >> ((11 - level) * 3)) & 0x7;
 
          if(tmp_prio >= last_prio)
          {
@@ -46,17 +51,17 @@ static void BuildInterruptCache(void)
          }
       }
 
-   PCFX_V810.SetInt(InterruptCache);
+   PCFX_V810->SetInt(InterruptCache);
 }
 
 void PCFXIRQ_Assert(int source, bool assert)
 {
    assert(source >= 0 && source <= 7);
 
-   InterruptAsserted &= ~(1 << (7 - source));
+   pcfxirq->InterruptAsserted &= ~(1 << (7 - source));
 
    if(assert)
-      InterruptAsserted |= (1 << (7 - source));
+      pcfxirq->InterruptAsserted |= (1 << (7 - source));
 
    BuildInterruptCache();
 }
@@ -67,13 +72,13 @@ uint16 PCFXIRQ_Read16(uint32 A)
    switch(A & 0xC0)
    {
       case 0x00:
-         return InterruptAsserted;
+         return pcfxirq->InterruptAsserted;
       case 0x40:
-         return InterruptMask;
+         return pcfxirq->InterruptMask;
       case 0x80:
-         return InterruptPriority[0];
+         return pcfxirq->InterruptPriority[0];
       case 0xC0:
-         return InterruptPriority[1];
+         return pcfxirq->InterruptPriority[1];
    }
 
    return 0;
@@ -94,22 +99,22 @@ void PCFXIRQ_Write16(uint32 A, uint16 V)
          puts("Address error clear");
          break;
       case 0x40:
-         InterruptMask = V & 0x7F;
+         pcfxirq->InterruptMask = V & 0x7F;
          BuildInterruptCache();
          break;
 
       case 0x80:
-         if(InterruptMask == 0x7F)
+         if(pcfxirq->InterruptMask == 0x7F)
          {
-            InterruptPriority[0] = V & 0xFFF;
+            pcfxirq->InterruptPriority[0] = V & 0xFFF;
             BuildInterruptCache();
          }
          break;
 
       case 0xC0:
-         if(InterruptMask == 0x7F)
+         if(pcfxirq->InterruptMask == 0x7F)
          {
-            InterruptPriority[1] = V & 0x1FF;
+            pcfxirq->InterruptPriority[1] = V & 0x1FF;
             BuildInterruptCache();
          }
          break;
@@ -120,9 +125,9 @@ int PCFXIRQ_StateAction(StateMem *sm, int load, int data_only)
 {
    SFORMAT StateRegs[] =
    {
-      SFVAR(InterruptAsserted),
-      SFVAR(InterruptMask),
-      SFARRAY16(InterruptPriority, 2),
+      SFVARN(pcfxirq->InterruptAsserted, "InterruptAsserted"),
+      SFVARN(pcfxirq->InterruptMask, "InterruptMask"),
+      SFARRAY16N(pcfxirq->InterruptPriority, 2, "InterruptPriority"),
       SFEND
    };
 
@@ -136,12 +141,26 @@ int PCFXIRQ_StateAction(StateMem *sm, int load, int data_only)
 
 void PCFXIRQ_Reset(void)
 {
-   InterruptAsserted = 0;
-   InterruptMask = 0xFFFF;
+   pcfxirq->InterruptAsserted = 0;
+   pcfxirq->InterruptMask = 0xFFFF;
 
-   InterruptPriority[0] = 0;
-   InterruptPriority[1] = 0;
+   pcfxirq->InterruptPriority[0] = 0;
+   pcfxirq->InterruptPriority[1] = 0;
 
    BuildInterruptCache();
 }
 
+pcfxirq_t *PCFXIRQ_NewContext(void)
+{
+   return(new pcfxirq_t());
+}
+
+void PCFXIRQ_DeleteContext(pcfxirq_t *ctx)
+{
+   delete ctx;
+}
+
+void PCFXIRQ_SetContext(pcfxirq_t *ctx)
+{
+   pcfxirq = ctx;
+}
@@ -17,4 +17,10 @@ int PCFXIRQ_StateAction(StateMem *sm, int load, int data_only);
 
 void PCFXIRQ_Reset(void);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct pcfxirq_t;
+pcfxirq_t *PCFXIRQ_NewContext(void);
+void PCFXIRQ_DeleteContext(pcfxirq_t *ctx);
+void PCFXIRQ_SetContext(pcfxirq_t *ctx);
+
 #endif
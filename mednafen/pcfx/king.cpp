@@ -37,6 +37,10 @@
 #include <mmintrin.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <math.h>
 
 #include "pcfx.h"
@@ -46,6 +50,7 @@
 #include "soundbox.h"
 #include "input.h"
 #include "timer.h"
+#include "profile.h"
 #include "../cdrom/scsicd.h"
 #include "../clamp.h"
 #include "../state_helpers.h"
@@ -152,8 +157,6 @@ typedef struct
 			 // Valid settings: 0(cellophane disabled for layer), 1-8.  9-F are "unsupported".
 } fx_vce_t;
 
-fx_vce_t fx_vce;
-
 //
 // VCE render cache, including registers cached at hblank
 //
@@ -183,9 +186,91 @@ typedef struct
 				//	       priority = 0, layer is disabled(via the layer enable bit not being set)
 } vce_rendercache_t;
 
-static vce_rendercache_t vce_rendercache;
+struct king_t;
+
+//
+// What a line of KING BG pixels depends on besides its line number and KRAM, see DrawBGLine().
+//
+typedef struct
+{
+ uint16 bgmode;
+ uint16 priority;
+ uint16 BGScrollMode;
+ uint16 PageSetting;	// Only the BG bit.
+ uint16 MPROGControl;	// Only the enable bit.
+ uint16 BGSize[4];
+ uint16 BGXScroll[4];
+ uint16 BGYScroll[4];
+ uint16 BGAffin[6];	// A, B, C, D, center X, center Y
+ uint16 MPROGData[0x10];
+ uint16 palette_offset[2];	// fx_vce, for DrawBG()
+ uint16 rc_palette_offset[2];	// vce_rendercache, for DrawBG_Fast()
+ uint32 palette_gen;
+ uint8 BGBATAddr[4];
+ uint8 BGCGAddr[4];
+ uint8 BG0SubBATAddr, BG0SubCGAddr;
+ uint8 BGLayerDisable;
+} bg_linekey_t;
+
+typedef struct
+{
+ bool valid;
+ uint32 kram_gen;	// kram_gen when it was drawn.
+ bg_linekey_t key;
+
+ // 8 * 2 for left + right padding for scrolling, as bg_linebuffer
+ MDFN_ALIGN(8) uint32 pixels[256 + 8 + 8];
+} bg_linecache_t;
+
+//
+// Everything that belongs to one emulated KING, see KING_SetContext().
+//
+struct fxking_t
+{
+ king_t *king;		// Registers and KRAM; cleared by KING_Reset()
+
+ fx_vce_t fx_vce;
+ vce_rendercache_t vce_rendercache;
+
+ int32 scsicd_ne;
+
+ int32 HPhase;
+ int32 HPhaseCounter;
+ int32 vdc_lb_pos;
+
+ MDFN_ALIGN(8) uint16 vdc_linebuffers[2][512];
+ MDFN_ALIGN(8) uint32 vdc_linebuffer[512];
+ MDFN_ALIGN(8) uint32 vdc_linebuffer_yuved[512];
+ MDFN_ALIGN(8) uint32 rainbow_linebuffer[256];
+
+ // 8 * 2 for left + right padding for scrolling
+ MDFN_ALIGN(8) uint32 bg_linebuffer[256 + 8 + 8];
+
+ // Lines 22-261 of the KING BGs as last drawn, reused while nothing they were drawn from has changed.
+ bg_linecache_t bg_linecache[240];
+ const uint32 *bg_line;		// What MixLayers() mixes: bg_linebuffer + 8, or a bg_linecache[] line's pixels + 8.
+ uint32 palette_gen;		// Bumped whenever palette_table_cache[] changes.
+ uint32 kram_gen;		// Bumped whenever a line is drawn into bg_linecache[].
+ uint32 kram_write_gen;		// kram_gen at the last KRAM write.
+ uint32 kram_page_gen[2][512];	// kram_gen at the last write to each 1KiB page of KRAM.
+
+ uint8 BGLayerDisable;
+ bool RAINBOWLayerDisable;
+
+ uint32 HighDotClockWidth;
 
-static int32 scsicd_ne;
+ int rs, gs, bs;	// FIXME
+
+ VDC **vdc_chips;
+ MDFN_Surface *surface;
+ MDFN_Rect *DisplayRect;
+ int32 *LineWidths;
+ int skip;
+
+ int rb_type;
+};
+
+static fxking_t *fxking = NULL;
 
 enum
 {
@@ -196,17 +281,6 @@ enum
  HPHASE_COUNT
 };
 
-static int32 HPhase;
-static int32 HPhaseCounter;
-static int32 vdc_lb_pos;
-
-static MDFN_ALIGN(8) uint16 vdc_linebuffers[2][512];
-static MDFN_ALIGN(8) uint32 vdc_linebuffer[512];
-static MDFN_ALIGN(8) uint32 vdc_linebuffer_yuved[512];
-static MDFN_ALIGN(8) uint32 rainbow_linebuffer[256];
-
-// 8 * 2 for left + right padding for scrolling
-static MDFN_ALIGN(8) uint32 bg_linebuffer[256 + 8 + 8];
 
 
 
@@ -231,8 +305,8 @@ static void BuildCMT(void)
  {
   for(int value = 0; value < 256; value++)
   {
-   vce_rendercache.coefficient_mul_table_y[coeff][value] = (value * coeff / 8); // Y
-   vce_rendercache.coefficient_mul_table_uv[coeff][value] = ((value - 128) * coeff / 8); // UV
+   fxking->vce_rendercache.coefficient_mul_table_y[coeff][value] = (value * coeff / 8); // Y
+   fxking->vce_rendercache.coefficient_mul_table_uv[coeff][value] = ((value - 128) * coeff / 8); // UV
   }
  }
 
@@ -240,15 +314,15 @@ static void BuildCMT(void)
 
 static INLINE void RebuildLayerPrioCache(void)
 {
- vce_rendercache_t *vr = &vce_rendercache;
+ vce_rendercache_t *vr = &fxking->vce_rendercache;
 
  vr->LayerPriority[LAYER_NONE] = 0;
 
  for(int n = 0; n < 4; n++)
  {
-  if(((fx_vce.picture_mode >> (10 + n)) & 1))
+  if(((fxking->fx_vce.picture_mode >> (10 + n)) & 1))
   {
-   vr->LayerPriority[LAYER_BG0 + n] = (((vce_rendercache.priority[1] >> (n * 4)) & 0xF) + 1);
+   vr->LayerPriority[LAYER_BG0 + n] = (((fxking->vce_rendercache.priority[1] >> (n * 4)) & 0xF) + 1);
    if(vr->LayerPriority[LAYER_BG0 + n] > 8)
    {
     printf("KING BG%d Priority Too Large: %d\n", n, vr->LayerPriority[LAYER_BG0 + n] - 1);
@@ -259,9 +333,9 @@ static INLINE void RebuildLayerPrioCache(void)
    vr->LayerPriority[LAYER_BG0 + n] = 0;
  }
 
- if(fx_vce.picture_mode & 0x0100)
+ if(fxking->fx_vce.picture_mode & 0x0100)
  {
-  vr->LayerPriority[LAYER_VDC_BG] = ((vce_rendercache.priority[0] & 0xF) + 1);
+  vr->LayerPriority[LAYER_VDC_BG] = ((fxking->vce_rendercache.priority[0] & 0xF) + 1);
   if(vr->LayerPriority[LAYER_VDC_BG] > 8)
   {
    printf("VDC BG Priority Too Large: %d\n", vr->LayerPriority[LAYER_VDC_BG] - 1);
@@ -271,9 +345,9 @@ static INLINE void RebuildLayerPrioCache(void)
  else
   vr->LayerPriority[LAYER_VDC_BG] = 0;
 
- if(fx_vce.picture_mode & 0x0200)
+ if(fxking->fx_vce.picture_mode & 0x0200)
  {
-  vr->LayerPriority[LAYER_VDC_SPR] = (((vce_rendercache.priority[0] >> 4) & 0xF) + 1);
+  vr->LayerPriority[LAYER_VDC_SPR] = (((fxking->vce_rendercache.priority[0] >> 4) & 0xF) + 1);
   if(vr->LayerPriority[LAYER_VDC_SPR] > 8)
   {
    printf("VDC SPR Priority Too Large: %d\n", vr->LayerPriority[LAYER_VDC_SPR] - 1);
@@ -283,9 +357,9 @@ static INLINE void RebuildLayerPrioCache(void)
  else 
   vr->LayerPriority[LAYER_VDC_SPR] = 0;
 
- if(fx_vce.picture_mode & 0x4000)
+ if(fxking->fx_vce.picture_mode & 0x4000)
  {
-  vr->LayerPriority[LAYER_RAINBOW] = (((vce_rendercache.priority[0] >> 8) & 0xF) + 1);
+  vr->LayerPriority[LAYER_RAINBOW] = (((fxking->vce_rendercache.priority[0] >> 8) & 0xF) + 1);
   if(vr->LayerPriority[LAYER_RAINBOW] > 8)
   {
    printf("RAINBOW Priority Too Large: %d\n", vr->LayerPriority[LAYER_RAINBOW] - 1);
@@ -340,13 +414,13 @@ static INLINE void RebuildLayerPrioCache(void)
 // Call this function in FX VCE hblank(or at the end/immediate start of active display)
 static void DoHBlankVCECaching(void)
 {
- const fx_vce_t *source = &fx_vce;
- vce_rendercache_t *dest = &vce_rendercache;
+ const fx_vce_t *source = &fxking->fx_vce;
+ vce_rendercache_t *dest = &fxking->vce_rendercache;
 
  dest->picture_mode = source->picture_mode;
 
- fx_vce.dot_clock = (bool)(fx_vce.picture_mode & 0x08);
- fx_vce.dot_clock_ratio = (fx_vce.picture_mode & 0x08) ? 3 : 4;
+ fxking->fx_vce.dot_clock = (bool)(fxking->fx_vce.picture_mode & 0x08);
+ fxking->fx_vce.dot_clock_ratio = (fxking->fx_vce.picture_mode & 0x08) ? 3 : 4;
 
  for(int i = 0; i < 2; i++)
   dest->priority[i] = source->priority[i];
@@ -366,18 +440,22 @@ static void DoHBlankVCECaching(void)
  for(int i = 0; i < 6; i++)
   dest->coefficients[i] = source->coefficients[i];
 
- RebuildLayerPrioCache();
+ // Only MixVDC() and MixLayers() look at the layer priorities, and the cache is rebuilt at the start of every line
+ // that is drawn.
+ if(!fxking->skip)
+  RebuildLayerPrioCache();
 }
 
 static INLINE void RedoPaletteCache(int n)
 {
- uint32 YUV = fx_vce.palette_table[n];
+ uint32 YUV = fxking->fx_vce.palette_table[n];
  uint8 Y = (YUV >> 8) & 0xFF;
  uint8 U = (YUV & 0xF0);
  uint8 V = (YUV & 0x0F) << 4;
 
- vce_rendercache.palette_table_cache[n] = 
- vce_rendercache.palette_table_cache[0x200 | n] = (Y << 16) | (U << 8) | (V << 0);
+ fxking->vce_rendercache.palette_table_cache[n] = 
+ fxking->vce_rendercache.palette_table_cache[0x200 | n] = (Y << 16) | (U << 8) | (V << 0);
+ fxking->palette_gen++;
 }
 
 enum
@@ -392,7 +470,7 @@ enum
  BGMODE_16M_EXTDOT = 7,
 };
 
-typedef struct
+typedef struct king_t
 {
 	uint8 AR;
 	
@@ -487,7 +565,9 @@ typedef struct
 	bool dma_receive_active;
 	bool dma_send_active;
 	int32 dma_cycle_counter;
-	int32 lastts;
+	bool dma_waiting;	// The last DMA cycle had nothing to do, and the SCSI bus hasn't been run since.
+	int32 lastts;		// Graphics
+	int32 scsi_lastts;	// SCSI bus and DMA
 
 
         uint16 KRAM[2][262144];
@@ -497,8 +577,6 @@ typedef struct
 
 static king_t *king = NULL;
 
-static uint8 BGLayerDisable;
-static bool RAINBOWLayerDisable;
 
 static void RedoKINGIRQCheck(void);
 
@@ -514,6 +592,23 @@ static void RecalcKRAMPagePtrs(void)
  king->DMAPagePtr = king->KRAM[king->PageSetting & 1];
 }
 
+// Must be called on every write to KRAM, for the BG line cache.
+static INLINE void KRAMWritten(const unsigned int page, const uint32 addr)
+{
+ fxking->kram_page_gen[page][(addr & 0x3FFFF) >> 9] = fxking->kram_gen;
+ fxking->kram_write_gen = fxking->kram_gen;
+}
+
+static void BGLineCache_Invalidate(void)
+{
+ for(unsigned int i = 0; i < 240; i++)
+  fxking->bg_linecache[i].valid = false;
+
+ memset(fxking->kram_page_gen, 0, sizeof(fxking->kram_page_gen));
+ fxking->kram_gen = 0;
+ fxking->kram_write_gen = 0;
+}
+
 uint8 KING_RB_Fetch(void)
 {
  uint8 ret = king->RainbowPagePtr[(king->RAINBOWKRAMReadPos >> 1) & 0x3FFFF] >> ((king->RAINBOWKRAMReadPos & 1) * 8);
@@ -530,6 +625,7 @@ static void DoRealDMA(uint8 db)
  else
  {
   king->DMAPagePtr[king->DMATransferAddr & 0x3FFFF] = king->DMALatch | (db << 8);
+  KRAMWritten(king->PageSetting & 1, king->DMATransferAddr);
   king->DMATransferAddr = ((king->DMATransferAddr + 1) & 0x1FFFF) | (king->DMATransferAddr & 0x20000);
   king->DMATransferSize = (king->DMATransferSize - 2) & 0x3FFFF;
   if(!king->DMATransferSize)
@@ -556,11 +652,11 @@ uint16 FXVCE_Read16(uint32 A)
  {	
 	uint16 fullret = 0;
 
-	fullret |= fx_vce.AR;
-	fullret |= fx_vce.odd_field ? 0x4000 : 0x0000;
-        fullret |= fx_vce.raster_counter << 5;
+	fullret |= fxking->fx_vce.AR;
+	fullret |= fxking->fx_vce.odd_field ? 0x4000 : 0x0000;
+        fullret |= fxking->fx_vce.raster_counter << 5;
 
-	if(fx_vce.in_hblank || fx_vce.raster_counter < 22 || fx_vce.raster_counter == 262) 
+	if(fxking->fx_vce.in_hblank || fxking->fx_vce.raster_counter < 22 || fxking->fx_vce.raster_counter == 262) 
 	 fullret |= 0 << 15; // Clear on blanking
 	else
 	 fullret |= 1 << 15; // Set on active display.
@@ -569,40 +665,40 @@ uint16 FXVCE_Read16(uint32 A)
  }
  else
  {
-  switch(fx_vce.AR) // No idea which registers are readable, so make them all readable :b
+  switch(fxking->fx_vce.AR) // No idea which registers are readable, so make them all readable :b
   {
 		default:  break;
-	        case 0x00: return(fx_vce.picture_mode);
-		case 0x01: return(fx_vce.palette_rw_offset);
+	        case 0x00: return(fxking->fx_vce.picture_mode);
+		case 0x01: return(fxking->fx_vce.palette_rw_offset);
 		case 0x03: // Boundary Gate reads from 0x03 expecting palette data...
 	        case 0x02: 
 			   {
-				uint16 ret = fx_vce.palette_rw_latch;
-				fx_vce.palette_rw_offset = (fx_vce.palette_rw_offset + 1) & 0x1FF;
-				fx_vce.palette_rw_latch = fx_vce.palette_table[fx_vce.palette_rw_offset];
+				uint16 ret = fxking->fx_vce.palette_rw_latch;
+				fxking->fx_vce.palette_rw_offset = (fxking->fx_vce.palette_rw_offset + 1) & 0x1FF;
+				fxking->fx_vce.palette_rw_latch = fxking->fx_vce.palette_table[fxking->fx_vce.palette_rw_offset];
 				return(ret);
 			   }
-	        case 0x04: return(fx_vce.palette_offset[0]);
-		case 0x05: return(fx_vce.palette_offset[1]);
-		case 0x06: return(fx_vce.palette_offset[2]);
-		case 0x07: return(fx_vce.palette_offset[3]);
-		case 0x08: return(fx_vce.priority[0]);
-		case 0x09: return(fx_vce.priority[1]);
-                case 0x0a: return(fx_vce.ChromaKeyY);
-                case 0x0b: return(fx_vce.ChromaKeyU);
-                case 0x0c: return(fx_vce.ChromaKeyV);
-
-                case 0x0d: return(fx_vce.CCR);
-                case 0x0e: return(fx_vce.BLE);
-                case 0x0f: return(fx_vce.SPBL);
-                case 0x10: return(fx_vce.coefficients[0]);
-                case 0x11: return(fx_vce.coefficients[1]);
-
-                case 0x12: return(fx_vce.coefficients[2]);
-                case 0x13: return(fx_vce.coefficients[3]);
-
-                case 0x14: return(fx_vce.coefficients[4]);
-                case 0x15: return(fx_vce.coefficients[5]);
+	        case 0x04: return(fxking->fx_vce.palette_offset[0]);
+		case 0x05: return(fxking->fx_vce.palette_offset[1]);
+		case 0x06: return(fxking->fx_vce.palette_offset[2]);
+		case 0x07: return(fxking->fx_vce.palette_offset[3]);
+		case 0x08: return(fxking->fx_vce.priority[0]);
+		case 0x09: return(fxking->fx_vce.priority[1]);
+                case 0x0a: return(fxking->fx_vce.ChromaKeyY);
+                case 0x0b: return(fxking->fx_vce.ChromaKeyU);
+                case 0x0c: return(fxking->fx_vce.ChromaKeyV);
+
+                case 0x0d: return(fxking->fx_vce.CCR);
+                case 0x0e: return(fxking->fx_vce.BLE);
+                case 0x0f: return(fxking->fx_vce.SPBL);
+                case 0x10: return(fxking->fx_vce.coefficients[0]);
+                case 0x11: return(fxking->fx_vce.coefficients[1]);
+
+                case 0x12: return(fxking->fx_vce.coefficients[2]);
+                case 0x13: return(fxking->fx_vce.coefficients[3]);
+
+                case 0x14: return(fxking->fx_vce.coefficients[4]);
+                case 0x15: return(fxking->fx_vce.coefficients[5]);
   }
  }
 
@@ -613,48 +709,48 @@ void FXVCE_Write16(uint32 A, uint16 V)
 {
  if(!(A & 0x4))
  {
-  fx_vce.AR = V & 0x1F;
+  fxking->fx_vce.AR = V & 0x1F;
  }
  else
  {
-  switch(fx_vce.AR)
+  switch(fxking->fx_vce.AR)
   {
-		case 0x00: fx_vce.picture_mode = V;
+		case 0x00: fxking->fx_vce.picture_mode = V;
 			   break;
 
-		case 0x01: fx_vce.palette_rw_offset = V & 0x1FF;
-			   fx_vce.palette_rw_latch = fx_vce.palette_table[fx_vce.palette_rw_offset];
+		case 0x01: fxking->fx_vce.palette_rw_offset = V & 0x1FF;
+			   fxking->fx_vce.palette_rw_latch = fxking->fx_vce.palette_table[fxking->fx_vce.palette_rw_offset];
 			   break;
 
-		case 0x02: fx_vce.palette_rw_latch = V;
-			   fx_vce.palette_table[fx_vce.palette_rw_offset] = fx_vce.palette_rw_latch;
-			   RedoPaletteCache(fx_vce.palette_rw_offset);
-			   fx_vce.palette_rw_offset = (fx_vce.palette_rw_offset + 1) & 0x1FF;
+		case 0x02: fxking->fx_vce.palette_rw_latch = V;
+			   fxking->fx_vce.palette_table[fxking->fx_vce.palette_rw_offset] = fxking->fx_vce.palette_rw_latch;
+			   RedoPaletteCache(fxking->fx_vce.palette_rw_offset);
+			   fxking->fx_vce.palette_rw_offset = (fxking->fx_vce.palette_rw_offset + 1) & 0x1FF;
 			   break;
 
-		case 0x04: fx_vce.palette_offset[0] = V; break;
-		case 0x05: fx_vce.palette_offset[1] = V; break;
-		case 0x06: fx_vce.palette_offset[2] = V; break;
-		case 0x07: fx_vce.palette_offset[3] = V & 0x00FF; break;
-		case 0x08: fx_vce.priority[0] = V & 0x0777; break;
-		case 0x09: fx_vce.priority[1] = V & 0x7777; break;
+		case 0x04: fxking->fx_vce.palette_offset[0] = V; break;
+		case 0x05: fxking->fx_vce.palette_offset[1] = V; break;
+		case 0x06: fxking->fx_vce.palette_offset[2] = V; break;
+		case 0x07: fxking->fx_vce.palette_offset[3] = V & 0x00FF; break;
+		case 0x08: fxking->fx_vce.priority[0] = V & 0x0777; break;
+		case 0x09: fxking->fx_vce.priority[1] = V & 0x7777; break;
 
-		case 0x0a: fx_vce.ChromaKeyY = V; break;
-                case 0x0b: fx_vce.ChromaKeyU = V; break;
-                case 0x0c: fx_vce.ChromaKeyV = V; break;
+		case 0x0a: fxking->fx_vce.ChromaKeyY = V; break;
+                case 0x0b: fxking->fx_vce.ChromaKeyU = V; break;
+                case 0x0c: fxking->fx_vce.ChromaKeyV = V; break;
 
-		case 0x0d: fx_vce.CCR = V; break;
-		case 0x0e: fx_vce.BLE = V; break;
-		case 0x0f: fx_vce.SPBL = V; break;
+		case 0x0d: fxking->fx_vce.CCR = V; break;
+		case 0x0e: fxking->fx_vce.BLE = V; break;
+		case 0x0f: fxking->fx_vce.SPBL = V; break;
 
-		case 0x10: fx_vce.coefficients[0] = V & 0xFFF; break;
-                case 0x11: fx_vce.coefficients[1] = V & 0xFFF; break;
+		case 0x10: fxking->fx_vce.coefficients[0] = V & 0xFFF; break;
+                case 0x11: fxking->fx_vce.coefficients[1] = V & 0xFFF; break;
 
-                case 0x12: fx_vce.coefficients[2] = V & 0xFFF; break;
-                case 0x13: fx_vce.coefficients[3] = V & 0xFFF; break;
+                case 0x12: fxking->fx_vce.coefficients[2] = V & 0xFFF; break;
+                case 0x13: fxking->fx_vce.coefficients[3] = V & 0xFFF; break;
 
-                case 0x14: fx_vce.coefficients[4] = V & 0xFFF; break;
-                case 0x15: fx_vce.coefficients[5] = V & 0xFFF; break;
+                case 0x14: fxking->fx_vce.coefficients[4] = V & 0xFFF; break;
+                case 0x15: fxking->fx_vce.coefficients[5] = V & 0xFFF; break;
   }
  }
 }
@@ -734,10 +830,14 @@ uint8 KING_Read8(const v810_timestamp_t timestamp, uint32 A)
  return(ret);
 }
 
+static void KING_ScheduleEvents(const v810_timestamp_t timestamp);
+
 void KING_EndFrame(v810_timestamp_t timestamp)
 {
- PCFX_SetEvent(PCFX_EVENT_KING, KING_Update(timestamp));
- scsicd_ne = SCSICD_Run(timestamp);
+ KING_Update(timestamp);
+ fxking->scsicd_ne = SCSICD_Run(timestamp);
+ king->dma_waiting = false;
+ KING_ScheduleEvents(timestamp);
 }
 
 void KING_ResetTS(v810_timestamp_t ts_base)
@@ -745,6 +845,7 @@ void KING_ResetTS(v810_timestamp_t ts_base)
  SCSICD_ResetTS(ts_base);
 
  king->lastts = ts_base;
+ king->scsi_lastts = ts_base;
 
  if(king->dma_cycle_counter & 0x40000000)
  {
@@ -764,29 +865,22 @@ static INLINE int32 CalcNextEvent(int32 next_event)
  if(king->dma_cycle_counter < next_event)
   next_event = king->dma_cycle_counter;
 
- if(scsicd_ne < next_event)
-  next_event = scsicd_ne;
+ if(fxking->scsicd_ne < next_event)
+  next_event = fxking->scsicd_ne;
 
  return(next_event);
 }
 
-static int32 CalcNextExternalEvent(int32 next_event)
+static int32 CalcNextGfxEvent(int32 next_event)
 {
- // 100 = Hack to make the emulator go faster during CD DMA transfers.
- if(king->dma_cycle_counter < next_event)
-  next_event = 100;	//king->dma_cycle_counter;
-
- if(scsicd_ne < next_event)
-  next_event = scsicd_ne;
+ if(next_event > fxking->HPhaseCounter)
+  next_event = fxking->HPhaseCounter;
 
- if(next_event > HPhaseCounter)
-  next_event = HPhaseCounter;
-
- //printf("KING: %d %d %d; %d\n", king->dma_cycle_counter, scsicd_ne, HPhaseCounter, next_event);
+ //printf("KING: %d; %d\n", HPhaseCounter, next_event);
 
  for(int chip = 0; chip < 2; chip++)
  {
-  int fwoom = (fx_vce.vdc_event[chip] * fx_vce.dot_clock_ratio - fx_vce.clock_divider);
+  int fwoom = (fxking->fx_vce.vdc_event[chip] * fxking->fx_vce.dot_clock_ratio - fxking->fx_vce.clock_divider);
 
   if(fwoom < 1)
    fwoom = 1;
@@ -798,19 +892,148 @@ static int32 CalcNextExternalEvent(int32 next_event)
  return(next_event);
 }
 
+// SCSICD_Run() returns 0x7FFFFFFF when it has nothing pending, so clamp it like the other KING events.
+static INLINE v810_timestamp_t CalcNextSCSIEventTS(const v810_timestamp_t timestamp)
+{
+ return(timestamp + std::min<int32>(fxking->scsicd_ne, 0x4FFFFFFF));
+}
+
+// While a DMA is moving data, run it in batches of this many cycles rather than interrupting the CPU every KING_MAGIC_INTERVAL.
+#define KING_DMA_EVENT_BATCH 100
+
+static v810_timestamp_t CalcNextDMAEventTS(const v810_timestamp_t timestamp)
+{
+ // Nothing to do until the SCSI bus changes; the SCSI event(or a register access) will reschedule this.
+ if(king->dma_cycle_counter >= 0x4FFFFFFF || king->dma_waiting)
+  return(PCFX_EVENT_NONONO);
+
+ int32 next_event = std::max<int32>(king->dma_cycle_counter, KING_DMA_EVENT_BATCH);
+
+ // When the drive already has data waiting, KING_RunSCSI() can move it in one burst, so don't come back until the DMA cycle
+ // that releases ACK on the last byte the drive has, or, never any later, the one that takes the last byte of the transfer
+ // and raises the DMA IRQ.
+ // Stop at the end of the current H phase, though, so that DrawActive() sees the DMA'd data in KRAM; an odd cycle leaves
+ // the next byte up on the bus, ready for another burst.
+ if(king->dma_receive_active && (king->DMAStatus & 0x1) && !king->DRQ && !SCSICD_GetCD() && SCSICD_GetIO() && SCSICD_GetREQ() && !SCSICD_GetACK())
+ {
+  const int32 avail = SCSICD_DataInBurstAvail();
+  const int32 left = king->DMATransferSize - king->DMATransferFlipFlop;
+  const int32 hphase_cycles = (king->lastts + fxking->HPhaseCounter - timestamp - king->dma_cycle_counter) / KING_MAGIC_INTERVAL;
+  const bool done_in_burst = (left <= avail + 1);
+  int32 cycles = done_in_burst ? (left - 1) * 2 : avail * 2 + 1;
+
+  if(cycles > hphase_cycles)
+   cycles = hphase_cycles - !(hphase_cycles & 1);
+
+  if(cycles > 0)
+   next_event = std::max<int32>(next_event, king->dma_cycle_counter + cycles * KING_MAGIC_INTERVAL);
+
+  if(done_in_burst)
+   next_event = std::min<int32>(next_event, king->dma_cycle_counter + (left - 1) * 2 * KING_MAGIC_INTERVAL);
+ }
+
+ return(timestamp + next_event);
+}
+
 static void MDFN_FASTCALL KING_RunGfx(int32 clocks);
+static void KING_RunSCSI(const v810_timestamp_t timestamp);
 
-v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
+// The graphics have been run up to king->lastts, which isn't necessarily the current timestamp; see KING_UpdateForAccess().
+static INLINE v810_timestamp_t CalcNextGfxEventTS(void)
 {
- int32 clocks = timestamp - king->lastts;
- uint32 running_timestamp = king->lastts;
+ return(king->lastts + CalcNextGfxEvent(0x4FFFFFFF));
+}
 
- //printf("KING Run for: %d\n", clocks);
+static void KING_ScheduleEvents(const v810_timestamp_t timestamp)
+{
+ PCFX_SetEvent(PCFX_EVENT_KING, CalcNextGfxEventTS());
+ PCFX_SetEvent(PCFX_EVENT_KING_SCSI, CalcNextSCSIEventTS(timestamp));
+ PCFX_SetEvent(PCFX_EVENT_KING_DMA, CalcNextDMAEventTS(timestamp));
+}
+
+v810_timestamp_t KING_GfxEvent(const v810_timestamp_t timestamp)
+{
+ int32 clocks = timestamp - king->lastts;
 
  king->lastts = timestamp;
 
+ PCFX_Prof_CountKINGGfxRun();
  KING_RunGfx(clocks);
 
+ return(CalcNextGfxEventTS());
+}
+
+// Runs the graphics, and with them the VDCs, up to timestamp; for when the CPU accesses a VDC, so that it sees the VDC as of
+// then and its writes land on the right pixel.
+void KING_UpdateGfx(const v810_timestamp_t timestamp)
+{
+ PCFX_SetEvent(PCFX_EVENT_KING, KING_GfxEvent(timestamp));
+}
+
+v810_timestamp_t KING_SCSIEvent(const v810_timestamp_t timestamp)
+{
+ KING_RunSCSI(timestamp);
+
+ PCFX_SetEvent(PCFX_EVENT_KING_DMA, CalcNextDMAEventTS(timestamp));
+
+ return(CalcNextSCSIEventTS(timestamp));
+}
+
+v810_timestamp_t KING_DMAEvent(const v810_timestamp_t timestamp)
+{
+ KING_RunSCSI(timestamp);
+
+ PCFX_SetEvent(PCFX_EVENT_KING_SCSI, CalcNextSCSIEventTS(timestamp));
+
+ return(CalcNextDMAEventTS(timestamp));
+}
+
+// Brings everything in KING up to timestamp, and reschedules the SCSI and DMA events; returns the next graphics event.
+v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
+{
+ const v810_timestamp_t ret = KING_GfxEvent(timestamp);
+
+ KING_RunSCSI(timestamp);
+
+ PCFX_SetEvent(PCFX_EVENT_KING_SCSI, CalcNextSCSIEventTS(timestamp));
+ PCFX_SetEvent(PCFX_EVENT_KING_DMA, CalcNextDMAEventTS(timestamp));
+
+ return(ret);
+}
+
+// KING_Update() for a register access.  Nothing the registers read or write depends on the graphics between one graphics
+// deadline(an H phase boundary or a VDC event, see CalcNextGfxEvent()) and the next, so the graphics are only run here if
+// one has passed; otherwise the graphics event does it, a whole segment at a time instead of once per access.
+static void KING_UpdateForAccess(const v810_timestamp_t timestamp)
+{
+ if(timestamp >= CalcNextGfxEventTS())
+  KING_GfxEvent(timestamp);
+
+ KING_RunSCSI(timestamp);
+
+ PCFX_SetEvent(PCFX_EVENT_KING_SCSI, CalcNextSCSIEventTS(timestamp));
+ PCFX_SetEvent(PCFX_EVENT_KING_DMA, CalcNextDMAEventTS(timestamp));
+}
+
+// Returns how many bytes the DMA cycle just reached can move in a burst, with clocks left to run.  Every DMA cycle
+// of the burst, up to the one that releases ACK on the last byte, has to come before the drive's next event.
+static INLINE int32 CalcDMABurst(const int32 clocks)
+{
+ const int32 max_clocks = std::min<int32>(clocks, fxking->scsicd_ne - 1);
+
+ return(std::min<int32>(SCSICD_DataInBurstAvail(), (max_clocks + KING_MAGIC_INTERVAL) / (KING_MAGIC_INTERVAL * 2)));
+}
+
+static void KING_RunSCSI(const v810_timestamp_t timestamp)
+{
+ int32 clocks = timestamp - king->scsi_lastts;
+ uint32 running_timestamp = king->scsi_lastts;
+ int32 burst_count;
+
+ //printf("KING Run for: %d\n", clocks);
+
+ king->scsi_lastts = timestamp;
+
  while(clocks > 0)
  {
   int32 chunk_clocks = CalcNextEvent(clocks);
@@ -818,16 +1041,48 @@ v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
   running_timestamp += chunk_clocks;
   clocks -= chunk_clocks;
 
-  scsicd_ne -= chunk_clocks;
-  if(scsicd_ne <= 0)
-   scsicd_ne = SCSICD_Run(running_timestamp);
+  fxking->scsicd_ne -= chunk_clocks;
+  if(fxking->scsicd_ne <= 0)
+  {
+   fxking->scsicd_ne = SCSICD_Run(running_timestamp);
+   king->dma_waiting = false;
+  }
 
   king->dma_cycle_counter -= chunk_clocks;
   if(king->dma_cycle_counter <= 0)
   {
    //assert(king->dma_receive_active || king->dma_send_active);
    king->dma_cycle_counter += KING_MAGIC_INTERVAL;
-   if(king->dma_receive_active)
+   king->dma_waiting = true;
+
+   if(king->dma_receive_active && (king->DMAStatus & 0x1) && !king->DRQ && !SCSICD_GetCD() && SCSICD_GetIO() && SCSICD_GetREQ() && !SCSICD_GetACK() &&
+      (burst_count = CalcDMABurst(clocks)))
+   {
+    // Each byte takes two DMA cycles: this one takes it and asserts ACK, and the next releases ACK, after which the drive
+    // puts up the next byte.  Move as many as fit before the end of this run and before the drive's next event in one go.
+    int32 burst_clocks;
+
+    for(int32 i = 0; i < burst_count; i++)
+    {
+     king->data_cache = SCSICD_GetDB();
+     DoRealDMA(king->data_cache);
+     SCSICD_DataInBurstNext();
+
+     if(!(king->DMAStatus & 0x1))
+     {
+      burst_count = i + 1;
+      break;
+     }
+    }
+
+    // Up to the cycle that released ACK on the last byte; DMA cycles are evenly spaced, so dma_cycle_counter is unchanged.
+    burst_clocks = burst_count * KING_MAGIC_INTERVAL * 2 - KING_MAGIC_INTERVAL;
+    running_timestamp += burst_clocks;
+    clocks -= burst_clocks;
+    fxking->scsicd_ne -= burst_clocks;
+    king->dma_waiting = false;
+   }
+   else if(king->dma_receive_active)
    {
     if(!SCSICD_GetCD() && SCSICD_GetIO())
     {    
@@ -837,6 +1092,7 @@ v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
       {
        king->DRQ = TRUE;
        king->data_cache = SCSICD_GetDB();
+       king->dma_waiting = false;
        //SCSICD_SetACK(TRUE);
        //PCFX_SetEvent(PCFX_EVENT_SCSI, SCSICD_Run(timestamp));
 
@@ -845,14 +1101,15 @@ v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
         king->DRQ = FALSE;
         DoRealDMA(king->data_cache);
         SCSICD_SetACK(TRUE);
-        scsicd_ne = SCSICD_Run(running_timestamp);
+        fxking->scsicd_ne = SCSICD_Run(running_timestamp);
        }
       }
      }
      else if(SCSICD_GetACK() && !SCSICD_GetREQ())
      {
       SCSICD_SetACK(FALSE);
-      scsicd_ne = SCSICD_Run(running_timestamp);
+      fxking->scsicd_ne = SCSICD_Run(running_timestamp);
+      king->dma_waiting = false;
      }
     }
    }
@@ -867,21 +1124,21 @@ v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp)
        //KINGDBG("Did write: %02x\n", king->data_cache);
        SCSICD_SetDB(king->data_cache);
        SCSICD_SetACK(TRUE);
-       scsicd_ne = SCSICD_Run(running_timestamp);
+       fxking->scsicd_ne = SCSICD_Run(running_timestamp);
        king->DRQ = TRUE;
+       king->dma_waiting = false;
       }
      }
      else if(SCSICD_GetACK() && !SCSICD_GetREQ())
      {
       SCSICD_SetACK(FALSE);
-      scsicd_ne = SCSICD_Run(running_timestamp);
+      fxking->scsicd_ne = SCSICD_Run(running_timestamp);
+      king->dma_waiting = false;
      }
     }
    }
   }
  } // end while(clocks > 0)
-
- return(timestamp + CalcNextExternalEvent(0x4FFFFFFF));
 }
 
 uint16 KING_Read16(const v810_timestamp_t timestamp, uint32 A)
@@ -889,7 +1146,7 @@ uint16 KING_Read16(const v810_timestamp_t timestamp, uint32 A)
  int msh = A & 2;
  uint16 ret = 0;
 
- KING_Update(timestamp);
+ KING_UpdateForAccess(timestamp);
 
  //printf("KRead16: %08x, %d; %04x\n", A, timestamp, king->AR);
 
@@ -990,7 +1247,7 @@ uint16 KING_Read16(const v810_timestamp_t timestamp, uint32 A)
 			 {
 			  king->DRQ = FALSE;
      			  SCSICD_SetACK(TRUE);
-     			  scsicd_ne = 1;
+     			  fxking->scsicd_ne = 1;
 			 }
 			}
 			else
@@ -1104,7 +1361,8 @@ uint16 KING_Read16(const v810_timestamp_t timestamp, uint32 A)
 	      
  }
 
- PCFX_SetEvent(PCFX_EVENT_KING, timestamp + CalcNextExternalEvent(0x4FFFFFFF));    // TODO: Optimize this to only be called when necessary.
+ king->dma_waiting = false;
+ KING_ScheduleEvents(timestamp);    // TODO: Optimize this to only be called when necessary.
 
  return(ret);
 }
@@ -1123,7 +1381,7 @@ static INLINE void SCSI_Reg0_Write(const v810_timestamp_t timestamp, uint8 V, bo
 
  if(!delay_run)
  {
-  scsicd_ne = 1; //SCSICD_Run(timestamp);
+  fxking->scsicd_ne = 1; //SCSICD_Run(timestamp);
  }
 }
 
@@ -1156,7 +1414,7 @@ static INLINE void SCSI_Reg2_Write(const v810_timestamp_t timestamp, uint8 V, bo
 
   if(!delay_run)
   {
-   scsicd_ne = 1; //SCSICD_Run(timestamp);
+   fxking->scsicd_ne = 1; //SCSICD_Run(timestamp);
   }
   king->DRQ = FALSE;
 
@@ -1175,7 +1433,7 @@ static INLINE void SCSI_Reg3_Write(const v810_timestamp_t timestamp, uint8 V, bo
 
  if(!delay_run)
  {
-  scsicd_ne = 1; //SCSICD_Run(timestamp);
+  fxking->scsicd_ne = 1; //SCSICD_Run(timestamp);
  }
 }
 
@@ -1195,7 +1453,7 @@ void KING_Write16(const v810_timestamp_t timestamp, uint32 A, uint16 V)
  {
   //if(king->AR != 0x0E)
   // printf("KING: %02x %04x, %d\n", king->AR, V, fx_vce.raster_counter);
-  KING_Update(timestamp);
+  KING_UpdateForAccess(timestamp);
 
   if(king->AR >= 0x50 && king->AR <= 0x5E)
   {
@@ -1248,7 +1506,7 @@ void KING_Write16(const v810_timestamp_t timestamp, uint32 A, uint16 V)
 			     SCSICD_SetACK(V & 0x10);
 			    }
                             SCSICD_SetRST(V & 0x80);
-			    scsicd_ne = 1;
+			    fxking->scsicd_ne = 1;
 			   }
 			   break;
 
@@ -1337,6 +1595,7 @@ void KING_Write16(const v810_timestamp_t timestamp, uint32 A, uint16 V)
 			   int32 inc_amount = ((int32)((king->KRAMWA & (0x3FF << 18)) << 4)) >> 22; // Convert from 10-bit signed 2's complement
 
 			   king->KRAM[page][king->KRAMWA & 0x3FFFF] = V;
+			   KRAMWritten(page, king->KRAMWA);
 			   king->KRAMWA = (king->KRAMWA &~ 0x1FFFF) | ((king->KRAMWA + inc_amount) & 0x1FFFF);
 			  }
 			  break;
@@ -1514,7 +1773,8 @@ void KING_Write16(const v810_timestamp_t timestamp, uint32 A, uint16 V)
 			   break;
 	      }
 
-  PCFX_SetEvent(PCFX_EVENT_KING, timestamp + CalcNextExternalEvent(0x4FFFFFFF));	// TODO: Optimize this to only be called when necessary.
+  king->dma_waiting = false;
+  KING_ScheduleEvents(timestamp);	// TODO: Optimize this to only be called when necessary.
  }
 }
 
@@ -1567,18 +1827,34 @@ uint16 KING_GetADPCMHalfWord(int ch)
  return(ret);
 }
 
-static uint32 HighDotClockWidth;
-extern RavenBuffer* FXCDDABufs[2]; // FIXME, externals are evil!
+fxking_t *KING_NewContext(void)
+{
+ fxking_t *ctx = new fxking_t();
 
-bool KING_Init(void)
+ ctx->king = new king_t();
+
+ return(ctx);
+}
+
+void KING_DeleteContext(fxking_t *ctx)
 {
- if(!(king = (king_t*)calloc(1, sizeof(king_t))))
-  return(0);
+ delete ctx->king;
+ delete ctx;
+}
+
+void KING_SetContext(fxking_t *ctx)
+{
+ fxking = ctx;
+ king = ctx ? ctx->king : NULL;
+}
 
+bool KING_Init(void)
+{
  king->lastts = 0;
+ king->scsi_lastts = 0;
 
- HighDotClockWidth = MDFN_GetSettingUI("pcfx.high_dotclock_width");
- BGLayerDisable = 0;
+ fxking->HighDotClockWidth = MDFN_GetSettingUI("pcfx.high_dotclock_width");
+ fxking->BGLayerDisable = 0;
 
  BuildCMT();
 
@@ -1634,18 +1910,13 @@ bool KING_Init(void)
     }
    }
 
- SCSICD_Init(SCSICD_PCFX, 3, FXCDDABufs[0]->Buf(), FXCDDABufs[1]->Buf(), 153600 * MDFN_GetSettingUI("pcfx.cdspeed"), 21477273, KING_CDIRQ, KING_StuffSubchannels);
+ SCSICD_Init(SCSICD_PCFX, 3, SoundBox_GetCDDABuf(0), SoundBox_GetCDDABuf(1), 153600 * MDFN_GetSettingUI("pcfx.cdspeed"), 21477273, KING_CDIRQ, KING_StuffSubchannels);
 
  return(1);
 }
 
 void KING_Close(void)
 {
- if(king)
- {
-  free(king);
-  king = NULL;
- }
  SCSICD_Close();
 }
 
@@ -1654,11 +1925,13 @@ void KING_Reset(const v810_timestamp_t timestamp)
 {
  KING_Update(timestamp);
 
- memset(&fx_vce, 0, sizeof(fx_vce));
+ memset(&fxking->fx_vce, 0, sizeof(fxking->fx_vce));
 
  int32 ltssave = king->lastts;
+ int32 scsi_ltssave = king->scsi_lastts;
  memset(king, 0, sizeof(king_t));
  king->lastts = ltssave;
+ king->scsi_lastts = scsi_ltssave;
 
  king->Reg00 = 0;
  king->Reg01 = 0;
@@ -1671,19 +1944,19 @@ void KING_Reset(const v810_timestamp_t timestamp)
 
  RecalcKRAMPagePtrs();
 
- HPhase = HPHASE_HBLANK_PART1;
- HPhaseCounter = 1;
- vdc_lb_pos = 0;
+ fxking->HPhase = HPHASE_HBLANK_PART1;
+ fxking->HPhaseCounter = 1;
+ fxking->vdc_lb_pos = 0;
 
- memset(vdc_linebuffers, 0, sizeof(vdc_linebuffers));
- memset(vdc_linebuffer, 0, sizeof(vdc_linebuffer));
- memset(vdc_linebuffer_yuved, 0, sizeof(vdc_linebuffer_yuved));
- memset(rainbow_linebuffer, 0, sizeof(rainbow_linebuffer));
- memset(bg_linebuffer, 0, sizeof(bg_linebuffer));
+ memset(fxking->vdc_linebuffers, 0, sizeof(fxking->vdc_linebuffers));
+ memset(fxking->vdc_linebuffer, 0, sizeof(fxking->vdc_linebuffer));
+ memset(fxking->vdc_linebuffer_yuved, 0, sizeof(fxking->vdc_linebuffer_yuved));
+ memset(fxking->rainbow_linebuffer, 0, sizeof(fxking->rainbow_linebuffer));
+ memset(fxking->bg_linebuffer, 0, sizeof(fxking->bg_linebuffer));
 
 
  king->dma_cycle_counter = 0x7FFFFFFF;
- scsicd_ne = 1;	// FIXME
+ fxking->scsicd_ne = 1;	// FIXME
 
  RedoKINGIRQCheck();
 
@@ -1697,71 +1970,30 @@ void KING_Reset(const v810_timestamp_t timestamp)
  SCSICD_Power(timestamp);
 
  memset(king->KRAM, 0xFF, sizeof(king->KRAM));
-}
 
-
-static INLINE void DRAWBG8x1_4(uint32 *target, const uint16 *cg, const uint32 *palette_ptr, const uint32 layer_or)
-{
- if(*cg >> 14) target[0] = palette_ptr[(*cg >> 14)] | layer_or;
- if((*cg >> 12) & 0x3) target[1] = palette_ptr[((*cg >> 12) & 0x3)] | layer_or;
- if((*cg >> 10) & 0x3) target[2] = palette_ptr[((*cg >> 10) & 0x3)] | layer_or;
- if((*cg >> 8) & 0x3) target[3] = palette_ptr[((*cg >> 8) & 0x3)] | layer_or;
- if((*cg >> 6) & 0x3) target[4] = palette_ptr[((*cg >> 6) & 0x3)] | layer_or;
- if((*cg >> 4) & 0x3) target[5] = palette_ptr[((*cg >> 4) & 0x3)] | layer_or;
- if((*cg >> 2) & 0x3) target[6] = palette_ptr[((*cg >> 2) & 0x3)] | layer_or;
- if((*cg >> 0) & 0x3) target[7] = palette_ptr[((*cg >> 0) & 0x3)] | layer_or;
+ fxking->bg_line = fxking->bg_linebuffer + 8;
+ BGLineCache_Invalidate();
 }
 
-static INLINE void DRAWBG8x1_16(uint32 *target, const uint16 *cgptr, const uint32 *palette_ptr, const uint32 layer_or)
-{
- if(cgptr[0] >> 12) target[0] = palette_ptr[((cgptr[0] >> 12))] | layer_or;
- if((cgptr[0] >> 8) & 0xF) target[1] = palette_ptr[(((cgptr[0] >> 8) & 0xF))] | layer_or;
- if((cgptr[0] >> 4) & 0xF) target[2] = palette_ptr[(((cgptr[0] >> 4) & 0xF))] | layer_or;
- if((cgptr[0] >> 0) & 0xF) target[3] = palette_ptr[(((cgptr[0] >> 0) & 0xF))] | layer_or;
 
- if(cgptr[1] >> 12) target[4] = palette_ptr[((cgptr[1] >> 12))] | layer_or;
- if((cgptr[1] >> 8) & 0xF) target[5] = palette_ptr[(((cgptr[1] >> 8) & 0xF))] | layer_or;
- if((cgptr[1] >> 4) & 0xF) target[6] = palette_ptr[(((cgptr[1] >> 4) & 0xF))] | layer_or;
- if((cgptr[1] >> 0) & 0xF) target[7] = palette_ptr[(((cgptr[1] >> 0) & 0xF))] | layer_or;
-}
+#include "king-drawbg.inc"
 
-static INLINE void DRAWBG8x1_256(uint32 *target, const uint16 *cgptr, const uint32 *palette_ptr, const uint32 layer_or)
-{
- if(cgptr[0] >> 8) target[0] = palette_ptr[(cgptr[0] >> 0x8)] | layer_or;
- if(cgptr[0] & 0xFF) target[1] = palette_ptr[(cgptr[0] & 0xFF)] | layer_or;
- if(cgptr[1] >> 8) target[2] = palette_ptr[(cgptr[1] >> 0x8)] | layer_or;
- if(cgptr[1] & 0xFF) target[3] = palette_ptr[(cgptr[1] & 0xFF)] | layer_or;
- if(cgptr[2] >> 8) target[4] = palette_ptr[(cgptr[2] >> 0x8)] | layer_or;
- if(cgptr[2] & 0xFF) target[5] = palette_ptr[(cgptr[2] & 0xFF)] | layer_or;
- if(cgptr[3] >> 8) target[6] = palette_ptr[(cgptr[3] >> 0x8)] | layer_or;
- if(cgptr[3] & 0xFF) target[7] = palette_ptr[(cgptr[3] & 0xFF)] | layer_or;
-}
+static bool bgmode_warning = 0; // Debug
 
-static INLINE void DRAWBG8x1_64K(uint32 *target, const uint16 *cgptr, const uint32 *palette_ptr, const uint32 layer_or)
+// BG size settings, as log2 of the size in pixels, for BG0 and for BG1-3; and which ones are out of range.
+// TODO: Verify behavior when size is out of bounds on BG1-3.
+// With BG0 at least, it behaves as if the size is at its minimum, with caveats(TO BE INVESTIGATED).
+static const uint32 bg_ss_table[2][0x10] =
 {
- if(cgptr[0] & 0xFF00) target[0] = ((cgptr[0x0] & 0x00F0) << 8) | ((cgptr[0] & 0x000F)<<4) | ((cgptr[0] & 0xFF00) << 8) | layer_or;
- if(cgptr[1] & 0xFF00) target[1] = ((cgptr[0x1] & 0x00F0) << 8) | ((cgptr[1] & 0x000F)<<4) | ((cgptr[1] & 0xFF00) << 8) | layer_or;
- if(cgptr[2] & 0xFF00) target[2] = ((cgptr[0x2] & 0x00F0) << 8) | ((cgptr[2] & 0x000F)<<4) | ((cgptr[2] & 0xFF00) << 8) | layer_or;
- if(cgptr[3] & 0xFF00) target[3] = ((cgptr[0x3] & 0x00F0) << 8) | ((cgptr[3] & 0x000F)<<4) | ((cgptr[3] & 0xFF00) << 8) | layer_or;
- if(cgptr[4] & 0xFF00) target[4] = ((cgptr[0x4] & 0x00F0) << 8) | ((cgptr[4] & 0x000F)<<4) | ((cgptr[4] & 0xFF00) << 8) | layer_or;
- if(cgptr[5] & 0xFF00) target[5] = ((cgptr[0x5] & 0x00F0) << 8) | ((cgptr[5] & 0x000F)<<4) | ((cgptr[5] & 0xFF00) << 8) | layer_or;
- if(cgptr[6] & 0xFF00) target[6] = ((cgptr[0x6] & 0x00F0) << 8) | ((cgptr[6] & 0x000F)<<4) | ((cgptr[6] & 0xFF00) << 8) | layer_or;
- if(cgptr[7] & 0xFF00) target[7] = ((cgptr[0x7] & 0x00F0) << 8) | ((cgptr[7] & 0x000F)<<4) | ((cgptr[7] & 0xFF00) << 8) | layer_or;
-}
+ { 0x3, 0x3, 0x3, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0x3, 0x3, 0x3, 0x3, 0x3 },
+ { 0x3, 0x3, 0x3, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0x3, 0x3, 0x3, 0x3, 0x3, 0x3 },
+};
 
-static INLINE void DRAWBG8x1_16M(uint32 *target, const uint16 *cgptr, const uint32 *palette_ptr, const uint32 layer_or)
+static const bool bg_ss_invalid_table[2][0x10] =
 {
- if(cgptr[0] >> 8) target[0] = ((cgptr[0x0] & 0xFF00) << 8) | (cgptr[1] & 0xFF00) | (cgptr[1] & 0xFF) | layer_or;
- if(cgptr[0] & 0xFF) target[1] = ((cgptr[0x0] & 0x00FF) << 16) | (cgptr[1] & 0xFF00) | (cgptr[1] & 0xFF) | layer_or;
- if(cgptr[2] >> 8) target[2] = ((cgptr[0x2] & 0xFF00) << 8) | (cgptr[3] & 0xFF00) | (cgptr[3] & 0xFF) | layer_or;
- if(cgptr[2] & 0xFF) target[3] = ((cgptr[0x2] & 0x00FF) << 16) | (cgptr[3] & 0xFF00) | (cgptr[3] & 0xFF) | layer_or;
- if(cgptr[4] >> 8) target[4] = ((cgptr[0x4] & 0xFF00) << 8) | (cgptr[5] & 0xFF00) | (cgptr[5] & 0xFF) | layer_or;
- if(cgptr[4] & 0xFF) target[5] = ((cgptr[0x4] & 0x00FF) << 16) | (cgptr[5] & 0xFF00) | (cgptr[5] & 0xFF) | layer_or;
- if(cgptr[6] >> 8) target[6] = ((cgptr[0x6] & 0xFF00) << 8) | (cgptr[7] & 0xFF00) | (cgptr[7] & 0xFF) | layer_or;
- if(cgptr[6] & 0xFF) target[7] = ((cgptr[0x6] & 0x00FF) << 16) | (cgptr[7] & 0xFF00) | (cgptr[7] & 0xFF) | layer_or;
-}
-
-static bool bgmode_warning = 0; // Debug
+ { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1 },
+ { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1 },
+};
 
 #include "king-bgfast.inc"
 
@@ -1775,20 +2007,6 @@ static INLINE int32 max(int32 a, int32 b)
 
 static void DrawBG(uint32 *target, int n, bool sub)
 {
- // TODO: Verify behavior when size is out of bounds on BG1-3.
- // With BG0 at least, it behaves as if the size is at its minimum, with caveats(TO BE INVESTIGATED).
- const uint32 bg_ss_table[2][0x10] = 
- {
-  { 0x3, 0x3, 0x3, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0x3, 0x3, 0x3, 0x3, 0x3 },
-  { 0x3, 0x3, 0x3, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0x3, 0x3, 0x3, 0x3, 0x3, 0x3 },
- };
-
- const bool bg_ss_invalid_table[2][0x10] =
- {
-  { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1 },
-  { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1 },
- };
-
 #if 0
  const uint32 cg_per_mode[0x8] = 
  {
@@ -1804,8 +2022,8 @@ static void DrawBG(uint32 *target, int n, bool sub)
 #endif
  const uint32 layer_or = (LAYER_BG0 + n) << 28;
 
- const uint32 palette_offset = ((fx_vce.palette_offset[1 + (n >> 1)] >> ((n & 1) ? 8 : 0)) << 1) & 0x1FF;
- const uint32 *palette_ptr = &vce_rendercache.palette_table_cache[palette_offset];
+ const uint32 palette_offset = ((fxking->fx_vce.palette_offset[1 + (n >> 1)] >> ((n & 1) ? 8 : 0)) << 1) & 0x1FF;
+ const uint32 *palette_ptr = &fxking->vce_rendercache.palette_table_cache[palette_offset];
  const uint32 bat_and_cg_page = (king->PageSetting & 0x0010) ? 1 : 0;
 
  const uint16 bgmode = (king->bgmode >> (n * 4)) & 0xF;
@@ -1813,7 +2031,7 @@ static void DrawBG(uint32 *target, int n, bool sub)
  const uint32 XScroll = king->BGXScroll[n];
  const uint32 YScroll = king->BGYScroll[n];
 
- const uint32 YOffset = (YScroll + (fx_vce.raster_counter - 22)) & 0xFFFF;
+ const uint32 YOffset = (YScroll + (fxking->fx_vce.raster_counter - 22)) & 0xFFFF;
 
  const uint32 bat_offset = king->BGBATAddr[n] * 1024;
  const uint32 bat_sub_offset = n ? bat_offset : (king->BG0SubBATAddr * 1024);
@@ -1964,7 +2182,7 @@ static void DrawBG(uint32 *target, int n, bool sub)
 	 const int32 bat_height_mask = endless ? (bat_height - 1) : 0xFFFF;		\
          int32 a, b, c, d;	\
          int32 raw_x_coord = (int32)sign_11_to_s16(XScroll) - (int16)king->BGAffinCenterX;	\
-         int32 raw_y_coord = fx_vce.raster_counter + (int32)sign_11_to_s16(YScroll) - 22 - (int16)king->BGAffinCenterY;		\
+         int32 raw_y_coord = fxking->fx_vce.raster_counter + (int32)sign_11_to_s16(YScroll) - 22 - (int16)king->BGAffinCenterY;		\
          int32 xaccum;	\
          int32 yaccum;	\
 	\
@@ -2198,48 +2416,61 @@ static void DrawBG(uint32 *target, int n, bool sub)
  }
 }
 
+// Shared by all instances.  UVLUT and RGBDeflower don't depend on the pixel format and are built once, by the first
+// KING_SetPixelFormat().  CbCrLUT does, and there's only one of it, so every instance is assumed to use the same Cb/Cr
+// shifts(the libretro frontend only ever sets one pixel format); it's rebuilt whenever they change.
 static int16 UVLUT[65536][3];
 static uint8 RGBDeflower[1152]; // 0 is at 384
 static uint32 CbCrLUT[65536];
+static bool UVLUTBuilt = false;
+static int CbCrLUTShifts[2] = { -1, -1 };
 
 static void RebuildUVLUT(const MDFN_PixelFormat &format)
 {
- for(int ur = 0; ur < 256; ur++)
+ if(!UVLUTBuilt)
  {
-  for(int vr = 0; vr < 256; vr++)
+  for(int ur = 0; ur < 256; ur++)
   {
-   int r, g, b;
-   int u, v;
-   
-   u = ur - 128;
-   v = vr - 128;
-
-   // FIXME:  Use lrint() ?
-   r = (int)(0 - 0.000039457070707 * u + 1.139827967171717 * v);
-   g = (int)(0 - 0.394610164141414 * u - 0.580500315656566 * v);
-   b = (int)(0 + 2.031999684343434 * u - 0.000481376262626 * v);
+   for(int vr = 0; vr < 256; vr++)
+   {
+    int u = ur - 128;
+    int v = vr - 128;
 
-   UVLUT[vr + ur * 256][0] = r;
-   UVLUT[vr + ur * 256][1] = g;
-   UVLUT[vr + ur * 256][2] = b;
- 
-   CbCrLUT[vr + ur * 256] = clamp_to_u8(128 + ((r * -9699 + g * -19071 + b * 28770) >> 16)) << format.Cbshift;
-   CbCrLUT[vr + ur * 256] |= clamp_to_u8(128 + ((r * 28770 + g * -24117 + b * -4653) >> 16)) << format.Crshift;
+    // FIXME:  Use lrint() ?
+    UVLUT[vr + ur * 256][0] = (int)(0 - 0.000039457070707 * u + 1.139827967171717 * v);
+    UVLUT[vr + ur * 256][1] = (int)(0 - 0.394610164141414 * u - 0.580500315656566 * v);
+    UVLUT[vr + ur * 256][2] = (int)(0 + 2.031999684343434 * u - 0.000481376262626 * v);
+   }
+  }
 
-   //printf("%d %d %d, %08x\n", r, g, b, CbCrLUT[vr + ur * 256]);
+  for(int x = 0; x < 1152; x++)
+  {
+   if(x < 384) RGBDeflower[x] = 0;
+   else if(x > (384 + 255)) RGBDeflower[x] = 255;
+   else
+    RGBDeflower[x] = x - 384;
   }
+
+  UVLUTBuilt = true;
  }
- for(int x = 0; x < 1152; x++)
+
+ if(CbCrLUTShifts[0] == format.Cbshift && CbCrLUTShifts[1] == format.Crshift)
+  return;
+
+ for(int i = 0; i < 65536; i++)
  {
-  if(x < 384) RGBDeflower[x] = 0;
-  else if(x > (384 + 255)) RGBDeflower[x] = 255;
-  else
-   RGBDeflower[x] = x - 384;
+  const int r = UVLUT[i][0];
+  const int g = UVLUT[i][1];
+  const int b = UVLUT[i][2];
+
+  CbCrLUT[i] = clamp_to_u8(128 + ((r * -9699 + g * -19071 + b * 28770) >> 16)) << format.Cbshift;
+  CbCrLUT[i] |= clamp_to_u8(128 + ((r * 28770 + g * -24117 + b * -4653) >> 16)) << format.Crshift;
  }
+
+ CbCrLUTShifts[0] = format.Cbshift;
+ CbCrLUTShifts[1] = format.Crshift;
 }
 
-// FIXME
-static int rs, gs, bs;
 static uint32 INLINE YUV888_TO_RGB888(uint32 yuv)
 {
  int32 r, g, b;
@@ -2253,7 +2484,7 @@ static uint32 INLINE YUV888_TO_RGB888(uint32 yuv)
  g = clamp_to_u8(g);
  b = clamp_to_u8(b);
 
- return((r << rs) | (g << gs) | (b << bs));
+ return((r << fxking->rs) | (g << fxking->gs) | (b << fxking->bs));
 }
 
 static uint32 INLINE YUV888_TO_PF(const uint32 yuv, const MDFN_PixelFormat &pf, const uint8 a = 0x00)
@@ -2279,52 +2510,196 @@ static uint32 INLINE YUV888_TO_YCbCr888(uint32 yuv)
 
 // FIXME: 
 //static unsigned int lines_per_frame; //= (fx_vce.picture_mode & 0x1) ? 262 : 263;
-static VDC **vdc_chips;
-static MDFN_Surface *surface;
-static MDFN_Rect *DisplayRect;
-static int32 *LineWidths;
-static int skip;
 
 void KING_StartFrame(VDC **arg_vdc_chips, EmulateSpecStruct *espec)	//MDFN_Surface *arg_surface, MDFN_Rect *arg_DisplayRect, MDFN_Rect *arg_LineWidths, int arg_skip)
 {
- ::vdc_chips = arg_vdc_chips;
- ::surface = espec->surface;
- ::DisplayRect = &espec->DisplayRect;
- ::LineWidths = espec->LineWidths;
- ::skip = espec->skip;
+ fxking->vdc_chips = arg_vdc_chips;
+ fxking->surface = espec->surface;
+ fxking->DisplayRect = &espec->DisplayRect;
+ fxking->LineWidths = espec->LineWidths;
+ fxking->skip = espec->skip;
 
  //MDFN_DispMessage("P0:%06x P1:%06x; I0: %06x I1: %06x", king->ADPCMPlayAddress[0], king->ADPCMPlayAddress[1], king->ADPCMIntermediateAddress[0] << 6, king->ADPCMIntermediateAddress[1] << 6);
  //MDFN_DispMessage("%d %d\n", SCSICD_GetACK(), SCSICD_GetREQ());
 
  // For the case of interlaced mode(clear ~0 state)
- LineWidths[0] = 0;
+ fxking->LineWidths[0] = 0;
 
  // These 2 should be overwritten in the big loop below.
- DisplayRect->x = 0;
- DisplayRect->w = 256;
+ fxking->DisplayRect->x = 0;
+ fxking->DisplayRect->w = 256;
 
- DisplayRect->y = MDFN_GetSettingUI("pcfx.slstart");
- DisplayRect->h = MDFN_GetSettingUI("pcfx.slend") - DisplayRect->y + 1;
+ fxking->DisplayRect->y = MDFN_GetSettingUI("pcfx.slstart");
+ fxking->DisplayRect->h = MDFN_GetSettingUI("pcfx.slend") - fxking->DisplayRect->y + 1;
 
- if(fx_vce.frame_interlaced)
+ if(fxking->fx_vce.frame_interlaced)
  {
-  skip = false;
+  fxking->skip = false;
+  espec->skip = false;
 
   espec->InterlaceOn = true;
-  espec->InterlaceField = fx_vce.odd_field;
-  DisplayRect->y *= 2;
-  DisplayRect->h *= 2;
+  espec->InterlaceField = fxking->fx_vce.odd_field;
+  fxking->DisplayRect->y *= 2;
+  fxking->DisplayRect->h *= 2;
+ }
+}
+
+static void BGLineCache_MakeKey(bg_linekey_t *key)
+{
+ memset(key, 0, sizeof(bg_linekey_t));
+
+ key->bgmode = king->bgmode;
+ key->priority = king->priority;
+ key->BGScrollMode = king->BGScrollMode;
+ key->PageSetting = king->PageSetting & 0x0010;
+ key->MPROGControl = king->MPROGControl & 0x1;
+
+ for(unsigned int n = 0; n < 4; n++)
+ {
+  key->BGSize[n] = king->BGSize[n];
+  key->BGXScroll[n] = king->BGXScroll[n];
+  key->BGYScroll[n] = king->BGYScroll[n];
+  key->BGBATAddr[n] = king->BGBATAddr[n];
+  key->BGCGAddr[n] = king->BGCGAddr[n];
+ }
+
+ key->BGAffin[0] = king->BGAffinA;
+ key->BGAffin[1] = king->BGAffinB;
+ key->BGAffin[2] = king->BGAffinC;
+ key->BGAffin[3] = king->BGAffinD;
+ key->BGAffin[4] = king->BGAffinCenterX;
+ key->BGAffin[5] = king->BGAffinCenterY;
+
+ memcpy(key->MPROGData, king->MPROGData, sizeof(key->MPROGData));
+
+ key->palette_offset[0] = fxking->fx_vce.palette_offset[1];
+ key->palette_offset[1] = fxking->fx_vce.palette_offset[2];
+ key->rc_palette_offset[0] = fxking->vce_rendercache.palette_offset[1];
+ key->rc_palette_offset[1] = fxking->vce_rendercache.palette_offset[2];
+ key->palette_gen = fxking->palette_gen;
+
+ key->BG0SubBATAddr = king->BG0SubBATAddr;
+ key->BG0SubCGAddr = king->BG0SubCGAddr;
+ key->BGLayerDisable = fxking->BGLayerDisable;
+}
+
+// Returns true if any of the 1KiB pages overlapping the "words" halfwords of KRAM from "offset", wrapping within its
+// 128K-halfword half as DrawBG() addresses it, was written after kram_gen "gen".
+static bool KRAMSpanWrittenSince(const uint32 *page_gen, const uint32 offset, const uint32 words, const uint32 gen)
+{
+ const uint32 half = (offset & 0x20000) >> 9;
+ const uint32 first = (offset & 0x1FFFF) >> 9;
+ const uint32 count = std::min<uint32>(((offset & 0x1FF) + words + 0x1FF) >> 9, 0x100);
+
+ for(uint32 i = 0; i < count; i++)
+ {
+  if(page_gen[half + ((first + i) & 0xFF)] > gen)
+   return(true);
+ }
+
+ return(false);
+}
+
+// Returns true if KRAM that BG n, with the registers as they are, could draw from was written after kram_gen "gen".
+// The BAT is bounded by the BG size; CG, by the bitmap size and by the 4096 tiles a BAT entry can address(or the whole
+// half in the 256 and 64K/16M color modes, where DrawBG()'s affine code doesn't mask the BAT entry), plus the 7
+// halfwords the microprogram can offset a CG fetch by.
+static bool BGLineKRAMWrittenSince(const int n, const uint32 gen)
+{
+ const uint16 bgmode = (king->bgmode >> (n * 4)) & 0xF;
+ const uint32 *page_gen = fxking->kram_page_gen[(king->PageSetting & 0x0010) ? 1 : 0];
+ const uint32 tile_words = ((bgmode & 0x7) == BGMODE_4) ? 0x8000 : (((bgmode & 0x7) == BGMODE_16) ? 0x10000 : 0x20000);
+
+ if(!(bgmode & 0x7) || (bgmode & 0x7) >= 6)
+  return(false);
+
+ for(unsigned int sub = 0; sub < (n ? 1U : 2U); sub++)
+ {
+  const uint32 width_shift = bg_ss_table[(bool)n][(king->BGSize[n] >> (sub ? 12 : 4)) & 0xF];
+  const uint32 height_shift = bg_ss_table[(bool)n][(king->BGSize[n] >> (sub ? 8 : 0)) & 0xF];
+  const uint32 bat_words = ((1 << width_shift) >> 3) * ((1 << height_shift) >> 3);
+  const uint32 cg_words = std::max<uint32>((1 << width_shift) << height_shift, tile_words) + 8;
+  const uint32 bat_offset = (sub ? king->BG0SubBATAddr : king->BGBATAddr[n]) * 1024;
+  const uint32 cg_offset = (sub ? king->BG0SubCGAddr : king->BGCGAddr[n]) * 1024;
+
+  if(KRAMSpanWrittenSince(page_gen, bat_offset, bat_words, gen) || KRAMSpanWrittenSince(page_gen, cg_offset, cg_words, gen))
+   return(true);
  }
+
+ return(false);
+}
+
+// Draws the enabled KING BGs for the current line, into its bg_linecache[] line, unless that line already has them as
+// they'd be drawn now.
+static void DrawBGLine(void)
+{
+ bg_linecache_t *lc = &fxking->bg_linecache[fxking->fx_vce.raster_counter - 22];
+ bg_linekey_t key;
+
+ BGLineCache_MakeKey(&key);
+ fxking->bg_line = lc->pixels + 8;
+
+ if(lc->valid && !memcmp(&lc->key, &key, sizeof(bg_linekey_t)))
+ {
+  bool written = false;
+
+  if(fxking->kram_write_gen > lc->kram_gen)
+  {
+   for(int x = 0; x < 4 && !written; x++)
+   {
+    if(((king->priority >> (x * 3)) & 0x7) && !(fxking->BGLayerDisable & (1 << x)))
+     written = BGLineKRAMWrittenSince(x, lc->kram_gen);
+   }
+  }
+
+  if(!written)
+  {
+   PCFX_Prof_CountBGCachedLine();
+   return;
+  }
+ }
+
+ MDFN_FastU32MemsetM8(lc->pixels + 8, 0, 256);
+
+ for(int prio = 1; prio <= 7; prio++)
+ {
+  for(int x = 0; x < 4; x++)
+  {
+   int thisprio = (king->priority >> (x * 3)) & 0x7;
+
+   if(fxking->BGLayerDisable & (1 << x)) continue;
+
+   if(thisprio == prio)
+   {
+    const unsigned int fallback = CheckDrawBG_Fast(x);
+
+    PCFX_Prof_CountBGLine(x, fallback);
+
+    // TODO/FIXME: TEST MORE
+    if(fallback == PCFX_BGFALLBACK_NONE)
+     DrawBG_Fast(lc->pixels, x);
+    else if(fallback != PCFX_BGFALLBACK_BLANK)
+     DrawBG(lc->pixels, x, 0);
+   }
+  }
+ }
+
+ lc->valid = true;
+ lc->key = key;
+ lc->kram_gen = fxking->kram_gen;
+
+ // KRAM written from here on is newer than this line.  After 2^32 lines, start over.
+ if(!++fxking->kram_gen)
+  BGLineCache_Invalidate();
 }
 
-static int rb_type;
 //  unsigned int width = (fx_vce.picture_mode & 0x08) ? 341 : 256;
 
 static void DrawActive(void)
 {
- rb_type = -1;
+ fxking->rb_type = -1;
 
- if(fx_vce.raster_counter == king->RAINBOWTransferStartPosition && (king->RAINBOWTransferControl & 1))
+ if(fxking->fx_vce.raster_counter == king->RAINBOWTransferStartPosition && (king->RAINBOWTransferControl & 1))
  {
   king->RAINBOWStartPending = TRUE;
 
@@ -2334,7 +2709,7 @@ static void DrawActive(void)
   // puts("MOOO");
  }
 
- if(fx_vce.raster_counter < 262)
+ if(fxking->fx_vce.raster_counter < 262)
  {
   if(king->RAINBOWBusyCount)
   {
@@ -2369,44 +2744,46 @@ static void DrawActive(void)
    {
     king->RAINBOWBusyCount = 16;
 
-    if(fx_vce.raster_counter == 262)
+    if(fxking->fx_vce.raster_counter == 262)
      king->RAINBOWBusyCount++;
 
     // If we ever change the emulation time range from the current 0 through 262/263, we will need to readjust this
     // statement to prevent the previous frame's skip value to mess up the current frame's graphics data, since
     // RAINBOW data is delayed by 16 scanlines from when it's decoded(16 + 15 maximum delay).
-    RAINBOW_DecodeBlock(FirstDecode, skip && fx_vce.raster_counter < 246);
+    const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_RAINBOW);
+    RAINBOW_DecodeBlock(FirstDecode, fxking->skip && fxking->fx_vce.raster_counter < 246);
+    PCFX_Prof_Leave(prof);
    }
   }
 
-  rb_type = RAINBOW_FetchRaster(skip ? NULL : rainbow_linebuffer, LAYER_RAINBOW << 28, &vce_rendercache.palette_table_cache[((fx_vce.palette_offset[3] >> 0) & 0xFF) << 1]);
+  fxking->rb_type = RAINBOW_FetchRaster(fxking->skip ? NULL : fxking->rainbow_linebuffer, LAYER_RAINBOW << 28, &fxking->vce_rendercache.palette_table_cache[((fxking->fx_vce.palette_offset[3] >> 0) & 0xFF) << 1]);
 
   king->RAINBOWStartPending = FALSE;
  } // end   if(fx_vce.raster_counter < 262)
 
- if(fx_vce.raster_counter >= 22 && fx_vce.raster_counter < 262)
+ if(fxking->fx_vce.raster_counter >= 22 && fxking->fx_vce.raster_counter < 262)
  {
-  if(!skip)
+  if(!fxking->skip)
   {
-   if(rb_type == 1) // YUV
+   if(fxking->rb_type == 1) // YUV
    {
     // Only chroma key when we're not in 7.16MHz pixel mode
-    if(!(fx_vce.picture_mode & 0x08))
+    if(!(fxking->fx_vce.picture_mode & 0x08))
     {
-     const unsigned int ymin = fx_vce.ChromaKeyY & 0xFF;
-     const unsigned int ymax = fx_vce.ChromaKeyY >> 8;
-     const unsigned int umin = fx_vce.ChromaKeyU & 0xFF;
-     const unsigned int umax = fx_vce.ChromaKeyU >> 8;
-     const unsigned int vmin = fx_vce.ChromaKeyV & 0xFF;
-     const unsigned int vmax = fx_vce.ChromaKeyV >> 8;
-
-     if((fx_vce.ChromaKeyY | fx_vce.ChromaKeyU | fx_vce.ChromaKeyV) == 0)
+     const unsigned int ymin = fxking->fx_vce.ChromaKeyY & 0xFF;
+     const unsigned int ymax = fxking->fx_vce.ChromaKeyY >> 8;
+     const unsigned int umin = fxking->fx_vce.ChromaKeyU & 0xFF;
+     const unsigned int umax = fxking->fx_vce.ChromaKeyU >> 8;
+     const unsigned int vmin = fxking->fx_vce.ChromaKeyV & 0xFF;
+     const unsigned int vmax = fxking->fx_vce.ChromaKeyV >> 8;
+
+     if((fxking->fx_vce.ChromaKeyY | fxking->fx_vce.ChromaKeyU | fxking->fx_vce.ChromaKeyV) == 0)
      {
       //puts("Opt: 0 chroma key");
       for(int x = 0; x < 256; x++)
       {
-       if(!(rainbow_linebuffer[x] & 0xFFFFFF))
-        rainbow_linebuffer[x] = 0;
+       if(!(fxking->rainbow_linebuffer[x] & 0xFFFFFF))
+        fxking->rainbow_linebuffer[x] = 0;
       }
      }
      else if(ymin == ymax && umin == umax && vmin == vmax)
@@ -2417,8 +2794,8 @@ static void DrawActive(void)
 
       for(int x = 0; x < 256; x++)
       {
-       if((rainbow_linebuffer[x] & 0xFFFFFF) == compare_color)
-        rainbow_linebuffer[x] = 0;
+       if((fxking->rainbow_linebuffer[x] & 0xFFFFFF) == compare_color)
+        fxking->rainbow_linebuffer[x] = 0;
       }
      }
      else if(ymin <= ymax && umin <= umax && vmin <= vmax)
@@ -2430,7 +2807,7 @@ static void DrawActive(void)
 
       for(int x = 0; x < 256; x++)
       {
-       const uint32 pixel = rainbow_linebuffer[x];
+       const uint32 pixel = fxking->rainbow_linebuffer[x];
        const uint32 yv = pixel & 0xFF00FF;
        const uint32 u = pixel & 0x00FF00;
        uint32 testie;
@@ -2439,7 +2816,7 @@ static void DrawActive(void)
        testie |= ((u - u_min_sub) | (u + u_max_add)) & 0x00FF00FF;
 
        if(!testie)
-        rainbow_linebuffer[x] = 0;
+        fxking->rainbow_linebuffer[x] = 0;
       }
      }
      else
@@ -2455,32 +2832,13 @@ static void DrawActive(void)
         0 = Hidden
     */
 
-   MDFN_FastU32MemsetM8(bg_linebuffer + 8, 0, 256);
-
     // Only bother to draw the BGs if the microprogram is enabled.
    if(king->MPROGControl & 0x1)
+    DrawBGLine();
+   else
    {
-    for(int prio = 1; prio <= 7; prio++)
-    {
-     for(int x = 0; x < 4; x++)
-     {
-      int thisprio = (king->priority >> (x * 3)) & 0x7;
-
-      if(BGLayerDisable & (1 << x)) continue;
-
-      if(thisprio == prio)
-      {
-       //if(fx_vce.raster_counter == 50)
-        // CanDrawBG_Fast(x);
-
-       // TODO/FIXME: TEST MORE
-       if(CanDrawBG_Fast(x)) // && (rand() & 1))
-	DrawBG_Fast(bg_linebuffer, x);
-       else
-        DrawBG(bg_linebuffer, x, 0);
-      }
-     }
-    }
+    MDFN_FastU32MemsetM8(fxking->bg_linebuffer + 8, 0, 256);
+    fxking->bg_line = fxking->bg_linebuffer + 8;
    }
 
   } // end if(!skip)
@@ -2491,15 +2849,15 @@ static INLINE void VDC_PIXELMIX(bool SPRCOMBO_ON, bool BGCOMBO_ON)
 {
     static const uint32 vdc_layer_num[2] = { LAYER_VDC_BG << 28, LAYER_VDC_SPR << 28};
     const uint32 vdc_poffset[2] = {
-                                (((uint32)fx_vce.palette_offset[0] >> 0) & 0xFF) << 1, // BG
-                                (((uint32)fx_vce.palette_offset[0] >> 8) & 0xFF) << 1 // SPR
+                                (((uint32)fxking->fx_vce.palette_offset[0] >> 0) & 0xFF) << 1, // BG
+                                (((uint32)fxking->fx_vce.palette_offset[0] >> 8) & 0xFF) << 1 // SPR
                                };
 
-    const int width = fx_vce.dot_clock ? 342 : 256; // 342, not 341, to prevent garbage pixels in high dot clock mode.
+    const int width = fxking->fx_vce.dot_clock ? 342 : 256; // 342, not 341, to prevent garbage pixels in high dot clock mode.
 
     for(int x = 0; x < width; x++)
     {
-     const uint32 zort[2] = { vdc_linebuffers[0][x], vdc_linebuffers[1][x] };
+     const uint32 zort[2] = { fxking->vdc_linebuffers[0][x], fxking->vdc_linebuffers[1][x] };
      uint32 tmp_pixel;
    
      /* SPR combination */
@@ -2511,10 +2869,10 @@ static INLINE void VDC_PIXELMIX(bool SPRCOMBO_ON, bool BGCOMBO_ON)
      else
       tmp_pixel = (zort[1] & 0xF) ? zort[1] : zort[0];
 
-     vdc_linebuffer[x] = tmp_pixel;
-     vdc_linebuffer_yuved[x] = 0;
+     fxking->vdc_linebuffer[x] = tmp_pixel;
+     fxking->vdc_linebuffer_yuved[x] = 0;
      if(tmp_pixel & 0xF)
-      vdc_linebuffer_yuved[x] = vce_rendercache.palette_table_cache[(tmp_pixel & 0xFF) + vdc_poffset[(tmp_pixel >> 8) & 1]] | vdc_layer_num[(tmp_pixel >> 8) & 1];
+      fxking->vdc_linebuffer_yuved[x] = fxking->vce_rendercache.palette_table_cache[(tmp_pixel & 0xFF) + vdc_poffset[(tmp_pixel >> 8) & 1]] | vdc_layer_num[(tmp_pixel >> 8) & 1];
     }
 }
 
@@ -2522,11 +2880,11 @@ static void MixVDC(void) NO_INLINE;
 static void MixVDC(void)
 {
     // Optimization for when both layers are disabled in the VCE.
-    if(!vce_rendercache.LayerPriority[LAYER_VDC_BG] && !vce_rendercache.LayerPriority[LAYER_VDC_SPR])
+    if(!fxking->vce_rendercache.LayerPriority[LAYER_VDC_BG] && !fxking->vce_rendercache.LayerPriority[LAYER_VDC_SPR])
     {
-     MDFN_FastU32MemsetM8(vdc_linebuffer_yuved, 0, 512);
+     MDFN_FastU32MemsetM8(fxking->vdc_linebuffer_yuved, 0, 512);
     }
-    else switch(fx_vce.picture_mode & 0xC0)
+    else switch(fxking->fx_vce.picture_mode & 0xC0)
     {
      case 0x00: VDC_PIXELMIX(0, 0); break;      // None on
      case 0x40: VDC_PIXELMIX(0, 1); break;      // BG combo on
@@ -2536,9 +2894,359 @@ static void MixVDC(void)
 }
 
 
+#ifdef __SSE2__
+// The SSE2 version of MixLayers() mixes a line 4 pixels at a time into YUV, and then converts it to the output format.
+// It mixes the same pixels as the LAYER_MIX_* macros(which are the reference, for other targets).
+
+// table[layer] per lane, for the layers a source can have; the others are 0.
+struct mix_lut_t
+{
+ unsigned int count;
+ __m128i layer[8];
+ __m128i value[8];
+};
+
+static void MixLUT_Build(mix_lut_t *lut, const uint32 *table, const unsigned int first, const unsigned int last)
+{
+ lut->count = 0;
+
+ for(unsigned int l = first; l <= last; l++)
+ {
+  if(table[l])
+  {
+   lut->layer[lut->count] = _mm_set1_epi32(l << 28);
+   lut->value[lut->count] = _mm_set1_epi32(table[l]);
+   lut->count++;
+  }
+ }
+}
+
+static INLINE __m128i MixLUT_Lookup(const mix_lut_t &lut, const __m128i pixel)
+{
+ const __m128i layer = _mm_and_si128(pixel, _mm_set1_epi32(0xF0000000));
+ __m128i ret = _mm_setzero_si128();
+
+ for(unsigned int i = 0; i < lut.count; i++)
+  ret = _mm_or_si128(ret, _mm_and_si128(_mm_cmpeq_epi32(layer, lut.layer[i]), lut.value[i]));
+
+ return(ret);
+}
+
+static INLINE __m128i MixSelect(const __m128i mask, const __m128i a, const __m128i b)
+{
+ return(_mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)));
+}
+
+// Without cellophane, the mixed pixel is the frontmost non-transparent pixel of an enabled layer, else bpc.  Each
+// source's remapped priority is 0 where its pixel is transparent or its layer disabled, and the enabled layers'
+// priorities differ, so a pixel's key, (priority << 24 | Y-U-V), or 0 if its priority is 0, is the greatest of the
+// keys for that position, bpc's key being its Y-U-V.
+static INLINE __m128i MixKey(const mix_lut_t &prio, const __m128i pixel)
+{
+ const __m128i p = MixLUT_Lookup(prio, pixel);
+
+ return(_mm_andnot_si128(_mm_cmpeq_epi32(p, _mm_setzero_si128()), _mm_or_si128(_mm_slli_epi32(p, 24), _mm_and_si128(pixel, _mm_set1_epi32(0xFFFFFF)))));
+}
+
+static INLINE __m128i MixMax(const __m128i a, const __m128i b)
+{
+ return(MixSelect(_mm_cmpgt_epi32(a, b), a, b));
+}
+
+// Keys count(a multiple of 4) pixels.
+static void MixKeyLine(uint32 *out, const uint32 *src, const unsigned int count, const mix_lut_t &prio)
+{
+ for(unsigned int x = 0; x < count; x += 4)
+  _mm_store_si128((__m128i *)&out[x], MixKey(prio, _mm_loadu_si128((const __m128i *)&src[x])));
+}
+
+// Mixes the 256 pixels of a line with no cellophane; the layer bits of the result are garbage.
+static void MixLine_NoCello(uint32 *out, const mix_lut_t *prio, const uint32 bpc)
+{
+ const __m128i bpc_key = _mm_set1_epi32(bpc & 0xFFFFFF);
+
+ for(unsigned int x = 0; x < 256; x += 4)
+ {
+  __m128i zeout = MixMax(bpc_key, MixKey(prio[0], _mm_loadu_si128((const __m128i *)&fxking->vdc_linebuffer_yuved[x])));
+
+  zeout = MixMax(zeout, MixKey(prio[1], _mm_loadu_si128((const __m128i *)&fxking->bg_line[x])));
+  zeout = MixMax(zeout, MixKey(prio[2], _mm_loadu_si128((const __m128i *)&fxking->rainbow_linebuffer[x])));
+
+  _mm_store_si128((__m128i *)&out[x], zeout);
+ }
+}
+
+// Mixes a high dot-clock line, count pixels wide, with no cellophane, as MixLine_NoCello() does.  The KING layers are
+// stretched from 256 pixels, and the VDC layers from 341; in the 1024-pixel mode, 12 pixels take 3 KING and 4 VDC
+// pixels, so that's done 4 at a time with shuffles, else the stretched source is gathered.
+static void MixLine_HighDotClock(uint32 *out, const unsigned int count, const mix_lut_t *prio, const uint32 bpc)
+{
+ MDFN_ALIGN(16) uint32 vdc_key[344];
+ MDFN_ALIGN(16) uint32 king_key[256 + 4];
+ const __m128i bpc_key = _mm_set1_epi32(bpc & 0xFFFFFF);
+
+ MixKeyLine(vdc_key, fxking->vdc_linebuffer_yuved, 344, prio[0]);
+
+ for(unsigned int x = 0; x < 256; x += 4)
+ {
+  const __m128i bg = MixKey(prio[1], _mm_loadu_si128((const __m128i *)&fxking->bg_line[x]));
+  const __m128i rb = MixKey(prio[2], _mm_loadu_si128((const __m128i *)&fxking->rainbow_linebuffer[x]));
+
+  _mm_store_si128((__m128i *)&king_key[x], MixMax(MixMax(bg, rb), bpc_key));
+ }
+ _mm_store_si128((__m128i *)&king_key[256], bpc_key);
+
+ if(count == 1024)
+ {
+  for(unsigned int x = 0; x < 1024; x += 12)
+  {
+   const __m128i k = _mm_loadu_si128((const __m128i *)&king_key[x / 4]);
+   const __m128i v = _mm_loadu_si128((const __m128i *)&vdc_key[x / 3]);
+
+   _mm_store_si128((__m128i *)&out[x + 0], MixMax(_mm_shuffle_epi32(k, 0x00), _mm_shuffle_epi32(v, 0x40)));
+   _mm_store_si128((__m128i *)&out[x + 4], MixMax(_mm_shuffle_epi32(k, 0x55), _mm_shuffle_epi32(v, 0xA5)));
+   _mm_store_si128((__m128i *)&out[x + 8], MixMax(_mm_shuffle_epi32(k, 0xAA), _mm_shuffle_epi32(v, 0xFE)));
+  }
+ }
+ else if(count == 341)
+ {
+  for(unsigned int x = 0; x < 341; x += 4)
+  {
+   const __m128i k = _mm_set_epi32(king_key[(x + 3) * 256 / 341], king_key[(x + 2) * 256 / 341], king_key[(x + 1) * 256 / 341], king_key[x * 256 / 341]);
+
+   _mm_store_si128((__m128i *)&out[x], MixMax(k, _mm_load_si128((const __m128i *)&vdc_key[x])));
+  }
+ }
+ else
+ {
+  for(unsigned int x = 0; x < 256; x += 4)
+  {
+   const __m128i v = _mm_set_epi32(vdc_key[(x + 3) * 341 / 256], vdc_key[(x + 2) * 341 / 256], vdc_key[(x + 1) * 341 / 256], vdc_key[x * 341 / 256]);
+
+   _mm_store_si128((__m128i *)&out[x], MixMax(_mm_load_si128((const __m128i *)&king_key[x]), v));
+  }
+ }
+}
+
+// coefficient_mul_table_y/uv[][] for q's Y, U and V, in the low 16 bits of each lane: (Y * coefficient) / 8 as a uint8,
+// and ((U or V - 128) * coefficient) / 8 rounded toward 0 as an int8.  coeff holds the coefficients in bits 8-11(Y),
+// 4-7(U) and 0-3(V).
+static INLINE void MixCoeff(const __m128i q, const __m128i coeff, __m128i *y, __m128i *u, __m128i *v)
+{
+ const __m128i ff = _mm_set1_epi32(0xFF);
+ const __m128i f = _mm_set1_epi32(0xF);
+ const __m128i t_u = _mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(_mm_srli_epi32(q, 8), ff), _mm_set1_epi32(128)), _mm_and_si128(_mm_srli_epi32(coeff, 4), f));
+ const __m128i t_v = _mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(q, ff), _mm_set1_epi32(128)), _mm_and_si128(coeff, f));
+
+ *y = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(q, 16), ff), _mm_and_si128(_mm_srli_epi32(coeff, 8), f)), 3), ff);
+ *u = _mm_srai_epi16(_mm_slli_epi16(_mm_srai_epi16(_mm_add_epi16(t_u, _mm_and_si128(_mm_srai_epi16(t_u, 15), _mm_set1_epi32(7))), 3), 8), 8);
+ *v = _mm_srai_epi16(_mm_slli_epi16(_mm_srai_epi16(_mm_add_epi16(t_v, _mm_and_si128(_mm_srai_epi16(t_v, 15), _mm_set1_epi32(7))), 3), 8), 8);
+}
+
+// (layer | y << 16 | (u + 128) << 8 | (v + 128)), clamping each to 0-255 as RGBDeflower[] does.
+static INLINE __m128i MixPackYUV(const __m128i layer, const __m128i y, const __m128i u, const __m128i v)
+{
+ const __m128i lo = _mm_setzero_si128();
+ const __m128i hi = _mm_set1_epi32(0xFF);
+ const __m128i bias = _mm_set1_epi32(128);
+ const __m128i cy = _mm_max_epi16(_mm_min_epi16(y, hi), lo);
+ const __m128i cu = _mm_max_epi16(_mm_min_epi16(_mm_add_epi16(u, bias), hi), lo);
+ const __m128i cv = _mm_max_epi16(_mm_min_epi16(_mm_add_epi16(v, bias), hi), lo);
+
+ return(_mm_or_si128(_mm_or_si128(layer, _mm_slli_epi32(cy, 16)), _mm_or_si128(_mm_slli_epi32(cu, 8), cv)));
+}
+
+enum
+{
+ MIX_CELLO_NORMAL = 0,	// On some layers.
+ MIX_CELLO_BACK,
+ MIX_CELLO_FRONT
+};
+
+#define MIX_CELLO_KEY_ON 0x01000000
+
+static INLINE void MixSwap(const __m128i mask, __m128i *a, __m128i *b)
+{
+ const __m128i d = _mm_and_si128(mask, _mm_xor_si128(*a, *b));
+
+ *a = _mm_xor_si128(*a, d);
+ *b = _mm_xor_si128(*b, d);
+}
+
+// Mixes the 256 pixels of a line with cellophane, as LAYER_MIX_FINAL_CELLO, LAYER_MIX_FINAL_BACK_CELLO or
+// LAYER_MIX_FINAL_FRONT_CELLO.  key[] holds, per source, (priority << 28 | MIX_CELLO_KEY_ON | coefficients) for each
+// enabled layer, coefficients being the fore(bits 12-23) and back(bits 0-11) ones for the layer's ble_cache[] value
+// and MIX_CELLO_KEY_ON set if it's not 0.  Each pixel's three sources are sorted by key, hindmost first, and then
+// mixed in that order.  For front cellophane, front_ccr is CCR times the fore coefficients of set 0, Y-U-V as
+// MixCoeff() returns it, and front_coeff the back coefficients of set 0, as DOCELLOSPECIALFRONT() has them.
+static INLINE void MixLine_Cello(uint32 *out, const unsigned int mode, const mix_lut_t *key, const uint32 front_coeff, const uint32 spbl,
+	const __m128i *front_ccr, const uint32 bpc)
+{
+ const uint32 *src_ptr[3] = { fxking->vdc_linebuffer_yuved, fxking->bg_line, fxking->rainbow_linebuffer };
+ const __m128i spr = _mm_set1_epi32(LAYER_VDC_SPR << 28);
+ const __m128i on = _mm_set1_epi32(MIX_CELLO_KEY_ON);
+
+ for(unsigned int x = 0; x < 256; x += 4)
+ {
+  __m128i src[3], k[3];
+
+  for(unsigned int i = 0; i < 3; i++)
+  {
+   src[i] = _mm_loadu_si128((const __m128i *)&src_ptr[i][x]);
+   k[i] = MixLUT_Lookup(key[i], src[i]);
+  }
+
+  // No cellophane for the sprite pixels whose palette bank(bits 4-7 of vdc_linebuffer[]) SPBL excludes; 1 << bank
+  // is made as a float.
+  {
+   const __m128i bank = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i *)&fxking->vdc_linebuffer[x]), 4), _mm_set1_epi32(0xF));
+   const __m128i bit = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(bank, _mm_set1_epi32(127)), 23)));
+   const __m128i excluded = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(src[0], _mm_set1_epi32(0xF0000000)), spr),
+					   _mm_cmpeq_epi32(_mm_and_si128(bit, _mm_set1_epi32(spbl)), _mm_setzero_si128()));
+
+   k[0] = _mm_andnot_si128(_mm_and_si128(excluded, on), k[0]);
+  }
+
+  // Sort hindmost first; the enabled layers' priorities differ.
+  for(unsigned int i = 0; i < 3; i++)
+  {
+   const unsigned int a = (i == 1) ? 1 : 0;
+   const __m128i swap = _mm_cmpgt_epi32(k[a], k[a + 1]);
+
+   MixSwap(swap, &src[a], &src[a + 1]);
+   MixSwap(swap, &k[a], &k[a + 1]);
+  }
+
+  __m128i zeout = _mm_set1_epi32(bpc);
+
+  for(unsigned int i = 0; i < 3; i++)
+  {
+   const __m128i shown = _mm_cmpgt_epi32(k[i], _mm_set1_epi32(0x0FFFFFFF));
+   __m128i next = MixSelect(shown, src[i], zeout);
+
+   // Except with back cellophane, the hindmost pixel has no layer behind it to mix with.
+   if(mode == MIX_CELLO_BACK || i)
+   {
+    __m128i cello = _mm_and_si128(shown, _mm_cmpeq_epi32(_mm_and_si128(k[i], on), on));
+
+    if(mode != MIX_CELLO_BACK)
+     cello = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_srli_epi32(zeout, 28), _mm_setzero_si128()), cello);
+
+    if(_mm_movemask_epi8(cello))
+    {
+     __m128i by, bu, bv, fy, fu, fv;
+
+     MixCoeff(zeout, k[i], &by, &bu, &bv);
+     MixCoeff(src[i], _mm_srli_epi32(k[i], 12), &fy, &fu, &fv);
+     next = MixSelect(cello, MixPackYUV(_mm_and_si128(src[i], _mm_set1_epi32(0xFF000000)), _mm_add_epi16(by, fy), _mm_add_epi16(bu, fu), _mm_add_epi16(bv, fv)), next);
+    }
+   }
+   zeout = next;
+  }
+
+  if(mode == MIX_CELLO_FRONT)
+  {
+   __m128i by, bu, bv;
+
+   MixCoeff(zeout, _mm_set1_epi32(front_coeff), &by, &bu, &bv);
+   zeout = MixPackYUV(_mm_and_si128(zeout, _mm_set1_epi32(0xFF000000)), _mm_add_epi16(by, front_ccr[0]), _mm_add_epi16(bu, front_ccr[1]), _mm_add_epi16(bv, front_ccr[2]));
+  }
+
+  _mm_store_si128((__m128i *)&out[x], zeout);
+ }
+}
+
+// Converts count mixed pixels, reusing the previous pixel's conversion for runs of the same color.
+#define MIX_CONVERT_LINE(YUV888_TO_xxx)			\
+	{						\
+	 uint32 prev_yuv = ~0U;				\
+	 uint32 prev_out = 0;				\
+							\
+	 for(unsigned int x = 0; x < count; x++)	\
+	 {						\
+	  const uint32 yuv = line[x] & 0xFFFFFF;	\
+							\
+	  if(yuv != prev_yuv)				\
+	  {						\
+	   prev_yuv = yuv;				\
+	   prev_out = YUV888_TO_xxx(yuv);		\
+	  }						\
+	  target[x] = prev_out;				\
+	 }						\
+	}
+
+static void MixConvertLine(uint32 *target, const uint32 *line, const unsigned int count)
+{
+ if(fxking->surface->format.colorspace == MDFN_COLORSPACE_YCbCr)
+  MIX_CONVERT_LINE(YUV888_TO_YCbCr888)
+ else
+  MIX_CONVERT_LINE(YUV888_TO_RGB888)
+}
+
+#undef MIX_CONVERT_LINE
+
+static void MixLayers_SSE2(uint32 *target, const uint32 *priority_remap, const uint32 *ble_cache, const bool ble_cache_any, uint32 BPC_Cache)
+{
+ MDFN_ALIGN(16) uint32 line[1024 + 8];
+
+ if(fxking->fx_vce.dot_clock || (!(fxking->vce_rendercache.BLE & 0x4000) && !ble_cache_any))
+ {
+  mix_lut_t prio[3];
+
+  MixLUT_Build(&prio[0], priority_remap, LAYER_VDC_BG, LAYER_VDC_SPR);
+  MixLUT_Build(&prio[1], priority_remap, LAYER_BG0, LAYER_BG0 + 3);
+  MixLUT_Build(&prio[2], priority_remap, LAYER_RAINBOW, LAYER_RAINBOW);
+
+  if(fxking->fx_vce.dot_clock) // No cellophane in 7.16MHz pixel mode
+  {
+   MixLine_HighDotClock(line, fxking->HighDotClockWidth, prio, BPC_Cache);
+   MixConvertLine(target, line, fxking->HighDotClockWidth);
+   return;
+  }
+
+  MixLine_NoCello(line, prio, BPC_Cache);
+  MixConvertLine(target, line, 256);
+  return;
+ }
+
+ const uint16 *coefficients = fxking->vce_rendercache.coefficients;
+ uint32 cello_key[8];
+ mix_lut_t key[3];
+ __m128i front_ccr[3];
+
+ for(unsigned int n = 0; n < 8; n++)
+ {
+  cello_key[n] = priority_remap[n] << 28;
+
+  if(priority_remap[n] && ble_cache[n])
+   cello_key[n] |= MIX_CELLO_KEY_ON | ((coefficients[(ble_cache[n] - 1) * 2 + 0] & 0xFFF) << 12) | (coefficients[(ble_cache[n] - 1) * 2 + 1] & 0xFFF);
+ }
+
+ MixLUT_Build(&key[0], cello_key, LAYER_VDC_BG, LAYER_VDC_SPR);
+ MixLUT_Build(&key[1], cello_key, LAYER_BG0, LAYER_BG0 + 3);
+ MixLUT_Build(&key[2], cello_key, LAYER_RAINBOW, LAYER_RAINBOW);
+
+ if((fxking->vce_rendercache.BLE & 0xC000) == 0xC000) // Front cellophane
+ {
+  MixCoeff(_mm_set1_epi32(((fxking->vce_rendercache.CCR & 0xFF00) << 8) | ((fxking->vce_rendercache.CCR & 0xF0) << 8) | ((fxking->vce_rendercache.CCR & 0x0F) << 4)),
+	   _mm_set1_epi32(coefficients[0] & 0xFFF), &front_ccr[0], &front_ccr[1], &front_ccr[2]);
+  MixLine_Cello(line, MIX_CELLO_FRONT, key, coefficients[1] & 0xFFF, fxking->vce_rendercache.SPBL, front_ccr, 0x008080 | (LAYER_NONE << 28));
+ }
+ else if((fxking->vce_rendercache.BLE & 0xC000) == 0x4000) // Back cellophane
+ {
+  BPC_Cache = ((fxking->vce_rendercache.CCR & 0xFF00) << 8) | ((fxking->vce_rendercache.CCR & 0xF0) << 8) | ((fxking->vce_rendercache.CCR & 0x0F) << 4) | (LAYER_NONE << 28);
+  MixLine_Cello(line, MIX_CELLO_BACK, key, coefficients[1] & 0xFFF, fxking->vce_rendercache.SPBL, NULL, BPC_Cache);
+ }
+ else
+  MixLine_Cello(line, MIX_CELLO_NORMAL, key, coefficients[1] & 0xFFF, fxking->vce_rendercache.SPBL, NULL, BPC_Cache);
+
+ MixConvertLine(target, line, 256);
+}
+#endif
+
 static void MixLayers(void)
 {
- uint32 *pXBuf = surface->pixels;
+ uint32 *pXBuf = fxking->surface->pixels;
 
     // Now we have to mix everything together... I'm scared, mommy.
     // We have, vdc_linebuffer[0] and bg_linebuffer
@@ -2549,21 +3257,21 @@ static void MixLayers(void)
 
     for(int n = 0; n < 8; n++)
     {
-     priority_remap[n] = vce_rendercache.LayerPriority[n];
+     priority_remap[n] = fxking->vce_rendercache.LayerPriority[n];
      //printf("%d: %d\n", n, priority_remap[n]);
     }
 
     // Rainbow layer disabled?
-    if(rb_type == -1 || RAINBOWLayerDisable)
+    if(fxking->rb_type == -1 || fxking->RAINBOWLayerDisable)
      priority_remap[LAYER_RAINBOW] = 0;
 
     ble_cache[LAYER_NONE] = 0;
     for(int x = 0; x < 4; x++)
-     ble_cache[LAYER_BG0 + x] = (vce_rendercache.BLE >> (4 + x * 2)) & 0x3;
+     ble_cache[LAYER_BG0 + x] = (fxking->vce_rendercache.BLE >> (4 + x * 2)) & 0x3;
 
-    ble_cache[LAYER_VDC_BG] = (vce_rendercache.BLE >> 0) & 0x3;
-    ble_cache[LAYER_VDC_SPR] = (vce_rendercache.BLE >> 2) & 0x3;
-    ble_cache[LAYER_RAINBOW] = (vce_rendercache.BLE >> 12) & 0x3;
+    ble_cache[LAYER_VDC_BG] = (fxking->vce_rendercache.BLE >> 0) & 0x3;
+    ble_cache[LAYER_VDC_SPR] = (fxking->vce_rendercache.BLE >> 2) & 0x3;
+    ble_cache[LAYER_RAINBOW] = (fxking->vce_rendercache.BLE >> 12) & 0x3;
 
     for(int x = 0; x < 8; x++)
      if(ble_cache[x])
@@ -2572,6 +3280,7 @@ static void MixLayers(void)
       break;
      }
    
+#ifndef __SSE2__
     uint8 *coeff_cache_y_back[3];
     int8 *coeff_cache_u_back[3], *coeff_cache_v_back[3];
     uint8 *coeff_cache_y_fore[3];
@@ -2579,22 +3288,23 @@ static void MixLayers(void)
 
     for(int x = 0; x < 3; x++)
     {
-     coeff_cache_y_fore[x] = vce_rendercache.coefficient_mul_table_y[(vce_rendercache.coefficients[x * 2 + 0] >> 8) & 0xF];
-     coeff_cache_u_fore[x] = vce_rendercache.coefficient_mul_table_uv[(vce_rendercache.coefficients[x * 2 + 0] >> 4) & 0xF];
-     coeff_cache_v_fore[x] = vce_rendercache.coefficient_mul_table_uv[(vce_rendercache.coefficients[x * 2 + 0] >> 0) & 0xF];
+     coeff_cache_y_fore[x] = fxking->vce_rendercache.coefficient_mul_table_y[(fxking->vce_rendercache.coefficients[x * 2 + 0] >> 8) & 0xF];
+     coeff_cache_u_fore[x] = fxking->vce_rendercache.coefficient_mul_table_uv[(fxking->vce_rendercache.coefficients[x * 2 + 0] >> 4) & 0xF];
+     coeff_cache_v_fore[x] = fxking->vce_rendercache.coefficient_mul_table_uv[(fxking->vce_rendercache.coefficients[x * 2 + 0] >> 0) & 0xF];
 
-     coeff_cache_y_back[x] = vce_rendercache.coefficient_mul_table_y[(vce_rendercache.coefficients[x * 2 + 1] >> 8) & 0xF];
-     coeff_cache_u_back[x] = vce_rendercache.coefficient_mul_table_uv[(vce_rendercache.coefficients[x * 2 + 1] >> 4) & 0xF];
-     coeff_cache_v_back[x] = vce_rendercache.coefficient_mul_table_uv[(vce_rendercache.coefficients[x * 2 + 1] >> 0) & 0xF];
+     coeff_cache_y_back[x] = fxking->vce_rendercache.coefficient_mul_table_y[(fxking->vce_rendercache.coefficients[x * 2 + 1] >> 8) & 0xF];
+     coeff_cache_u_back[x] = fxking->vce_rendercache.coefficient_mul_table_uv[(fxking->vce_rendercache.coefficients[x * 2 + 1] >> 4) & 0xF];
+     coeff_cache_v_back[x] = fxking->vce_rendercache.coefficient_mul_table_uv[(fxking->vce_rendercache.coefficients[x * 2 + 1] >> 0) & 0xF];
     }
+#endif
 
     uint32 *target;
     uint32 BPC_Cache = (LAYER_NONE << 28); // Backmost pixel color(cache)
 
-    if(fx_vce.frame_interlaced)
-     target = pXBuf + surface->pitch32 * ((fx_vce.raster_counter - 22) * 2 + fx_vce.odd_field);
+    if(fxking->fx_vce.frame_interlaced)
+     target = pXBuf + fxking->surface->pitch32 * ((fxking->fx_vce.raster_counter - 22) * 2 + fxking->fx_vce.odd_field);
     else
-     target = pXBuf + surface->pitch32 * (fx_vce.raster_counter - 22);
+     target = pXBuf + fxking->surface->pitch32 * (fxking->fx_vce.raster_counter - 22);
     
 
     // If at least one layer is enabled with the HuC6261, hindmost color is palette[0]
@@ -2606,13 +3316,16 @@ static void MixLayers(void)
     //  or if it just outputs black.
     // TODO:  See if enabling front/back cellophane in high dot-clock mode will set the hindmost color, even though the cellophane color mixing
     //  is disabled in high dot-clock mode.
-    if(vce_rendercache.picture_mode & 0x7F00)
-     BPC_Cache |= vce_rendercache.palette_table_cache[0];
+    if(fxking->vce_rendercache.picture_mode & 0x7F00)
+     BPC_Cache |= fxking->vce_rendercache.palette_table_cache[0];
     else			
      BPC_Cache |= 0x008080;
 
+#ifdef __SSE2__
+    MixLayers_SSE2(target, priority_remap, ble_cache, ble_cache_any, BPC_Cache);
+#else
 #define DOCELLO(pixpoo) \
-	if((pixel[pixpoo] >> 28) != LAYER_VDC_SPR || ((vce_rendercache.SPBL >> ((vdc_linebuffer[x] & 0xF0)>> 4)) & 1))	\
+	if((pixel[pixpoo] >> 28) != LAYER_VDC_SPR || ((fxking->vce_rendercache.SPBL >> ((fxking->vdc_linebuffer[x] & 0xF0)>> 4)) & 1))	\
         {	\
          int which_co = (ble_cache[pixel[pixpoo] >> 28] - 1);	\
          uint8 back_y = coeff_cache_y_back[which_co][(zeout >> 16) & 0xFF];	\
@@ -2637,9 +3350,9 @@ static void MixLayers(void)
       { uint32 pixel[4];	\
       uint32 prio[3];	\
       uint32 zeout = BPC_Cache;	\
-      prio[0] = priority_remap[vdc_linebuffer_yuved[index_341] >> 28];  \
-      prio[1] = priority_remap[(bg_linebuffer + 8)[index_256] >> 28];	\
-      prio[2] = priority_remap[rainbow_linebuffer[index_256] >> 28];	\
+      prio[0] = priority_remap[fxking->vdc_linebuffer_yuved[index_341] >> 28];  \
+      prio[1] = priority_remap[fxking->bg_line[index_256] >> 28];	\
+      prio[2] = priority_remap[fxking->rainbow_linebuffer[index_256] >> 28];	\
       pixel[0] = 0;	\
       pixel[1] = 0;	\
       pixel[2] = 0;	\
@@ -2647,9 +3360,9 @@ static void MixLayers(void)
        uint8 pi0 = VCEPrioMap[prio[0]][prio[1]][prio[2]][0];	\
        uint8 pi1 = VCEPrioMap[prio[0]][prio[1]][prio[2]][1];	\
        uint8 pi2 = VCEPrioMap[prio[0]][prio[1]][prio[2]][2];	\
-       /*assert(pi0 == 3 || !pixel[pi0]);*/ pixel[pi0] = vdc_linebuffer_yuved[index_341]; 	\
-       /*assert(pi1 == 3 || !pixel[pi1]);*/ pixel[pi1] = (bg_linebuffer + 8)[index_256];	\
-       /*assert(pi2 == 3 || !pixel[pi2]);*/ pixel[pi2] = rainbow_linebuffer[index_256];		\
+       /*assert(pi0 == 3 || !pixel[pi0]);*/ pixel[pi0] = fxking->vdc_linebuffer_yuved[index_341]; 	\
+       /*assert(pi1 == 3 || !pixel[pi1]);*/ pixel[pi1] = fxking->bg_line[index_256];	\
+       /*assert(pi2 == 3 || !pixel[pi2]);*/ pixel[pi2] = fxking->rainbow_linebuffer[index_256];		\
       }
 
 #define LAYER_MIX_FINAL_NOCELLO	\
@@ -2756,7 +3469,7 @@ static void MixLayers(void)
       target[x] = YUV888_TO_xxx(zeout);	\
      }
 
-    if(surface->format.colorspace == MDFN_COLORSPACE_YCbCr)
+    if(fxking->surface->format.colorspace == MDFN_COLORSPACE_YCbCr)
     {
      #define YUV888_TO_xxx YUV888_TO_YCbCr888
      #include "king_mix_body.inc"
@@ -2768,36 +3481,39 @@ static void MixLayers(void)
      #include "king_mix_body.inc"
      #undef YUV888_TO_xxx
     }
-    DisplayRect->w = fx_vce.dot_clock ? HighDotClockWidth : 256;
-    DisplayRect->x = 0;
+#endif
+    fxking->DisplayRect->w = fxking->fx_vce.dot_clock ? fxking->HighDotClockWidth : 256;
+    fxking->DisplayRect->x = 0;
 
 	// FIXME
-    if(fx_vce.frame_interlaced)
-     LineWidths[(fx_vce.raster_counter - 22) * 2 + fx_vce.odd_field] = DisplayRect->w;
+    if(fxking->fx_vce.frame_interlaced)
+     fxking->LineWidths[(fxking->fx_vce.raster_counter - 22) * 2 + fxking->fx_vce.odd_field] = fxking->DisplayRect->w;
     else
-     LineWidths[fx_vce.raster_counter - 22] = DisplayRect->w;
+     fxking->LineWidths[fxking->fx_vce.raster_counter - 22] = fxking->DisplayRect->w;
 }
 
 static INLINE void RunVDCs(const int master_cycles, uint16 *pixels0, uint16 *pixels1)
 {
  int32 div_clocks;
 
- fx_vce.clock_divider += master_cycles;
- div_clocks = fx_vce.clock_divider / fx_vce.dot_clock_ratio;
- fx_vce.clock_divider -= div_clocks * fx_vce.dot_clock_ratio;
+ fxking->fx_vce.clock_divider += master_cycles;
+ div_clocks = fxking->fx_vce.clock_divider / fxking->fx_vce.dot_clock_ratio;
+ fxking->fx_vce.clock_divider -= div_clocks * fxking->fx_vce.dot_clock_ratio;
 
  if(pixels0)
-  pixels0 += vdc_lb_pos;
+  pixels0 += fxking->vdc_lb_pos;
 
  if(pixels1)
-  pixels1 += vdc_lb_pos;
+  pixels1 += fxking->vdc_lb_pos;
 
- assert((vdc_lb_pos + div_clocks) <= 512);
+ assert((fxking->vdc_lb_pos + div_clocks) <= 512);
 
- fx_vce.vdc_event[0] = vdc_chips[0]->Run(div_clocks, pixels0, pixels0 ? false : true);
- fx_vce.vdc_event[1] = vdc_chips[1]->Run(div_clocks, pixels1, pixels1 ? false : true);
+ const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_VDC);
+ fxking->fx_vce.vdc_event[0] = fxking->vdc_chips[0]->Run(div_clocks, pixels0, pixels0 ? false : true);
+ fxking->fx_vce.vdc_event[1] = fxking->vdc_chips[1]->Run(div_clocks, pixels1, pixels1 ? false : true);
+ PCFX_Prof_Leave(prof);
 
- vdc_lb_pos += div_clocks;
+ fxking->vdc_lb_pos += div_clocks;
 
 // printf("%d\n", vdc_lb_pos);
 // if(fx_vce.dot_clock)
@@ -2812,83 +3528,89 @@ static void MDFN_FASTCALL KING_RunGfx(int32 clocks)
  {
   int32 chunk_clocks = clocks;
 
-  if(chunk_clocks > HPhaseCounter)
-   chunk_clocks = HPhaseCounter;
+  if(chunk_clocks > fxking->HPhaseCounter)
+   chunk_clocks = fxking->HPhaseCounter;
 
   clocks -= chunk_clocks;
-  HPhaseCounter -= chunk_clocks;
+  fxking->HPhaseCounter -= chunk_clocks;
 
-  if(skip)
+  if(fxking->skip)
    RunVDCs(chunk_clocks, NULL, NULL);
-  else if(fx_vce.in_hblank)
+  else if(fxking->fx_vce.in_hblank)
   {
    static uint16 dummybuf[1024];
    RunVDCs(chunk_clocks, dummybuf, dummybuf);
   }
   else
   {
-   RunVDCs(chunk_clocks, vdc_linebuffers[0], vdc_linebuffers[1]);
+   RunVDCs(chunk_clocks, fxking->vdc_linebuffers[0], fxking->vdc_linebuffers[1]);
   }
 
-  assert(HPhaseCounter >= 0);
+  assert(fxking->HPhaseCounter >= 0);
 
-  while(HPhaseCounter <= 0)
+  while(fxking->HPhaseCounter <= 0)
   {
-   HPhase = (HPhase + 1) % HPHASE_COUNT;
-   switch(HPhase)
+   fxking->HPhase = (fxking->HPhase + 1) % HPHASE_COUNT;
+   switch(fxking->HPhase)
    {
-    case HPHASE_ACTIVE: vdc_lb_pos = 0;
-			fx_vce.in_hblank = false;
+    case HPHASE_ACTIVE: fxking->vdc_lb_pos = 0;
+			fxking->fx_vce.in_hblank = false;
 			DoHBlankVCECaching();
-			DrawActive();
-			HPhaseCounter += 1024;
+			{
+			 const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_KING_DRAW);
+			 DrawActive();
+			 PCFX_Prof_Leave(prof);
+			}
+			fxking->HPhaseCounter += 1024;
 			break;
 
     case HPHASE_HBLANK_PART1:
-                        if(!skip)
+                        if(!fxking->skip)
                         {
-                         if(fx_vce.raster_counter >= 22 && fx_vce.raster_counter < 262)
+                         if(fxking->fx_vce.raster_counter >= 22 && fxking->fx_vce.raster_counter < 262)
                          {
+                          const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_KING_MIX);
                           MixVDC();
                           MixLayers();
+                          PCFX_Prof_Leave(prof);
                          }
                         }
-			fx_vce.in_hblank = true;
-                        fx_vce.in_vdc_hsync = true;
+			fxking->fx_vce.in_hblank = true;
+                        fxking->fx_vce.in_vdc_hsync = true;
 
                         for(int chip = 0; chip < 2; chip++)
-                         vdc_chips[chip]->HSync(true);
+                         fxking->vdc_chips[chip]->HSync(true);
 
-			HPhaseCounter += 48;
+			fxking->HPhaseCounter += 48;
 			break;
 
     case HPHASE_HBLANK_PART3:
-			fx_vce.raster_counter = (fx_vce.raster_counter + 1) % ((fx_vce.picture_mode & 0x1) ? 262 : 263); //lines_per_frame;
+			fxking->fx_vce.raster_counter = (fxking->fx_vce.raster_counter + 1) % ((fxking->fx_vce.picture_mode & 0x1) ? 262 : 263); //lines_per_frame;
 
-                        if(fx_vce.raster_counter == 0)
+                        if(fxking->fx_vce.raster_counter == 0)
                          for(int chip = 0; chip < 2; chip++)
-                          vdc_chips[chip]->VSync(true);
+                          fxking->vdc_chips[chip]->VSync(true);
 
-                        if(fx_vce.raster_counter == 3)
+                        if(fxking->fx_vce.raster_counter == 3)
                          for(int chip = 0; chip < 2; chip++)
-                          vdc_chips[chip]->VSync(false);
+                          fxking->vdc_chips[chip]->VSync(false);
 
-			if(!fx_vce.raster_counter)
+			if(!fxking->fx_vce.raster_counter)
 			{
-			 bool previous_interlaced = fx_vce.frame_interlaced;
+			 bool previous_interlaced = fxking->fx_vce.frame_interlaced;
 
-			 fx_vce.frame_interlaced = fx_vce.picture_mode & 2;
+			 fxking->fx_vce.frame_interlaced = fxking->fx_vce.picture_mode & 2;
 
-			 if(fx_vce.frame_interlaced && previous_interlaced)
-			  fx_vce.odd_field ^= 1;
+			 if(fxking->fx_vce.frame_interlaced && previous_interlaced)
+			  fxking->fx_vce.odd_field ^= 1;
 
-			 if(!fx_vce.frame_interlaced)
-			  fx_vce.odd_field = 0;
+			 if(!fxking->fx_vce.frame_interlaced)
+			  fxking->fx_vce.odd_field = 0;
 
-			 PCFX_V810.Exit();
+			 PCFX_V810->Exit();
 			}
 
-			if(fx_vce.raster_counter == king->RasterIRQLine && (king->RAINBOWTransferControl & 0x2))
+			if(fxking->fx_vce.raster_counter == king->RasterIRQLine && (king->RAINBOWTransferControl & 0x2))
 			{
 			 //printf("Wovely: %d, %d, %d\n", fx_vce.raster_counter, king->RAINBOWRasterCounter, king->RAINBOWTransferControl);
 
@@ -2906,21 +3628,21 @@ static void MDFN_FASTCALL KING_RunGfx(int32 clocks)
 			// This -18(and +18) may or may not be correct in regards to how a real PC-FX adjusts the VDC layer horizontal position
 			// versus the KING and RAINBOW layers.
 
-			if(fx_vce.dot_clock)
-			 HPhaseCounter += 173 - 18;
+			if(fxking->fx_vce.dot_clock)
+			 fxking->HPhaseCounter += 173 - 18;
 			else
-			 HPhaseCounter += 165;
+			 fxking->HPhaseCounter += 165;
 			break;
 
     case HPHASE_HBLANK_PART4:
-			fx_vce.in_vdc_hsync = false;
+			fxking->fx_vce.in_vdc_hsync = false;
                         for(int chip = 0; chip < 2; chip++)
-			 vdc_chips[chip]->HSync(false);
+			 fxking->vdc_chips[chip]->HSync(false);
 
-			if(fx_vce.dot_clock)
-			 HPhaseCounter += 120 + 18;
+			if(fxking->fx_vce.dot_clock)
+			 fxking->HPhaseCounter += 120 + 18;
 			else
- 		  	 HPhaseCounter += 128;
+ 		  	 fxking->HPhaseCounter += 128;
 			break;
 
    } // end: switch(HPhase)
@@ -2930,9 +3652,9 @@ static void MDFN_FASTCALL KING_RunGfx(int32 clocks)
 
 void KING_SetPixelFormat(const MDFN_PixelFormat &format) 
 {
- rs = format.Rshift;
- gs = format.Gshift;
- bs = format.Bshift;
+ fxking->rs = format.Rshift;
+ fxking->gs = format.Gshift;
+ fxking->bs = format.Bshift;
  RebuildUVLUT(format);
 }
 
@@ -2941,7 +3663,7 @@ void KING_SetLayerEnableMask(uint64 mask)
  uint64 ms = mask;
  // "BG0\0BG1\0BG2\0BG3\0VDC-A BG\0VDC-A SPR\0VDC-B BG\0VDC-B SPR\0RAINBOW\0",
 
- BGLayerDisable = (~ms) & 0xF;
+ fxking->BGLayerDisable = (~ms) & 0xF;
  ms >>= 4;
 
  for(unsigned chip = 0; chip < 2; chip++)
@@ -2950,14 +3672,14 @@ void KING_SetLayerEnableMask(uint64 mask)
   ms >>= 2;
  }
 
- RAINBOWLayerDisable = (~ms) & 0x1;
+ fxking->RAINBOWLayerDisable = (~ms) & 0x1;
  ms >>= 1;
 
 #if 0
  if(which < 4)
  {
-  BGLayerDisable ^= 1 << which;
-  return( !((BGLayerDisable >> which) & 1));
+  fxking->BGLayerDisable ^= 1 << which;
+  return( !((fxking->BGLayerDisable >> which) & 1));
  }
  else if(which == 4 || which == 5)
  {
@@ -2969,8 +3691,8 @@ void KING_SetLayerEnableMask(uint64 mask)
  }
  else if(which == 8)
  {
-  RAINBOWLayerDisable = !RAINBOWLayerDisable;
-  return(!RAINBOWLayerDisable);
+  fxking->RAINBOWLayerDisable = !fxking->RAINBOWLayerDisable;
+  return(!fxking->RAINBOWLayerDisable);
  }
  else
   return(0);
@@ -3052,55 +3774,55 @@ int KING_StateAction(StateMem *sm, int load, int data_only)
   SFVARN(king->SubChannelInterrupt, "SubChannelInterrupt"),
   SFVARN(king->SubChannelControl, "SubChannelControl"),
 
-  SFVAR(scsicd_ne),
+  SFVARN(fxking->scsicd_ne, "scsicd_ne"),
   // scsicd_ne here??
   SFEND
  };
 
  SFORMAT VCEStateRegs[] =
  {
-  SFVARN(fx_vce.AR, "AR"),
-  SFARRAY16N(fx_vce.priority, 2, "priority"),
-  SFVARN(fx_vce.odd_field, "odd_field"),
-  SFVARN(fx_vce.in_hblank, "in_hblank"),
-  SFVARN(fx_vce.in_vdc_hsync, "in_vdc_hsync"),
-  SFVARN(fx_vce.picture_mode, "picture_mode"),
-
-  SFVARN(HPhase, "HPhase"),
-  SFVARN(HPhaseCounter, "HPhaseCounter"),
-  SFVAR(vdc_lb_pos),
-
-  SFVARN(fx_vce.dot_clock, "dot_clock"),
-  SFVARN(fx_vce.clock_divider, "clock_divider"),
-
-  SFARRAY32N(fx_vce.vdc_event, 2, "vdc_event"),
-
-  SFVARN(fx_vce.raster_counter, "raster_counter"),
-  SFVARN(fx_vce.palette_rw_offset, "palette_rw_offset"),
-  SFVARN(fx_vce.palette_rw_latch, "palette_rw_latch"),
-  SFARRAY16N(fx_vce.palette_offset, 4, "palette_offset"),
-  SFARRAY16N(fx_vce.palette_table, 512, "palette_table"),
-  SFVARN(fx_vce.ChromaKeyY, "ChromaKeyY"),
-  SFVARN(fx_vce.ChromaKeyU, "ChromaKeyU"),
-  SFVARN(fx_vce.ChromaKeyV, "ChromaKeyV"),
-  SFVARN(fx_vce.CCR, "CCR"),
-  SFVARN(fx_vce.BLE, "BLE"),
-  SFVARN(fx_vce.SPBL, "SPBL"),
-  SFARRAY16N(fx_vce.coefficients, 6, "coefficients"),
+  SFVARN(fxking->fx_vce.AR, "AR"),
+  SFARRAY16N(fxking->fx_vce.priority, 2, "priority"),
+  SFVARN(fxking->fx_vce.odd_field, "odd_field"),
+  SFVARN(fxking->fx_vce.in_hblank, "in_hblank"),
+  SFVARN(fxking->fx_vce.in_vdc_hsync, "in_vdc_hsync"),
+  SFVARN(fxking->fx_vce.picture_mode, "picture_mode"),
+
+  SFVARN(fxking->HPhase, "HPhase"),
+  SFVARN(fxking->HPhaseCounter, "HPhaseCounter"),
+  SFVARN(fxking->vdc_lb_pos, "vdc_lb_pos"),
+
+  SFVARN(fxking->fx_vce.dot_clock, "dot_clock"),
+  SFVARN(fxking->fx_vce.clock_divider, "clock_divider"),
+
+  SFARRAY32N(fxking->fx_vce.vdc_event, 2, "vdc_event"),
+
+  SFVARN(fxking->fx_vce.raster_counter, "raster_counter"),
+  SFVARN(fxking->fx_vce.palette_rw_offset, "palette_rw_offset"),
+  SFVARN(fxking->fx_vce.palette_rw_latch, "palette_rw_latch"),
+  SFARRAY16N(fxking->fx_vce.palette_offset, 4, "palette_offset"),
+  SFARRAY16N(fxking->fx_vce.palette_table, 512, "palette_table"),
+  SFVARN(fxking->fx_vce.ChromaKeyY, "ChromaKeyY"),
+  SFVARN(fxking->fx_vce.ChromaKeyU, "ChromaKeyU"),
+  SFVARN(fxking->fx_vce.ChromaKeyV, "ChromaKeyV"),
+  SFVARN(fxking->fx_vce.CCR, "CCR"),
+  SFVARN(fxking->fx_vce.BLE, "BLE"),
+  SFVARN(fxking->fx_vce.SPBL, "SPBL"),
+  SFARRAY16N(fxking->fx_vce.coefficients, 6, "coefficients"),
 
 
   // HB render cache:
   // FIXME
-  SFARRAY16N(vce_rendercache.priority, 2, "rc_priority"),
-  SFVARN(vce_rendercache.picture_mode, "rc_picture_mode"),
-  SFARRAY16N(vce_rendercache.palette_offset, 4, "rc_palette_offset"),
-  SFVARN(vce_rendercache.ChromaKeyY, "rc_ChromaKeyY"),
-  SFVARN(vce_rendercache.ChromaKeyU, "rc_ChromaKeyU"),
-  SFVARN(vce_rendercache.ChromaKeyV, "rc_ChromaKeyV"),
-  SFVARN(vce_rendercache.CCR, "rc_CCR"),
-  SFVARN(vce_rendercache.BLE, "rc_BLE"),
-  SFVARN(vce_rendercache.SPBL, "rc_SPBL"),
-  SFARRAY16N(vce_rendercache.coefficients, 6, "rc_coefficients"),
+  SFARRAY16N(fxking->vce_rendercache.priority, 2, "rc_priority"),
+  SFVARN(fxking->vce_rendercache.picture_mode, "rc_picture_mode"),
+  SFARRAY16N(fxking->vce_rendercache.palette_offset, 4, "rc_palette_offset"),
+  SFVARN(fxking->vce_rendercache.ChromaKeyY, "rc_ChromaKeyY"),
+  SFVARN(fxking->vce_rendercache.ChromaKeyU, "rc_ChromaKeyU"),
+  SFVARN(fxking->vce_rendercache.ChromaKeyV, "rc_ChromaKeyV"),
+  SFVARN(fxking->vce_rendercache.CCR, "rc_CCR"),
+  SFVARN(fxking->vce_rendercache.BLE, "rc_BLE"),
+  SFVARN(fxking->vce_rendercache.SPBL, "rc_SPBL"),
+  SFARRAY16N(fxking->vce_rendercache.coefficients, 6, "rc_coefficients"),
 
   SFEND
  };
@@ -3112,21 +3834,23 @@ int KING_StateAction(StateMem *sm, int load, int data_only)
  if(load)
  {
   RecalcKRAMPagePtrs();
+  BGLineCache_Invalidate();
+  king->dma_waiting = false;
 
-  fx_vce.dot_clock_ratio = fx_vce.dot_clock ? 3 : 4;
+  fxking->fx_vce.dot_clock_ratio = fxking->fx_vce.dot_clock ? 3 : 4;
 
-  fx_vce.palette_rw_offset &= 0x1FF;
-  fx_vce.palette_offset[3] &= 0x00FF;
-  fx_vce.priority[0] &= 0x0777;
-  fx_vce.priority[1] &= 0x7777;
+  fxking->fx_vce.palette_rw_offset &= 0x1FF;
+  fxking->fx_vce.palette_offset[3] &= 0x00FF;
+  fxking->fx_vce.priority[0] &= 0x0777;
+  fxking->fx_vce.priority[1] &= 0x7777;
 
   for(int x = 0; x < 6; x++)
-   fx_vce.coefficients[x] &= 0x0FFF;
+   fxking->fx_vce.coefficients[x] &= 0x0FFF;
 
   for(int x = 0; x < 0x200; x++)
    RedoPaletteCache(x);
 
-  vdc_lb_pos &= 0x1FF; // FIXME: Better checks(in case we remove the assert() elsewhere)?
+  fxking->vdc_lb_pos &= 0x1FF; // FIXME: Better checks(in case we remove the assert() elsewhere)?
 
   RedoKINGIRQCheck();
   SoundBox_SetKINGADPCMControl(king->ADPCMControl);
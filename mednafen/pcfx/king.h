@@ -35,4 +35,14 @@ void KING_EndFrame(v810_timestamp_t timestamp);
 void KING_ResetTS(v810_timestamp_t ts_base);
 
 v810_timestamp_t MDFN_FASTCALL KING_Update(const v810_timestamp_t timestamp);
+v810_timestamp_t KING_GfxEvent(const v810_timestamp_t timestamp);
+void KING_UpdateGfx(const v810_timestamp_t timestamp);
+v810_timestamp_t KING_SCSIEvent(const v810_timestamp_t timestamp);
+v810_timestamp_t KING_DMAEvent(const v810_timestamp_t timestamp);
+
+// Per-machine state, see PCFX_SelectInstance().
+struct fxking_t;
+fxking_t *KING_NewContext(void);
+void KING_DeleteContext(fxking_t *ctx);
+void KING_SetContext(fxking_t *ctx);
 #endif
@@ -0,0 +1,123 @@
+#ifndef __PCFX_MEMBUS_H
+#define __PCFX_MEMBUS_H
+
+#include "../mednafen-endian.h"
+
+// The PC-FX memory map, for the V810 run loops(see V810_GenericBus in v810_cpu.h).  RAM and BIOS ROM accesses are done
+// inline, with the bus width known at compile time; everything else goes to the handlers passed in, which are
+// mem_rbyte() and friends.  Must be kept in sync with mem-handler.inc.
+struct PCFX_MemBus
+{
+ static uint8 *RAM;	// 2MB
+ static uint8 *BIOSROM;	// 1MB
+ static uint32 RAM_LPA;	// Last DRAM page accessed
+
+ enum { RAM_PageNOTMask = ~(2048 - 1) };
+
+ // Checks to see if this main-RAM-area access is in the same DRAM page as the last access.
+ static INLINE void RAMPageCheck(v810_timestamp_t &timestamp, uint32 A)
+ {
+  if((A & RAM_PageNOTMask) != RAM_LPA)
+  {
+   timestamp += 3;
+   RAM_LPA = A & RAM_PageNOTMask;
+  }
+ }
+
+ static INLINE bool ReadBus32(const bool *table, uint32 A)
+ {
+  if(A <= 0x001FFFFF)
+   return(true);
+  else if(A >= 0xF0000000)
+   return(false);
+
+  return(table[A >> 24]);
+ }
+
+ static INLINE bool WriteBus32(const bool *table, uint32 A)
+ {
+  if(A <= 0x001FFFFF)
+   return(true);
+
+  return(table[A >> 24]);
+ }
+
+ static INLINE uint8 Read8(v810_timestamp_t &timestamp, uint32 A, uint8 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   return(RAM[A]);
+  }
+  else if(A >= 0xF0000000)
+  {
+   timestamp += 2;
+   return(BIOSROM[A & 0xFFFFF]);
+  }
+
+  return(handler(timestamp, A));
+ }
+
+ static INLINE uint16 Read16(v810_timestamp_t &timestamp, uint32 A, uint16 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   return(le16toh(*(uint16*)&RAM[A]));
+  }
+  else if(A >= 0xF0000000)
+  {
+   timestamp += 2;
+   return(le16toh(*(uint16*)&BIOSROM[A & 0xFFFFF]));
+  }
+
+  return(handler(timestamp, A));
+ }
+
+ // Only called when ReadBus32() is true, so never for the BIOS ROM.
+ static INLINE uint32 Read32(v810_timestamp_t &timestamp, uint32 A, uint32 MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   return(le32toh(*(uint32*)&RAM[A]));
+  }
+
+  return(handler(timestamp, A));
+ }
+
+ static INLINE void Write8(v810_timestamp_t &timestamp, uint32 A, uint8 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint8))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   RAM[A] = V;
+  }
+  else
+   handler(timestamp, A, V);
+ }
+
+ static INLINE void Write16(v810_timestamp_t &timestamp, uint32 A, uint16 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint16))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   *(uint16*)&RAM[A] = htole16(V);
+  }
+  else
+   handler(timestamp, A, V);
+ }
+
+ static INLINE void Write32(v810_timestamp_t &timestamp, uint32 A, uint32 V, void MDFN_FASTCALL (*handler)(v810_timestamp_t &, uint32, uint32))
+ {
+  if(A <= 0x001FFFFF)
+  {
+   RAMPageCheck(timestamp, A);
+   *(uint32*)&RAM[A] = htole32(V);
+  }
+  else
+   handler(timestamp, A, V);
+ }
+};
+
+#endif
@@ -28,7 +28,7 @@ static INLINE void MDFN_FastU32MemsetM8(uint32_t *array, uint32_t value_32, unsi
    }
 }
 
-extern V810 PCFX_V810;
+extern V810 *PCFX_V810;
 
 uint8 MDFN_FASTCALL mem_peekbyte(const v810_timestamp_t timestamp, const uint32 A);
 uint16 MDFN_FASTCALL mem_peekhword(const v810_timestamp_t timestamp, const uint32 A);
@@ -42,17 +42,35 @@ extern VDC *fx_vdc_chips[2];
 #define REGSETHW(_reg, _data, _msh) { _reg &= 0xFFFF << (_msh ? 0 : 16); _reg |= _data << (_msh ? 16 : 0); }
 #define REGGETHW(_reg, _msh) ((_reg >> (_msh ? 16 : 0)) & 0xFFFF)
 
+// In the order events that are due at the same time are run(see pcfx_event_handler()).
 enum
 {
- PCFX_EVENT_PAD = 0,
+ PCFX_EVENT_KING = 0,	// KING graphics
+ PCFX_EVENT_KING_SCSI,
+ PCFX_EVENT_KING_DMA,
+ PCFX_EVENT_PAD,
  PCFX_EVENT_TIMER,
- PCFX_EVENT_KING,
- PCFX_EVENT_ADPCM
+ PCFX_EVENT_ADPCM,
+
+ PCFX_EVENT__COUNT
 };
 
 #define PCFX_EVENT_NONONO       0x7fffffff
 
 void PCFX_SetEvent(const int type, const v810_timestamp_t next_timestamp);
 
+// A complete emulated PC-FX.  retro_init() creates and selects a default instance; more can be created, and the
+// libretro entry points and everything under them act on whichever instance was selected last.
+//
+// Selecting an instance swaps process-wide globals(the device context pointers, PCFX_V810, the memory bus
+// pointers and MDFNGameInfo) rather than passing the instance down, so only one instance may run at a time:
+// never run two from different threads at once, and never call PCFX_SelectInstance() from inside a running
+// instance(a frontend callback, say).  Instances may be interleaved from one thread between frames.
+struct PCFX_Instance;
+
+PCFX_Instance *PCFX_CreateInstance(void);
+void PCFX_DestroyInstance(PCFX_Instance *inst);	// Unload its game first.
+void PCFX_SelectInstance(PCFX_Instance *inst);
+PCFX_Instance *PCFX_GetInstance(void);
 
 #endif
@@ -0,0 +1,132 @@
+#ifndef __PCFX_PROFILE_H
+#define __PCFX_PROFILE_H
+
+// Optional accounting of the host time spent in each subsystem, for the benchmark harness(bench/pcfx_bench.cpp) and the
+// "pcfx_profiling" core option.  Off until PCFX_Prof_Start(); while on, time is charged to whichever subsystem was
+// entered most recently, so each total excludes the time of the subsystems nested inside it(e.g. VDC and RAINBOW time
+// isn't counted as KING graphics).  retro_run() brackets each frame with PCFX_Prof_BeginFrame()/PCFX_Prof_EndFrame(),
+// so time spent in the frontend's callbacks isn't counted.
+enum
+{
+ PCFX_PROF_OTHER = 0,	// Event scheduling, timer, input, frame setup, and whatever isn't listed below.
+ PCFX_PROF_V810,
+ PCFX_PROF_KING_GFX,
+ PCFX_PROF_KING_DRAW,	// DrawActive()
+ PCFX_PROF_KING_MIX,	// MixLayers()
+ PCFX_PROF_VDC,
+ PCFX_PROF_RAINBOW,
+ PCFX_PROF_SOUNDBOX,
+ PCFX_PROF_RESAMPLE,	// OwlResampler, from SoundBox_Flush()
+ PCFX_PROF_SCSICD,	// Including the KING DMA of CD data into KRAM.
+ PCFX_PROF_CD_WAIT,	// Waiting for the CD read thread.
+ PCFX_PROF__COUNT
+};
+
+// Why a KING BG line was drawn by the generic DrawBG() rather than DrawBG_Fast(), or that it wasn't drawn at all; see
+// CheckDrawBG_Fast() in king-bgfast.inc.  Counted, per BG, only while profiling is on.
+enum
+{
+ PCFX_BGFALLBACK_NONE = 0,	// Drawn by DrawBG_Fast().
+ PCFX_BGFALLBACK_BLANK,		// Not drawn: invalid or EXT DOT BG mode, which DrawBG() doesn't draw either.
+ PCFX_BGFALLBACK_AFFINE,	// BG0 rotation/scaling in 16M color mode.
+ PCFX_BGFALLBACK_MPROG_AFFINE,	// A CG fetch with the microprogram affine bit set.
+ PCFX_BGFALLBACK_CG_TYPE,	// A CG fetch of the wrong type(BAT or bitmap) for the BG mode.
+ PCFX_BGFALLBACK_CG_ORDER,	// CG fetches out of order.
+ PCFX_BGFALLBACK__COUNT
+};
+
+// Returns a monotonically increasing tick count; see retro_perf_get_counter_t.
+typedef uint64 (*PCFX_ProfClock)(void);
+
+struct PCFX_ProfState
+{
+ PCFX_ProfClock clock;	// NULL while off.
+ unsigned int current;
+ uint64 last;
+ uint64 ticks[PCFX_PROF__COUNT];
+
+ uint64 frames;
+ uint64 frame_start[PCFX_PROF__COUNT];	// ticks[] at the start of the frame.
+ uint64 frame_max[PCFX_PROF__COUNT];	// Most ticks in any one frame.
+
+ uint64 bg_lines[4][PCFX_BGFALLBACK__COUNT];	// BG lines drawn, by BG and by PCFX_BGFALLBACK_*.
+ uint64 bg_cached_lines;			// Lines whose BGs were reused from the KING's line cache instead.
+
+ uint64 event_dispatches;	// Times the V810 stopped to run pcfx_event_handler().
+ uint64 event_handlers;		// Event handlers it ran, PCFX_EVENT_* ones that were due; ForceEventUpdates() isn't counted.
+ uint64 king_gfx_runs;		// Times KING's graphics(and the VDCs) were run, by its event or to catch up for something else.
+};
+
+extern PCFX_ProfState PCFX_Prof;
+
+// Clears the totals, too.
+void PCFX_Prof_Start(PCFX_ProfClock clock);
+void PCFX_Prof_Stop(void);
+void PCFX_Prof_BeginFrame(void);
+void PCFX_Prof_EndFrame(void);
+const char *PCFX_Prof_Name(unsigned int which);
+const char *PCFX_Prof_BGFallbackName(unsigned int which);
+
+// Writes the totals, the per-frame figures, the BG line counts and the event counts as JSON.
+bool PCFX_Prof_Dump(const char *path, const char *title);
+
+// Returns what to pass to the matching PCFX_Prof_Leave().
+static INLINE unsigned int PCFX_Prof_Enter(const unsigned int which)
+{
+ const unsigned int prev = PCFX_Prof.current;
+
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+ {
+  const uint64 now = PCFX_Prof.clock();
+
+  PCFX_Prof.ticks[prev] += now - PCFX_Prof.last;
+  PCFX_Prof.last = now;
+  PCFX_Prof.current = which;
+ }
+
+ return(prev);
+}
+
+static INLINE void PCFX_Prof_Leave(const unsigned int prev)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+ {
+  const uint64 now = PCFX_Prof.clock();
+
+  PCFX_Prof.ticks[PCFX_Prof.current] += now - PCFX_Prof.last;
+  PCFX_Prof.last = now;
+  PCFX_Prof.current = prev;
+ }
+}
+
+static INLINE void PCFX_Prof_CountBGLine(const unsigned int n, const unsigned int fallback)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+  PCFX_Prof.bg_lines[n][fallback]++;
+}
+
+static INLINE void PCFX_Prof_CountBGCachedLine(void)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+  PCFX_Prof.bg_cached_lines++;
+}
+
+static INLINE void PCFX_Prof_CountEventDispatch(void)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+  PCFX_Prof.event_dispatches++;
+}
+
+static INLINE void PCFX_Prof_CountEventHandler(void)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+  PCFX_Prof.event_handlers++;
+}
+
+static INLINE void PCFX_Prof_CountKINGGfxRun(void)
+{
+ if(MDFN_UNLIKELY(PCFX_Prof.clock != NULL))
+  PCFX_Prof.king_gfx_runs++;
+}
+
+#endif
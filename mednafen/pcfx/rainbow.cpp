@@ -26,8 +26,6 @@
 #include "../clamp.h"
 #include "../state_helpers.h"
 
-static bool ChromaIP;	// Bilinearly interpolate chroma channel
-
 /* Y = luminance/luma, UV = chrominance/chroma */
 
 typedef struct
@@ -237,6 +235,7 @@ static const uint8 zigzag[63] =
  0x3C, 0x3D, 0x36, 0x2F, 0x37, 0x3E, 0x3F
 };
 
+// Read-only once built, and shared by all instances; built by the first RAINBOW_Init() and kept for the life of the process.
 static HuffmanQuickLUT dc_y_qlut = { NULL }, dc_uv_qlut = { NULL}, ac_y_qlut = { NULL }, ac_uv_qlut = { NULL };
 
 static void KillHuffmanLUT(HuffmanQuickLUT *qlut)
@@ -292,38 +291,51 @@ static bool BuildHuffmanLUT(const HuffmanTable *table, HuffmanQuickLUT *qlut, co
 }
 
 
-static uint8 *DecodeBuffer[2] = { NULL, NULL };
-static int32 DecodeFormat[2]; // The format each buffer is in(-1 = invalid, 0 = palettized 8-bit, 1 = YUV)
-static uint32 QuantTables[2][64], QuantTablesBase[2][64];	// 0 = Y, 1 = UV
+struct rainbow_t
+{
+ bool ChromaIP;	// Bilinearly interpolate chroma channel
+
+ uint8 *DecodeBuffer[2];
+ int32 DecodeFormat[2]; // The format each buffer is in(-1 = invalid, 0 = palettized 8-bit, 1 = YUV)
+ uint32 QuantTables[2][64], QuantTablesBase[2][64];	// 0 = Y, 1 = UV
+
+ uint32 DecodeBufferWhichRead;
 
-static uint32 DecodeBufferWhichRead;
+ int32 RasterReadPos;
+ uint16 Control;
+ uint16 NullRunY, NullRunU, NullRunV, HSync;
+ uint16 HScroll;
 
-static int32 RasterReadPos;
-static uint16 Control;
-static uint16 NullRunY, NullRunU, NullRunV, HSync;
-static uint16 HScroll;
+ uint32 bits_buffer;
+ uint32 bits_buffered_bits;
+ int32 bits_bytes_left;
+
+ uint32 HappyColor; // Cached, calculated from null run yuv registers;
+
+ uint32 LastLine[256];
+ bool FirstDecode;
+ bool GarbageData;
+};
 
-static uint32 bits_buffer;
-static uint32 bits_buffered_bits;
-static int32 bits_bytes_left;
+static rainbow_t *rainbow = NULL;
 
 static void InitBits(int32 bcount)
 {
- bits_bytes_left = bcount;
- bits_buffer = 0;
- bits_buffered_bits = 0;
+ rainbow->bits_bytes_left = bcount;
+ rainbow->bits_buffer = 0;
+ rainbow->bits_buffered_bits = 0;
 }
 
 static INLINE uint8 FetchWidgywabbit(void)
 {
- if(bits_bytes_left <= 0)
+ if(rainbow->bits_bytes_left <= 0)
   return(0);
 
  uint8 ret = KING_RB_Fetch();
  if(ret == 0xFF) 
   KING_RB_Fetch();
 
- bits_bytes_left--;
+ rainbow->bits_bytes_left--;
 
  return(ret);
 }
@@ -338,17 +350,17 @@ static INLINE uint32 GetBits(const unsigned int count, const unsigned int how =
 {
  uint32 ret;
 
- while(bits_buffered_bits < count)
+ while(rainbow->bits_buffered_bits < count)
  {
-  bits_buffer <<= 8;
-  bits_buffer |= FetchWidgywabbit();
-  bits_buffered_bits += 8;
+  rainbow->bits_buffer <<= 8;
+  rainbow->bits_buffer |= FetchWidgywabbit();
+  rainbow->bits_buffered_bits += 8;
  }
 
- ret = (bits_buffer >> (bits_buffered_bits - count)) & ((1 << count) - 1);
+ ret = (rainbow->bits_buffer >> (rainbow->bits_buffered_bits - count)) & ((1 << count) - 1);
 
  if(!(how & MDFNBITS_PEEK))
-  bits_buffered_bits -= count;
+  rainbow->bits_buffered_bits -= count;
 
  if((how & MDFNBITS_FUNNYSIGN) && count)
  {
@@ -363,18 +375,17 @@ static INLINE uint32 GetBits(const unsigned int count, const unsigned int how =
 // and the count pass to SkipBits must be less than or equal to the count passed to GetBits().
 static INLINE void SkipBits(const unsigned int count)
 {
- bits_buffered_bits -= count;
+ rainbow->bits_buffered_bits -= count;
 }
 
 
-static uint32 HappyColor; // Cached, calculated from null run yuv registers;
 static void CalcHappyColor(void)
 {
- uint8 y_c = (int16)NullRunY + 0x80;
- uint8 u_c = (int16)NullRunU + 0x80;
- uint8 v_c = (int16)NullRunV + 0x80;
+ uint8 y_c = (int16)rainbow->NullRunY + 0x80;
+ uint8 u_c = (int16)rainbow->NullRunU + 0x80;
+ uint8 v_c = (int16)rainbow->NullRunV + 0x80;
 
- HappyColor = (y_c << 16) | (u_c << 8) | (v_c << 0);
+ rainbow->HappyColor = (y_c << 16) | (u_c << 8) | (v_c << 0);
 }
 
 static uint32 get_ac_coeff(const HuffmanQuickLUT *table, int32 *zeroes)
@@ -440,27 +451,27 @@ static uint32 get_dc_coeff(const HuffmanQuickLUT *table, int32 *zeroes, int maxb
    for(int i = 0; i < 64; i++)
    {
     // Y
-    uint32 coeff = (QuantTablesBase[0][i] * code) >> 2;
+    uint32 coeff = (rainbow->QuantTablesBase[0][i] * code) >> 2;
 
     if(coeff < 1)
      coeff = 1;
     else if(coeff > 0xFE)
      coeff = 0xFE;
 
-    QuantTables[0][i] = coeff;
+    rainbow->QuantTables[0][i] = coeff;
 
     // UV
     if(i)
-     coeff = (QuantTablesBase[1][i] * code) >> 2;
+     coeff = (rainbow->QuantTablesBase[1][i] * code) >> 2;
     else
-     coeff = (QuantTablesBase[1][i]) >> 2;
+     coeff = (rainbow->QuantTablesBase[1][i]) >> 2;
 
     if(coeff < 1)
      coeff = 1;
     else if(coeff > 0xFE)
      coeff = 0xFE;
 
-    QuantTables[1][i] = coeff;
+    rainbow->QuantTables[1][i] = coeff;
    }
 
   }
@@ -527,38 +538,35 @@ static void decode(int32 *dct, const uint32 *QuantTable, const int32 dc, const H
 
 }
 
-static uint32 LastLine[256];
-static bool FirstDecode;
-static bool GarbageData;
-
 bool RAINBOW_Init(bool arg_ChromaIP)
 {
- ChromaIP = arg_ChromaIP;
+ rainbow->ChromaIP = arg_ChromaIP;
 
  for(int i = 0; i < 2; i++)
  {
-  if(!(DecodeBuffer[i] = (uint8*)malloc(0x2000 * 4)))
+  if(!(rainbow->DecodeBuffer[i] = (uint8*)malloc(0x2000 * 4)))
    return(0);
-  memset(DecodeBuffer[i], 0, 0x2000 * 4);
+  memset(rainbow->DecodeBuffer[i], 0, 0x2000 * 4);
  }
 
- if(!BuildHuffmanLUT(&dc_y_table, &dc_y_qlut, 9))
-  return(FALSE);
-
- if(!BuildHuffmanLUT(&dc_uv_table, &dc_uv_qlut, 8))
-  return(FALSE);
-
- if(!BuildHuffmanLUT(&ac_y_table, &ac_y_qlut, 12))
-  return(FALSE);
-
- if(!BuildHuffmanLUT(&ac_uv_table, &ac_uv_qlut, 12))
-  return(FALSE);
+ if(!ac_uv_qlut.lut_bits)
+ {
+  if(!BuildHuffmanLUT(&dc_y_table, &dc_y_qlut, 9) || !BuildHuffmanLUT(&dc_uv_table, &dc_uv_qlut, 8) ||
+     !BuildHuffmanLUT(&ac_y_table, &ac_y_qlut, 12) || !BuildHuffmanLUT(&ac_uv_table, &ac_uv_qlut, 12))
+  {
+   KillHuffmanLUT(&dc_y_qlut);
+   KillHuffmanLUT(&dc_uv_qlut);
+   KillHuffmanLUT(&ac_y_qlut);
+   KillHuffmanLUT(&ac_uv_qlut);
+   return(FALSE);
+  }
+ }
 
- DecodeFormat[0] = DecodeFormat[1] = -1;
- DecodeBufferWhichRead = 0;
- GarbageData = FALSE;
- FirstDecode = TRUE;
- RasterReadPos = 0;
+ rainbow->DecodeFormat[0] = rainbow->DecodeFormat[1] = -1;
+ rainbow->DecodeBufferWhichRead = 0;
+ rainbow->GarbageData = FALSE;
+ rainbow->FirstDecode = TRUE;
+ rainbow->RasterReadPos = 0;
 
  return(1);
 }
@@ -566,16 +574,11 @@ bool RAINBOW_Init(bool arg_ChromaIP)
 void RAINBOW_Close(void)
 {
  for(int i = 0; i < 2; i++)
-  if(DecodeBuffer[i])
+  if(rainbow->DecodeBuffer[i])
   {
-   free(DecodeBuffer[i]);
-   DecodeBuffer[i] = NULL;
+   free(rainbow->DecodeBuffer[i]);
+   rainbow->DecodeBuffer[i] = NULL;
   }
-
- KillHuffmanLUT(&dc_y_qlut);
- KillHuffmanLUT(&dc_uv_qlut);
- KillHuffmanLUT(&ac_y_qlut);
- KillHuffmanLUT(&ac_uv_qlut);
 }
 
 // RAINBOW base I/O port address: 0x200
@@ -590,12 +593,12 @@ void RAINBOW_Write8(uint32 A, uint8 V)
  //printf("RAINBOW Wr8: %08x %02x\n", A, V);
  switch(A & 0x1C)
  {
-  case 0x00: REGSETBOFH(HScroll, V, (A & 0x2) >> 1); HScroll &= 0x1FF; break;
-  case 0x04: REGSETBOFH(Control, V, A & 0x3); break;
-  case 0x08: REGSETBOFH(NullRunY, V, A & 0x3); CalcHappyColor(); break;
-  case 0x0C: REGSETBOFH(NullRunU, V, A & 0x3); CalcHappyColor(); break;
-  case 0x10: REGSETBOFH(NullRunV, V, A & 0x3); CalcHappyColor(); break;
-  case 0x14: REGSETBOFH(HSync, V, A & 0x3); break;
+  case 0x00: REGSETBOFH(rainbow->HScroll, V, (A & 0x2) >> 1); rainbow->HScroll &= 0x1FF; break;
+  case 0x04: REGSETBOFH(rainbow->Control, V, A & 0x3); break;
+  case 0x08: REGSETBOFH(rainbow->NullRunY, V, A & 0x3); CalcHappyColor(); break;
+  case 0x0C: REGSETBOFH(rainbow->NullRunU, V, A & 0x3); CalcHappyColor(); break;
+  case 0x10: REGSETBOFH(rainbow->NullRunV, V, A & 0x3); CalcHappyColor(); break;
+  case 0x14: REGSETBOFH(rainbow->HSync, V, A & 0x3); break;
  }
 }
 
@@ -606,25 +609,25 @@ void RAINBOW_Write16(uint32 A, uint16 V)
  //printf("RAINBOW Wr16: %08x %04x\n", A, V);
  switch(A & 0x1C)
  {
-  case 0x00: REGSETBOFH(HScroll, V & 0xFF, (A & 0x2) >> 1); HScroll &= 0x1FF; break;
-  case 0x04: REGSETHW(Control, V, msh); break;
-  case 0x08: REGSETHW(NullRunY, V, msh); CalcHappyColor(); break;
-  case 0x0C: REGSETHW(NullRunU, V, msh); CalcHappyColor(); break;
-  case 0x10: REGSETHW(NullRunV, V, msh); CalcHappyColor(); break;
-  case 0x14: REGSETHW(HSync, V, msh); break;
+  case 0x00: REGSETBOFH(rainbow->HScroll, V & 0xFF, (A & 0x2) >> 1); rainbow->HScroll &= 0x1FF; break;
+  case 0x04: REGSETHW(rainbow->Control, V, msh); break;
+  case 0x08: REGSETHW(rainbow->NullRunY, V, msh); CalcHappyColor(); break;
+  case 0x0C: REGSETHW(rainbow->NullRunU, V, msh); CalcHappyColor(); break;
+  case 0x10: REGSETHW(rainbow->NullRunV, V, msh); CalcHappyColor(); break;
+  case 0x14: REGSETHW(rainbow->HSync, V, msh); break;
  }
 }
 
 void RAINBOW_ForceTransferReset(void)
 {
- RasterReadPos = 0;
- DecodeFormat[0] = DecodeFormat[1] = -1;
+ rainbow->RasterReadPos = 0;
+ rainbow->DecodeFormat[0] = rainbow->DecodeFormat[1] = -1;
 }
 
 void RAINBOW_SwapBuffers(void)
 {
- DecodeBufferWhichRead ^= 1;
- RasterReadPos = 0;
+ rainbow->DecodeBufferWhichRead ^= 1;
+ rainbow->RasterReadPos = 0;
 }
 
 void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
@@ -632,9 +635,9 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
    uint8 block_type;
    int32 block_size;
    int icount;
-   int which_buffer = DecodeBufferWhichRead ^ 1;
+   int which_buffer = rainbow->DecodeBufferWhichRead ^ 1;
 
-   if(!(Control & 0x01))
+   if(!(rainbow->Control & 0x01))
    {
     puts("Rainbow decode when disabled!!");
     return;
@@ -642,11 +645,11 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
 
    if(arg_FirstDecode)
    {
-    FirstDecode = TRUE;
-    GarbageData = FALSE;
+    rainbow->FirstDecode = TRUE;
+    rainbow->GarbageData = FALSE;
    }
 
-   if(GarbageData)
+   if(rainbow->GarbageData)
     icount = 0;
    else
     icount = 0x200;
@@ -690,17 +693,17 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
    if(icount <= 0)
    {
     FXDBG("Garbage data.");
-    GarbageData = TRUE;
+    rainbow->GarbageData = TRUE;
     //printf("Dooom: %d\n");
-    DecodeFormat[which_buffer] = 0;
-    memset(DecodeBuffer[which_buffer], 0, 0x2000);
+    rainbow->DecodeFormat[which_buffer] = 0;
+    memset(rainbow->DecodeBuffer[which_buffer], 0, 0x2000);
     goto BufferNoDecode;
    }
 
    if(block_type == 0xf8 || block_type == 0xff)
-    DecodeFormat[which_buffer] = 1;
+    rainbow->DecodeFormat[which_buffer] = 1;
    else
-    DecodeFormat[which_buffer] = 0;
+    rainbow->DecodeFormat[which_buffer] = 0;
 
    if(block_type == 0xF8 || block_type == 0xFF)
    {
@@ -711,8 +714,8 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
       {
        uint8 meow = KING_RB_Fetch();
 
-       QuantTables[q][i] = meow; 
-       QuantTablesBase[q][i] = meow;
+       rainbow->QuantTables[q][i] = meow; 
+       rainbow->QuantTablesBase[q][i] = meow;
       }
      block_size -= 128;
     }
@@ -720,7 +723,7 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
     InitBits(block_size);
 
     int32 dc_y = 0, dc_u = 0, dc_v = 0;
-    uint32 *dest_base = (uint32 *)DecodeBuffer[which_buffer];
+    uint32 *dest_base = (uint32 *)rainbow->DecodeBuffer[which_buffer];
     for(int column = 0; column < 16; column++)
     {
      uint32 *dest_base_column = &dest_base[column * 16];
@@ -738,7 +741,7 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
 
         for(int y = 0; y < 16; y++)
          for(int x = 0; x < 16; x++)
-          dest_base_column[y * 256 + x] = HappyColor;
+          dest_base_column[y * 256 + x] = rainbow->HappyColor;
        }
        column++;
        zeroes--;
@@ -759,27 +762,27 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
       // | B | D |
       // ---------
       // A (0, 0)
-      decode(&dct_y[0x00], QuantTables[0], dc_y, &ac_y_qlut);
+      decode(&dct_y[0x00], rainbow->QuantTables[0], dc_y, &ac_y_qlut);
 
       // B (0, 1)
       dc_y += get_dc_y_coeff(&zeroes);
-      decode(&dct_y[0x40], QuantTables[0], dc_y, &ac_y_qlut);
+      decode(&dct_y[0x40], rainbow->QuantTables[0], dc_y, &ac_y_qlut);
 
       // C (1, 0)
       dc_y += get_dc_y_coeff(&zeroes);
-      decode(&dct_y[0x80], QuantTables[0], dc_y, &ac_y_qlut);
+      decode(&dct_y[0x80], rainbow->QuantTables[0], dc_y, &ac_y_qlut);
 
       // D (1, 1)
       dc_y += get_dc_y_coeff(&zeroes);
-      decode(&dct_y[0xC0], QuantTables[0], dc_y, &ac_y_qlut);
+      decode(&dct_y[0xC0], rainbow->QuantTables[0], dc_y, &ac_y_qlut);
 
       // U, 8x8 components
       dc_u += get_dc_uv_coeff();
-      decode(&dct_u[0x00], QuantTables[1], dc_u, &ac_uv_qlut);
+      decode(&dct_u[0x00], rainbow->QuantTables[1], dc_u, &ac_uv_qlut);
 
       // V, 8x8 components
       dc_v += get_dc_uv_coeff();
-      decode(&dct_v[0x00], QuantTables[1], dc_v, &ac_uv_qlut);
+      decode(&dct_v[0x00], rainbow->QuantTables[1], dc_v, &ac_uv_qlut);
 
       if(Skip)
        continue;
@@ -795,7 +798,7 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
        for(int x = 0; x < 16; x++)
         dest_base_column[y * 256 + x] = clamp_to_u8(dct_y[y * 8 + (x & 0x7) + ((x & 0x8) << 4)] + 0x80) << 16;
 
-      if(!ChromaIP)
+      if(!rainbow->ChromaIP)
       {
        for(int y = 0; y < 8; y++)
        {
@@ -824,7 +827,7 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
     }
 
     // Do bilinear interpolation on the chroma channels:
-    if(!Skip && ChromaIP)
+    if(!Skip && rainbow->ChromaIP)
     {
      for(int y = 0; y < 16; y+= 2)
      {
@@ -843,23 +846,23 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
 
       linebase1[0xFF] = (linebase1[0xFF] & ~ 0xFFFF) | (linebase1[0xFE] & 0xFFFF);
 
-      if(FirstDecode)
+      if(rainbow->FirstDecode)
       {
        for(int x = 0; x < 256; x++) linebase[x] = (linebase[x] & ~ 0xFFFF) | (linebase1[x] & 0xFFFF);
-       FirstDecode = 0;
+       rainbow->FirstDecode = 0;
       }
       else
        for(int x = 0; x < 256; x++)
        {
         unsigned int u, v;
  
-        u = (((LastLine[x] >> 8) & 0xFF) + ((linebase1[x] >> 8) & 0xFF)) >> 1;
-        v = (((LastLine[x] >> 0) & 0xFF) + ((linebase1[x] >> 0) & 0xFF)) >> 1;
+        u = (((rainbow->LastLine[x] >> 8) & 0xFF) + ((linebase1[x] >> 8) & 0xFF)) >> 1;
+        v = (((rainbow->LastLine[x] >> 0) & 0xFF) + ((linebase1[x] >> 0) & 0xFF)) >> 1;
 
         linebase[x] = (linebase[x] & ~ 0xFFFF) | (u << 8) | v;
        }
 
-      memcpy(LastLine, linebase1, 256 * 4);
+      memcpy(rainbow->LastLine, linebase1, 256 * 4);
      }
     } // End chroma interpolation
    } // end jpeg-like decoding
@@ -906,7 +909,7 @@ void RAINBOW_DecodeBlock(bool arg_FirstDecode, bool Skip)
        //puts("Oops");
        break; // Don't overflow our decode buffer!
       }
-      DecodeBuffer[which_buffer][x] = (boot >> plt_shift);
+      rainbow->DecodeBuffer[which_buffer][x] = (boot >> plt_shift);
       x++;
      }
     }
@@ -925,22 +928,22 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
 {
  int ret;
 
- ret = DecodeFormat[DecodeBufferWhichRead];
+ ret = rainbow->DecodeFormat[rainbow->DecodeBufferWhichRead];
 
  if(linebuffer)
  {
-  if(DecodeFormat[DecodeBufferWhichRead] == -1) // None
+  if(rainbow->DecodeFormat[rainbow->DecodeBufferWhichRead] == -1) // None
   {
    if(linebuffer)
     MDFN_FastU32MemsetM8(linebuffer, 0, 256);
   }
-  else if(DecodeFormat[DecodeBufferWhichRead] == 1)	// YUV
+  else if(rainbow->DecodeFormat[rainbow->DecodeBufferWhichRead] == 1)	// YUV
   {
-   uint32 *in_ptr = (uint32*)&DecodeBuffer[DecodeBufferWhichRead][RasterReadPos * 256 * 4];
+   uint32 *in_ptr = (uint32*)&rainbow->DecodeBuffer[rainbow->DecodeBufferWhichRead][rainbow->RasterReadPos * 256 * 4];
 
-   if(Control & 0x2)	// Endless scroll mode:
+   if(rainbow->Control & 0x2)	// Endless scroll mode:
    {
-    uint8 tmpss = HScroll;
+    uint8 tmpss = rainbow->HScroll;
 
     for(int x = 0; x < 256; x++)
     {
@@ -950,7 +953,7 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
    }
    else // Non-endless
    {
-    uint16 tmpss = HScroll & 0x1FF;
+    uint16 tmpss = rainbow->HScroll & 0x1FF;
 
     for(int x = 0; x < 256; x++)
     {
@@ -960,13 +963,13 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
    }
     MDFN_FastU32MemsetM8(in_ptr, 0, 256);
   }
-  else if(DecodeFormat[DecodeBufferWhichRead] == 0)	// Palette
+  else if(rainbow->DecodeFormat[rainbow->DecodeBufferWhichRead] == 0)	// Palette
   {
-   uint8 *in_ptr = &DecodeBuffer[DecodeBufferWhichRead][RasterReadPos * 256];
+   uint8 *in_ptr = &rainbow->DecodeBuffer[rainbow->DecodeBufferWhichRead][rainbow->RasterReadPos * 256];
 
-   if(Control & 0x2)    // Endless scroll mode:
+   if(rainbow->Control & 0x2)    // Endless scroll mode:
    {
-    uint8 tmpss = HScroll;
+    uint8 tmpss = rainbow->HScroll;
 
     for(int x = 0; x < 256; x++)
     {
@@ -976,7 +979,7 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
    }
    else // Non-endless
    {
-    uint16 tmpss = HScroll & 0x1FF;
+    uint16 tmpss = rainbow->HScroll & 0x1FF;
 
     for(int x = 0; x < 256; x++)
     {
@@ -988,10 +991,10 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
   }
  }
 
- RasterReadPos = (RasterReadPos + 1) & 0xF;
+ rainbow->RasterReadPos = (rainbow->RasterReadPos + 1) & 0xF;
 
- if(!RasterReadPos)
-  DecodeFormat[DecodeBufferWhichRead] = -1;     // Invalidate this buffer.
+ if(!rainbow->RasterReadPos)
+  rainbow->DecodeFormat[rainbow->DecodeBufferWhichRead] = -1;     // Invalidate this buffer.
 
  //printf("Fetch: %d, buffer: %d\n", RasterReadPos, DecodeBufferWhichRead);
  return(ret);
@@ -999,15 +1002,15 @@ int RAINBOW_FetchRaster(uint32 *linebuffer, uint32 layer_or, uint32 *palette_ptr
 
 void RAINBOW_Reset(void)
 {
- Control = 0;
- NullRunY = NullRunU = NullRunV = 0;
- HScroll = 0;
- RasterReadPos = 0;
- DecodeBufferWhichRead = 0;
+ rainbow->Control = 0;
+ rainbow->NullRunY = rainbow->NullRunU = rainbow->NullRunV = 0;
+ rainbow->HScroll = 0;
+ rainbow->RasterReadPos = 0;
+ rainbow->DecodeBufferWhichRead = 0;
 
- memset(QuantTables, 0, sizeof(QuantTables));
- memset(QuantTablesBase, 0, sizeof(QuantTablesBase));
- DecodeFormat[0] = DecodeFormat[1] = -1;
+ memset(rainbow->QuantTables, 0, sizeof(rainbow->QuantTables));
+ memset(rainbow->QuantTablesBase, 0, sizeof(rainbow->QuantTablesBase));
+ rainbow->DecodeFormat[0] = rainbow->DecodeFormat[1] = -1;
 
  CalcHappyColor();
 }
@@ -1017,18 +1020,18 @@ int RAINBOW_StateAction(StateMem *sm, int load, int data_only)
 {
  SFORMAT StateRegs[] =
  {
-   SFVAR(HScroll),
-   SFVAR(Control),
-   SFVAR(RasterReadPos),
-   SFVAR(DecodeBufferWhichRead),
-   SFVAR(NullRunY),
-   SFVAR(NullRunU),
-   SFVAR(NullRunV),
-   SFVAR(HSync),
-   SFARRAY32(DecodeFormat, 2),
+   SFVARN(rainbow->HScroll, "HScroll"),
+   SFVARN(rainbow->Control, "Control"),
+   SFVARN(rainbow->RasterReadPos, "RasterReadPos"),
+   SFVARN(rainbow->DecodeBufferWhichRead, "DecodeBufferWhichRead"),
+   SFVARN(rainbow->NullRunY, "NullRunY"),
+   SFVARN(rainbow->NullRunU, "NullRunU"),
+   SFVARN(rainbow->NullRunV, "NullRunV"),
+   SFVARN(rainbow->HSync, "HSync"),
+   SFARRAY32N(rainbow->DecodeFormat, 2, "DecodeFormat"),
    //  if(!(DecodeBuffer[i] = (uint8*)MDFN_malloc(0x2000 * 4, _("RAINBOW buffer RAM"))))
-   SFARRAY(DecodeBuffer[0], 0x2000 * 4),
-   SFARRAY(DecodeBuffer[1], 0x2000 * 4),
+   SFARRAYN(rainbow->DecodeBuffer[0], 0x2000 * 4, "DecodeBuffer[0]"),
+   SFARRAYN(rainbow->DecodeBuffer[1], 0x2000 * 4, "DecodeBuffer[1]"),
    SFEND
  };
 
@@ -1036,9 +1039,23 @@ int RAINBOW_StateAction(StateMem *sm, int load, int data_only)
 
  if(load)
  {
-  RasterReadPos &= 0xF;
+  rainbow->RasterReadPos &= 0xF;
   CalcHappyColor();
  }
  return(ret);
 }
 
+rainbow_t *RAINBOW_NewContext(void)
+{
+ return(new rainbow_t());
+}
+
+void RAINBOW_DeleteContext(rainbow_t *ctx)
+{
+ delete ctx;
+}
+
+void RAINBOW_SetContext(rainbow_t *ctx)
+{
+ rainbow = ctx;
+}
@@ -15,4 +15,10 @@ bool RAINBOW_Init(bool arg_ChromaIP);
 void RAINBOW_Close(void);
 void RAINBOW_Reset(void);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct rainbow_t;
+rainbow_t *RAINBOW_NewContext(void);
+void RAINBOW_DeleteContext(rainbow_t *ctx);
+void RAINBOW_SetContext(rainbow_t *ctx);
+
 #endif
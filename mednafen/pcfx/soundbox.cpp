@@ -21,6 +21,7 @@
 #include "pcfx.h"
 #include "soundbox.h"
 #include "king.h"
+#include "profile.h"
 #include "pce_psg/pce_psg.h"
 
 #include "../cdrom/scsicd.h"
@@ -42,15 +43,6 @@ static const int StepIndexDeltas[16] =
  -1, -1, -1, -1, 2, 4, 6, 8
 };
 
-static OwlResampler* FXres = NULL;
-static OwlBuffer* FXsbuf[2] = { NULL, NULL };
-RavenBuffer* FXCDDABufs[2] = { NULL, NULL };	// Used in the CDROM code
-
-static PCE_PSG *pce_psg = NULL;
-
-static bool SoundEnabled;
-static uint32 adpcm_lastts;
-
 struct SoundBox
 {
    uint16 ADPCMControl;
@@ -74,38 +66,69 @@ struct SoundBox
    bool ADPCMHaveHalfWord[2];
 
    int32 ADPCM_last[2][2];
+
+   uint32 KINGADPCMControl;
+
+   OwlResampler* FXres;
+   OwlBuffer* FXsbuf[2];
+   RavenBuffer* FXCDDABufs[2];	// Used in the CDROM code
+
+   PCE_PSG *pce_psg;
+
+   bool SoundEnabled;
+   uint32 adpcm_lastts;
+
+   bool EmulateBuggyCodec;	// If true, emulate the buggy codec/algorithm used by an official PC-FX ADPCM encoder, rather than how the
+				// hardware actually works.
+   bool ResetAntiClickEnabled;	// = true;
 };
 
-static SoundBox sbox;
-static double ADPCMVolTable[0x40];
+static SoundBox *sbox;
+static double ADPCMVolTable[0x40];	// Constant, shared by all instances.
+
+SoundBox *SoundBox_NewContext(void)
+{
+   return new SoundBox();
+}
+
+void SoundBox_DeleteContext(SoundBox *ctx)
+{
+   delete ctx;
+}
 
-static bool EmulateBuggyCodec;		// If true, emulate the buggy codec/algorithm used by an official PC-FX ADPCM encoder, rather than how the
-					// hardware actually works.
-static bool ResetAntiClickEnabled;	// = true;
+void SoundBox_SetContext(SoundBox *ctx)
+{
+   sbox = ctx;
+}
+
+int32 *SoundBox_GetCDDABuf(unsigned ch)
+{
+   return sbox->FXCDDABufs[ch]->Buf();
+}
 
 
 static void RedoVolume(void)
 {
- pce_psg->SetVolume(0.681);	//0.227 * 0.50);
+ sbox->pce_psg->SetVolume(0.681);	//0.227 * 0.50);
  //ADPCMSynth.volume(0.50);
 }
 
 bool SoundBox_SetSoundRate(uint32 rate)
 {
-   SoundEnabled = (bool)rate;
+   sbox->SoundEnabled = (bool)rate;
 
-   if(FXres)
+   if(sbox->FXres)
    {
-      delete FXres;
-      FXres = NULL;
+      delete sbox->FXres;
+      sbox->FXres = NULL;
    }
 
    if(rate > 0)
    {
-      FXres = new OwlResampler(PCFX_MASTER_CLOCK / 12, rate, MDFN_GetSettingF("pcfx.resamp_rate_error"), 20, MDFN_GetSettingUI("pcfx.resamp_quality"));
+      sbox->FXres = new OwlResampler(PCFX_MASTER_CLOCK / 12, rate, MDFN_GetSettingF("pcfx.resamp_rate_error"), 20, MDFN_GetSettingUI("pcfx.resamp_quality"));
 
       for(unsigned i = 0; i < 2; i++)
-         FXres->ResetBufResampState(FXsbuf[i]);
+         sbox->FXres->ResetBufResampState(sbox->FXsbuf[i]);
    }
 
    RedoVolume();
@@ -115,21 +138,21 @@ bool SoundBox_SetSoundRate(uint32 rate)
 
 int SoundBox_Init(bool arg_EmulateBuggyCodec, bool arg_ResetAntiClickEnabled)
 {
-   adpcm_lastts = 0;
-   SoundEnabled = false;
+   memset(sbox, 0, sizeof(*sbox));
+
+   sbox->adpcm_lastts = 0;
+   sbox->SoundEnabled = false;
 
-   EmulateBuggyCodec = arg_EmulateBuggyCodec;
-   ResetAntiClickEnabled = arg_ResetAntiClickEnabled;
+   sbox->EmulateBuggyCodec = arg_EmulateBuggyCodec;
+   sbox->ResetAntiClickEnabled = arg_ResetAntiClickEnabled;
 
    for(unsigned i = 0; i < 2; i++)
    {
-      FXsbuf[i] = new OwlBuffer();
-      FXCDDABufs[i] = new RavenBuffer();
+      sbox->FXsbuf[i] = new OwlBuffer();
+      sbox->FXCDDABufs[i] = new RavenBuffer();
    }
 
-   pce_psg = new PCE_PSG(FXsbuf[0]->Buf(), FXsbuf[1]->Buf(), PCE_PSG::REVISION_HUC6280A);
-
-   memset(&sbox, 0, sizeof(sbox));
+   sbox->pce_psg = new PCE_PSG(sbox->FXsbuf[0]->Buf(), sbox->FXsbuf[1]->Buf(), PCE_PSG::REVISION_HUC6280A);
 
    // Build ADPCM volume table, 1.5dB per step, ADPCM volume settings of 0x0 through 0x1B result in silence.
    for(int x = 0; x < 0x40; x++)
@@ -151,30 +174,30 @@ int SoundBox_Init(bool arg_EmulateBuggyCodec, bool arg_ResetAntiClickEnabled)
 
 void SoundBox_Kill(void)
 {
-   if(pce_psg)
+   if(sbox->pce_psg)
    {
-      delete pce_psg;
-      pce_psg = NULL;
+      delete sbox->pce_psg;
+      sbox->pce_psg = NULL;
    }
 
    for(unsigned i = 0; i < 2; i++)
    {
-      if(FXsbuf[i])
+      if(sbox->FXsbuf[i])
       {
-         delete FXsbuf[i];
-         FXsbuf[i] = NULL;
+         delete sbox->FXsbuf[i];
+         sbox->FXsbuf[i] = NULL;
       }
-      if(FXCDDABufs[i])
+      if(sbox->FXCDDABufs[i])
       {
-         delete FXCDDABufs[i];
-         FXCDDABufs[i] = NULL;
+         delete sbox->FXCDDABufs[i];
+         sbox->FXCDDABufs[i] = NULL;
       }
    }
 
-   if(FXres)
+   if(sbox->FXres)
    {
-      delete FXres;
-      FXres = NULL;
+      delete sbox->FXres;
+      sbox->FXres = NULL;
    }
 }
 
@@ -184,7 +207,7 @@ void SoundBox_Write(uint32 A, uint16 V, const v810_timestamp_t timestamp)
    A &= 0x3F;
 
    if(A < 0x20)
-      pce_psg->Write(timestamp / 3, A >> 1, V);
+      sbox->pce_psg->Write(timestamp / 3, A >> 1, V);
    else
    {
       //printf("%04x %04x %d\n", A, V, timestamp);
@@ -194,76 +217,74 @@ void SoundBox_Write(uint32 A, uint16 V, const v810_timestamp_t timestamp)
             SoundBox_ADPCMUpdate(timestamp);
             for(int ch = 0; ch < 2; ch++)
             {
-               if(!(sbox.ADPCMControl & (0x10 << ch)) && (V & (0x10 << ch)))
+               if(!(sbox->ADPCMControl & (0x10 << ch)) && (V & (0x10 << ch)))
                {
                   //printf("Reset: %d\n", ch);
 
-                  if(ResetAntiClickEnabled)
+                  if(sbox->ResetAntiClickEnabled)
                   {
-                     sbox.ResetAntiClick[ch] += (int64)sbox.ADPCMPredictor[ch] << 32;
-                     if(sbox.ResetAntiClick[ch] > ((int64)0x3FFF << 32))
-                        sbox.ResetAntiClick[ch] = (int64)0x3FFF << 32;
-                     if(sbox.ResetAntiClick[ch] < ((int64)-0x4000 << 32))
-                        sbox.ResetAntiClick[ch] = (int64)-0x4000 << 32;
+                     sbox->ResetAntiClick[ch] += (int64)sbox->ADPCMPredictor[ch] << 32;
+                     if(sbox->ResetAntiClick[ch] > ((int64)0x3FFF << 32))
+                        sbox->ResetAntiClick[ch] = (int64)0x3FFF << 32;
+                     if(sbox->ResetAntiClick[ch] < ((int64)-0x4000 << 32))
+                        sbox->ResetAntiClick[ch] = (int64)-0x4000 << 32;
                   }
 
-                  sbox.ADPCMPredictor[ch] = 0;
-                  sbox.StepSizeIndex[ch] = 0;
+                  sbox->ADPCMPredictor[ch] = 0;
+                  sbox->StepSizeIndex[ch] = 0;
                }
             }
-            sbox.ADPCMControl = V; 
+            sbox->ADPCMControl = V; 
             break;
 
          case 0x22:
             SoundBox_ADPCMUpdate(timestamp);
-            sbox.ADPCMVolume[0][0] = V & 0x3F; 
+            sbox->ADPCMVolume[0][0] = V & 0x3F; 
             break;
 
          case 0x24:
             SoundBox_ADPCMUpdate(timestamp);
-            sbox.ADPCMVolume[0][1] = V & 0x3F;
+            sbox->ADPCMVolume[0][1] = V & 0x3F;
             break;
 
          case 0x26:
             SoundBox_ADPCMUpdate(timestamp);
-            sbox.ADPCMVolume[1][0] = V & 0x3F;
+            sbox->ADPCMVolume[1][0] = V & 0x3F;
             break;
 
          case 0x28:
             SoundBox_ADPCMUpdate(timestamp);
-            sbox.ADPCMVolume[1][1] = V & 0x3F; 
+            sbox->ADPCMVolume[1][1] = V & 0x3F; 
             break;
 
          case 0x2A:
-            sbox.CDDAVolume[0] = V & 0x3F;
-            SCSICD_SetCDDAVolume(0.50f * sbox.CDDAVolume[0] / 63, 0.50f * sbox.CDDAVolume[1] / 63);
+            sbox->CDDAVolume[0] = V & 0x3F;
+            SCSICD_SetCDDAVolume(0.50f * sbox->CDDAVolume[0] / 63, 0.50f * sbox->CDDAVolume[1] / 63);
             break;
 
          case 0x2C:
-            sbox.CDDAVolume[1] = V & 0x3F;
-            SCSICD_SetCDDAVolume(0.50f * sbox.CDDAVolume[0] / 63, 0.50f * sbox.CDDAVolume[1] / 63);
+            sbox->CDDAVolume[1] = V & 0x3F;
+            SCSICD_SetCDDAVolume(0.50f * sbox->CDDAVolume[0] / 63, 0.50f * sbox->CDDAVolume[1] / 63);
             break;
       }
    }
 }
 
-static uint32 KINGADPCMControl;
-
 void SoundBox_SetKINGADPCMControl(uint32 value)
 {
-   KINGADPCMControl = value;
+   sbox->KINGADPCMControl = value;
 }
 
 /* Digital filter designed by mkfilter/mkshape/gencode   A.J. Fisher
    Command line: /www/usr/fisher/helpers/mkfilter -Bu -Lp -o 1 -a 1.5888889125e-04 0.0000000000e+00 -l */
 static void DoVolumeFilter(int ch, int lr)
 {
-   sbox.vf_xv[ch][lr][0] = sbox.vf_xv[ch][lr][1]; 
-   sbox.vf_xv[ch][lr][1] = (double)ADPCMVolTable[sbox.ADPCMVolume[ch][lr]] / 2.004348738e+03;
+   sbox->vf_xv[ch][lr][0] = sbox->vf_xv[ch][lr][1]; 
+   sbox->vf_xv[ch][lr][1] = (double)ADPCMVolTable[sbox->ADPCMVolume[ch][lr]] / 2.004348738e+03;
 
-   sbox.vf_yv[ch][lr][0] = sbox.vf_yv[ch][lr][1]; 
-   sbox.vf_yv[ch][lr][1] = (sbox.vf_xv[ch][lr][0] + sbox.vf_xv[ch][lr][1]) + (  0.9990021696 * sbox.vf_yv[ch][lr][0]);
-   sbox.VolumeFiltered[ch][lr] = sbox.vf_yv[ch][lr][1];
+   sbox->vf_yv[ch][lr][0] = sbox->vf_yv[ch][lr][1]; 
+   sbox->vf_yv[ch][lr][1] = (sbox->vf_xv[ch][lr][0] + sbox->vf_xv[ch][lr][1]) + (  0.9990021696 * sbox->vf_yv[ch][lr][0]);
+   sbox->VolumeFiltered[ch][lr] = sbox->vf_yv[ch][lr][1];
 }
 
 static const int16 ADPCM_PhaseFilter[8][7] =
@@ -280,82 +301,82 @@ static const int16 ADPCM_PhaseFilter[8][7] =
 
 v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp)
 {
-   int32 run_time = timestamp - adpcm_lastts;
+   int32 run_time = timestamp - sbox->adpcm_lastts;
 
-   adpcm_lastts = timestamp;
+   sbox->adpcm_lastts = timestamp;
 
-   sbox.bigdiv -= run_time * 2;
+   sbox->bigdiv -= run_time * 2;
 
-   while(sbox.bigdiv <= 0)
+   while(sbox->bigdiv <= 0)
    {
-      sbox.smalldiv--;
-      while(sbox.smalldiv <= 0)
+      sbox->smalldiv--;
+      while(sbox->smalldiv <= 0)
       {
-         sbox.smalldiv += 1 << ((KINGADPCMControl >> 2) & 0x3);
+         sbox->smalldiv += 1 << ((sbox->KINGADPCMControl >> 2) & 0x3);
          for(int ch = 0; ch < 2; ch++)
          {
             // Keep playing our last halfword fetched even if KING ADPCM is disabled
-            if(sbox.ADPCMHaveHalfWord[ch] || KINGADPCMControl & (1 << ch)) 
+            if(sbox->ADPCMHaveHalfWord[ch] || sbox->KINGADPCMControl & (1 << ch)) 
             {
-               if(!sbox.ADPCMWhichNibble[ch])
+               if(!sbox->ADPCMWhichNibble[ch])
                {
-                  sbox.ADPCMHalfWord[ch] = KING_GetADPCMHalfWord(ch);
-                  sbox.ADPCMHaveHalfWord[ch] = TRUE;
+                  sbox->ADPCMHalfWord[ch] = KING_GetADPCMHalfWord(ch);
+                  sbox->ADPCMHaveHalfWord[ch] = TRUE;
                }
 
                // If the channel's reset bit is set, don't update its ADPCM state.
-               if(sbox.ADPCMControl & (0x10 << ch))
+               if(sbox->ADPCMControl & (0x10 << ch))
                {
-                  sbox.ADPCMDelta[ch] = 0;
+                  sbox->ADPCMDelta[ch] = 0;
                }
                else
                {
-                  uint8 nibble = (sbox.ADPCMHalfWord[ch] >> (sbox.ADPCMWhichNibble[ch])) & 0xF;
-                  int32 BaseStepSize = StepSizes[sbox.StepSizeIndex[ch]];
+                  uint8 nibble = (sbox->ADPCMHalfWord[ch] >> (sbox->ADPCMWhichNibble[ch])) & 0xF;
+                  int32 BaseStepSize = StepSizes[sbox->StepSizeIndex[ch]];
 
                   //if(!ch)
                   //printf("Nibble: %02x\n", nibble);
 
-                  if(EmulateBuggyCodec)
+                  if(sbox->EmulateBuggyCodec)
                   {
                      if(BaseStepSize == 1552)
                         BaseStepSize = 1522;
 
-                     sbox.ADPCMDelta[ch] = BaseStepSize * ((nibble & 0x7) + 1) * 2;
+                     sbox->ADPCMDelta[ch] = BaseStepSize * ((nibble & 0x7) + 1) * 2;
                   }
                   else
-                     sbox.ADPCMDelta[ch] = BaseStepSize * ((nibble & 0x7) + 1);
+                     sbox->ADPCMDelta[ch] = BaseStepSize * ((nibble & 0x7) + 1);
 
                   // Linear interpolation turned on?
-                  if(sbox.ADPCMControl & (0x4 << ch))
-                     sbox.ADPCMDelta[ch] >>= (KINGADPCMControl >> 2) & 0x3;
+                  if(sbox->ADPCMControl & (0x4 << ch))
+                     sbox->ADPCMDelta[ch] >>= (sbox->KINGADPCMControl >> 2) & 0x3;
 
                   if(nibble & 0x8)
-                     sbox.ADPCMDelta[ch] = -sbox.ADPCMDelta[ch];
+                     sbox->ADPCMDelta[ch] = -sbox->ADPCMDelta[ch];
 
-                  sbox.StepSizeIndex[ch] += StepIndexDeltas[nibble];
+                  sbox->StepSizeIndex[ch] += StepIndexDeltas[nibble];
 
-                  if(sbox.StepSizeIndex[ch] < 0)
-                     sbox.StepSizeIndex[ch] = 0;
+                  if(sbox->StepSizeIndex[ch] < 0)
+                     sbox->StepSizeIndex[ch] = 0;
 
-                  if(sbox.StepSizeIndex[ch] > 48)
-                     sbox.StepSizeIndex[ch] = 48;
+                  if(sbox->StepSizeIndex[ch] > 48)
+                     sbox->StepSizeIndex[ch] = 48;
                }
-               sbox.ADPCMHaveDelta[ch] = 1;
+               sbox->ADPCMHaveDelta[ch] = 1;
 
                // Linear interpolation turned on?
-               if(sbox.ADPCMControl & (0x4 << ch))
-                  sbox.ADPCMHaveDelta[ch] = 1 << ((KINGADPCMControl >> 2) & 0x3);
+               if(sbox->ADPCMControl & (0x4 << ch))
+                  sbox->ADPCMHaveDelta[ch] = 1 << ((sbox->KINGADPCMControl >> 2) & 0x3);
 
-               sbox.ADPCMWhichNibble[ch] = (sbox.ADPCMWhichNibble[ch] + 4) & 0xF;
+               sbox->ADPCMWhichNibble[ch] = (sbox->ADPCMWhichNibble[ch] + 4) & 0xF;
 
-               if(!sbox.ADPCMWhichNibble[ch])
-                  sbox.ADPCMHaveHalfWord[ch] = FALSE;
+               if(!sbox->ADPCMWhichNibble[ch])
+                  sbox->ADPCMHaveHalfWord[ch] = FALSE;
             }
          } // for(int ch...)
-      } // while(sbox.smalldiv <= 0)
+      } // while(sbox->smalldiv <= 0)
 
-      const uint32 synthtime42 = (timestamp << 1) + sbox.bigdiv;
+      const uint32 synthtime42 = (timestamp << 1) + sbox->bigdiv;
       const uint32 synthtime14 = synthtime42 / 3;
       const uint32 synthtime = synthtime14 >> 3;
       const unsigned synthtime_phase = synthtime14 & 7;
@@ -370,36 +391,36 @@ v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp)
          // last_synthtime = synthtime;
          //}
 
-         if(sbox.ADPCMHaveDelta[ch]) 
+         if(sbox->ADPCMHaveDelta[ch]) 
          {
-            sbox.ADPCMPredictor[ch] += sbox.ADPCMDelta[ch];
+            sbox->ADPCMPredictor[ch] += sbox->ADPCMDelta[ch];
 
-            sbox.ADPCMHaveDelta[ch]--;
+            sbox->ADPCMHaveDelta[ch]--;
 
-            if(sbox.ADPCMPredictor[ch] > 0x3FFF) { sbox.ADPCMPredictor[ch] = 0x3FFF; /*printf("Overflow: %d\n", ch);*/ }
-            if(sbox.ADPCMPredictor[ch] < -0x4000) { sbox.ADPCMPredictor[ch] = -0x4000; /*printf("Underflow: %d\n", ch);*/ }
+            if(sbox->ADPCMPredictor[ch] > 0x3FFF) { sbox->ADPCMPredictor[ch] = 0x3FFF; /*printf("Overflow: %d\n", ch);*/ }
+            if(sbox->ADPCMPredictor[ch] < -0x4000) { sbox->ADPCMPredictor[ch] = -0x4000; /*printf("Underflow: %d\n", ch);*/ }
          }
          else
          {
 
          }
 
-         if(SoundEnabled)
+         if(sbox->SoundEnabled)
          {
             int32 samp[2];
 
-            if(EmulateBuggyCodec)
+            if(sbox->EmulateBuggyCodec)
             {
-               samp[0] = (int32)(((sbox.ADPCMPredictor[ch] >> 1) + (sbox.ResetAntiClick[ch] >> 33)) * sbox.VolumeFiltered[ch][0]);
-               samp[1] = (int32)(((sbox.ADPCMPredictor[ch] >> 1) + (sbox.ResetAntiClick[ch] >> 33)) * sbox.VolumeFiltered[ch][1]);
+               samp[0] = (int32)(((sbox->ADPCMPredictor[ch] >> 1) + (sbox->ResetAntiClick[ch] >> 33)) * sbox->VolumeFiltered[ch][0]);
+               samp[1] = (int32)(((sbox->ADPCMPredictor[ch] >> 1) + (sbox->ResetAntiClick[ch] >> 33)) * sbox->VolumeFiltered[ch][1]);
             }
             else
             {
-               samp[0] = (int32)((sbox.ADPCMPredictor[ch] + (sbox.ResetAntiClick[ch] >> 32)) * sbox.VolumeFiltered[ch][0]);
-               samp[1] = (int32)((sbox.ADPCMPredictor[ch] + (sbox.ResetAntiClick[ch] >> 32)) * sbox.VolumeFiltered[ch][1]);
+               samp[0] = (int32)((sbox->ADPCMPredictor[ch] + (sbox->ResetAntiClick[ch] >> 32)) * sbox->VolumeFiltered[ch][0]);
+               samp[1] = (int32)((sbox->ADPCMPredictor[ch] + (sbox->ResetAntiClick[ch] >> 32)) * sbox->VolumeFiltered[ch][1]);
             }
 #if 0
-            printf("%d, %f %f\n", ch, sbox.VolumeFiltered[ch][0], sbox.VolumeFiltered[ch][1]);
+            printf("%d, %f %f\n", ch, sbox->VolumeFiltered[ch][0], sbox->VolumeFiltered[ch][1]);
 
             {
                static int inv = 0x1FFF;
@@ -412,8 +433,8 @@ v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp)
 #endif
             for(unsigned y = 0; y < 2; y++)
             {
-               const int32 delta = samp[y] - sbox.ADPCM_last[ch][y];
-               int32* tb = FXsbuf[y]->Buf() + (synthtime & 0xFFFF);
+               const int32 delta = samp[y] - sbox->ADPCM_last[ch][y];
+               int32* tb = sbox->FXsbuf[y]->Buf() + (synthtime & 0xFFFF);
                const int16* coeffs = ADPCM_PhaseFilter[synthtime_phase];
 
                for(unsigned c = 0; c < 7; c++)
@@ -424,16 +445,16 @@ v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp)
                }
             }
 
-            sbox.ADPCM_last[ch][0] = samp[0];
-            sbox.ADPCM_last[ch][1] = samp[1];
+            sbox->ADPCM_last[ch][0] = samp[0];
+            sbox->ADPCM_last[ch][1] = samp[1];
          }
       }
 
       for(int ch = 0; ch < 2; ch++)
       {
-         sbox.ResetAntiClick[ch] -= sbox.ResetAntiClick[ch] >> 8;
+         sbox->ResetAntiClick[ch] -= sbox->ResetAntiClick[ch] >> 8;
          //if(ch)
-         // MDFN_DispMessage("%d", (int)(sbox.ResetAntiClick[ch] >> 32));
+         // MDFN_DispMessage("%d", (int)(sbox->ResetAntiClick[ch] >> 32));
       }
 
       for(int ch = 0; ch < 2; ch++)
@@ -441,10 +462,10 @@ v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp)
          {
             DoVolumeFilter(ch, lr);
          }
-      sbox.bigdiv += 1365 * 2 / 2;
+      sbox->bigdiv += 1365 * 2 / 2;
    }
 
-   return(timestamp + (sbox.bigdiv + 1) / 2);
+   return(timestamp + (sbox->bigdiv + 1) / 2);
 }
 
 int32 SoundBox_Flush(const v810_timestamp_t end_timestamp, v810_timestamp_t* new_base_timestamp, int16 *SoundBuf, const int32 MaxSoundFrames)
@@ -457,19 +478,21 @@ int32 SoundBox_Flush(const v810_timestamp_t end_timestamp, v810_timestamp_t* new
 
    *new_base_timestamp = end_timestamp_mod12;
 
-   pce_psg->Update(end_timestamp_div3);
+   sbox->pce_psg->Update(end_timestamp_div3);
 
    for(unsigned y = 0; y < 2; y++)
    {
-      if(SoundEnabled && FXres)
+      if(sbox->SoundEnabled && sbox->FXres)
       {
-         FXsbuf[y]->Integrate(rsc, 0, 0, FXCDDABufs[y]);
-         FrameCount = FXres->Resample(FXsbuf[y], rsc, SoundBuf + y, MaxSoundFrames);
+         sbox->FXsbuf[y]->Integrate(rsc, 0, 0, sbox->FXCDDABufs[y]);
+         const unsigned int prof = PCFX_Prof_Enter(PCFX_PROF_RESAMPLE);
+         FrameCount = sbox->FXres->Resample(sbox->FXsbuf[y], rsc, SoundBuf + y, MaxSoundFrames);
+         PCFX_Prof_Leave(prof);
       }
       else
-         FXsbuf[y]->ResampleSkipped(rsc);
+         sbox->FXsbuf[y]->ResampleSkipped(rsc);
 
-      FXCDDABufs[y]->Finish(rsc);
+      sbox->FXCDDABufs[y]->Finish(rsc);
    }
 
    return(FrameCount);
@@ -477,75 +500,75 @@ int32 SoundBox_Flush(const v810_timestamp_t end_timestamp, v810_timestamp_t* new
 
 void SoundBox_ResetTS(const v810_timestamp_t ts_base)
 {
-   pce_psg->ResetTS(ts_base / 3);
-   adpcm_lastts = ts_base;
+   sbox->pce_psg->ResetTS(ts_base / 3);
+   sbox->adpcm_lastts = ts_base;
 }
 
 void SoundBox_Reset(const v810_timestamp_t timestamp)
 {
    SoundBox_ADPCMUpdate(timestamp);
-   pce_psg->Power(timestamp / 3);
+   sbox->pce_psg->Power(timestamp / 3);
 
-   sbox.ADPCMControl = 0;
+   sbox->ADPCMControl = 0;
 
-   memset(&sbox.vf_xv, 0, sizeof(sbox.vf_xv));
-   memset(&sbox.vf_yv, 0, sizeof(sbox.vf_yv));
+   memset(&sbox->vf_xv, 0, sizeof(sbox->vf_xv));
+   memset(&sbox->vf_yv, 0, sizeof(sbox->vf_yv));
 
    for(int lr = 0; lr < 2; lr++)
    {
       for(int ch = 0; ch < 2; ch++)
       {
-         sbox.ADPCMVolume[ch][lr] = 0;
-         sbox.VolumeFiltered[ch][lr] = 0;
+         sbox->ADPCMVolume[ch][lr] = 0;
+         sbox->VolumeFiltered[ch][lr] = 0;
       }
 
-      sbox.CDDAVolume[lr] = 0;
+      sbox->CDDAVolume[lr] = 0;
    }
 
    for(int ch = 0; ch < 2; ch++)
    {
-      sbox.ADPCMPredictor[ch] = 0;
-      sbox.StepSizeIndex[ch] = 0;
+      sbox->ADPCMPredictor[ch] = 0;
+      sbox->StepSizeIndex[ch] = 0;
    }
 
-   memset(sbox.ADPCMWhichNibble, 0, sizeof(sbox.ADPCMWhichNibble));
-   memset(sbox.ADPCMHalfWord, 0, sizeof(sbox.ADPCMHalfWord));
-   memset(sbox.ADPCMHaveHalfWord, 0, sizeof(sbox.ADPCMHaveHalfWord));
+   memset(sbox->ADPCMWhichNibble, 0, sizeof(sbox->ADPCMWhichNibble));
+   memset(sbox->ADPCMHalfWord, 0, sizeof(sbox->ADPCMHalfWord));
+   memset(sbox->ADPCMHaveHalfWord, 0, sizeof(sbox->ADPCMHaveHalfWord));
 
-   SCSICD_SetCDDAVolume(0.50f * sbox.CDDAVolume[0] / 63, 0.50f * sbox.CDDAVolume[1] / 63);
+   SCSICD_SetCDDAVolume(0.50f * sbox->CDDAVolume[0] / 63, 0.50f * sbox->CDDAVolume[1] / 63);
 
-   sbox.bigdiv = 2;	// TODO: KING->SBOX ADPCM Synch //(1365 - 85 * 4) * 2; //1365 * 2 / 2;
-   sbox.smalldiv = 0;
+   sbox->bigdiv = 2;	// TODO: KING->SBOX ADPCM Synch //(1365 - 85 * 4) * 2; //1365 * 2 / 2;
+   sbox->smalldiv = 0;
 }
 
 int SoundBox_StateAction(StateMem *sm, int load, int data_only)
 {
    int ret = 1;
 
-   ret &= pce_psg->StateAction(sm, load, data_only);
+   ret &= sbox->pce_psg->StateAction(sm, load, data_only);
 
    SFORMAT SoundBox_StateRegs[] =
    {
-      SFVARN(sbox.ADPCMControl, "ADPCMControl"),
-      SFARRAYN(&sbox.ADPCMVolume[0][0], 2 * 2, "ADPCMVolume"),
-      SFARRAYN(sbox.CDDAVolume, 2, "CDDAVolume"),
-      SFVARN(sbox.bigdiv, "bigdiv"),
-      SFVARN(sbox.smalldiv, "smalldiv"),
+      SFVARN(sbox->ADPCMControl, "ADPCMControl"),
+      SFARRAYN(&sbox->ADPCMVolume[0][0], 2 * 2, "ADPCMVolume"),
+      SFARRAYN(sbox->CDDAVolume, 2, "CDDAVolume"),
+      SFVARN(sbox->bigdiv, "bigdiv"),
+      SFVARN(sbox->smalldiv, "smalldiv"),
 
-      SFARRAY64N(&sbox.ResetAntiClick[0], 2, "ResetAntiClick"),
-      SFARRAYDN(&sbox.VolumeFiltered[0][0], 2 * 2, "VolumeFiltered"),
-      SFARRAYDN(&sbox.vf_xv[0][0][0], 2 * 2 * (1 + 1), "vf_xv"),
-      SFARRAYDN(&sbox.vf_yv[0][0][0], 2 * 2 * (1 + 1), "vf_yv"),
+      SFARRAY64N(&sbox->ResetAntiClick[0], 2, "ResetAntiClick"),
+      SFARRAYDN(&sbox->VolumeFiltered[0][0], 2 * 2, "VolumeFiltered"),
+      SFARRAYDN(&sbox->vf_xv[0][0][0], 2 * 2 * (1 + 1), "vf_xv"),
+      SFARRAYDN(&sbox->vf_yv[0][0][0], 2 * 2 * (1 + 1), "vf_yv"),
 
-      SFARRAY32N(sbox.ADPCMDelta, 2, "ADPCMDelta"),
-      SFARRAY32N(sbox.ADPCMHaveDelta, 2, "ADPCMHaveDelta"),
+      SFARRAY32N(sbox->ADPCMDelta, 2, "ADPCMDelta"),
+      SFARRAY32N(sbox->ADPCMHaveDelta, 2, "ADPCMHaveDelta"),
 
-      SFARRAY32N(&sbox.ADPCMPredictor[0], 2, "ADPCMPredictor"),
-      SFARRAY32N(&sbox.StepSizeIndex[0], 2, "ADPCMStepSizeIndex"),
+      SFARRAY32N(&sbox->ADPCMPredictor[0], 2, "ADPCMPredictor"),
+      SFARRAY32N(&sbox->StepSizeIndex[0], 2, "ADPCMStepSizeIndex"),
 
-      SFARRAY32N(sbox.ADPCMWhichNibble, 2, "ADPCMWNibble"),
-      SFARRAY16N(sbox.ADPCMHalfWord, 2, "ADPCMHalfWord"),
-      SFARRAYBN(sbox.ADPCMHaveHalfWord, 2, "ADPCMHHW"),
+      SFARRAY32N(sbox->ADPCMWhichNibble, 2, "ADPCMWNibble"),
+      SFARRAY16N(sbox->ADPCMHalfWord, 2, "ADPCMHalfWord"),
+      SFARRAYBN(sbox->ADPCMHaveHalfWord, 2, "ADPCMHHW"),
 
       SFEND
    };
@@ -556,23 +579,23 @@ int SoundBox_StateAction(StateMem *sm, int load, int data_only)
    {
       for(int ch = 0; ch < 2; ch++)
       {
-         clamp(&sbox.ADPCMPredictor[ch], -0x4000, 0x3FFF);
-         clamp(&sbox.ResetAntiClick[ch], (int64)-0x4000 << 32, (int64)0x3FFF << 32);
+         clamp(&sbox->ADPCMPredictor[ch], -0x4000, 0x3FFF);
+         clamp(&sbox->ResetAntiClick[ch], (int64)-0x4000 << 32, (int64)0x3FFF << 32);
 
-         if(!ResetAntiClickEnabled)
-            sbox.ResetAntiClick[ch] = 0;
+         if(!sbox->ResetAntiClickEnabled)
+            sbox->ResetAntiClick[ch] = 0;
 
-         clamp(&sbox.StepSizeIndex[ch], 0, 48);
+         clamp(&sbox->StepSizeIndex[ch], 0, 48);
 
-         clamp(&sbox.bigdiv, 1, 1365);
-         clamp(&sbox.smalldiv, 1, 8);
+         clamp(&sbox->bigdiv, 1, 1365);
+         clamp(&sbox->smalldiv, 1, 8);
 
          for(int lr = 0; lr < 2; lr++)
          {
 
          }
       }
-      SCSICD_SetCDDAVolume(0.50f * sbox.CDDAVolume[0] / 63, 0.50f * sbox.CDDAVolume[1] / 63);
+      SCSICD_SetCDDAVolume(0.50f * sbox->CDDAVolume[0] / 63, 0.50f * sbox->CDDAVolume[1] / 63);
    }
    return(ret); 
 }
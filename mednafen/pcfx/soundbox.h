@@ -17,4 +17,12 @@ v810_timestamp_t SoundBox_ADPCMUpdate(const v810_timestamp_t timestamp);
 
 void SoundBox_ResetTS(const v810_timestamp_t ts_base);
 
+int32 *SoundBox_GetCDDABuf(unsigned ch);
+
+// Per-machine state, see PCFX_SelectInstance().
+struct SoundBox;
+SoundBox *SoundBox_NewContext(void);
+void SoundBox_DeleteContext(SoundBox *ctx);
+void SoundBox_SetContext(SoundBox *ctx);
+
 #endif
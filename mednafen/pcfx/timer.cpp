@@ -24,44 +24,49 @@
 
 #include "../state_helpers.h"
 
-static uint16 control;
-static uint16 period;
-static int32 counter;
+struct fxtimer_t
+{
+   uint16 control;
+   uint16 period;
+   int32 counter;
+
+   int32 lastts;
+};
 
-static int32 lastts;
+static fxtimer_t *fxtimer = NULL;
 
 static INLINE v810_timestamp_t CalcNextEventTS(const v810_timestamp_t timestamp)
 {
-   return((control & 0x2) ? (timestamp + counter) : PCFX_EVENT_NONONO);
+   return((fxtimer->control & 0x2) ? (timestamp + fxtimer->counter) : PCFX_EVENT_NONONO);
 }
 
-#define EFF_PERIOD ((period ? period : 0x10000) * 15)
+#define EFF_PERIOD ((fxtimer->period ? fxtimer->period : 0x10000) * 15)
 
 v810_timestamp_t FXTIMER_Update(const v810_timestamp_t timestamp)
 {
-   if(control & 0x2)
+   if(fxtimer->control & 0x2)
    {
-      int32 cycles = timestamp - lastts;
-      counter -= cycles;
-      while(counter <= 0)
+      int32 cycles = timestamp - fxtimer->lastts;
+      fxtimer->counter -= cycles;
+      while(fxtimer->counter <= 0)
       {
-         counter += EFF_PERIOD;
-         if(control & 0x1)
+         fxtimer->counter += EFF_PERIOD;
+         if(fxtimer->control & 0x1)
          {
-            control |= 0x4;
+            fxtimer->control |= 0x4;
             PCFXIRQ_Assert(PCFXIRQ_SOURCE_TIMER, TRUE);
          }
       }
    }
 
-   lastts = timestamp;
+   fxtimer->lastts = timestamp;
 
    return(CalcNextEventTS(timestamp));
 }
 
 void FXTIMER_ResetTS(int32 ts_base)
 {
-   lastts = ts_base;
+   fxtimer->lastts = ts_base;
 }
 
 uint16 FXTIMER_Read16(uint32 A, const v810_timestamp_t timestamp)
@@ -73,11 +78,11 @@ uint16 FXTIMER_Read16(uint32 A, const v810_timestamp_t timestamp)
       default:
          break;
       case 0xF00:
-         return(control);
+         return(fxtimer->control);
       case 0xF80:
-         return(period);
+         return(fxtimer->period);
       case 0xFC0:
-         return((counter + 14) / 15);
+         return((fxtimer->counter + 14) / 15);
    }
 
    return 0;
@@ -98,19 +103,19 @@ void FXTIMER_Write16(uint32 A, uint16 V, const v810_timestamp_t timestamp)
       default:
          break;
       case 0xF00:
-         if(!(control & 0x2) && (V & 0x2))
-            counter = EFF_PERIOD;
-         control = V & 0x7;
+         if(!(fxtimer->control & 0x2) && (V & 0x2))
+            fxtimer->counter = EFF_PERIOD;
+         fxtimer->control = V & 0x7;
 
          if(V & 0x4)
             FXDBG("Timer control write with D2 set?");
 
-         PCFXIRQ_Assert(PCFXIRQ_SOURCE_TIMER, (bool)(control & 0x4));
+         PCFXIRQ_Assert(PCFXIRQ_SOURCE_TIMER, (bool)(fxtimer->control & 0x4));
          PCFX_SetEvent(PCFX_EVENT_TIMER, CalcNextEventTS(timestamp));
          break;
 
       case 0xF80:
-         period = V; 
+         fxtimer->period = V; 
          PCFX_SetEvent(PCFX_EVENT_TIMER, CalcNextEventTS(timestamp));
          break;
    }
@@ -120,9 +125,9 @@ int FXTIMER_StateAction(StateMem *sm, int load, int data_only)
 {
    SFORMAT StateRegs[] =
    {
-      SFVAR(counter),
-      SFVAR(period),
-      SFVAR(control),
+      SFVARN(fxtimer->counter, "counter"),
+      SFVARN(fxtimer->period, "period"),
+      SFVARN(fxtimer->control, "control"),
       SFEND
    };
 
@@ -139,18 +144,18 @@ bool FXTIMER_GetRegister(const std::string &name, uint32 &value, std::string *sp
 {
    if(name == "TCTRL")
    {
-      value = control;
+      value = fxtimer->control;
       if(special)
       {
          char buf[256];
-         snprintf(buf, 256, "Counting Enabled: %d, IRQ Enabled: %d, IRQ Asserted: %d", (int)(bool)(control & 2), (int)(bool)(control & 1), (int)(bool)(control & 4));
+         snprintf(buf, 256, "Counting Enabled: %d, IRQ Enabled: %d, IRQ Asserted: %d", (int)(bool)(fxtimer->control & 2), (int)(bool)(fxtimer->control & 1), (int)(bool)(fxtimer->control & 4));
          *special = std::string(buf);
       }
       return(TRUE);
    }
    else if(name == "TPRD")
    {
-      value = period;
+      value = fxtimer->period;
       if(special)
       {
          char buf[256];
@@ -161,7 +166,7 @@ bool FXTIMER_GetRegister(const std::string &name, uint32 &value, std::string *sp
    }
    else if(name == "TCNTR")
    {
-      value = counter;
+      value = fxtimer->counter;
       if(special)
       {
          //char buf[256];
@@ -175,13 +180,28 @@ bool FXTIMER_GetRegister(const std::string &name, uint32 &value, std::string *sp
 
 void FXTIMER_Reset(void)
 {
-   control = 0;
-   period = 0;
-   counter = 0;
+   fxtimer->control = 0;
+   fxtimer->period = 0;
+   fxtimer->counter = 0;
 }
 
 void FXTIMER_Init(void)
 {
-   lastts = 0;
+   fxtimer->lastts = 0;
    FXTIMER_Reset();
 }
+
+fxtimer_t *FXTIMER_NewContext(void)
+{
+   return(new fxtimer_t());
+}
+
+void FXTIMER_DeleteContext(fxtimer_t *ctx)
+{
+   delete ctx;
+}
+
+void FXTIMER_SetContext(fxtimer_t *ctx)
+{
+   fxtimer = ctx;
+}
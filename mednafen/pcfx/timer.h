@@ -13,4 +13,10 @@ void FXTIMER_Init(void);
 int FXTIMER_StateAction(StateMem *sm, int load, int data_only);
 bool FXTIMER_GetRegister(const std::string &name, uint32 &value, std::string *special);
 
+// Per-machine state, see PCFX_SelectInstance().
+struct fxtimer_t;
+fxtimer_t *FXTIMER_NewContext(void);
+void FXTIMER_DeleteContext(fxtimer_t *ctx);
+void FXTIMER_SetContext(fxtimer_t *ctx);
+
 #endif
@@ -30,6 +30,8 @@ int setting_resamp_quality = 3;
 int setting_suppress_channel_reset_clicks = 1;
 int setting_emulate_buggy_codec = 0;
 int setting_rainbow_chromaip = 0;
+int setting_cpu_emulation = -1;
+int setting_idle_loop_skip = 0;
 
 uint64_t MDFN_GetSettingUI(const char *name)
 {
@@ -49,7 +51,7 @@ uint64_t MDFN_GetSettingUI(const char *name)
 int64_t MDFN_GetSettingI(const char *name)
 {
    if (!strcmp("pcfx.cpu_emulation", name))
-      return 2;
+      return setting_cpu_emulation;
    return 0;
 }
 
@@ -85,6 +87,8 @@ bool MDFN_GetSettingB(const char *name)
       return setting_emulate_buggy_codec;
    if (!strcmp("pcfx.rainbow.chromaip", name))
       return setting_rainbow_chromaip;
+   if (!strcmp("pcfx.idle_loop_skip", name))
+      return setting_idle_loop_skip;
    /* CDROM */
    if (!strcmp("cdrom.lec_eval", name))
       return 1;
@@ -16,6 +16,8 @@ extern int setting_resamp_quality;
 extern int setting_suppress_channel_reset_clicks;
 extern int setting_emulate_buggy_codec;
 extern int setting_rainbow_chromaip;
+extern int setting_cpu_emulation; /* -1 = pick per game */
+extern int setting_idle_loop_skip;
 
 // This should assert() or something if the setting isn't found, since it would
 // be a totally tubular error!
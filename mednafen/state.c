@@ -31,6 +31,292 @@
 /* Forward declaration */
 int StateAction(StateMem *sm, int load, int data_only);
 
+/* Layout of the last state MDFNSS_SaveSM() wrote: where each chunk and
+ * variable header went, and its bytes.  The same variables are saved in
+ * the same order every time, so as long as the SFORMAT lists still match
+ * it(checked as they're walked), MDFNSS_SaveSMFast() can write a state
+ * straight into a fixed buffer without formatting any names, and
+ * MDFNSS_LoadSM() can read each variable from its known offset instead of
+ * looking it up by name. */
+typedef struct
+{
+   uint32_t size;          /* SFORMAT size; 0 for a chunk. */
+   uint32_t flags;
+   uint32_t pos;           /* Offset of the header in the state. */
+   uint32_t header_off;    /* Offset of the header bytes in headers[]. */
+   uint32_t header_len;
+} SSLayoutEntry;
+
+typedef struct
+{
+   SSLayoutEntry *entries;
+   uint32_t count;
+   uint32_t entries_alloced;
+
+   uint8_t *headers;
+   uint32_t headers_len;
+   uint32_t headers_alloced;
+
+   uint32_t total;         /* Size of the whole state; 0 if there's none. */
+   bool failed;            /* Out of memory while recording. */
+} SSLayout;
+
+enum
+{
+   SS_MODE_SLOW = 0,
+   SS_MODE_FAST_SAVE,
+   SS_MODE_FAST_LOAD
+};
+
+/* Everything cached between calls, kept per machine; see MDFNSS_SetContext(). */
+struct MDFNSS_Context
+{
+   SSLayout layout, recording;
+   int mode;
+   uint32_t cursor;
+   bool mismatch;
+};
+
+static MDFNSS_Context *ss = NULL;
+
+MDFNSS_Context *MDFNSS_NewContext(void)
+{
+   return (MDFNSS_Context *)calloc(1, sizeof(MDFNSS_Context));
+}
+
+void MDFNSS_DeleteContext(MDFNSS_Context *ctx)
+{
+   if(!ctx)
+      return;
+
+   free(ctx->layout.entries);
+   free(ctx->layout.headers);
+   free(ctx->recording.entries);
+   free(ctx->recording.headers);
+   free(ctx);
+}
+
+void MDFNSS_SetContext(MDFNSS_Context *ctx)
+{
+   ss = ctx;
+}
+
+/* Appends an entry to the layout being recorded; the 4-byte size field
+ * that ends every header is added here.  Returns the entry's index. */
+static uint32_t RecordEntry(uint32_t size, uint32_t flags, uint32_t pos,
+      const void *header, uint32_t header_len, uint32_t size_field)
+{
+   SSLayoutEntry *e;
+   SSLayout *l = &ss->recording;
+
+   if(l->failed)
+      return 0;
+
+   if(l->count == l->entries_alloced)
+   {
+      uint32_t newsize = l->entries_alloced ? l->entries_alloced * 2 : 256;
+      SSLayoutEntry *tmp = (SSLayoutEntry *)realloc(l->entries,
+            newsize * sizeof(SSLayoutEntry));
+
+      if(!tmp)
+      {
+         l->failed = true;
+         return 0;
+      }
+
+      l->entries = tmp;
+      l->entries_alloced = newsize;
+   }
+
+   if(l->headers_len + header_len + 4 > l->headers_alloced)
+   {
+      uint32_t newsize = l->headers_alloced ? l->headers_alloced : 4096;
+      uint8_t *tmp;
+
+      while(newsize < l->headers_len + header_len + 4)
+         newsize *= 2;
+
+      if(!(tmp = (uint8_t *)realloc(l->headers, newsize)))
+      {
+         l->failed = true;
+         return 0;
+      }
+
+      l->headers = tmp;
+      l->headers_alloced = newsize;
+   }
+
+   e             = &l->entries[l->count];
+   e->size       = size;
+   e->flags      = flags;
+   e->pos        = pos;
+   e->header_off = l->headers_len;
+   e->header_len = header_len + 4;
+
+   memcpy(l->headers + l->headers_len, header, header_len);
+   MDFN_en32lsb(l->headers + l->headers_len + header_len, size_field);
+   l->headers_len += header_len + 4;
+
+   return l->count++;
+}
+
+/* Returns the next entry of the layout if it's for the given chunk or
+ * variable, else flags the mismatch. */
+static const SSLayoutEntry *NextEntry(const char *name,
+      uint32_t size, uint32_t flags)
+{
+   const SSLayoutEntry *e;
+   const uint8_t *hdr;
+
+   if(ss->mismatch || ss->cursor >= ss->layout.count)
+      goto mismatch;
+
+   e   = &ss->layout.entries[ss->cursor];
+   hdr = ss->layout.headers + e->header_off;
+
+   if(e->size != size || e->flags != flags)
+      goto mismatch;
+
+   if(size)
+   {
+      if(strlen(name) != hdr[0] || memcmp(hdr + 1, name, hdr[0]))
+         goto mismatch;
+   }
+   else if(strncmp((const char *)hdr, name, 32))
+      goto mismatch;
+
+   ss->cursor++;
+   return e;
+
+mismatch:
+   ss->mismatch = true;
+   return NULL;
+}
+
+/* Copies a variable into a state, in the state's format(bools as single
+ * bytes, everything little-endian). */
+static void StoreVar(uint8_t *dest, const SFORMAT *sf)
+{
+   if(sf->flags & MDFNSTATE_BOOL)
+   {
+      uint32_t i;
+
+      for(i = 0; i < sf->size; i++)
+         dest[i] = ((const bool *)sf->v)[i];
+      return;
+   }
+
+   memcpy(dest, sf->v, sf->size);
+
+#ifdef MSB_FIRST
+   if(sf->flags & MDFNSTATE_RLSB64)
+      Endian_A64_Swap(dest, sf->size / sizeof(uint64_t));
+   else if(sf->flags & MDFNSTATE_RLSB32)
+      Endian_A32_Swap(dest, sf->size / sizeof(uint32_t));
+   else if(sf->flags & MDFNSTATE_RLSB16)
+      Endian_A16_Swap(dest, sf->size / sizeof(uint16_t));
+   else if(sf->flags & RLSB)
+      FlipByteOrder(dest, sf->size);
+#endif
+}
+
+/* The reverse of StoreVar(). */
+static void LoadVar(const SFORMAT *sf, const uint8_t *src)
+{
+   if(sf->flags & MDFNSTATE_BOOL)
+   {
+      uint32_t i;
+
+      for(i = 0; i < sf->size; i++)
+         ((bool *)sf->v)[i] = src[i];
+      return;
+   }
+
+   memcpy(sf->v, src, sf->size);
+
+#ifdef MSB_FIRST
+   if(sf->flags & MDFNSTATE_RLSB64)
+      Endian_A64_LE_to_NE(sf->v, sf->size / sizeof(uint64_t));
+   else if(sf->flags & MDFNSTATE_RLSB32)
+      Endian_A32_LE_to_NE(sf->v, sf->size / sizeof(uint32_t));
+   else if(sf->flags & MDFNSTATE_RLSB16)
+      Endian_A16_LE_to_NE(sf->v, sf->size / sizeof(uint16_t));
+   else if(sf->flags & RLSB)
+      FlipByteOrder((uint8_t *)sf->v, sf->size);
+#endif
+}
+
+static bool FastSubWrite(StateMem *st, SFORMAT *sf)
+{
+   while(sf->size || sf->name)
+   {
+      const SSLayoutEntry *e;
+
+      if(!sf->size || !sf->v)
+      {
+         sf++;
+         continue;
+      }
+
+      if(sf->size == (uint32_t)~0)
+      {
+         if(!FastSubWrite(st, (SFORMAT *)sf->v))
+            return false;
+
+         sf++;
+         continue;
+      }
+
+      if(!(e = NextEntry(sf->name, sf->size, sf->flags)))
+         return false;
+
+      memcpy(st->data + e->pos, ss->layout.headers + e->header_off, e->header_len);
+      StoreVar(st->data + e->pos + e->header_len, sf);
+      st->loc = e->pos + e->header_len + sf->size;
+      sf++;
+   }
+
+   return true;
+}
+
+static bool FastSubRead(StateMem *st, SFORMAT *sf)
+{
+   while(sf->size || sf->name)
+   {
+      const SSLayoutEntry *e;
+
+      if(!sf->size || !sf->v)
+      {
+         sf++;
+         continue;
+      }
+
+      if(sf->size == (uint32_t)~0)
+      {
+         if(!FastSubRead(st, (SFORMAT *)sf->v))
+            return false;
+
+         sf++;
+         continue;
+      }
+
+      if(!(e = NextEntry(sf->name, sf->size, sf->flags)))
+         return false;
+
+      /* The state's own header must say it's this variable, too. */
+      if(memcmp(st->data + e->pos, ss->layout.headers + e->header_off, e->header_len))
+      {
+         ss->mismatch = true;
+         return false;
+      }
+
+      LoadVar(sf, st->data + e->pos + e->header_len);
+      sf++;
+   }
+
+   return true;
+}
+
 int32_t smem_read(StateMem *st, void *buffer, uint32_t len)
 {
    if ((len + st->loc) > st->len)
@@ -154,6 +440,8 @@ static bool SubWrite(StateMem *st, SFORMAT *sf, const char *name_prefix)
       if(slen >= 255)
          slen = 255;
 
+      RecordEntry(bytesize, sf->flags, st->loc, nameo, 1 + (uint8_t)nameo[0], bytesize);
+
       smem_write(st, nameo, 1 + nameo[0]);
       smem_write32le(st, bytesize);
 
@@ -216,10 +504,28 @@ static int WriteStateChunk(StateMem *st, const char *sname, SFORMAT *sf)
 
    uint8_t sname_tmp[32];
    size_t sname_len = strlen(sname);
+   uint32_t chunk;
+
+   if(ss->mode == SS_MODE_FAST_SAVE)
+   {
+      const SSLayoutEntry *e = NextEntry(sname, 0, 0);
+
+      if(!e)
+         return(0);
+
+      memcpy(st->data + e->pos, ss->layout.headers + e->header_off, e->header_len);
+
+      if(!FastSubWrite(st, sf))
+         return(0);
+
+      return(st->loc - (e->pos + e->header_len));
+   }
 
    memset(sname_tmp, 0, sizeof(sname_tmp));
    memcpy((char *)sname_tmp, sname, (sname_len < 32) ? sname_len : 32);
 
+   chunk = RecordEntry(0, 0, st->loc, sname_tmp, 32, 0);
+
    smem_write(st, sname_tmp, 32);
 
    /* We'll come back and write this later. */
@@ -236,6 +542,12 @@ static int WriteStateChunk(StateMem *st, const char *sname, SFORMAT *sf)
    smem_write32le(st, end_pos - data_start_pos);
    smem_seek(st, end_pos, SEEK_SET);
 
+   if(!ss->recording.failed)
+   {
+      const SSLayoutEntry *e = &ss->recording.entries[chunk];
+      MDFN_en32lsb(ss->recording.headers + e->header_off + 32, end_pos - data_start_pos);
+   }
+
    return(end_pos - data_start_pos);
 }
 
@@ -389,6 +701,18 @@ static int MDFNSS_StateAction_internal(void *st_p, int load,
       uint32_t tmp_size;
       uint32_t total = 0;
 
+      if(ss->mode == SS_MODE_FAST_LOAD && !ss->mismatch)
+      {
+         const SSLayoutEntry *e = NextEntry(section->name, 0, 0);
+
+         if(e && !memcmp(st->data + e->pos, ss->layout.headers + e->header_off, e->header_len)
+               && FastSubRead(st, section->sf))
+            return(1);
+
+         /* Look the rest up by name, starting with this section. */
+         ss->mismatch = true;
+      }
+
       while(smem_read(st, (uint8_t *)sname, 32) == 32)
       {
          if(smem_read32le(st, &tmp_size) != 4)
@@ -458,6 +782,11 @@ int MDFNSS_SaveSM(void *st_p, int a, int b, const void *c, const void *d, const
    MDFN_en32lsb(header + 28, neoheight);
    smem_write(st, header, 32);
 
+   ss->recording.count       = 0;
+   ss->recording.headers_len = 0;
+   ss->recording.failed      = false;
+   ss->layout.total          = 0;
+
    if(!StateAction(st, 0, 0))
       return(0);
 
@@ -465,6 +794,45 @@ int MDFNSS_SaveSM(void *st_p, int a, int b, const void *c, const void *d, const
    smem_seek(st, 16 + 4, SEEK_SET);
    smem_write32le(st, sizy);
 
+   if(!ss->recording.failed)
+   {
+      SSLayout tmp = ss->layout;
+
+      ss->layout       = ss->recording;
+      ss->layout.total = sizy;
+      ss->recording    = tmp;
+   }
+
+   return(1);
+}
+
+int MDFNSS_SaveSMFast(void *st_p)
+{
+   StateMem *st = (StateMem*)st_p;
+   int ret;
+
+   if(!ss->layout.total || st->malloced < ss->layout.total)
+      return(0);
+
+   memset(st->data, 0, 32);
+   memcpy(st->data, "MDFNSVST", 8);
+   MDFN_en32lsb(st->data + 16, MEDNAFEN_VERSION_NUMERIC);
+   MDFN_en32lsb(st->data + 20, ss->layout.total);
+
+   ss->mode     = SS_MODE_FAST_SAVE;
+   ss->cursor   = 0;
+   ss->mismatch = false;
+   st->loc     = 32;
+
+   ret = StateAction(st, 0, 0);
+
+   ss->mode = SS_MODE_SLOW;
+
+   if(!ret || ss->mismatch || ss->cursor != ss->layout.count || st->loc != ss->layout.total)
+      return(0);
+
+   st->len = st->loc;
+
    return(1);
 }
 
@@ -481,5 +849,20 @@ int MDFNSS_LoadSM(void *st_p, int a, int b)
 
    stateversion = MDFN_de32lsb(header + 16);
 
+   if(ss->layout.total && st->len >= ss->layout.total)
+   {
+      int ret;
+
+      ss->mode     = SS_MODE_FAST_LOAD;
+      ss->cursor   = 0;
+      ss->mismatch = false;
+
+      ret = StateAction(st, stateversion, 0);
+
+      ss->mode = SS_MODE_SLOW;
+
+      return ret;
+   }
+
    return StateAction(st, stateversion, 0);
 }
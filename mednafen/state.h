@@ -61,8 +61,21 @@ int smem_read32le(StateMem *st, uint32_t *b);
 int MDFNSS_SaveSM(void *st, int, int, const void*, const void*, const void*);
 int MDFNSS_LoadSM(void *st, int, int);
 
+// Writes a state straight into st->data, which has room for st->malloced bytes, reusing the layout of the last
+// state MDFNSS_SaveSM() wrote.  Returns 0, with st->data partly written, if there's no such layout or the
+// emulator's variables no longer match it; MDFNSS_SaveSM() must be used then.
+int MDFNSS_SaveSMFast(void *st);
+
 int MDFNSS_StateAction(void *st, int load, int data_only, SFORMAT *sf, const char *name, bool optional);
 
+// The layouts the functions above cache between calls belong to the selected context, one per machine; a context must
+// be selected before any of them is called.
+typedef struct MDFNSS_Context MDFNSS_Context;
+
+MDFNSS_Context *MDFNSS_NewContext(void);
+void MDFNSS_DeleteContext(MDFNSS_Context *ctx);
+void MDFNSS_SetContext(MDFNSS_Context *ctx);
+
 #ifdef __cplusplus
 }
 #endif
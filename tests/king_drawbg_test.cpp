@@ -0,0 +1,159 @@
+/* Checks the SSE2 versions of the KING BG tile row kernels(DRAWBG8x1_* in mednafen/pcfx/king-drawbg.inc) against the
+ * plain versions, for every BG mode, over random CG words(biased toward transparent pixels), palettes, palette offsets,
+ * layer bits and background pixels.  Then again with only some of the CG words fetched(see BGPartialCG()), against the
+ * plain versions given the unfetched words as 0.  Built and run by "make test".
+ *
+ *  king_drawbg_test [cases per mode(default 1000000)] [seed(default 1)]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mednafen/mednafen.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The same kernels twice, once as built into the core and once with the SSE2 paths compiled out.
+namespace native_bg
+{
+#include "mednafen/pcfx/king-drawbg.inc"
+
+#ifdef __SSE2__
+ static const bool uses_sse2 = true;
+#else
+ static const bool uses_sse2 = false;
+#endif
+}
+
+#undef __SSE2__
+
+namespace plain_bg
+{
+#include "mednafen/pcfx/king-drawbg.inc"
+}
+
+static uint32 rng_state;
+
+static uint32 rng(void)
+{
+ rng_state ^= rng_state << 13;
+ rng_state ^= rng_state >> 17;
+ rng_state ^= rng_state << 5;
+
+ return(rng_state);
+}
+
+typedef void (*drawbg_func)(uint32 *target, const uint16 *cg, const uint32 *palette_ptr, const uint32 layer_or);
+
+struct bg_mode
+{
+ const char *name;
+ drawbg_func native;
+ drawbg_func plain;
+ unsigned cg_words;
+ unsigned palette_bank_shift;	// The palette offset for the BAT palette bank, or 0 if the mode doesn't use one.
+ uint16 pixel_mask;		// Bits of one pixel in a CG word, to clear at random for transparent pixels.
+ unsigned pixel_bits;
+};
+
+static const bg_mode modes[] =
+{
+ { "4",   native_bg::DRAWBG8x1_4,   plain_bg::DRAWBG8x1_4,   1, 2, 0x0003, 2 },
+ { "16",  native_bg::DRAWBG8x1_16,  plain_bg::DRAWBG8x1_16,  2, 4, 0x000F, 4 },
+ { "256", native_bg::DRAWBG8x1_256, plain_bg::DRAWBG8x1_256, 4, 0, 0x00FF, 8 },
+ { "64K", native_bg::DRAWBG8x1_64K, plain_bg::DRAWBG8x1_64K, 8, 0, 0xFF00, 16 },
+ { "16M", native_bg::DRAWBG8x1_16M, plain_bg::DRAWBG8x1_16M, 8, 0, 0x00FF, 8 },
+};
+
+// Runs cases random cases of one mode, with all of its CG words fetched or, if partial, a random number fewer; returns
+// the number of mismatches.
+static unsigned long test_mode(const bg_mode *mode, const bool partial, const unsigned long cases, const uint32 seed)
+{
+ unsigned long mismatches = 0;
+ uint32 palette[256];
+ uint16 cg[8];
+ uint32 native_target[8 + 2], plain_target[8 + 2];	// With a guard pixel at each end.
+
+ rng_state = seed ? seed : 1;
+
+ for(unsigned long i = 0; i < cases; i++)
+ {
+  if(!(i & 1023))
+  {
+   for(unsigned j = 0; j < 256; j++)
+    palette[j] = rng();
+  }
+
+  for(unsigned j = 0; j < mode->cg_words; j++)
+  {
+   cg[j] = rng();
+
+   // Make about a third of the pixels transparent.
+   for(unsigned shift = 0; shift < 16; shift += mode->pixel_bits)
+   {
+    if(!(rng() % 3))
+     cg[j] &= ~(mode->pixel_mask << (mode->pixel_bits == 16 ? 0 : shift));
+   }
+  }
+
+  const unsigned cg_count = partial ? (rng() % mode->cg_words) : mode->cg_words;
+  const uint32 *palette_ptr = palette + (mode->palette_bank_shift ? ((rng() & 0xF) << mode->palette_bank_shift) : 0);
+  const uint32 layer_or = (rng() & 1) ? (rng() & 0xFF000000) : rng();
+  uint16 native_buf[8], plain_cg[8];
+
+  for(unsigned j = 0; j < mode->cg_words; j++)
+   plain_cg[j] = (j < cg_count) ? cg[j] : 0;
+
+  for(unsigned j = 0; j < 8 + 2; j++)
+   native_target[j] = plain_target[j] = rng();
+
+  mode->native(native_target + 1, native_bg::BGPartialCG(native_buf, cg, cg_count, mode->cg_words), palette_ptr, layer_or);
+  mode->plain(plain_target + 1, plain_cg, palette_ptr, layer_or);
+
+  if(memcmp(native_target, plain_target, sizeof(native_target)))
+  {
+   if(mismatches < 10)
+   {
+    printf("%s: cg", mode->name);
+    for(unsigned j = 0; j < mode->cg_words; j++)
+     printf(" %04x", cg[j]);
+    printf(", %u fetched, layer_or %08x:\n  native", cg_count, layer_or);
+    for(unsigned j = 0; j < 8 + 2; j++)
+     printf(" %08x", native_target[j]);
+    printf("\n  plain ");
+    for(unsigned j = 0; j < 8 + 2; j++)
+     printf(" %08x", plain_target[j]);
+    printf("\n");
+   }
+   mismatches++;
+  }
+ }
+
+ return(mismatches);
+}
+
+int main(int argc, char *argv[])
+{
+ const unsigned long cases = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+ const uint32 seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+ unsigned long total_mismatches = 0;
+
+ if(!native_bg::uses_sse2)
+  printf("SSE2 isn't enabled for this build; both sides use the plain kernels.\n");
+
+ for(unsigned partial = 0; partial < 2; partial++)
+ {
+  for(unsigned m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+  {
+   const unsigned long mismatches = test_mode(&modes[m], partial, cases, seed);
+
+   printf("%-4s  %s%lu cases, %lu mismatches\n", modes[m].name, partial ? "partial CG, " : "", cases, mismatches);
+   total_mismatches += mismatches;
+  }
+ }
+
+ return(total_mismatches ? 1 : 0);
+}
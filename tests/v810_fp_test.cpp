@@ -0,0 +1,203 @@
+/* Differential test of the V810 floating point operations: the host FPU paths(V810_FP_HOST, see v810_fp_ops.h) are
+ * checked against the software model alone(V810_FP_SOFT_ONLY) for add, sub, mul, div and itof, comparing both the
+ * results and the exception flags.  Operands are random, biased toward the exponents at the edges of the normal range
+ * and toward operand pairs whose results land there.  Built and run by "make test".
+ *
+ *  v810_fp_test [cases per operation(default 1000000)] [seed(default 1)]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mednafen/mednafen.h"
+#include <float.h>
+#include <algorithm>
+
+// The same source twice, once as built into the core and once with the host paths compiled out.
+namespace host_fp
+{
+#include "mednafen/hw_cpu/v810/v810_fp_ops.cpp"
+
+#ifdef V810_FP_HOST
+ static const bool uses_host = true;
+#else
+ static const bool uses_host = false;
+#endif
+}
+
+#undef V810_FP_HOST
+#define V810_FP_SOFT_ONLY 1
+
+namespace soft_fp
+{
+#include "mednafen/hw_cpu/v810/v810_fp_ops.cpp"
+}
+
+static uint32 rng_state;
+
+static uint32 rng(void)
+{
+ rng_state ^= rng_state << 13;
+ rng_state ^= rng_state >> 17;
+ rng_state ^= rng_state << 5;
+
+ return(rng_state);
+}
+
+static const uint8 edge_exponents[] = { 0x00, 0x01, 0x02, 0x03, 0x17, 0x18, 0x7E, 0x7F, 0x80, 0x96, 0x97, 0xFC, 0xFD, 0xFE, 0xFF };
+
+static uint32 random_mantissa(void)
+{
+ switch(rng() & 7)
+ {
+  case 0: return(0);
+  case 1: return(0x7FFFFF);
+  case 2: return(rng() & 0xF);
+  case 3: return(0x7FFFFF - (rng() & 0xF));
+ }
+
+ return(rng() & 0x7FFFFF);
+}
+
+static uint32 make_float(uint32 sign, int exp, uint32 mantissa)
+{
+ return((sign << 31) | ((uint32)std::min(std::max(exp, 0), 0xFF) << 23) | mantissa);
+}
+
+static uint32 random_float(void)
+{
+ const uint32 sign = rng() & 1;
+ int exp;
+
+ if(rng() & 1)
+  exp = edge_exponents[rng() % sizeof(edge_exponents)];
+ else
+  exp = rng() & 0xFF;
+
+ return(make_float(sign, exp, random_mantissa()));
+}
+
+// Exponent of a result that's near the bottom or the top of the normal range.
+static int random_edge_result_exp(void)
+{
+ return((rng() & 1) ? (int)(rng() % 5) - 1 : 0xFE + (int)(rng() % 5) - 2);
+}
+
+enum { OP_ADD = 0, OP_SUB, OP_MUL, OP_DIV, OP_ITOF, OP__COUNT };
+
+static const char *const op_names[OP__COUNT] = { "add", "sub", "mul", "div", "itof" };
+
+// Picks operands for op; about half of the pairs are chosen so that the result lands near an edge of the normal range.
+static void random_operands(unsigned op, uint32 *a, uint32 *b)
+{
+ *a = random_float();
+ *b = random_float();
+
+ if(op == OP_ITOF)
+ {
+  // Integers of every magnitude, so that rounding happens at every position.
+  *a = rng() >> (rng() & 31);
+
+  if(rng() & 1)
+   *a = -*a;
+
+  if(!(rng() & 63))
+   *a = 0x80000000;
+  return;
+ }
+
+ if(rng() & 1)
+  return;
+
+ const int ea = (*a >> 23) & 0xFF;
+ const int target = random_edge_result_exp();
+
+ switch(op)
+ {
+  case OP_ADD:
+  case OP_SUB:
+	// Close exponents, for cancellation down to the bottom of the range, and carries off the top.
+	if(rng() & 1)
+	 *b = make_float(rng() & 1, ea + (int)(rng() % 3) - 1, random_mantissa());
+	else
+	{
+	 *a = make_float(rng() & 1, target, random_mantissa());
+	 *b = make_float(rng() & 1, target + (int)(rng() % 3) - 1, random_mantissa());
+	}
+	break;
+
+  case OP_MUL:
+	*b = make_float(rng() & 1, target - ea + 127, random_mantissa());
+	break;
+
+  case OP_DIV:
+	*b = make_float(rng() & 1, ea - target + 127, random_mantissa());
+	break;
+ }
+}
+
+template<typename T>
+static uint32 run_op(T *fp, unsigned op, uint32 a, uint32 b, uint32 *flags)
+{
+ uint32 ret = 0;
+
+ fp->clear_flags();
+
+ switch(op)
+ {
+  case OP_ADD: ret = fp->add(a, b); break;
+  case OP_SUB: ret = fp->sub(a, b); break;
+  case OP_MUL: ret = fp->mul(a, b); break;
+  case OP_DIV: ret = fp->div(a, b); break;
+  case OP_ITOF: ret = fp->itof(a); break;
+ }
+
+ *flags = fp->get_flags();
+
+ return(ret);
+}
+
+int main(int argc, char *argv[])
+{
+ const unsigned long cases = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+ const uint32 seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+ host_fp::V810_FP_Ops host;
+ soft_fp::V810_FP_Ops soft;
+ unsigned long total_mismatches = 0;
+
+ if(!host_fp::uses_host)
+  printf("V810_FP_HOST isn't enabled for this build; both sides use the software model.\n");
+
+ for(unsigned op = 0; op < OP__COUNT; op++)
+ {
+  unsigned long mismatches = 0;
+
+  rng_state = seed ? seed : 1;
+
+  for(unsigned long i = 0; i < cases; i++)
+  {
+   uint32 a, b;
+   uint32 host_flags, soft_flags;
+
+   random_operands(op, &a, &b);
+
+   const uint32 host_ret = run_op(&host, op, a, b, &host_flags);
+   const uint32 soft_ret = run_op(&soft, op, a, b, &soft_flags);
+
+   if(host_ret != soft_ret || host_flags != soft_flags)
+   {
+    if(mismatches < 10)
+    {
+     printf("%s(0x%08x, 0x%08x): host 0x%08x flags 0x%02x, software 0x%08x flags 0x%02x\n", op_names[op], a, b,
+	host_ret, host_flags, soft_ret, soft_flags);
+    }
+    mismatches++;
+   }
+  }
+
+  printf("%-4s  %lu cases, %lu mismatches\n", op_names[op], cases, mismatches);
+  total_mismatches += mismatches;
+ }
+
+ return(total_mismatches ? 1 : 0);
+}